@@ -0,0 +1,314 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// read a memory-mapped pack of scene assets and write new packs
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+#include "TagHash.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// PACK_HEADER struct starts the pack file, the pack is read in
+	// place so all of the fields are little-endian
+	struct PACK_HEADER
+	{
+		char magic[4];           // "SPAK"
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t tableOffset;    // offset of the entry table
+	};
+
+	const char PACK_MAGIC[4] = { 'S', 'P', 'A', 'K' };
+	// version 2 added the transparency of the scene materials
+	const uint32_t PACK_VERSION = 2;
+
+	static_assert(sizeof(PACK_HEADER) == 24, "the pack header layout is part of the file format");
+	static_assert(sizeof(AssetPack::PACK_ENTRY) == 72, "the pack entry layout is part of the file format");
+
+	/***********************************************************
+	 *  AlignOffset()
+	 *
+	 *  This function is used for rounding a file offset up to
+	 *  the passed in alignment.
+	 ***********************************************************/
+	uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+	{
+		return((offset + alignment - 1) / alignment * alignment);
+	}
+}
+
+/***********************************************************
+ *  AssetPack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPack::AssetPack()
+{
+	m_pData = NULL;
+	m_size = 0;
+	m_pEntries = NULL;
+	m_entryCount = 0;
+#ifdef _WIN32
+	m_hFile = NULL;
+	m_hMapping = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~AssetPack()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a pack file into memory
+ *  and validating its header and offset table.  Nothing is
+ *  read here - the pages are brought in when a payload is
+ *  first touched.
+ ***********************************************************/
+bool AssetPack::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	HANDLE hMapping = NULL;
+	if (GetFileSizeEx(hFile, &fileSize) && (fileSize.QuadPart > 0))
+	{
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (hMapping == NULL)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_pData = (const unsigned char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == NULL)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileInfo;
+	void* mapped = MAP_FAILED;
+	if ((fstat(file, &fileInfo) == 0) && (fileInfo.st_size > 0))
+	{
+		mapped = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	// the mapping keeps the file open
+	close(file);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+
+	// the whole pack is read during startup, so start reading ahead
+	madvise(mapped, (size_t)fileInfo.st_size, MADV_WILLNEED);
+	m_pData = (const unsigned char*)mapped;
+	m_size = (size_t)fileInfo.st_size;
+#endif
+
+	// validate the header and the offset table before trusting them
+	const PACK_HEADER* pHeader = (const PACK_HEADER*)m_pData;
+	if ((m_size < sizeof(PACK_HEADER)) ||
+		(memcmp(pHeader->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) ||
+		(pHeader->version != PACK_VERSION) ||
+		(pHeader->tableOffset > m_size) ||
+		((m_size - pHeader->tableOffset) / sizeof(PACK_ENTRY) < pHeader->entryCount))
+	{
+		std::cout << "Invalid asset pack:" << filename << std::endl;
+		Close();
+		return false;
+	}
+
+	m_pEntries = (const PACK_ENTRY*)(m_pData + pHeader->tableOffset);
+	m_entryCount = pHeader->entryCount;
+	for (uint32_t i = 0; i < m_entryCount; i++)
+	{
+		if ((m_pEntries[i].offset > m_size) || (m_pEntries[i].size > m_size - m_pEntries[i].offset))
+		{
+			std::cout << "Invalid asset pack entry:" << filename << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the pack file.  Any
+ *  payload pointers taken from the pack become invalid.
+ ***********************************************************/
+void AssetPack::Close()
+{
+	if (m_pData != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pData);
+		CloseHandle((HANDLE)m_hMapping);
+		CloseHandle((HANDLE)m_hFile);
+		m_hMapping = NULL;
+		m_hFile = NULL;
+#else
+		munmap((void*)m_pData, m_size);
+#endif
+	}
+
+	m_pData = NULL;
+	m_size = 0;
+	m_pEntries = NULL;
+	m_entryCount = 0;
+}
+
+/***********************************************************
+ *  FindEntry()
+ *
+ *  This method is used for finding the entry of the passed in
+ *  type and name in the offset table.
+ ***********************************************************/
+const AssetPack::PACK_ENTRY* AssetPack::FindEntry(EntryType type, const char* name) const
+{
+	uint32_t nameHash = HashTag(name);
+
+	for (uint32_t i = 0; i < m_entryCount; i++)
+	{
+		const PACK_ENTRY& entry = m_pEntries[i];
+		if ((entry.nameHash == nameHash) &&
+			(entry.type == (uint32_t)type) &&
+			(strncmp(entry.name, name, MAX_NAME_LENGTH) == 0))
+		{
+			return(&entry);
+		}
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing a pack file.  The header
+ *  comes first, then the aligned payloads, and the offset
+ *  table last, once all of the payload offsets are known.
+ ***********************************************************/
+bool AssetPack::Write(const char* filename, const std::vector<PACK_SOURCE>& sources)
+{
+	std::vector<PACK_ENTRY> entries(sources.size());
+	uint64_t offset = AlignOffset(sizeof(PACK_HEADER), PAYLOAD_ALIGNMENT);
+
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (sources[i].name.size() >= MAX_NAME_LENGTH)
+		{
+			std::cout << "Asset name is too long for the pack:" << sources[i].name << std::endl;
+			return false;
+		}
+
+		PACK_ENTRY& entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		entry.nameHash = HashTag(sources[i].name.c_str());
+		entry.type = (uint32_t)sources[i].type;
+		entry.offset = offset;
+		entry.size = sources[i].data.size();
+		memcpy(entry.name, sources[i].name.c_str(), sources[i].name.size());
+
+		offset = AlignOffset(offset + entry.size, PAYLOAD_ALIGNMENT);
+	}
+
+	PACK_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.tableOffset = offset;
+
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL)
+	{
+		std::cout << "Could not create asset pack:" << filename << std::endl;
+		return false;
+	}
+
+	// zero padding written between the payloads
+	const unsigned char padding[PAYLOAD_ALIGNMENT] = { 0 };
+	uint64_t written = 0;
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, file) == 1);
+	written += sizeof(header);
+
+	for (size_t i = 0; bSuccess && (i < sources.size()); i++)
+	{
+		bSuccess = (fwrite(padding, 1, (size_t)(entries[i].offset - written), file) == entries[i].offset - written);
+		written = entries[i].offset;
+
+		if (bSuccess && (entries[i].size > 0))
+		{
+			bSuccess = (fwrite(sources[i].data.data(), 1, sources[i].data.size(), file) == sources[i].data.size());
+		}
+		written += entries[i].size;
+	}
+
+	if (bSuccess)
+	{
+		bSuccess = (fwrite(padding, 1, (size_t)(header.tableOffset - written), file) == header.tableOffset - written);
+	}
+	if (bSuccess && (entries.size() > 0))
+	{
+		bSuccess = (fwrite(entries.data(), sizeof(PACK_ENTRY), entries.size(), file) == entries.size());
+	}
+	fclose(file);
+
+	if (!bSuccess)
+	{
+		std::cout << "Could not write asset pack:" << filename << std::endl;
+	}
+
+	return(bSuccess);
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// read a memory-mapped pack of scene assets and write new packs
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class maps a packed binary asset file into memory and
+ *  finds its entries through the offset table.  The file
+ *  starts with a header pointing at the table, and every
+ *  entry names a typed payload in the file.  Payloads are
+ *  used in place, so reading an asset is a pointer into the
+ *  mapped file instead of a seek and a copy per file.
+ ***********************************************************/
+class AssetPack
+{
+public:
+	// constructor
+	AssetPack();
+	// destructor
+	~AssetPack();
+
+	// EntryType enum identifies what a payload holds
+	enum class EntryType : uint32_t { Objects = 1, Materials = 2, Lights = 3, Texture = 4 };
+
+	// longest entry name, including the terminator
+	static const int MAX_NAME_LENGTH = 48;
+	// payloads start on this alignment inside the file
+	static const int PAYLOAD_ALIGNMENT = 16;
+
+	// PACK_ENTRY struct is one row of the offset table
+	struct PACK_ENTRY
+	{
+		uint32_t nameHash;       // hashed name, for the lookups
+		uint32_t type;           // EntryType of the payload
+		uint64_t offset;         // payload offset from the start of the file
+		uint64_t size;           // payload size in bytes
+		char name[MAX_NAME_LENGTH];
+	};
+
+	// map a pack file, returns false if it is missing or invalid
+	bool Open(const char* filename);
+	// unmap the pack file
+	void Close();
+	// true while a pack file is mapped
+	bool IsOpen() const { return(m_pData != NULL); }
+
+	// get the number of entries in the offset table
+	int GetEntryCount() const { return((int)m_entryCount); }
+	// get an entry of the offset table
+	const PACK_ENTRY& GetEntry(int index) const { return(m_pEntries[index]); }
+	// find an entry by type and name, NULL if there is none
+	const PACK_ENTRY* FindEntry(EntryType type, const char* name) const;
+	// get the mapped payload of an entry
+	const unsigned char* GetPayload(const PACK_ENTRY& entry) const { return(m_pData + entry.offset); }
+
+	// PACK_SOURCE struct is a payload waiting to be written
+	struct PACK_SOURCE
+	{
+		EntryType type;
+		std::string name;
+		std::vector<unsigned char> data;
+	};
+
+	// write a new pack file from the passed in payloads
+	static bool Write(const char* filename, const std::vector<PACK_SOURCE>& sources);
+
+private:
+	// start of the mapped file
+	const unsigned char* m_pData;
+	// size of the mapped file
+	size_t m_size;
+	// offset table inside the mapped file
+	const PACK_ENTRY* m_pEntries;
+	// number of entries in the offset table
+	uint32_t m_entryCount;
+
+#ifdef _WIN32
+	// file and mapping handles, kept as void* to keep
+	// <windows.h> out of the header
+	void* m_hFile;
+	void* m_hMapping;
+#endif
+};
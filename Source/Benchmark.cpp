@@ -0,0 +1,723 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// render a fixed number of offscreen frames and report their timings
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "BoundingVolumeHierarchy.h"
+#include "FrustumCuller.h"
+#include "GpuMemory.h"
+#include "TransformBatch.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// default number of measured and warmup frames
+	const int DEFAULT_FRAME_COUNT = 600;
+	const int DEFAULT_WARMUP_FRAMES = 60;
+
+	// generated orbit used when no camera path is passed in,
+	// it circles the table while looking at its center
+	const glm::vec3 ORBIT_CENTER = glm::vec3(0.0f, 1.5f, 0.0f);
+	const float ORBIT_RADIUS = 14.0f;
+	const float ORBIT_HEIGHT = 5.0f;
+
+	// the transform microbenchmark keeps the fastest of its runs
+	const int TRANSFORM_RUNS = 20;
+
+	// the hierarchy microbenchmark keeps the fastest of its runs,
+	// and each churn or refit run changes one in this many boxes
+	const int HIERARCHY_RUNS = 10;
+	const int HIERARCHY_CHANGE_RATIO = 100;
+
+	/***********************************************************
+	 *  WriteJsonString()
+	 *
+	 *  This function is used for writing a quoted and escaped
+	 *  JSON string.
+	 ***********************************************************/
+	void WriteJsonString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if ((*c == '"') || (*c == '\\'))
+			{
+				fputc('\\', file);
+				fputc(*c, file);
+			}
+			else if ((unsigned char)*c < 0x20)
+			{
+				fprintf(file, "\\u%04x", (unsigned char)*c);
+			}
+			else
+			{
+				fputc(*c, file);
+			}
+		}
+		fputc('"', file);
+	}
+
+	/***********************************************************
+	 *  ComposeMatrixChain()
+	 *
+	 *  This function is used for building a model matrix the way
+	 *  the scene did before the batched transforms, from a
+	 *  separate matrix for each part of the transform.
+	 ***********************************************************/
+	glm::mat4 ComposeMatrixChain(const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& position)
+	{
+		glm::mat4 rotationX = glm::rotate(glm::radians(rotationDeg.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(rotationDeg.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(rotationDeg.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+		return(glm::translate(position) * rotationZ * rotationY * rotationX * glm::scale(scale));
+	}
+
+	/***********************************************************
+	 *  Percentile()
+	 *
+	 *  This function is used for getting a percentile between
+	 *  0 and 100 of sorted times.
+	 ***********************************************************/
+	float Percentile(const std::vector<float>& sorted, float percentile)
+	{
+		size_t rank = (size_t)(percentile / 100.0f * (float)(sorted.size() - 1) + 0.5f);
+		return(sorted[std::min(rank, sorted.size() - 1)]);
+	}
+}
+
+/***********************************************************
+ *  ParseOptions()
+ *
+ *  This method is used for reading the benchmark settings
+ *  from the command line:
+ *
+ *      --benchmark [--frames N] [--warmup N] [--boxes N]
+ *                  [--lights N] [--transforms N] [--bvh N]
+ *                  [--prepass]
+ *                  [--camera-path file] [--json file]
+ *
+ *  Returns false when --benchmark is not on the command line.
+ ***********************************************************/
+bool Benchmark::ParseOptions(int argc, char* argv[], OPTIONS& options)
+{
+	options.frameCount = DEFAULT_FRAME_COUNT;
+	options.warmupFrames = DEFAULT_WARMUP_FRAMES;
+	options.boxCount = 0;
+	options.lightCount = 0;
+	options.transformCount = 0;
+	options.hierarchyCount = 0;
+	options.bDepthPrepass = false;
+	options.jsonFile.clear();
+	options.cameraPathFile.clear();
+
+	bool bEnabled = false;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			bEnabled = true;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--frames") == 0))
+		{
+			options.frameCount = std::max(atoi(value), 1);
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--warmup") == 0))
+		{
+			options.warmupFrames = std::max(atoi(value), 0);
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--boxes") == 0))
+		{
+			options.boxCount = std::max(atoi(value), 0);
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--lights") == 0))
+		{
+			options.lightCount = std::max(atoi(value), 0);
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--transforms") == 0))
+		{
+			options.transformCount = std::max(atoi(value), 0);
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--bvh") == 0))
+		{
+			options.hierarchyCount = std::max(atoi(value), 0);
+			i++;
+		}
+		else if (strcmp(argv[i], "--prepass") == 0)
+		{
+			options.bDepthPrepass = true;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--camera-path") == 0))
+		{
+			options.cameraPathFile = value;
+			i++;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--json") == 0))
+		{
+			options.jsonFile = value;
+			i++;
+		}
+	}
+
+	return(bEnabled);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Benchmark::Benchmark(const OPTIONS& options)
+{
+	m_options = options;
+	memset(&m_counters, 0, sizeof(m_counters));
+	m_bGpuTimes = false;
+	m_culledObjects = 0;
+	m_fenceStalls = 0;
+	memset(&m_transformTimes, 0, sizeof(m_transformTimes));
+	memset(&m_hierarchyTimes, 0, sizeof(m_hierarchyTimes));
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+}
+
+/***********************************************************
+ *  ~Benchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Benchmark::~Benchmark()
+{
+	DestroyFramebuffer();
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating the offscreen framebuffer
+ *  the benchmark renders into.  A hidden window may not own
+ *  the pixels of its default framebuffer, so rendering into
+ *  it could be skipped by the driver.
+ ***********************************************************/
+bool Benchmark::CreateFramebuffer(int width, int height)
+{
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	GpuMemory::Track(GpuMemory::OBJECT_RENDERBUFFER, m_colorBuffer, GpuMemory::MEMORY_TARGETS, (size_t)width * height * 4);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_RENDERBUFFER, m_depthBuffer, GpuMemory::MEMORY_TARGETS, (size_t)width * height * 4);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Offscreen framebuffer is incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		DestroyFramebuffer();
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyFramebuffer()
+ *
+ *  This method is used for freeing the offscreen framebuffer.
+ ***********************************************************/
+void Benchmark::DestroyFramebuffer()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_RENDERBUFFER, m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_RENDERBUFFER, m_depthBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  MeasureTransforms()
+ *
+ *  This method is used for timing the composition of the
+ *  model matrices of generated transforms.  The matrix chain
+ *  builds and multiplies a matrix per part of each transform,
+ *  the batch writes all of them out four at a time, and a
+ *  batch update with no changed transform only tests the
+ *  marks.  Every time is the fastest of several runs.
+ ***********************************************************/
+void Benchmark::MeasureTransforms()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int count = m_options.transformCount;
+	std::vector<glm::vec3> scales(count);
+	std::vector<glm::vec3> rotations(count);
+	std::vector<glm::vec3> positions(count);
+	for (int i = 0; i < count; i++)
+	{
+		scales[i] = glm::vec3(0.5f + (float)(i % 7) * 0.25f, 1.0f, 0.5f + (float)(i % 5) * 0.5f);
+		rotations[i] = glm::vec3((float)((i * 13) % 360), (float)((i * 37) % 360), (float)((i * 71) % 360));
+		positions[i] = glm::vec3((float)(i % 100), (float)(i % 10), (float)(i / 100));
+	}
+
+	std::vector<glm::mat4> chainMatrices(count);
+	TransformBatch batch;
+	for (int i = 0; i < count; i++)
+	{
+		batch.SetTransform(i, scales[i], rotations[i], positions[i]);
+	}
+
+	double chainTime = 1.0e9;
+	double batchTime = 1.0e9;
+	double unchangedTime = 1.0e9;
+	for (int run = 0; run < TRANSFORM_RUNS; run++)
+	{
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			chainMatrices[i] = ComposeMatrixChain(scales[i], rotations[i], positions[i]);
+		}
+		Clock::time_point chainEnd = Clock::now();
+
+		batch.MarkAll();
+		Clock::time_point batchStart = Clock::now();
+		batch.Update();
+		Clock::time_point batchEnd = Clock::now();
+		batch.Update();
+		Clock::time_point unchangedEnd = Clock::now();
+
+		chainTime = std::min(chainTime, std::chrono::duration<double, std::milli>(chainEnd - start).count());
+		batchTime = std::min(batchTime, std::chrono::duration<double, std::milli>(batchEnd - batchStart).count());
+		unchangedTime = std::min(unchangedTime, std::chrono::duration<double, std::milli>(unchangedEnd - batchEnd).count());
+	}
+
+	// the results are compared, which also keeps the matrix chain
+	// from being optimized away
+	float maxError = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		const glm::mat4& model = batch.GetMatrix(i);
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				maxError = std::max(maxError, fabsf(model[column][row] - chainMatrices[i][column][row]));
+			}
+		}
+	}
+
+	m_transformTimes.matrixChainTime = (float)chainTime;
+	m_transformTimes.batchTime = (float)batchTime;
+	m_transformTimes.unchangedTime = (float)unchangedTime;
+	m_transformTimes.maxError = maxError;
+}
+
+/***********************************************************
+ *  MeasureHierarchy()
+ *
+ *  This method is used for timing the bounding volume
+ *  hierarchy over generated boxes scattered through a cube.
+ *  The build adds every box to an empty tree, the churn
+ *  removes some of the boxes and adds them back so they are
+ *  inserted in place, and the refit moves them.  The frustum
+ *  query is checked against the frustum culler testing every
+ *  box.  Every time is the fastest of several runs.
+ ***********************************************************/
+void Benchmark::MeasureHierarchy()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int count = m_options.hierarchyCount;
+	const float side = 4.0f * cbrtf((float)count);
+	std::vector<glm::vec3> centers(count);
+	std::vector<glm::vec3> extents(count);
+	for (int i = 0; i < count; i++)
+	{
+		centers[i] = glm::vec3(
+			side * (float)(((unsigned int)i * 7919u) % 10007u) / 10007.0f,
+			side * (float)(((unsigned int)i * 104729u) % 10009u) / 10009.0f,
+			side * (float)(((unsigned int)i * 1299709u) % 10037u) / 10037.0f);
+		extents[i] = glm::vec3(0.25f + (float)(i % 5) * 0.25f, 0.25f + (float)(i % 3) * 0.5f, 0.25f + (float)(i % 7) * 0.125f);
+	}
+
+	// the camera stands outside a corner of the cube and looks
+	// at its center
+	const glm::vec3 target = glm::vec3(side * 0.5f);
+	const glm::vec3 eye = glm::vec3(-side * 0.25f, side * 0.75f, -side * 0.25f);
+	FrustumCuller culler;
+	culler.SetViewProjection(
+		glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, side * 4.0f) *
+		glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+	culler.SetBoundsCount(count);
+	for (int i = 0; i < count; i++)
+	{
+		culler.SetBounds(i, centers[i], extents[i]);
+	}
+	std::vector<unsigned char> visible;
+	m_hierarchyTimes.bruteForceVisible = culler.Cull(visible);
+
+	BoundingVolumeHierarchy hierarchy;
+	std::vector<int> ids;
+	ids.reserve(count);
+	float hitDistance = 0.0f;
+
+	double buildTime = 1.0e9;
+	double frustumTime = 1.0e9;
+	double churnTime = 1.0e9;
+	double refitTime = 1.0e9;
+	double raycastTime = 1.0e9;
+	for (int run = 0; run < HIERARCHY_RUNS; run++)
+	{
+		hierarchy.Clear();
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			hierarchy.SetObjectBounds(i, centers[i], extents[i]);
+		}
+		hierarchy.Update();
+		Clock::time_point buildEnd = Clock::now();
+
+		hierarchy.QueryFrustum(culler.GetPlanes(), ids);
+		Clock::time_point frustumEnd = Clock::now();
+
+		for (int i = run % HIERARCHY_CHANGE_RATIO; i < count; i += HIERARCHY_CHANGE_RATIO)
+		{
+			hierarchy.RemoveObject(i);
+		}
+		for (int i = run % HIERARCHY_CHANGE_RATIO; i < count; i += HIERARCHY_CHANGE_RATIO)
+		{
+			hierarchy.SetObjectBounds(i, centers[i], extents[i]);
+		}
+		hierarchy.Update();
+		Clock::time_point churnEnd = Clock::now();
+
+		const glm::vec3 offset = glm::vec3(1.0f, 0.0f, 0.5f);
+		for (int i = run % HIERARCHY_CHANGE_RATIO; i < count; i += HIERARCHY_CHANGE_RATIO)
+		{
+			hierarchy.SetObjectBounds(i, centers[i] + offset, extents[i]);
+		}
+		hierarchy.Update();
+		Clock::time_point refitEnd = Clock::now();
+
+		hierarchy.Raycast(eye, glm::normalize(target - eye), side * 4.0f, hitDistance);
+		Clock::time_point raycastEnd = Clock::now();
+
+		buildTime = std::min(buildTime, std::chrono::duration<double, std::milli>(buildEnd - start).count());
+		frustumTime = std::min(frustumTime, std::chrono::duration<double, std::milli>(frustumEnd - buildEnd).count());
+		churnTime = std::min(churnTime, std::chrono::duration<double, std::milli>(churnEnd - frustumEnd).count());
+		refitTime = std::min(refitTime, std::chrono::duration<double, std::milli>(refitEnd - churnEnd).count());
+		raycastTime = std::min(raycastTime, std::chrono::duration<double, std::milli>(raycastEnd - refitEnd).count());
+	}
+
+	// the query of the built tree is what the frustum culler
+	// is compared against, so a difference means missed boxes
+	hierarchy.Clear();
+	for (int i = 0; i < count; i++)
+	{
+		hierarchy.SetObjectBounds(i, centers[i], extents[i]);
+	}
+	hierarchy.QueryFrustum(culler.GetPlanes(), ids);
+	if ((int)ids.size() != m_hierarchyTimes.bruteForceVisible)
+	{
+		std::cout << "WARNING: hierarchy found " << ids.size() << " of the "
+			<< m_hierarchyTimes.bruteForceVisible << " boxes in the frustum" << std::endl;
+	}
+
+	m_hierarchyTimes.buildTime = (float)buildTime;
+	m_hierarchyTimes.frustumTime = (float)frustumTime;
+	m_hierarchyTimes.churnTime = (float)churnTime;
+	m_hierarchyTimes.refitTime = (float)refitTime;
+	m_hierarchyTimes.raycastTime = (float)raycastTime;
+	m_hierarchyTimes.visible = (int)ids.size();
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering the benchmark frames.
+ *  The generated objects and lights are added first and all
+ *  of the textures are made resident, then the warmup frames
+ *  walk the camera path once before the measured frames
+ *  restart it from its first pose.
+ ***********************************************************/
+int Benchmark::Run(GLFWwindow* window, ViewManager* pViewManager, SceneManager* pSceneManager)
+{
+	const int width = ViewManager::GetWindowWidth();
+	const int height = ViewManager::GetWindowHeight();
+
+	CameraPath path;
+	if (m_options.cameraPathFile.empty())
+	{
+		path.MakeOrbit(ORBIT_CENTER, ORBIT_RADIUS, ORBIT_HEIGHT, m_options.frameCount);
+	}
+	else if (!path.Load(m_options.cameraPathFile.c_str()))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	if (!CreateFramebuffer(width, height))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	if (m_options.transformCount > 0)
+	{
+		MeasureTransforms();
+	}
+
+	if (m_options.hierarchyCount > 0)
+	{
+		MeasureHierarchy();
+	}
+
+	pSceneManager->SetDepthPrepass(m_options.bDepthPrepass);
+	pSceneManager->AddSyntheticObjects(m_options.boxCount);
+	pSceneManager->AddSyntheticLights(m_options.lightCount);
+	pSceneManager->WaitForTextures();
+
+	// the camera follows the path and nothing waits for vsync
+	pViewManager->SetInputEnabled(false);
+	glfwSwapInterval(0);
+
+	Profiler profiler("Benchmark");
+	profiler.Initialize();
+	pSceneManager->SetProfiler(&profiler);
+	m_bGpuTimes = true;
+	m_fenceStalls = 0;
+	m_samples.clear();
+	m_samples.reserve(m_options.frameCount);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+
+	const int totalFrames = m_options.warmupFrames + m_options.frameCount;
+	for (int frame = 0; frame < totalFrames; frame++)
+	{
+		const bool bMeasured = (frame >= m_options.warmupFrames);
+
+		profiler.BeginFrame();
+		UniformCache::ResetUploadCount();
+
+		profiler.BeginCpuScope(Profiler::CPU_WAIT_FRAME);
+		bool bFrameStalled = pSceneManager->BeginFrame();
+		profiler.EndCpuScope(Profiler::CPU_WAIT_FRAME);
+
+		const CameraPath::CAMERA_POSE& pose = path.GetPose(bMeasured ? frame - m_options.warmupFrames : frame);
+		pViewManager->SetCameraPose(pose.position, pose.front);
+
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		profiler.BeginCpuScope(Profiler::CPU_PREPARE_VIEW);
+		pViewManager->PrepareSceneView();
+		profiler.EndCpuScope(Profiler::CPU_PREPARE_VIEW);
+		pSceneManager->SetViewProjection(pViewManager->GetViewMatrix(), pViewManager->GetProjectionMatrix());
+
+		profiler.BeginCpuScope(Profiler::CPU_RENDER_SCENE);
+		pSceneManager->RenderScene();
+		profiler.EndCpuScope(Profiler::CPU_RENDER_SCENE);
+		pSceneManager->EndFrame();
+
+		// waiting for the GPU takes the place of the buffer swap,
+		// so every frame time covers the GPU work of its frame
+		profiler.BeginCpuScope(Profiler::CPU_SWAP_BUFFERS);
+		glFinish();
+		profiler.EndCpuScope(Profiler::CPU_SWAP_BUFFERS);
+
+		const SceneManager::FRAME_STATS& frameStats = pSceneManager->GetFrameStats();
+		m_counters.drawCalls = frameStats.drawCalls;
+		m_counters.stateChanges = frameStats.stateChanges;
+		m_counters.uniformUploads = UniformCache::GetUploadCount();
+		m_counters.fenceStalls = bFrameStalled ? 1 : 0;
+		m_counters.resolutionScale = 1.0f;
+		profiler.SetFrameCounters(m_counters);
+		m_culledObjects = frameStats.culledObjects;
+
+		glfwPollEvents();
+		profiler.EndFrame(window);
+
+		if (bMeasured)
+		{
+			m_fenceStalls += m_counters.fenceStalls;
+
+			FRAME_SAMPLE sample;
+			sample.frameTime = profiler.GetLastFrameTime();
+			sample.cpuTime = profiler.GetCpuTime(Profiler::CPU_PREPARE_VIEW) +
+				profiler.GetCpuTime(Profiler::CPU_RENDER_SCENE);
+			sample.gpuTime = profiler.GetGpuSceneTime();
+			m_bGpuTimes = m_bGpuTimes && (sample.gpuTime >= 0.0f);
+			m_samples.push_back(sample);
+		}
+	}
+
+	pSceneManager->SetProfiler(NULL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	DestroyFramebuffer();
+	pViewManager->SetInputEnabled(true);
+
+	// the JSON goes to stdout unless a file is named
+	FILE* file = stdout;
+	if (!m_options.jsonFile.empty())
+	{
+		file = fopen(m_options.jsonFile.c_str(), "w");
+		if (file == NULL)
+		{
+			std::cout << "Could not create benchmark results:" << m_options.jsonFile << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+
+	bool bSuccess = WriteResults(file, pSceneManager);
+	if (file != stdout)
+	{
+		bSuccess = (fclose(file) == 0) && bSuccess;
+		std::cout << "INFO: Benchmark results written to " << m_options.jsonFile << std::endl;
+	}
+	else
+	{
+		fflush(file);
+	}
+
+	return(bSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *  WriteTimeStats()
+ *
+ *  This method is used for writing the minimum, mean,
+ *  percentiles and maximum of the passed in times as a JSON
+ *  object.
+ ***********************************************************/
+void Benchmark::WriteTimeStats(FILE* file, const char* name, std::vector<float>& times)
+{
+	std::sort(times.begin(), times.end());
+
+	double total = 0.0;
+	for (float time : times)
+	{
+		total += time;
+	}
+
+	fprintf(file, "  \"%s\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		name, times.front(), total / (double)times.size(),
+		Percentile(times, 50.0f), Percentile(times, 90.0f), Percentile(times, 99.0f), times.back());
+}
+
+/***********************************************************
+ *  WriteResults()
+ *
+ *  This method is used for writing the benchmark settings and
+ *  the statistics of the measured frames as one JSON object.
+ ***********************************************************/
+bool Benchmark::WriteResults(FILE* file, SceneManager* pSceneManager)
+{
+	if (m_samples.size() == 0)
+	{
+		return false;
+	}
+
+	std::vector<float> frameTimes;
+	std::vector<float> cpuTimes;
+	std::vector<float> gpuTimes;
+	double totalFrameTime = 0.0;
+	for (const FRAME_SAMPLE& sample : m_samples)
+	{
+		frameTimes.push_back(sample.frameTime);
+		cpuTimes.push_back(sample.cpuTime);
+		gpuTimes.push_back(sample.gpuTime);
+		totalFrameTime += sample.frameTime;
+	}
+
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	const GLubyte* version = glGetString(GL_VERSION);
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"renderer\": ");
+	WriteJsonString(file, (renderer != NULL) ? (const char*)renderer : "");
+	fprintf(file, ",\n  \"glVersion\": ");
+	WriteJsonString(file, (version != NULL) ? (const char*)version : "");
+	fprintf(file, ",\n  \"width\": %d,\n  \"height\": %d,\n", ViewManager::GetWindowWidth(), ViewManager::GetWindowHeight());
+	fprintf(file, "  \"frames\": %d,\n  \"warmupFrames\": %d,\n", (int)m_samples.size(), m_options.warmupFrames);
+	fprintf(file, "  \"syntheticBoxes\": %d,\n  \"syntheticLights\": %d,\n", m_options.boxCount, m_options.lightCount);
+	fprintf(file, "  \"depthPrepass\": %s,\n", m_options.bDepthPrepass ? "true" : "false");
+	fprintf(file, "  \"objects\": %d,\n  \"lights\": %d,\n", pSceneManager->GetObjectCount(), pSceneManager->GetLightCount());
+	fprintf(file, "  \"cameraPath\": ");
+	WriteJsonString(file, m_options.cameraPathFile.empty() ? "orbit" : m_options.cameraPathFile.c_str());
+	fprintf(file, ",\n");
+
+	WriteTimeStats(file, "frameMs", frameTimes);
+	WriteTimeStats(file, "cpuMs", cpuTimes);
+	if (m_bGpuTimes)
+	{
+		WriteTimeStats(file, "gpuMs", gpuTimes);
+	}
+	else
+	{
+		fprintf(file, "  \"gpuMs\": null,\n");
+	}
+
+	if (m_options.transformCount > 0)
+	{
+		fprintf(file, "  \"transforms\": { \"count\": %d, \"matrixChainMs\": %.4f, \"batchMs\": %.4f, \"unchangedMs\": %.4f, \"maxError\": %g },\n",
+			m_options.transformCount, m_transformTimes.matrixChainTime, m_transformTimes.batchTime,
+			m_transformTimes.unchangedTime, m_transformTimes.maxError);
+	}
+
+	if (m_options.hierarchyCount > 0)
+	{
+		fprintf(file, "  \"hierarchy\": { \"count\": %d, \"buildMs\": %.4f, \"frustumMs\": %.4f, \"visible\": %d, \"bruteForceVisible\": %d, "
+			"\"churnMs\": %.4f, \"refitMs\": %.4f, \"raycastMs\": %.4f },\n",
+			m_options.hierarchyCount, m_hierarchyTimes.buildTime, m_hierarchyTimes.frustumTime, m_hierarchyTimes.visible,
+			m_hierarchyTimes.bruteForceVisible, m_hierarchyTimes.churnTime,
+			m_hierarchyTimes.refitTime, m_hierarchyTimes.raycastTime);
+	}
+
+	fprintf(file, "  \"fps\": %.2f,\n", (totalFrameTime > 0.0) ? 1000.0 * (double)m_samples.size() / totalFrameTime : 0.0);
+	fprintf(file, "  \"drawCalls\": %d,\n  \"stateChanges\": %d,\n  \"uniformUploads\": %d,\n  \"culledObjects\": %d,\n  \"fenceStalls\": %d\n",
+		m_counters.drawCalls, m_counters.stateChanges, m_counters.uniformUploads, m_culledObjects, m_fenceStalls);
+	fprintf(file, "}\n");
+
+	return(ferror(file) == 0);
+}
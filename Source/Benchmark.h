@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// render a fixed number of offscreen frames and report their timings
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Profiler.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  Benchmark
+ *
+ *  This class renders the scene into an offscreen framebuffer
+ *  of the window size for a fixed number of frames, with the
+ *  camera following a recorded or generated path and vsync
+ *  turned off.  Each frame waits for the GPU to finish, so a
+ *  frame time is the full cost of the frame and runs of the
+ *  same build are comparable.  Generated boxes and lights can
+ *  be added to the scene to measure how the frame time scales,
+ *  and the batched transform composition can be timed against
+ *  the matrix chain before the frames, as can the building,
+ *  queries and in place changes of a bounding volume hierarchy
+ *  over generated boxes.  The statistics are written as JSON.
+ ***********************************************************/
+class Benchmark
+{
+public:
+	// OPTIONS struct holds the benchmark command line settings
+	struct OPTIONS
+	{
+		int frameCount;              // measured frames
+		int warmupFrames;            // frames rendered before measuring
+		int boxCount;                // generated boxes added to the scene
+		int lightCount;              // generated lights added to the scene
+		int transformCount;          // transforms composed by the transform
+		                             // microbenchmark, 0 to skip it
+		int hierarchyCount;          // boxes in the hierarchy microbenchmark,
+		                             // 0 to skip it
+		bool bDepthPrepass;          // draw the opaque objects depth only first
+		std::string jsonFile;        // JSON output file, empty for stdout
+		std::string cameraPathFile;  // recorded camera path, empty for an orbit
+	};
+
+	// parse the command line, returns true when --benchmark is on it
+	static bool ParseOptions(int argc, char* argv[], OPTIONS& options);
+
+	// constructor
+	Benchmark(const OPTIONS& options);
+	// destructor
+	~Benchmark();
+
+	// render the benchmark frames and write the statistics,
+	// returns the process exit code
+	int Run(GLFWwindow* window, ViewManager* pViewManager, SceneManager* pSceneManager);
+
+private:
+	// FRAME_SAMPLE struct holds the measured times of one frame
+	struct FRAME_SAMPLE
+	{
+		float frameTime;
+		float cpuTime;
+		float gpuTime;
+	};
+
+	// command line settings
+	OPTIONS m_options;
+	// measured frames
+	std::vector<FRAME_SAMPLE> m_samples;
+	// work counters of the last measured frame
+	Profiler::FRAME_COUNTERS m_counters;
+	// true when the GPU times were measured
+	bool m_bGpuTimes;
+	// objects culled in the last measured frame, -1 when the GPU
+	// culled them and no count was read back yet
+	int m_culledObjects;
+	// measured frames that waited for a frame in flight
+	int m_fenceStalls;
+
+	// TRANSFORM_TIMES struct holds the transform microbenchmark results
+	struct TRANSFORM_TIMES
+	{
+		float matrixChainTime;   // scale, rotations and translation multiplied
+		float batchTime;         // every transform composed by the batch
+		float unchangedTime;     // batch update with no transform changed
+		float maxError;          // largest element difference of the two
+	};
+	// results of the transform microbenchmark
+	TRANSFORM_TIMES m_transformTimes;
+
+	// HIERARCHY_TIMES struct holds the hierarchy microbenchmark results
+	struct HIERARCHY_TIMES
+	{
+		float buildTime;         // every box added and the tree built
+		float frustumTime;       // one frustum query
+		float churnTime;         // boxes removed and added back in place
+		float refitTime;         // boxes moved and the tree refitted
+		float raycastTime;       // one raycast through the boxes
+		int visible;             // boxes the frustum query found
+		int bruteForceVisible;   // boxes the frustum culler found
+	};
+	// results of the hierarchy microbenchmark
+	HIERARCHY_TIMES m_hierarchyTimes;
+
+	// offscreen framebuffer and its attachments
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// create the offscreen framebuffer of the passed in size
+	bool CreateFramebuffer(int width, int height);
+	// free the offscreen framebuffer
+	void DestroyFramebuffer();
+	// time the batched transform composition against the matrix chain
+	void MeasureTransforms();
+	// time building, querying and changing the bounding volume hierarchy
+	void MeasureHierarchy();
+	// write the statistics of the measured frames as JSON
+	bool WriteResults(FILE* file, SceneManager* pSceneManager);
+	// write the statistics of one measured time as a JSON object,
+	// sorts the passed in times
+	static void WriteTimeStats(FILE* file, const char* name, std::vector<float>& times);
+};
@@ -0,0 +1,1023 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.cpp
+// ============
+// a bounding volume hierarchy over the scene objects for culling, picking
+// and nearest object queries
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
+// declaration of the global variables and defines
+namespace
+{
+	// largest number of objects kept in a leaf
+	const int MAX_LEAF_ITEMS = 4;
+	// leaves never hold more objects than this, even when the
+	// surface area heuristic prefers not to split
+	const int MAX_FORCED_LEAF_ITEMS = 16;
+	// number of bins the split heuristic sorts the centroids into
+	const int SPLIT_BIN_COUNT = 12;
+	// trees over fewer objects are built on the calling thread
+	const int PARALLEL_BUILD_ITEMS = 8192;
+	// refitting, adding and removing objects rebuild the tree once
+	// its summed surface area has grown by this factor since the build
+	const float REBUILD_AREA_RATIO = 2.0f;
+	// the object list is compacted by a rebuild once the removed
+	// objects leave more than half of it empty
+	const int COMPACT_ITEMS_RATIO = 2;
+
+	/***********************************************************
+	 *  ClassifyBox()
+	 *
+	 *  This function is used for testing a box against the
+	 *  frustum planes.  Returns 0 when the box is outside, 1
+	 *  when it crosses a plane and 2 when it is inside.
+	 ***********************************************************/
+	int ClassifyBox(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+		int result = 2;
+
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes[p];
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+
+			if (distance + radius < 0.0f)
+			{
+				return(0);
+			}
+			if (distance - radius < 0.0f)
+			{
+				result = 1;
+			}
+		}
+
+		return(result);
+	}
+
+	/***********************************************************
+	 *  IntersectRay()
+	 *
+	 *  This function is used for intersecting a ray with a box
+	 *  by clipping it against the three slabs of the box.
+	 *  Returns the entry distance, or FLT_MAX for a miss.
+	 ***********************************************************/
+	float IntersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+		const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		float tNear = 0.0f;
+		float tFar = maxDistance;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			tNear = std::max(tNear, std::min(t0, t1));
+			tFar = std::min(tFar, std::max(t0, t1));
+		}
+
+		return((tNear <= tFar) ? tNear : FLT_MAX);
+	}
+
+	/***********************************************************
+	 *  DistanceSquared()
+	 *
+	 *  This function is used for getting the squared distance
+	 *  from a point to a box, zero for a point inside it.
+	 ***********************************************************/
+	float DistanceSquared(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		float distance = 0.0f;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float outside = std::max(std::max(boundsMin[axis] - point[axis], point[axis] - boundsMax[axis]), 0.0f);
+			distance += outside * outside;
+		}
+
+		return(distance);
+	}
+}
+
+/***********************************************************
+ *  BoundingVolumeHierarchy()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+	m_objectCount = 0;
+	m_builtTreeArea = 0.0f;
+	m_treeArea = 0.0f;
+	m_bStructureDirty = false;
+	m_bBoundsDirty = false;
+	m_pBuilders = NULL;
+}
+
+/***********************************************************
+ *  ~BoundingVolumeHierarchy()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+	if (m_pBuilders != NULL)
+	{
+		delete m_pBuilders;
+		m_pBuilders = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetObjectBounds()
+ *
+ *  This method is used for adding an object with its world
+ *  bounds, or for moving an object that is already in the
+ *  tree.  An added object is inserted into the tree right
+ *  away, and moving only refits the tree on the next query.
+ *  Objects added before the first build wait for it.
+ ***********************************************************/
+void BoundingVolumeHierarchy::SetObjectBounds(int id, const glm::vec3& center, const glm::vec3& extents)
+{
+	if (id >= (int)m_bPresent.size())
+	{
+		m_objectMin.resize(id + 1);
+		m_objectMax.resize(id + 1);
+		m_bPresent.resize(id + 1, 0);
+		m_objectLeaf.resize(id + 1, -1);
+	}
+
+	m_objectMin[id] = center - extents;
+	m_objectMax[id] = center + extents;
+
+	if (m_bPresent[id] == 0)
+	{
+		m_bPresent[id] = 1;
+		m_objectCount++;
+		if (m_nodes.empty())
+		{
+			m_bStructureDirty = true;
+		}
+		if (!m_bStructureDirty)
+		{
+			InsertLeaf(id);
+		}
+	}
+	else
+	{
+		m_bBoundsDirty = true;
+	}
+}
+
+/***********************************************************
+ *  RemoveObject()
+ *
+ *  This method is used for removing an object from the tree,
+ *  which takes it out of its leaf right away.
+ ***********************************************************/
+void BoundingVolumeHierarchy::RemoveObject(int id)
+{
+	if ((id >= 0) && (id < (int)m_bPresent.size()) && (m_bPresent[id] != 0))
+	{
+		m_bPresent[id] = 0;
+		m_objectCount--;
+		if (!m_bStructureDirty)
+		{
+			RemoveLeaf(id);
+		}
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the objects.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Clear()
+{
+	m_objectMin.clear();
+	m_objectMax.clear();
+	m_bPresent.clear();
+	m_objectLeaf.clear();
+	m_objectCount = 0;
+	m_nodes.clear();
+	m_items.clear();
+	m_freePairs.clear();
+	m_builtTreeArea = 0.0f;
+	m_treeArea = 0.0f;
+	m_bStructureDirty = false;
+	m_bBoundsDirty = false;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for bringing the tree up to date with
+ *  the objects.  Moved objects refit it, and the tree is
+ *  rebuilt when it has none of its objects yet, or when the
+ *  refits and the added and removed leaves loosen it too much.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Update()
+{
+	if (m_bStructureDirty)
+	{
+		Build();
+		return;
+	}
+
+	if (m_bBoundsDirty)
+	{
+		m_treeArea = Refit();
+	}
+	if (m_treeArea > m_builtTreeArea * REBUILD_AREA_RATIO)
+	{
+		Build();
+	}
+}
+
+/***********************************************************
+ *  SurfaceArea()
+ *
+ *  This method is used for getting the surface area of a box.
+ ***********************************************************/
+float BoundingVolumeHierarchy::SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+	return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+}
+
+/***********************************************************
+ *  ComputeNodeBounds()
+ *
+ *  This method is used for computing the bounds of a node
+ *  from the objects in its range.
+ ***********************************************************/
+void BoundingVolumeHierarchy::ComputeNodeBounds(NODE& node) const
+{
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+
+	for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+	{
+		node.boundsMin = glm::min(node.boundsMin, m_objectMin[m_items[i]]);
+		node.boundsMax = glm::max(node.boundsMax, m_objectMax[m_items[i]]);
+	}
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over all of the
+ *  objects.  Large trees split their top levels here and hand
+ *  each subtree below them to a worker thread.  The subtrees
+ *  only touch their own range of the object list, and their
+ *  nodes are appended to the tree once they are all done.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Build()
+{
+	m_items.clear();
+	m_centroids.clear();
+	m_nodes.clear();
+	m_freePairs.clear();
+	for (int id = 0; id < (int)m_bPresent.size(); id++)
+	{
+		if (m_bPresent[id] != 0)
+		{
+			m_items.push_back(id);
+			m_centroids.push_back((m_objectMin[id] + m_objectMax[id]) * 0.5f);
+		}
+	}
+
+	m_bStructureDirty = false;
+	m_bBoundsDirty = false;
+	m_builtTreeArea = 0.0f;
+	m_treeArea = 0.0f;
+	if (m_items.size() == 0)
+	{
+		return;
+	}
+
+	NODE root;
+	root.firstItem = 0;
+	root.itemCount = (int)m_items.size();
+	root.leftChild = -1;
+	root.parent = -1;
+	ComputeNodeBounds(root);
+	m_nodes.reserve(m_items.size() * 2 / MAX_LEAF_ITEMS + 1);
+	m_nodes.push_back(root);
+
+	if ((int)m_items.size() < PARALLEL_BUILD_ITEMS)
+	{
+		Subdivide(m_nodes, 0, 0, 0, NULL);
+	}
+	else
+	{
+		if (m_pBuilders == NULL)
+		{
+			m_pBuilders = new ThreadPool();
+		}
+
+		// split until there are about two subtrees per worker,
+		// which evens out subtrees of different sizes
+		int taskDepth = 1;
+		while ((1 << taskDepth) < m_pBuilders->GetWorkerCount() * 2)
+		{
+			taskDepth++;
+		}
+
+		std::vector<BUILD_TASK> tasks;
+		Subdivide(m_nodes, 0, 0, taskDepth, &tasks);
+
+		std::mutex mutex;
+		std::condition_variable done;
+		size_t remainingTasks = tasks.size();
+		for (BUILD_TASK& task : tasks)
+		{
+			task.nodes.push_back(m_nodes[task.nodeIndex]);
+			BUILD_TASK* pTask = &task;
+			m_pBuilders->Submit([this, pTask, &mutex, &done, &remainingTasks]() {
+				Subdivide(pTask->nodes, 0, 0, 0, NULL);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				remainingTasks--;
+				done.notify_one();
+			});
+		}
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [&remainingTasks]() { return(remainingTasks == 0); });
+		}
+
+		// the subtree root replaces its placeholder node and the
+		// rest is appended, so the children still follow parents
+		for (BUILD_TASK& task : tasks)
+		{
+			int offset = (int)m_nodes.size() - 1;
+			for (size_t i = 0; i < task.nodes.size(); i++)
+			{
+				NODE node = task.nodes[i];
+				if (node.leftChild >= 0)
+				{
+					node.leftChild += offset;
+				}
+
+				if (i == 0)
+				{
+					m_nodes[task.nodeIndex] = node;
+				}
+				else
+				{
+					m_nodes.push_back(node);
+				}
+			}
+		}
+	}
+
+	LinkNodes();
+	for (const NODE& node : m_nodes)
+	{
+		m_builtTreeArea += SurfaceArea(node.boundsMin, node.boundsMax);
+	}
+	m_treeArea = m_builtTreeArea;
+}
+
+/***********************************************************
+ *  LinkNodes()
+ *
+ *  This method is used for setting the parent of every node
+ *  and the leaf of every object after a build, which the
+ *  subtrees built on the workers could not know.
+ ***********************************************************/
+void BoundingVolumeHierarchy::LinkNodes()
+{
+	m_objectLeaf.assign(m_bPresent.size(), -1);
+	m_nodes[0].parent = -1;
+
+	for (int i = 0; i < (int)m_nodes.size(); i++)
+	{
+		const NODE& node = m_nodes[i];
+		if (node.leftChild >= 0)
+		{
+			m_nodes[node.leftChild].parent = i;
+			m_nodes[node.leftChild + 1].parent = i;
+		}
+		else
+		{
+			for (int item = node.firstItem; item < node.firstItem + node.itemCount; item++)
+			{
+				m_objectLeaf[m_items[item]] = i;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  InsertLeaf()
+ *
+ *  This method is used for adding an object to the built tree
+ *  without building it again.  The descent takes the child
+ *  whose box grows the least with the object, down to a leaf.
+ *  That leaf moves into a new pair of children together with
+ *  a new leaf for the object, and its node becomes their
+ *  parent.  The new leaf's object is appended to the object
+ *  list, so the nodes above it no longer cover one range.
+ ***********************************************************/
+void BoundingVolumeHierarchy::InsertLeaf(int id)
+{
+	// a list mostly made of removed objects is compacted instead
+	if ((int)m_items.size() + 1 > COMPACT_ITEMS_RATIO * m_objectCount + MAX_FORCED_LEAF_ITEMS)
+	{
+		m_bStructureDirty = true;
+		return;
+	}
+
+	const glm::vec3& objectMin = m_objectMin[id];
+	const glm::vec3& objectMax = m_objectMax[id];
+
+	int sibling = 0;
+	while (m_nodes[sibling].leftChild >= 0)
+	{
+		const NODE& left = m_nodes[m_nodes[sibling].leftChild];
+		const NODE& right = m_nodes[m_nodes[sibling].leftChild + 1];
+		float leftGrowth = SurfaceArea(glm::min(left.boundsMin, objectMin), glm::max(left.boundsMax, objectMax)) -
+			SurfaceArea(left.boundsMin, left.boundsMax);
+		float rightGrowth = SurfaceArea(glm::min(right.boundsMin, objectMin), glm::max(right.boundsMax, objectMax)) -
+			SurfaceArea(right.boundsMin, right.boundsMax);
+		sibling = (leftGrowth <= rightGrowth) ? m_nodes[sibling].leftChild : m_nodes[sibling].leftChild + 1;
+	}
+
+	// the children have to follow their parent, so a freed pair is
+	// only reused when it does
+	int pair = -1;
+	if (!m_freePairs.empty() && (m_freePairs.back() > sibling))
+	{
+		pair = m_freePairs.back();
+		m_freePairs.pop_back();
+	}
+	else
+	{
+		pair = (int)m_nodes.size();
+		m_nodes.resize(m_nodes.size() + 2);
+	}
+
+	NODE moved = m_nodes[sibling];
+	moved.parent = sibling;
+	for (int item = moved.firstItem; item < moved.firstItem + moved.itemCount; item++)
+	{
+		m_objectLeaf[m_items[item]] = pair;
+	}
+
+	NODE leaf;
+	leaf.boundsMin = objectMin;
+	leaf.boundsMax = objectMax;
+	leaf.firstItem = (int)m_items.size();
+	leaf.itemCount = 1;
+	leaf.leftChild = -1;
+	leaf.parent = sibling;
+	m_items.push_back(id);
+	m_objectLeaf[id] = pair + 1;
+
+	m_nodes[pair] = moved;
+	m_nodes[pair + 1] = leaf;
+
+	// the node of the moved leaf joins the two, its old box is
+	// counted by the moved leaf now
+	NODE& joined = m_nodes[sibling];
+	m_treeArea += SurfaceArea(moved.boundsMin, moved.boundsMax) + SurfaceArea(leaf.boundsMin, leaf.boundsMax);
+	joined.leftChild = pair;
+	joined.firstItem = -1;
+	joined.itemCount = moved.itemCount + 1;
+	RefitPath(sibling, true);
+}
+
+/***********************************************************
+ *  RemoveLeaf()
+ *
+ *  This method is used for taking an object out of the built
+ *  tree without building it again.  The last object of its
+ *  leaf takes its place, which leaves a removed entry at the
+ *  end of the leaf's part of the object list.  A leaf left
+ *  empty is replaced by its sibling, which moves up into the
+ *  node of their parent, and the pair of children is freed.
+ ***********************************************************/
+void BoundingVolumeHierarchy::RemoveLeaf(int id)
+{
+	if (m_objectCount == 0)
+	{
+		// nothing is left to keep a tree for
+		m_nodes.clear();
+		m_items.clear();
+		m_freePairs.clear();
+		m_bBoundsDirty = false;
+		m_builtTreeArea = 0.0f;
+		m_treeArea = 0.0f;
+		return;
+	}
+
+	const int leafIndex = m_objectLeaf[id];
+	m_objectLeaf[id] = -1;
+	NODE& leaf = m_nodes[leafIndex];
+	const int lastItem = leaf.firstItem + leaf.itemCount - 1;
+	for (int item = leaf.firstItem; item <= lastItem; item++)
+	{
+		if (m_items[item] == id)
+		{
+			m_items[item] = m_items[lastItem];
+			break;
+		}
+	}
+	m_items[lastItem] = -1;
+	leaf.itemCount--;
+
+	if (leaf.itemCount > 0)
+	{
+		float leafArea = SurfaceArea(leaf.boundsMin, leaf.boundsMax);
+		ComputeNodeBounds(leaf);
+		m_treeArea += SurfaceArea(leaf.boundsMin, leaf.boundsMax) - leafArea;
+		RefitPath(leaf.parent, false);
+		return;
+	}
+
+	// the objects left keep the tree from ending at an empty root
+	const int parent = leaf.parent;
+	const int pair = m_nodes[parent].leftChild;
+	const int sibling = (leafIndex == pair) ? pair + 1 : pair;
+	m_treeArea -= SurfaceArea(m_nodes[parent].boundsMin, m_nodes[parent].boundsMax) +
+		SurfaceArea(leaf.boundsMin, leaf.boundsMax);
+
+	NODE raised = m_nodes[sibling];
+	raised.parent = m_nodes[parent].parent;
+	m_nodes[parent] = raised;
+	if (raised.leftChild >= 0)
+	{
+		m_nodes[raised.leftChild].parent = parent;
+		m_nodes[raised.leftChild + 1].parent = parent;
+	}
+	else
+	{
+		for (int item = raised.firstItem; item < raised.firstItem + raised.itemCount; item++)
+		{
+			m_objectLeaf[m_items[item]] = parent;
+		}
+	}
+
+	// the freed pair stays in the node list as two empty leaves,
+	// which the refits and the area sums pass over
+	for (int i = pair; i <= pair + 1; i++)
+	{
+		m_nodes[i].firstItem = 0;
+		m_nodes[i].itemCount = 0;
+		m_nodes[i].leftChild = -1;
+		m_nodes[i].parent = -1;
+		m_nodes[i].boundsMin = glm::vec3(0.0f);
+		m_nodes[i].boundsMax = glm::vec3(0.0f);
+	}
+	m_freePairs.push_back(pair);
+
+	if (raised.parent >= 0)
+	{
+		RefitPath(raised.parent, false);
+	}
+}
+
+/***********************************************************
+ *  RefitPath()
+ *
+ *  This method is used for recomputing the boxes from a node
+ *  up to the root after a leaf was added or removed below it.
+ *  The summed area of the tree follows the changed boxes.
+ ***********************************************************/
+void BoundingVolumeHierarchy::RefitPath(int nodeIndex, bool bDropRanges)
+{
+	while (nodeIndex >= 0)
+	{
+		NODE& node = m_nodes[nodeIndex];
+		const NODE& left = m_nodes[node.leftChild];
+		const NODE& right = m_nodes[node.leftChild + 1];
+		float nodeArea = SurfaceArea(node.boundsMin, node.boundsMax);
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		m_treeArea += SurfaceArea(node.boundsMin, node.boundsMax) - nodeArea;
+		if (bDropRanges)
+		{
+			node.firstItem = -1;
+		}
+		nodeIndex = node.parent;
+	}
+}
+
+/***********************************************************
+ *  Subdivide()
+ *
+ *  This method is used for splitting a node in two with the
+ *  binned surface area heuristic, and then its children.  The
+ *  centroids are sorted into bins along each axis, and the
+ *  split with the lowest summed cost of the two children wins.
+ *  A node stays a leaf when no split is cheaper than the leaf
+ *  itself.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Subdivide(std::vector<NODE>& nodes, int nodeIndex, int depth, int taskDepth, std::vector<BUILD_TASK>* pTasks)
+{
+	const NODE node = nodes[nodeIndex];
+	if (node.itemCount <= MAX_LEAF_ITEMS)
+	{
+		return;
+	}
+	if ((pTasks != NULL) && (depth == taskDepth))
+	{
+		BUILD_TASK task;
+		task.nodeIndex = nodeIndex;
+		pTasks->push_back(task);
+		return;
+	}
+
+	const int first = node.firstItem;
+	const int last = node.firstItem + node.itemCount;
+
+	glm::vec3 centroidMin = m_centroids[first];
+	glm::vec3 centroidMax = m_centroids[first];
+	for (int i = first + 1; i < last; i++)
+	{
+		centroidMin = glm::min(centroidMin, m_centroids[i]);
+		centroidMax = glm::max(centroidMax, m_centroids[i]);
+	}
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		glm::vec3 binMin[SPLIT_BIN_COUNT];
+		glm::vec3 binMax[SPLIT_BIN_COUNT];
+		int binCount[SPLIT_BIN_COUNT] = { 0 };
+		for (int b = 0; b < SPLIT_BIN_COUNT; b++)
+		{
+			binMin[b] = glm::vec3(FLT_MAX);
+			binMax[b] = glm::vec3(-FLT_MAX);
+		}
+
+		float binScale = (float)SPLIT_BIN_COUNT / extent;
+		for (int i = first; i < last; i++)
+		{
+			int b = std::min((int)((m_centroids[i][axis] - centroidMin[axis]) * binScale), SPLIT_BIN_COUNT - 1);
+			binMin[b] = glm::min(binMin[b], m_objectMin[m_items[i]]);
+			binMax[b] = glm::max(binMax[b], m_objectMax[m_items[i]]);
+			binCount[b]++;
+		}
+
+		// sweep from the right to get the cost of every right side,
+		// then from the left to combine it with every left side
+		float rightArea[SPLIT_BIN_COUNT];
+		int rightCount[SPLIT_BIN_COUNT];
+		glm::vec3 sweepMin = glm::vec3(FLT_MAX);
+		glm::vec3 sweepMax = glm::vec3(-FLT_MAX);
+		int sweepCount = 0;
+		for (int b = SPLIT_BIN_COUNT - 1; b > 0; b--)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCount[b];
+			rightArea[b] = SurfaceArea(sweepMin, sweepMax);
+			rightCount[b] = sweepCount;
+		}
+
+		sweepMin = glm::vec3(FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int b = 0; b < SPLIT_BIN_COUNT - 1; b++)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCount[b];
+			if ((sweepCount == 0) || (rightCount[b + 1] == 0))
+			{
+				continue;
+			}
+
+			float cost = SurfaceArea(sweepMin, sweepMax) * sweepCount + rightArea[b + 1] * rightCount[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	float leafCost = SurfaceArea(node.boundsMin, node.boundsMax) * node.itemCount;
+	if ((bestCost >= leafCost) && (node.itemCount <= MAX_FORCED_LEAF_ITEMS))
+	{
+		return;
+	}
+
+	// move the objects left of the split to the front of the range,
+	// objects with the same centroid are split by their order
+	int middle = first + node.itemCount / 2;
+	if (bestAxis >= 0)
+	{
+		float binScale = (float)SPLIT_BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		middle = first;
+		for (int i = first; i < last; i++)
+		{
+			int b = std::min((int)((m_centroids[i][bestAxis] - centroidMin[bestAxis]) * binScale), SPLIT_BIN_COUNT - 1);
+			if (b <= bestSplit)
+			{
+				std::swap(m_items[i], m_items[middle]);
+				std::swap(m_centroids[i], m_centroids[middle]);
+				middle++;
+			}
+		}
+	}
+
+	NODE left;
+	left.firstItem = first;
+	left.itemCount = middle - first;
+	left.leftChild = -1;
+	left.parent = nodeIndex;
+	ComputeNodeBounds(left);
+
+	NODE right;
+	right.firstItem = middle;
+	right.itemCount = last - middle;
+	right.leftChild = -1;
+	right.parent = nodeIndex;
+	ComputeNodeBounds(right);
+
+	int leftIndex = (int)nodes.size();
+	nodes.push_back(left);
+	nodes.push_back(right);
+	nodes[nodeIndex].leftChild = leftIndex;
+
+	Subdivide(nodes, leftIndex, depth + 1, taskDepth, pTasks);
+	Subdivide(nodes, leftIndex + 1, depth + 1, taskDepth, pTasks);
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for recomputing the node bounds after
+ *  objects moved.  Children are always stored after their
+ *  parent, so walking the nodes backwards visits the children
+ *  first.
+ ***********************************************************/
+float BoundingVolumeHierarchy::Refit()
+{
+	float treeArea = 0.0f;
+
+	for (int i = (int)m_nodes.size() - 1; i >= 0; i--)
+	{
+		NODE& node = m_nodes[i];
+		if (node.leftChild < 0)
+		{
+			ComputeNodeBounds(node);
+		}
+		else
+		{
+			const NODE& left = m_nodes[node.leftChild];
+			const NODE& right = m_nodes[node.leftChild + 1];
+			node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		}
+		treeArea += SurfaceArea(node.boundsMin, node.boundsMax);
+	}
+
+	m_bBoundsDirty = false;
+	return(treeArea);
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for finding the objects whose bounds
+ *  are not outside the frustum.  A node inside the frustum
+ *  adds all of its objects, and only the leaves that cross a
+ *  plane test their objects one by one.
+ ***********************************************************/
+void BoundingVolumeHierarchy::QueryFrustum(const glm::vec4 planes[6], std::vector<int>& ids)
+{
+	Update();
+	ids.clear();
+	if (m_nodes.size() == 0)
+	{
+		return;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(0);
+	while (m_stack.size() > 0)
+	{
+		const int nodeIndex = m_stack.back();
+		const NODE& node = m_nodes[nodeIndex];
+		m_stack.pop_back();
+
+		int classification = ClassifyBox(planes, node.boundsMin, node.boundsMax);
+		if (classification == 0)
+		{
+			continue;
+		}
+
+		if (classification == 2)
+		{
+			AddSubtree(nodeIndex, ids);
+		}
+		else if (node.leftChild < 0)
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				if (ClassifyBox(planes, m_objectMin[m_items[i]], m_objectMax[m_items[i]]) != 0)
+				{
+					ids.push_back(m_items[i]);
+				}
+			}
+		}
+		else
+		{
+			m_stack.push_back(node.leftChild);
+			m_stack.push_back(node.leftChild + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddSubtree()
+ *
+ *  This method is used for adding every object under a node
+ *  that is completely inside the frustum.  A node that still
+ *  covers one range of the object list adds it as a whole,
+ *  skipping the removed entries, and the others add the
+ *  objects of their leaves.
+ ***********************************************************/
+void BoundingVolumeHierarchy::AddSubtree(int nodeIndex, std::vector<int>& ids)
+{
+	m_insideStack.clear();
+	m_insideStack.push_back(nodeIndex);
+	while (m_insideStack.size() > 0)
+	{
+		const NODE& node = m_nodes[m_insideStack.back()];
+		m_insideStack.pop_back();
+
+		if ((node.firstItem >= 0) || (node.leftChild < 0))
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				if (m_items[i] >= 0)
+				{
+					ids.push_back(m_items[i]);
+				}
+			}
+		}
+		else
+		{
+			m_insideStack.push_back(node.leftChild);
+			m_insideStack.push_back(node.leftChild + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method is used for finding the closest object whose
+ *  bounds the ray hits.  The nearer child is visited first,
+ *  and nodes further away than the closest hit are skipped.
+ ***********************************************************/
+int BoundingVolumeHierarchy::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance)
+{
+	Update();
+	hitDistance = maxDistance;
+	if (m_nodes.size() == 0)
+	{
+		return(-1);
+	}
+
+	// a zero direction component becomes a tiny one, so the slab
+	// test never multiplies zero by infinity
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float d = direction[axis];
+		inverseDirection[axis] = 1.0f / ((fabsf(d) > 1e-12f) ? d : ((d < 0.0f) ? -1e-12f : 1e-12f));
+	}
+
+	int hitId = -1;
+	m_stack.clear();
+	m_stack.push_back(0);
+	while (m_stack.size() > 0)
+	{
+		const NODE& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if (IntersectRay(origin, inverseDirection, hitDistance, node.boundsMin, node.boundsMax) == FLT_MAX)
+		{
+			continue;
+		}
+
+		if (node.leftChild < 0)
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				float t = IntersectRay(origin, inverseDirection, hitDistance, m_objectMin[m_items[i]], m_objectMax[m_items[i]]);
+				if (t < hitDistance)
+				{
+					hitDistance = t;
+					hitId = m_items[i];
+				}
+			}
+		}
+		else
+		{
+			const NODE& left = m_nodes[node.leftChild];
+			const NODE& right = m_nodes[node.leftChild + 1];
+			float tLeft = IntersectRay(origin, inverseDirection, hitDistance, left.boundsMin, left.boundsMax);
+			float tRight = IntersectRay(origin, inverseDirection, hitDistance, right.boundsMin, right.boundsMax);
+
+			// the stack pops the nearer child first
+			int nearChild = (tLeft <= tRight) ? node.leftChild : node.leftChild + 1;
+			int farChild = (tLeft <= tRight) ? node.leftChild + 1 : node.leftChild;
+			if (std::max(tLeft, tRight) != FLT_MAX)
+			{
+				m_stack.push_back(farChild);
+			}
+			if (std::min(tLeft, tRight) != FLT_MAX)
+			{
+				m_stack.push_back(nearChild);
+			}
+		}
+	}
+
+	return(hitId);
+}
+
+/***********************************************************
+ *  FindNearest()
+ *
+ *  This method is used for finding the object whose bounds
+ *  are closest to a point.  Nodes further away than the
+ *  closest object found so far are skipped.
+ ***********************************************************/
+int BoundingVolumeHierarchy::FindNearest(const glm::vec3& point, float maxDistance, float& distance)
+{
+	Update();
+	float bestDistance = maxDistance * maxDistance;
+	int nearestId = -1;
+
+	if (m_nodes.size() > 0)
+	{
+		m_stack.clear();
+		m_stack.push_back(0);
+	}
+	while (m_stack.size() > 0)
+	{
+		const NODE& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if (DistanceSquared(point, node.boundsMin, node.boundsMax) > bestDistance)
+		{
+			continue;
+		}
+
+		if (node.leftChild < 0)
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				float d = DistanceSquared(point, m_objectMin[m_items[i]], m_objectMax[m_items[i]]);
+				if (d <= bestDistance)
+				{
+					bestDistance = d;
+					nearestId = m_items[i];
+				}
+			}
+		}
+		else
+		{
+			const NODE& left = m_nodes[node.leftChild];
+			const NODE& right = m_nodes[node.leftChild + 1];
+			float dLeft = DistanceSquared(point, left.boundsMin, left.boundsMax);
+			float dRight = DistanceSquared(point, right.boundsMin, right.boundsMax);
+
+			// the stack pops the nearer child first
+			m_stack.push_back((dLeft <= dRight) ? node.leftChild + 1 : node.leftChild);
+			m_stack.push_back((dLeft <= dRight) ? node.leftChild : node.leftChild + 1);
+		}
+	}
+
+	distance = sqrtf(bestDistance);
+	return(nearestId);
+}
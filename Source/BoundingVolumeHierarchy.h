@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.h
+// ============
+// a bounding volume hierarchy over the scene objects for culling, picking
+// and nearest object queries
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  BoundingVolumeHierarchy
+ *
+ *  This class keeps a binary tree of axis aligned boxes over
+ *  the world bounds of the scene objects.  Objects are named
+ *  by an id, which is their draw list handle.  Moving objects
+ *  only refits the boxes of the tree bottom-up.  An added
+ *  object becomes a new leaf next to the leaf whose box grows
+ *  the least, and a removed one leaves its leaf, which the
+ *  sibling replaces once it is empty, both refitting only the
+ *  path to the root.  The tree is only rebuilt when these
+ *  changes or refitting have made it much looser than when it
+ *  was built.
+ *
+ *  The tree is built top-down with a binned surface area
+ *  heuristic.  Large trees split their top levels first and
+ *  then build the subtrees on worker threads.  Every built
+ *  node covers a contiguous range of the object list, so a
+ *  node that is completely inside the frustum adds its objects
+ *  without visiting its children.  The nodes above an added
+ *  leaf lose their range and add the objects of their leaves.
+ ***********************************************************/
+class BoundingVolumeHierarchy
+{
+public:
+	// constructor
+	BoundingVolumeHierarchy();
+	// destructor
+	~BoundingVolumeHierarchy();
+
+	// add an object or move it to new world bounds
+	void SetObjectBounds(int id, const glm::vec3& center, const glm::vec3& extents);
+	// remove an object from the tree
+	void RemoveObject(int id);
+	// remove all of the objects
+	void Clear();
+
+	// rebuild or refit the tree after objects changed, the
+	// queries call this themselves
+	void Update();
+
+	// find the objects whose bounds are not outside the frustum
+	// planes, the plane normals point inside
+	void QueryFrustum(const glm::vec4 planes[6], std::vector<int>& ids);
+	// find the closest object whose bounds the ray hits, -1 if none
+	int Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance);
+	// find the object whose bounds are closest to a point, -1 if
+	// none is within the passed in distance
+	int FindNearest(const glm::vec3& point, float maxDistance, float& distance);
+
+	// get the number of objects in the tree
+	int GetObjectCount() const { return(m_objectCount); }
+	// get the number of nodes in the tree
+	int GetNodeCount() const { return((int)(m_nodes.size() - m_freePairs.size() * 2)); }
+
+private:
+	// NODE struct is one box of the tree, a leaf has no children
+	struct NODE
+	{
+		glm::vec3 boundsMin;
+		int firstItem;           // first object in m_items, -1 for a node
+		                         // whose leaves are not one range
+		glm::vec3 boundsMax;
+		int itemCount;           // number of objects of a leaf, or the
+		                         // length of the range of a node
+		int leftChild;           // right child is leftChild + 1, -1 for a leaf
+		int parent;              // -1 for the root
+	};
+
+	// BUILD_TASK struct is a subtree built on a worker thread
+	struct BUILD_TASK
+	{
+		int nodeIndex;           // node the subtree replaces
+		std::vector<NODE> nodes; // nodes of the subtree, the root first
+	};
+
+	// bounds of each object by id
+	std::vector<glm::vec3> m_objectMin;
+	std::vector<glm::vec3> m_objectMax;
+	// true for the ids that are in the tree
+	std::vector<unsigned char> m_bPresent;
+	// number of ids in the tree
+	int m_objectCount;
+
+	// nodes of the tree, the root first and children after parents
+	std::vector<NODE> m_nodes;
+	// object ids in leaf order, -1 where an object was removed
+	std::vector<int> m_items;
+	// leaf holding each object by id
+	std::vector<int> m_objectLeaf;
+	// first node of the pairs of children freed by removals
+	std::vector<int> m_freePairs;
+	// bounds center of each entry of m_items, used while building
+	std::vector<glm::vec3> m_centroids;
+	// summed surface area of the nodes when the tree was built,
+	// which measures how loose refitting has made the tree, and
+	// the area now, kept up to date by the added and removed leaves
+	float m_builtTreeArea;
+	float m_treeArea;
+
+	// true when the tree has to be built before the next query
+	bool m_bStructureDirty;
+	// true when objects moved since the last refit
+	bool m_bBoundsDirty;
+	// workers building the subtrees, created on the first large build
+	ThreadPool* m_pBuilders;
+	// reusable traversal stacks
+	std::vector<int> m_stack;
+	std::vector<int> m_insideStack;
+
+	// build the tree over all of the objects
+	void Build();
+	// split a node and its children, the children of nodes at
+	// the task depth become build tasks when tasks is not NULL
+	void Subdivide(std::vector<NODE>& nodes, int nodeIndex, int depth, int taskDepth, std::vector<BUILD_TASK>* pTasks);
+	// recompute the bounds of every node from its objects,
+	// returns the summed surface area of the nodes
+	float Refit();
+	// compute the bounds of the objects of a node
+	void ComputeNodeBounds(NODE& node) const;
+	// set the parents of the nodes and the leaves of the objects
+	void LinkNodes();
+	// add an object as a new leaf next to the leaf it grows least
+	void InsertLeaf(int id);
+	// take an object out of its leaf, and the leaf out of the tree
+	// once it is empty
+	void RemoveLeaf(int id);
+	// recompute the bounds of a node and its ancestors from their
+	// children, dropping the range of the nodes when asked to
+	void RefitPath(int nodeIndex, bool bDropRanges);
+	// add the objects under a node that is inside the frustum
+	void AddSubtree(int nodeIndex, std::vector<int>& ids);
+
+	// surface area of a box, used by the split heuristic
+	static float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+};
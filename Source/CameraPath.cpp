@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// record, load and replay a path of camera poses
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <cmath>
+#include <iostream>
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+	m_pRecordFile = NULL;
+}
+
+/***********************************************************
+ *  ~CameraPath()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraPath::~CameraPath()
+{
+	if (m_pRecordFile != NULL)
+	{
+		fclose(m_pRecordFile);
+		m_pRecordFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a recorded path file.
+ *  Lines that do not hold six numbers are skipped, so the
+ *  file can carry comments.
+ ***********************************************************/
+bool CameraPath::Load(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (file == NULL)
+	{
+		std::cout << "Could not open camera path:" << filename << std::endl;
+		return false;
+	}
+
+	std::vector<CAMERA_POSE> poses;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		CAMERA_POSE pose;
+		if (sscanf(line, "%f %f %f %f %f %f",
+			&pose.position.x, &pose.position.y, &pose.position.z,
+			&pose.front.x, &pose.front.y, &pose.front.z) == 6)
+		{
+			poses.push_back(pose);
+		}
+	}
+	fclose(file);
+
+	if (poses.size() == 0)
+	{
+		std::cout << "Camera path has no poses:" << filename << std::endl;
+		return false;
+	}
+
+	m_poses.swap(poses);
+	return true;
+}
+
+/***********************************************************
+ *  MakeOrbit()
+ *
+ *  This method is used for generating one full orbit around
+ *  the passed in center, split into the passed in number of
+ *  poses.  The camera always looks at the center.
+ ***********************************************************/
+void CameraPath::MakeOrbit(const glm::vec3& center, float radius, float height, int poseCount)
+{
+	m_poses.resize((poseCount > 0) ? poseCount : 1);
+	for (size_t i = 0; i < m_poses.size(); i++)
+	{
+		float angle = glm::radians(360.0f * (float)i / (float)m_poses.size());
+
+		CAMERA_POSE& pose = m_poses[i];
+		pose.position = center + glm::vec3(sin(angle) * radius, height, cos(angle) * radius);
+		pose.front = glm::normalize(center - pose.position);
+	}
+}
+
+/***********************************************************
+ *  OpenRecording()
+ *
+ *  This method is used for creating the path file that the
+ *  recorded poses are written into.
+ ***********************************************************/
+bool CameraPath::OpenRecording(const char* filename)
+{
+	if (m_pRecordFile != NULL)
+	{
+		fclose(m_pRecordFile);
+	}
+
+	m_pRecordFile = fopen(filename, "w");
+	if (m_pRecordFile == NULL)
+	{
+		std::cout << "Could not create camera path:" << filename << std::endl;
+		return false;
+	}
+
+	fprintf(m_pRecordFile, "# position.xyz front.xyz\n");
+	return true;
+}
+
+/***********************************************************
+ *  Record()
+ *
+ *  This method is used for appending the pose of a frame to
+ *  the path file.
+ ***********************************************************/
+void CameraPath::Record(const glm::vec3& position, const glm::vec3& front)
+{
+	if (m_pRecordFile != NULL)
+	{
+		fprintf(m_pRecordFile, "%.4f %.4f %.4f %.4f %.4f %.4f\n",
+			position.x, position.y, position.z, front.x, front.y, front.z);
+	}
+}
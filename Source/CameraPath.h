@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// record, load and replay a path of camera poses
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class holds one camera pose per frame, so that a
+ *  benchmark can move the camera the same way on every run.
+ *  A path is either recorded while flying the camera by hand
+ *  and loaded back from its text file, or generated as an
+ *  orbit around the scene.  Every line of a path file holds
+ *  the position and the view direction of one frame.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// CAMERA_POSE struct is the camera placement of one frame
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+	};
+
+	// constructor
+	CameraPath();
+	// destructor
+	~CameraPath();
+
+	// load a recorded path file, returns false if it is missing or empty
+	bool Load(const char* filename);
+	// replace the path with an orbit looking at the passed in center
+	void MakeOrbit(const glm::vec3& center, float radius, float height, int poseCount);
+
+	// start writing the recorded poses into a path file
+	bool OpenRecording(const char* filename);
+	// true while poses are written into a path file
+	bool IsRecording() const { return(m_pRecordFile != NULL); }
+	// append a pose to the path file
+	void Record(const glm::vec3& position, const glm::vec3& front);
+
+	// get the pose of a frame, the path repeats once it ends
+	const CAMERA_POSE& GetPose(int frame) const { return(m_poses[frame % m_poses.size()]); }
+	// get the number of poses in the path
+	int GetPoseCount() const { return((int)m_poses.size()); }
+
+private:
+	// camera pose of each frame
+	std::vector<CAMERA_POSE> m_poses;
+	// path file receiving the recorded poses, NULL if not recording
+	FILE* m_pRecordFile;
+};
@@ -0,0 +1,432 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the scene offscreen at a resolution that follows the GPU frame
+// time and upscale it into the window
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "GpuMemory.h"
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+const float DynamicResolution::MIN_SCALE = 0.5f;
+const float DynamicResolution::MAX_SCALE = 1.0f;
+
+// declaration of the global variables and defines
+namespace
+{
+	// frame rate the scale is tuned for unless set on the command line
+	const float DEFAULT_TARGET_FPS = 60.0f;
+	// the scale drops once the GPU time is over this share of the
+	// budget, and climbs once it is under the lower share, which
+	// keeps it from bouncing between two steps
+	const float SCALE_DOWN_LOAD = 0.9f;
+	const float SCALE_UP_LOAD = 0.7f;
+	// share of the budget a change of scale aims for
+	const float TARGET_LOAD = 0.8f;
+	// largest change of the scale in one step
+	const float MAX_SCALE_DOWN = 0.8f;
+	const float MAX_SCALE_UP = 1.1f;
+	// the scale moves in these steps, so the small changes that the
+	// eye would see as shimmering are never made
+	const float SCALE_STEP = 1.0f / 32.0f;
+	// the GPU times come back a few frames late, so the frames drawn
+	// at the old scale are skipped before the next change
+	const int SETTLE_FRAMES = 8;
+	// weight of the latest frame in the smoothed GPU time
+	const float SMOOTHING = 0.2f;
+	// strength of the sharpening of an upscaled frame, 0 to 1
+	const float UPSCALE_SHARPNESS = 0.5f;
+
+	/***********************************************************
+	 *  BuildProgram()
+	 *
+	 *  This function is used for building a program from a
+	 *  vertex and a fragment shader file, returns 0 when it
+	 *  fails.
+	 ***********************************************************/
+	GLuint BuildProgram(const char* vertexFile, const char* fragmentFile)
+	{
+		std::string vertexSource;
+		std::string fragmentSource;
+		if (!ShaderVariants::ReadShaderFile(vertexFile, vertexSource) ||
+			!ShaderVariants::ReadShaderFile(fragmentFile, fragmentSource))
+		{
+			return(0);
+		}
+		GLuint vertexShader = ShaderVariants::CompileStage(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = ShaderVariants::CompileStage(GL_FRAGMENT_SHADER, fragmentSource);
+		if ((vertexShader == 0) || (fragmentShader == 0))
+		{
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+			return(0);
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDetachShader(program, vertexShader);
+		glDetachShader(program, fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "ERROR: " << fragmentFile << " failed to link:" << std::endl << log << std::endl;
+			glDeleteProgram(program);
+			return(0);
+		}
+
+		return(program);
+	}
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	m_program = 0;
+	m_sourceScaleLocation = -1;
+	m_sourceTexelLocation = -1;
+	m_sourceMaxLocation = -1;
+	m_sharpnessLocation = -1;
+	m_vertexArray = 0;
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_previousFramebuffer = 0;
+	m_scale = MAX_SCALE;
+	m_bAutomatic = true;
+	m_targetTimeMs = 1000.0f / DEFAULT_TARGET_FPS;
+	m_smoothedTimeMs = 0.0f;
+	m_framesSinceChange = 0;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  ParseOptions()
+ *
+ *  This method is used for reading the resolution settings
+ *  from the command line:
+ *
+ *      [--target-fps N] [--resolution-scale S]
+ *
+ *  A fixed scale turns the automatic scaling off.
+ ***********************************************************/
+void DynamicResolution::ParseOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "--target-fps") == 0)
+		{
+			float targetFps = (float)atof(argv[i + 1]);
+			if (targetFps > 0.0f)
+			{
+				m_targetTimeMs = 1000.0f / targetFps;
+			}
+			i++;
+		}
+		else if (strcmp(argv[i], "--resolution-scale") == 0)
+		{
+			m_scale = std::min(std::max((float)atof(argv[i + 1]), MIN_SCALE), MAX_SCALE);
+			m_bAutomatic = false;
+			i++;
+		}
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the upscale program.  The
+ *  target itself is created by the first frame, once the size
+ *  of the window is known.
+ ***********************************************************/
+bool DynamicResolution::Initialize(const char* vertexFile, const char* fragmentFile)
+{
+	Destroy();
+
+	GLuint program = BuildProgram(vertexFile, fragmentFile);
+	if (program == 0)
+	{
+		return false;
+	}
+
+	m_program = program;
+	m_sourceScaleLocation = glGetUniformLocation(program, "sourceScale");
+	m_sourceTexelLocation = glGetUniformLocation(program, "sourceTexelSize");
+	m_sourceMaxLocation = glGetUniformLocation(program, "sourceMax");
+	m_sharpnessLocation = glGetUniformLocation(program, "sharpness");
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "sceneTexture"), 0);
+	glUseProgram(0);
+
+	glGenVertexArrays(1, &m_vertexArray);
+
+	return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the program and the
+ *  target.
+ ***********************************************************/
+void DynamicResolution::Destroy()
+{
+	DestroyTarget();
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+	}
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+	}
+
+	m_vertexArray = 0;
+	m_program = 0;
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used for binding the offscreen target and
+ *  setting the viewport to the part of it drawn at the
+ *  current scale.  A minimized window keeps the last target.
+ ***********************************************************/
+void DynamicResolution::BeginScene(int windowWidth, int windowHeight)
+{
+	if (m_program == 0)
+	{
+		glViewport(0, 0, windowWidth, windowHeight);
+		return;
+	}
+
+	if ((windowWidth > 0) && (windowHeight > 0) &&
+		((windowWidth != m_width) || (windowHeight != m_height)))
+	{
+		if (!CreateTarget(windowWidth, windowHeight))
+		{
+			std::cout << "ERROR: the scene target is incomplete, drawing at full resolution" << std::endl;
+			Destroy();
+			glViewport(0, 0, windowWidth, windowHeight);
+			return;
+		}
+	}
+	if (m_framebuffer == 0)
+	{
+		glViewport(0, 0, windowWidth, windowHeight);
+		return;
+	}
+
+	m_renderWidth = std::max((int)(m_width * m_scale + 0.5f), 1);
+	m_renderHeight = std::max((int)(m_height * m_scale + 0.5f), 1);
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  This method is used for drawing the scene into the window
+ *  with one full screen triangle.  The drawn part of the
+ *  target is stretched over the window and sharpened when it
+ *  is smaller, and copied as it is at full size.
+ ***********************************************************/
+void DynamicResolution::EndScene()
+{
+	if ((m_program == 0) || (m_framebuffer == 0))
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+	glViewport(0, 0, m_width, m_height);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glUseProgram(m_program);
+	const float texelWidth = 1.0f / (float)m_width;
+	const float texelHeight = 1.0f / (float)m_height;
+	glUniform2f(m_sourceScaleLocation, (float)m_renderWidth * texelWidth, (float)m_renderHeight * texelHeight);
+	glUniform2f(m_sourceTexelLocation, texelWidth, texelHeight);
+	// the filtered taps stop at the last drawn texel, the rest of
+	// the target still holds frames drawn at a larger scale
+	glUniform2f(m_sourceMaxLocation, ((float)m_renderWidth - 0.5f) * texelWidth, ((float)m_renderHeight - 0.5f) * texelHeight);
+	glUniform1f(m_sharpnessLocation, (m_scale < MAX_SCALE) ? UPSCALE_SHARPNESS : 0.0f);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for moving the scale towards the
+ *  frame budget.  The GPU time is smoothed over a few frames
+ *  so a single slow frame does not change the scale, and the
+ *  scale waits for the frames drawn at its last value to be
+ *  measured before it changes again.
+ ***********************************************************/
+void DynamicResolution::Update(float gpuTimeMs)
+{
+	if (!m_bAutomatic || (m_program == 0) || (gpuTimeMs <= 0.0f))
+	{
+		return;
+	}
+
+	m_smoothedTimeMs = (m_smoothedTimeMs > 0.0f) ?
+		m_smoothedTimeMs + (gpuTimeMs - m_smoothedTimeMs) * SMOOTHING : gpuTimeMs;
+	if (++m_framesSinceChange < SETTLE_FRAMES)
+	{
+		return;
+	}
+
+	const float load = m_smoothedTimeMs / m_targetTimeMs;
+	if ((load < SCALE_DOWN_LOAD) && (load > SCALE_UP_LOAD))
+	{
+		return;
+	}
+
+	// the GPU time goes with the pixel count, the square of the scale
+	float change = sqrtf(TARGET_LOAD / load);
+	change = std::min(std::max(change, MAX_SCALE_DOWN), MAX_SCALE_UP);
+	float scale = floorf(m_scale * change / SCALE_STEP + 0.5f) * SCALE_STEP;
+	scale = std::min(std::max(scale, MIN_SCALE), MAX_SCALE);
+
+	if (scale != m_scale)
+	{
+		m_scale = scale;
+		m_framesSinceChange = 0;
+		m_smoothedTimeMs = 0.0f;
+	}
+}
+
+/***********************************************************
+ *  SetAutomatic()
+ *
+ *  This method is used for turning the automatic scaling on
+ *  or off.  Turning it off draws at full size again.
+ ***********************************************************/
+void DynamicResolution::SetAutomatic(bool bAutomatic)
+{
+	m_bAutomatic = bAutomatic;
+	m_framesSinceChange = 0;
+	m_smoothedTimeMs = 0.0f;
+	if (!bAutomatic)
+	{
+		m_scale = MAX_SCALE;
+	}
+	std::cout << "INFO: dynamic resolution " << (bAutomatic ? "on" : "off") << std::endl;
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating the offscreen target at
+ *  the window size, replacing the previous one.
+ ***********************************************************/
+bool DynamicResolution::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_colorTexture, GpuMemory::MEMORY_TARGETS, (size_t)width * height * 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_RENDERBUFFER, m_depthBuffer, GpuMemory::MEMORY_TARGETS, (size_t)width * height * 4);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	m_width = width;
+	m_height = height;
+
+	return(status == GL_FRAMEBUFFER_COMPLETE);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void DynamicResolution::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+	}
+	if (m_depthBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_RENDERBUFFER, m_depthBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+	}
+	if (m_colorTexture != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_colorTexture);
+		glDeleteTextures(1, &m_colorTexture);
+	}
+
+	m_framebuffer = 0;
+	m_depthBuffer = 0;
+	m_colorTexture = 0;
+	m_width = 0;
+	m_height = 0;
+}
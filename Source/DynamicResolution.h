@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the scene offscreen at a resolution that follows the GPU frame
+// time and upscale it into the window
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class owns an offscreen target the size of the window
+ *  that the scene is drawn into, only using the part of it
+ *  given by the resolution scale.  The scale follows the
+ *  measured GPU time of the scene: it drops when the frames
+ *  run over the frame budget and climbs back while there is
+ *  room, changing by the square root of the time ratio since
+ *  the shading cost goes with the pixel count.  The drawn part
+ *  is stretched over the window with a contrast adaptive
+ *  sharpening pass that restores the edges the upscale blurs.
+ *  The target is kept at the full window size and is only
+ *  created again when the window is resized, so changing the
+ *  scale never reallocates.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// smallest and largest share of the window size drawn per axis
+	static const float MIN_SCALE;
+	static const float MAX_SCALE;
+
+	// constructor
+	DynamicResolution();
+	// destructor
+	~DynamicResolution();
+
+	// read the resolution settings from the command line
+	void ParseOptions(int argc, char* argv[]);
+
+	// build the upscale program, returns false when the scene has
+	// to be drawn straight into the window
+	bool Initialize(const char* vertexFile, const char* fragmentFile);
+	// free the program and the target
+	void Destroy();
+	// true when the scene is drawn offscreen
+	bool IsAvailable() const { return(m_program != 0); }
+
+	// bind the offscreen target at the current scale, sized for the
+	// passed in window framebuffer
+	void BeginScene(int windowWidth, int windowHeight);
+	// upscale the scene into the window framebuffer
+	void EndScene();
+
+	// follow the GPU time of the last measured frame, negative
+	// times are ignored
+	void Update(float gpuTimeMs);
+
+	// turn the automatic scaling on or off, off draws at full size
+	// unless a fixed scale was set
+	void SetAutomatic(bool bAutomatic);
+	bool IsAutomatic() const { return(m_bAutomatic); }
+	// get the share of the window size the scene is drawn at
+	float GetScale() const { return(m_scale); }
+
+private:
+	// program drawing the upscaled scene and its uniforms
+	GLuint m_program;
+	GLint m_sourceScaleLocation;
+	GLint m_sourceTexelLocation;
+	GLint m_sourceMaxLocation;
+	GLint m_sharpnessLocation;
+	// the full screen triangle reads no vertex buffers, but needs a
+	// vertex array bound
+	GLuint m_vertexArray;
+	// offscreen target with its color texture and depth buffer
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthBuffer;
+	// size of the target, the window size
+	int m_width;
+	int m_height;
+	// size the scene is drawn at this frame
+	int m_renderWidth;
+	int m_renderHeight;
+	// framebuffer bound when the scene started
+	GLint m_previousFramebuffer;
+
+	// share of the window size drawn per axis
+	float m_scale;
+	// true when the scale follows the GPU time
+	bool m_bAutomatic;
+	// GPU time budget of a frame in milliseconds
+	float m_targetTimeMs;
+	// smoothed GPU time of the recent frames
+	float m_smoothedTimeMs;
+	// frames measured since the scale last changed
+	int m_framesSinceChange;
+
+	// create the target at the window size
+	bool CreateTarget(int width, int height);
+	// free the target
+	void DestroyTarget();
+};
@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// poll a set of files on a background thread and report the changed ones
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include <chrono>
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_intervalMs = 250;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a file to the watch list.
+ *  The current version of the file is taken as the known one,
+ *  so only later changes are reported.  The same file is only
+ *  watched once.
+ ***********************************************************/
+int FileWatcher::Watch(const std::string& filename)
+{
+	if (IsRunning())
+	{
+		return(-1);
+	}
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].filename == filename)
+		{
+			return((int)i);
+		}
+	}
+
+	WATCHED_FILE file;
+	file.filename = filename;
+	file.reported = ReadStamp(filename);
+	file.pending = file.reported;
+	file.bPending = false;
+	m_files.push_back(file);
+
+	return((int)m_files.size() - 1);
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the polling thread.
+ ***********************************************************/
+void FileWatcher::Start(int intervalMs)
+{
+	if (IsRunning())
+	{
+		return;
+	}
+
+	m_intervalMs = (intervalMs > 0) ? intervalMs : 1;
+	m_bStopping = false;
+	m_thread = std::thread(&FileWatcher::PollLoop, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the polling thread.  The
+ *  thread is woken up instead of waiting for its next poll.
+ ***********************************************************/
+void FileWatcher::Stop()
+{
+	if (!IsRunning())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_stopSignal.notify_all();
+	m_thread.join();
+}
+
+/***********************************************************
+ *  TakeChanges()
+ *
+ *  This method is used for collecting the ids of the files
+ *  that changed since the last call.  A file that changed
+ *  several times is only listed once.
+ ***********************************************************/
+bool FileWatcher::TakeChanges(std::vector<int>& changedIds)
+{
+	changedIds.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	changedIds.swap(m_changedIds);
+
+	return(!changedIds.empty());
+}
+
+/***********************************************************
+ *  HasChanges()
+ *
+ *  This method is used for checking for changed files without
+ *  collecting them.
+ ***********************************************************/
+bool FileWatcher::HasChanges()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(!m_changedIds.empty());
+}
+
+/***********************************************************
+ *  PollLoop()
+ *
+ *  This method is the main loop of the polling thread.
+ ***********************************************************/
+void FileWatcher::PollLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_bStopping)
+	{
+		// the files are checked without holding the lock, so the
+		// main thread never waits on the file system
+		lock.unlock();
+		PollFiles();
+		lock.lock();
+
+		m_stopSignal.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this]() { return(m_bStopping); });
+	}
+}
+
+/***********************************************************
+ *  PollFiles()
+ *
+ *  This method is used for checking every watched file once.
+ *  A new version has to be seen on two polls in a row before
+ *  it is reported, and a missing file is never reported,
+ *  since editors often remove a file before writing it again.
+ ***********************************************************/
+void FileWatcher::PollFiles()
+{
+	std::vector<int> changedIds;
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		WATCHED_FILE& file = m_files[i];
+		FILE_STAMP stamp = ReadStamp(file.filename);
+
+		if (!stamp.bExists || IsSameStamp(stamp, file.reported))
+		{
+			file.bPending = false;
+		}
+		else if (file.bPending && IsSameStamp(stamp, file.pending))
+		{
+			// the new version has settled
+			file.reported = stamp;
+			file.bPending = false;
+			changedIds.push_back((int)i);
+		}
+		else
+		{
+			file.pending = stamp;
+			file.bPending = true;
+		}
+	}
+
+	if (!changedIds.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int id : changedIds)
+		{
+			bool bListed = false;
+			for (int listedId : m_changedIds)
+			{
+				bListed = bListed || (listedId == id);
+			}
+			if (!bListed)
+			{
+				m_changedIds.push_back(id);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ReadStamp()
+ *
+ *  This method is used for reading the modification time and
+ *  the size of a file.  The time is kept at the precision of
+ *  the file system rather than in whole seconds, so that two
+ *  saves within the same second that keep the size are still
+ *  told apart.
+ ***********************************************************/
+FileWatcher::FILE_STAMP FileWatcher::ReadStamp(const std::string& filename)
+{
+	FILE_STAMP stamp;
+	stamp.modifiedTime = 0;
+	stamp.size = 0;
+	stamp.bExists = false;
+
+#ifdef _WIN32
+	// the write time is in 100 nanosecond units
+	WIN32_FILE_ATTRIBUTE_DATA fileInfo;
+	if (GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &fileInfo))
+	{
+		stamp.modifiedTime = (int64_t)(((uint64_t)fileInfo.ftLastWriteTime.dwHighDateTime << 32) |
+			fileInfo.ftLastWriteTime.dwLowDateTime);
+		stamp.size = (int64_t)(((uint64_t)fileInfo.nFileSizeHigh << 32) | fileInfo.nFileSizeLow);
+		stamp.bExists = true;
+	}
+#else
+	// the write time is in nanoseconds
+	struct stat fileInfo;
+	if (stat(filename.c_str(), &fileInfo) == 0)
+	{
+#ifdef __APPLE__
+		stamp.modifiedTime = (int64_t)fileInfo.st_mtimespec.tv_sec * 1000000000 + fileInfo.st_mtimespec.tv_nsec;
+#else
+		stamp.modifiedTime = (int64_t)fileInfo.st_mtim.tv_sec * 1000000000 + fileInfo.st_mtim.tv_nsec;
+#endif
+		stamp.size = (int64_t)fileInfo.st_size;
+		stamp.bExists = true;
+	}
+#endif
+
+	return(stamp);
+}
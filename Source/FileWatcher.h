@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// poll a set of files on a background thread and report the changed ones
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class checks the modification time and the size of
+ *  the watched files on a background thread.  A change is
+ *  only reported once the file has stayed the same for one
+ *  more poll, so an editor that is still writing the file is
+ *  not read half way.  The changes are collected by the main
+ *  thread, which does the reloading since it owns the GL
+ *  context.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+	// destructor - stops the polling thread
+	~FileWatcher();
+
+	// add a file to the watch list, returns its watch id, files
+	// can only be added while the watcher is stopped
+	int Watch(const std::string& filename);
+	// get the file of a watch id
+	const std::string& GetFilename(int watchId) const { return(m_files[watchId].filename); }
+	// get the number of watched files
+	int GetWatchCount() const { return((int)m_files.size()); }
+
+	// start polling the watched files every intervalMs
+	void Start(int intervalMs = 250);
+	// stop the polling thread
+	void Stop();
+	// true while the polling thread runs
+	bool IsRunning() const { return(m_thread.joinable()); }
+
+	// move the ids of the files changed since the last call into
+	// the passed in list, returns false when nothing changed
+	bool TakeChanges(std::vector<int>& changedIds);
+	// true when files changed since the last TakeChanges()
+	bool HasChanges();
+
+private:
+	// FILE_STAMP struct identifies one version of a file
+	struct FILE_STAMP
+	{
+		int64_t modifiedTime;    // in the file system's own units
+		int64_t size;
+		bool bExists;
+	};
+
+	// WATCHED_FILE struct holds the state of one watched file
+	struct WATCHED_FILE
+	{
+		std::string filename;
+		FILE_STAMP reported;     // version the main thread knows about
+		FILE_STAMP pending;      // changed version waiting to settle
+		bool bPending;
+	};
+
+	// watched files, only touched by the polling thread while it runs
+	std::vector<WATCHED_FILE> m_files;
+	// ids of the changed files waiting for the main thread
+	std::vector<int> m_changedIds;
+	// guards the changed ids and the stop flag
+	std::mutex m_mutex;
+	// signaled when the polling thread should exit
+	std::condition_variable m_stopSignal;
+	// polling thread
+	std::thread m_thread;
+	// time between two polls in milliseconds
+	int m_intervalMs;
+	// true when the polling thread should exit
+	bool m_bStopping;
+
+	// main loop of the polling thread
+	void PollLoop();
+	// check every watched file once
+	void PollFiles();
+	// read the current version of a file
+	static FILE_STAMP ReadStamp(const std::string& filename);
+	// true when two versions of a file are the same
+	static bool IsSameStamp(const FILE_STAMP& first, const FILE_STAMP& second)
+		{ return((first.bExists == second.bExists) && (first.modifiedTime == second.modifiedTime) && (first.size == second.size)); }
+};
@@ -0,0 +1,201 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// pace the main loop - vsync, a frame rate cap and redrawing on demand
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of the global variables and defines
+namespace
+{
+	// longest sleep on demand before the scene is checked for
+	// changes again, such as textures that finished loading
+	const double SCENE_CHECK_SECONDS = 0.25;
+	// the end of a capped frame is waited out by yielding, since
+	// a sleep can overshoot by a whole scheduler tick
+	const std::chrono::microseconds CAP_SPIN_TIME(1500);
+
+	// true when the input asked for the next frame to be drawn,
+	// the callbacks and the main loop share the main thread
+	bool g_bRedrawRequested = true;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer()
+{
+	m_bVsync = true;
+	m_frameRateCap = 0.0;
+	m_mode = REDRAW_CONTINUOUS;
+	m_nextFrame = Clock::now();
+}
+
+/***********************************************************
+ *  ParseOptions()
+ *
+ *  This method is used for reading the pacing settings from
+ *  the command line:
+ *
+ *      [--no-vsync] [--fps-cap N] [--on-demand]
+ ***********************************************************/
+void FramePacer::ParseOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (strcmp(argv[i], "--no-vsync") == 0)
+		{
+			m_bVsync = false;
+		}
+		else if ((value != NULL) && (strcmp(argv[i], "--fps-cap") == 0))
+		{
+			SetFrameRateCap(atof(value));
+			i++;
+		}
+		else if (strcmp(argv[i], "--on-demand") == 0)
+		{
+			m_mode = REDRAW_ON_DEMAND;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetVsync()
+ *
+ *  This method is used for turning vsync on or off for the
+ *  current context.
+ ***********************************************************/
+void FramePacer::SetVsync(bool bEnabled)
+{
+	m_bVsync = bEnabled;
+	glfwSwapInterval(bEnabled ? 1 : 0);
+	std::cout << "INFO: vsync " << (bEnabled ? "on" : "off") << std::endl;
+}
+
+/***********************************************************
+ *  SetFrameRateCap()
+ *
+ *  This method is used for limiting the frame rate, with 0 or
+ *  less removing the cap.
+ ***********************************************************/
+void FramePacer::SetFrameRateCap(double framesPerSecond)
+{
+	m_frameRateCap = (framesPerSecond > 0.0) ? framesPerSecond : 0.0;
+	m_nextFrame = Clock::now();
+}
+
+/***********************************************************
+ *  SetRedrawMode()
+ *
+ *  This method is used for choosing when frames are drawn.
+ *  Switching modes draws one more frame, so the display is
+ *  current before the loop goes idle.
+ ***********************************************************/
+void FramePacer::SetRedrawMode(RedrawMode mode)
+{
+	m_mode = mode;
+	g_bRedrawRequested = true;
+	std::cout << "INFO: " << ((mode == REDRAW_ON_DEMAND) ? "redrawing on demand" : "redrawing continuously") << std::endl;
+}
+
+/***********************************************************
+ *  RequestRedraw()
+ *
+ *  This method is used for asking for the next frame to be
+ *  drawn in on demand mode, it has no effect otherwise.
+ ***********************************************************/
+void FramePacer::RequestRedraw()
+{
+	g_bRedrawRequested = true;
+}
+
+/***********************************************************
+ *  WaitForNextFrame()
+ *
+ *  This method is used for processing the events of the
+ *  window and waiting until the next frame is due.  On demand
+ *  the loop sleeps in the event wait until an input callback
+ *  or the scene asks for a frame, and closing the window
+ *  always ends the wait.
+ ***********************************************************/
+void FramePacer::WaitForNextFrame(GLFWwindow* window, const std::function<bool()>& hasSceneChanges)
+{
+	if (m_mode == REDRAW_ON_DEMAND)
+	{
+		// the frame just drawn has taken its request
+		g_bRedrawRequested = false;
+		glfwPollEvents();
+		bool bWaited = false;
+		while (!g_bRedrawRequested && !glfwWindowShouldClose(window))
+		{
+			if (hasSceneChanges && hasSceneChanges())
+			{
+				g_bRedrawRequested = true;
+				break;
+			}
+			glfwWaitEventsTimeout(SCENE_CHECK_SECONDS);
+			bWaited = true;
+		}
+		// a frame drawn after a sleep is already late for the cap
+		// and starts a new grid
+		if (bWaited)
+		{
+			m_nextFrame = Clock::now();
+			return;
+		}
+	}
+	else
+	{
+		glfwPollEvents();
+	}
+
+	WaitForFrameCap();
+}
+
+/***********************************************************
+ *  WaitForFrameCap()
+ *
+ *  This method is used for sleeping until the next frame of
+ *  the frame rate cap.  The frame times are kept on a fixed
+ *  grid, so the average rate holds even when single frames
+ *  wake up late, and a frame that ran over starts a new grid.
+ ***********************************************************/
+void FramePacer::WaitForFrameCap()
+{
+	if (m_frameRateCap <= 0.0)
+	{
+		return;
+	}
+
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / m_frameRateCap));
+	m_nextFrame += period;
+
+	Clock::time_point now = Clock::now();
+	if (m_nextFrame <= now)
+	{
+		m_nextFrame = now;
+		return;
+	}
+
+	if (m_nextFrame - now > CAP_SPIN_TIME)
+	{
+		std::this_thread::sleep_until(m_nextFrame - CAP_SPIN_TIME);
+	}
+	while (Clock::now() < m_nextFrame)
+	{
+		std::this_thread::yield();
+	}
+}
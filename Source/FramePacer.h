@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// pace the main loop - vsync, a frame rate cap and redrawing on demand
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLFW/glfw3.h"
+
+#include <chrono>
+#include <functional>
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  This class decides when the main loop draws its next
+ *  frame.  Continuous mode draws frame after frame, limited
+ *  by vsync and optionally by a frame rate cap, which sleeps
+ *  the rest of each frame away instead of spinning.  On
+ *  demand mode sleeps in glfwWaitEvents until the input moved
+ *  the camera or the scene changed, so an idle display uses
+ *  next to no CPU or GPU time.  The input callbacks ask for
+ *  the next frame through RequestRedraw().
+ ***********************************************************/
+class FramePacer
+{
+public:
+	// RedrawMode enum selects when frames are drawn
+	enum RedrawMode
+	{
+		REDRAW_CONTINUOUS = 0,
+		REDRAW_ON_DEMAND
+	};
+
+	// constructor
+	FramePacer();
+
+	// read the pacing settings from the command line
+	void ParseOptions(int argc, char* argv[]);
+
+	// sync the swaps to the display refresh, applied to the current
+	// context right away
+	void SetVsync(bool bEnabled);
+	bool IsVsyncEnabled() const { return(m_bVsync); }
+	// limit the frame rate, 0 draws as fast as the swaps allow
+	void SetFrameRateCap(double framesPerSecond);
+	double GetFrameRateCap() const { return(m_frameRateCap); }
+	// choose when frames are drawn
+	void SetRedrawMode(RedrawMode mode);
+	RedrawMode GetRedrawMode() const { return(m_mode); }
+
+	// ask for the next frame to be drawn, called by the input
+	// whenever it changed what is on screen
+	static void RequestRedraw();
+
+	// process the events and wait until the next frame is due, the
+	// scene check is polled while the loop sleeps on demand and
+	// returns true when the scene has changes to draw
+	void WaitForNextFrame(GLFWwindow* window, const std::function<bool()>& hasSceneChanges);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// true when the swaps wait for the display refresh
+	bool m_bVsync;
+	// most frames per second, 0 for no cap
+	double m_frameRateCap;
+	// when frames are drawn
+	RedrawMode m_mode;
+	// earliest start of the next frame under the cap
+	Clock::time_point m_nextFrame;
+
+	// sleep until the next frame of the cap is due
+	void WaitForFrameCap();
+};
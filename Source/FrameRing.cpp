@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// framering.cpp
+// ============
+// persistently mapped buffer split into one region per frame in flight
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRing.h"
+#include "GpuMemory.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// longest single wait for a fence, in nanoseconds
+	const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+	/***********************************************************
+	 *  AlignSize()
+	 *
+	 *  This function is used for rounding a size up to the
+	 *  passed in alignment, which does not have to be a power
+	 *  of two.
+	 ***********************************************************/
+	size_t AlignSize(size_t size, size_t alignment)
+	{
+		return((size + alignment - 1) / alignment * alignment);
+	}
+}
+
+/***********************************************************
+ *  FrameRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameRing::FrameRing()
+{
+	m_target = GL_ARRAY_BUFFER;
+	m_buffer = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_alignment = 1;
+	m_frame = 0;
+	m_used = 0;
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		m_fences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~FrameRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameRing::~FrameRing()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for immutable buffer
+ *  storage, the only way to keep a buffer mapped while it is
+ *  drawn from.
+ ***********************************************************/
+bool FrameRing::IsSupported()
+{
+	return(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer and mapping
+ *  it once.  The mapping is coherent, so the writes of a
+ *  frame reach the GPU without a flush.  A ring that already
+ *  has a buffer is created again with the new size, and the
+ *  old buffer is only freed once the new one exists, so the
+ *  new buffer never reuses the old name.
+ ***********************************************************/
+bool FrameRing::Initialize(GLenum target, size_t regionSize, size_t alignment)
+{
+	if (!IsSupported() || (regionSize == 0) || (alignment == 0))
+	{
+		return false;
+	}
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const size_t alignedRegionSize = AlignSize(regionSize, alignment);
+
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferStorage(target, alignedRegionSize * FRAMES_IN_FLIGHT, NULL, flags);
+	void* pMapped = glMapBufferRange(target, 0, alignedRegionSize * FRAMES_IN_FLIGHT, flags);
+	glBindBuffer(target, 0);
+
+	if (pMapped == NULL)
+	{
+		std::cout << "Could not map the frame ring buffer" << std::endl;
+		glDeleteBuffers(1, &buffer);
+		return false;
+	}
+
+	Destroy();
+
+	m_target = target;
+	m_buffer = buffer;
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, buffer, GpuMemory::MEMORY_BUFFERS, alignedRegionSize * FRAMES_IN_FLIGHT);
+	m_pMapped = (unsigned char*)pMapped;
+	m_regionSize = alignedRegionSize;
+	m_alignment = alignment;
+	m_frame = 0;
+	m_used = 0;
+
+	return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for unmapping and freeing the buffer.
+ *  The GL keeps the storage until the draws still reading it
+ *  are done.
+ ***********************************************************/
+void FrameRing::Destroy()
+{
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		if (m_fences[i] != NULL)
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = NULL;
+		}
+	}
+
+	if (m_buffer != 0)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glUnmapBuffer(m_target);
+		glBindBuffer(m_target, 0);
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_buffer);
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	m_buffer = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_used = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving to the region of the next
+ *  frame.  The fence of the frame that last wrote the region
+ *  is polled first, and only waited on when the GPU has not
+ *  passed it yet.
+ ***********************************************************/
+bool FrameRing::BeginFrame()
+{
+	m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+	m_used = 0;
+
+	GLsync fence = m_fences[m_frame];
+	if (fence == NULL)
+	{
+		return false;
+	}
+
+	bool bStalled = false;
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	while (status == GL_TIMEOUT_EXPIRED)
+	{
+		bStalled = true;
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	}
+
+	glDeleteSync(fence);
+	m_fences[m_frame] = NULL;
+
+	return(bStalled);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the commands of the
+ *  current frame, which are the last ones reading its region.
+ ***********************************************************/
+void FrameRing::EndFrame()
+{
+	if (m_buffer == 0)
+	{
+		return;
+	}
+
+	if (m_fences[m_frame] != NULL)
+	{
+		glDeleteSync(m_fences[m_frame]);
+	}
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking space from the region of
+ *  the current frame.  The returned memory is only written,
+ *  it may be uncached and slow to read back.
+ ***********************************************************/
+void* FrameRing::Allocate(size_t size, size_t& offset)
+{
+	size_t start = AlignSize(m_used, m_alignment);
+	if ((m_pMapped == NULL) || (start + size > m_regionSize))
+	{
+		return(NULL);
+	}
+
+	m_used = start + size;
+	offset = (size_t)m_frame * m_regionSize + start;
+
+	return(m_pMapped + offset);
+}
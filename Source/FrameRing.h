@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// framering.h
+// ============
+// persistently mapped buffer split into one region per frame in flight
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  FrameRing
+ *
+ *  This class owns a buffer that stays mapped for its whole
+ *  life, split into one region for each frame in flight.  A
+ *  frame writes its data straight into its own region while
+ *  the GPU still reads the regions of the previous frames,
+ *  and a fence placed after each frame tells when its region
+ *  can be written again.  The CPU only waits when it gets a
+ *  whole ring ahead of the GPU, which is counted as a stall.
+ ***********************************************************/
+class FrameRing
+{
+public:
+	// frames the CPU can build ahead of the GPU
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	// constructor
+	FrameRing();
+	// destructor
+	~FrameRing();
+
+	// true when the context can keep a buffer mapped while the
+	// GPU reads it
+	static bool IsSupported();
+
+	// create the mapped buffer with a region of the passed in size
+	// for each frame, allocations start on multiples of the alignment,
+	// returns false when persistent mapping is not supported
+	bool Initialize(GLenum target, size_t regionSize, size_t alignment);
+	// unmap and free the buffer
+	void Destroy();
+	// true while the buffer is mapped
+	bool IsAvailable() const { return(m_pMapped != NULL); }
+
+	// move to the region of the next frame and wait until the GPU
+	// is done with it, returns true if the CPU had to wait
+	bool BeginFrame();
+	// place the fence after the commands reading the current region
+	void EndFrame();
+
+	// take space from the region of the current frame, returns NULL
+	// when the region is full, the offset is from the buffer start
+	void* Allocate(size_t size, size_t& offset);
+
+	// get the buffer object
+	GLuint GetBuffer() const { return(m_buffer); }
+	// get the size of the region of each frame
+	size_t GetRegionSize() const { return(m_regionSize); }
+
+private:
+	// buffer object and the target it is bound to
+	GLenum m_target;
+	GLuint m_buffer;
+	// start of the mapped buffer
+	unsigned char* m_pMapped;
+	// size of each region and the alignment of the allocations
+	size_t m_regionSize;
+	size_t m_alignment;
+	// region of the current frame and the bytes taken from it
+	int m_frame;
+	size_t m_used;
+	// fence placed after the last frame that used each region,
+	// NULL once the region is free
+	GLsync m_fences[FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+// ============
+// test packed object bounding boxes against the camera frustum
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+// SSE is always present on x64, and x86 builds enable it with
+// /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRUSTUM_CULLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+	// until a frustum is set every box is inside
+	for (int i = 0; i < 6; i++)
+	{
+		m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	m_count = 0;
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for extracting the six frustum planes
+ *  from the rows of a combined view-projection matrix.  The
+ *  planes are normalized so that the plane test returns a
+ *  distance that compares against the box extents.
+ ***********************************************************/
+void FrustumCuller::SetViewProjection(const glm::mat4& viewProjection)
+{
+	const glm::mat4& m = viewProjection;
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+	}
+
+	m_planes[0] = rows[3] + rows[0];     // left
+	m_planes[1] = rows[3] - rows[0];     // right
+	m_planes[2] = rows[3] + rows[1];     // bottom
+	m_planes[3] = rows[3] - rows[1];     // top
+	m_planes[4] = rows[3] + rows[2];     // near
+	m_planes[5] = rows[3] - rows[2];     // far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = sqrtf(m_planes[i].x * m_planes[i].x +
+			m_planes[i].y * m_planes[i].y +
+			m_planes[i].z * m_planes[i].z);
+		if (length > 0.0f)
+		{
+			m_planes[i] = m_planes[i] * (1.0f / length);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetBoundsCount()
+ *
+ *  This method is used for setting the number of bounding
+ *  boxes.  The arrays are padded to the SIMD width with empty
+ *  boxes, so the test never needs a scalar tail.
+ ***********************************************************/
+void FrustumCuller::SetBoundsCount(int count)
+{
+	size_t padded = (size_t)((count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH);
+
+	m_centerX.assign(padded, 0.0f);
+	m_centerY.assign(padded, 0.0f);
+	m_centerZ.assign(padded, 0.0f);
+	m_extentX.assign(padded, 0.0f);
+	m_extentY.assign(padded, 0.0f);
+	m_extentZ.assign(padded, 0.0f);
+	m_count = count;
+}
+
+/***********************************************************
+ *  SetBounds()
+ *
+ *  This method is used for setting the world bounding box of
+ *  an object from its center and half extents.
+ ***********************************************************/
+void FrustumCuller::SetBounds(int index, const glm::vec3& center, const glm::vec3& extents)
+{
+	m_centerX[index] = center.x;
+	m_centerY[index] = center.y;
+	m_centerZ[index] = center.z;
+	m_extentX[index] = extents.x;
+	m_extentY[index] = extents.y;
+	m_extentZ[index] = extents.z;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing every bounding box
+ *  against the frustum planes.  A box is outside a plane when
+ *  the distance of its center is below minus its extent
+ *  projected onto the plane normal.
+ ***********************************************************/
+int FrustumCuller::Cull(std::vector<unsigned char>& visible) const
+{
+	visible.resize(m_count);
+
+	return(Cull(visible, 0, m_count));
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing the bounding boxes of a
+ *  part of the list, so that several threads can each test
+ *  their own part.  The visibility flags must already hold
+ *  one entry per box.
+ ***********************************************************/
+int FrustumCuller::Cull(std::vector<unsigned char>& visible, int first, int last) const
+{
+	int visibleCount = 0;
+	int i = first;
+
+#ifdef FRUSTUM_CULLER_SSE
+	// broadcast every plane and the absolute value of its
+	// normal once, the normals project the extents
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m128 absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(m_planes[p].x);
+		planeY[p] = _mm_set1_ps(m_planes[p].y);
+		planeZ[p] = _mm_set1_ps(m_planes[p].z);
+		planeW[p] = _mm_set1_ps(m_planes[p].w);
+		absX[p] = _mm_set1_ps(fabsf(m_planes[p].x));
+		absY[p] = _mm_set1_ps(fabsf(m_planes[p].y));
+		absZ[p] = _mm_set1_ps(fabsf(m_planes[p].z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	// whole groups of four boxes, the rest is tested one by one
+	for (; i + SIMD_WIDTH <= last; i += SIMD_WIDTH)
+	{
+		__m128 cx = _mm_loadu_ps(&m_centerX[i]);
+		__m128 cy = _mm_loadu_ps(&m_centerY[i]);
+		__m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&m_extentX[i]);
+		__m128 ey = _mm_loadu_ps(&m_extentY[i]);
+		__m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)),
+				_mm_mul_ps(absZ[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < SIMD_WIDTH; lane++)
+		{
+			visible[i + lane] = ((outsideMask >> lane) & 1) ? 0 : 1;
+			visibleCount += visible[i + lane];
+		}
+	}
+#endif
+
+	for (; i < last; i++)
+	{
+		bool bOutside = false;
+		for (int p = 0; (p < 6) && !bOutside; p++)
+		{
+			const glm::vec4& plane = m_planes[p];
+			float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+			float radius = fabsf(plane.x) * m_extentX[i] + fabsf(plane.y) * m_extentY[i] + fabsf(plane.z) * m_extentZ[i];
+			bOutside = (distance + radius < 0.0f);
+		}
+
+		visible[i] = bOutside ? 0 : 1;
+		visibleCount += visible[i];
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method is used for testing a single bounding box, in
+ *  the same way Cull() tests the packed boxes.
+ ***********************************************************/
+bool FrustumCuller::IsBoxVisible(const glm::vec3& center, const glm::vec3& extents) const
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = m_planes[p];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float radius = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if (distance + radius < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for transforming a local bounding box
+ *  by a model matrix.  The half extents of the world box are
+ *  the local half extents projected onto each world axis by
+ *  the absolute rotation and scale of the matrix.
+ ***********************************************************/
+void FrustumCuller::TransformBounds(
+	const glm::mat4& model,
+	const glm::vec3& localMin,
+	const glm::vec3& localMax,
+	glm::vec3& center,
+	glm::vec3& extents)
+{
+	glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+	glm::vec3 localExtents = (localMax - localMin) * 0.5f;
+
+	center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+	for (int axis = 0; axis < 3; axis++)
+	{
+		extents[axis] =
+			fabsf(model[0][axis]) * localExtents.x +
+			fabsf(model[1][axis]) * localExtents.y +
+			fabsf(model[2][axis]) * localExtents.z;
+	}
+}
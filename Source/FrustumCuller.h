@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+// ============
+// test packed object bounding boxes against the camera frustum
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class keeps the world bounding boxes of the scene
+ *  objects as packed arrays of centers and half extents, one
+ *  array per axis, and tests them against the six planes of
+ *  the camera frustum.  The packed layout lets the test run
+ *  on four boxes at a time with SSE.  A box is only culled
+ *  when it is completely outside one of the planes, so the
+ *  test is conservative.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// constructor
+	FrustumCuller();
+
+	// set the frustum planes from a combined view-projection matrix
+	void SetViewProjection(const glm::mat4& viewProjection);
+
+	// set the number of bounding boxes, all of them become empty
+	void SetBoundsCount(int count);
+	// set the world bounding box of an object
+	void SetBounds(int index, const glm::vec3& center, const glm::vec3& extents);
+	// get the number of bounding boxes
+	int GetBoundsCount() const { return(m_count); }
+	// get the six frustum planes, the normals point inside
+	const glm::vec4* GetPlanes() const { return(m_planes); }
+
+	// test every bounding box against the frustum, one visibility
+	// flag per box is written, returns the number of visible boxes
+	int Cull(std::vector<unsigned char>& visible) const;
+	// test the bounding boxes [first, last) against the frustum
+	int Cull(std::vector<unsigned char>& visible, int first, int last) const;
+	// test one bounding box against the frustum
+	bool IsBoxVisible(const glm::vec3& center, const glm::vec3& extents) const;
+
+	// transform a local bounding box into a world bounding box
+	// given as a center and half extents
+	static void TransformBounds(
+		const glm::mat4& model,
+		const glm::vec3& localMin,
+		const glm::vec3& localMax,
+		glm::vec3& center,
+		glm::vec3& extents);
+
+private:
+	// boxes tested together, the arrays are padded to a multiple
+	static const int SIMD_WIDTH = 4;
+
+	// frustum planes as (normal, distance), normals point inside
+	glm::vec4 m_planes[6];
+	// packed box centers and half extents of each axis
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	// number of bounding boxes, without the padding
+	int m_count;
+};
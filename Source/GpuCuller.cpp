@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull the scene objects in a compute shader and draw the visible ones with
+// indirect draw commands
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "GpuMemory.h"
+#include "MeshManager.h"
+#include "ShaderVariants.h"
+#include "UniformCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+// the buffers are read by the compute shader as they are, so the
+// structs have to match its std430 layout and the instance attributes
+static_assert(offsetof(GpuCuller::GPU_OBJECT, boundsCenter) == 64, "CullObject layout does not match std430");
+static_assert(offsetof(GpuCuller::GPU_OBJECT, command) == 96, "CullObject layout does not match std430");
+static_assert(sizeof(GpuCuller::GPU_OBJECT) == 112, "CullObject layout does not match std430");
+static_assert(sizeof(GpuCuller::DRAW_COMMAND) == 20, "DrawCommand layout does not match the indirect command");
+static_assert(sizeof(MeshManager::INSTANCE_DATA) == 18 * sizeof(GLuint), "the instance layout does not match the compute shader");
+
+// declaration of the global variables and defines
+namespace
+{
+	// objects culled by each compute work group, this matches the shader
+	const int CULL_GROUP_SIZE = 64;
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_program = 0;
+	m_objectBuffer = 0;
+	m_commandBuffer = 0;
+	m_instanceBuffer = 0;
+	m_objectCount = 0;
+	m_planesLocation = -1;
+	m_objectCountLocation = -1;
+	m_cameraPositionLocation = -1;
+	m_lodScaleLocation = -1;
+	m_lodSwitchSizesLocation = -1;
+	m_lodHysteresisLocation = -1;
+	m_occlusionLocation = -1;
+	m_hiZPyramidLocation = -1;
+	m_occlusionViewProjectionLocation = -1;
+	m_occlusionUnit = -1;
+	m_occlusionViewProjection = glm::mat4(1.0f);
+	m_readbackSlot = 0;
+	m_visibleCount = -1;
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		m_readbackBuffers[i] = 0;
+		m_readbackFences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the culling program and
+ *  creating the buffers.  Compute shaders, shader storage
+ *  buffers and multi-draw indirect all arrive with OpenGL 4.3,
+ *  so anything older leaves the culler unavailable.
+ ***********************************************************/
+bool GpuCuller::Initialize(const char* computeFile)
+{
+	Destroy();
+
+	if (!GLEW_VERSION_4_3)
+	{
+		return false;
+	}
+
+	std::string source;
+	if (!ShaderVariants::ReadShaderFile(computeFile, source))
+	{
+		return false;
+	}
+	GLuint shader = ShaderVariants::CompileStage(GL_COMPUTE_SHADER, source);
+	if (shader == 0)
+	{
+		return false;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, shader);
+	glLinkProgram(program);
+	glDetachShader(program, shader);
+	glDeleteShader(shader);
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+	if (bLinked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cout << "ERROR: culling shader failed to link:" << std::endl << log << std::endl;
+		glDeleteProgram(program);
+		return false;
+	}
+
+	m_program = program;
+	m_planesLocation = glGetUniformLocation(program, "frustumPlanes");
+	m_objectCountLocation = glGetUniformLocation(program, "objectCount");
+	m_cameraPositionLocation = glGetUniformLocation(program, "cameraPosition");
+	m_lodScaleLocation = glGetUniformLocation(program, "lodScale");
+	m_lodSwitchSizesLocation = glGetUniformLocation(program, "lodSwitchSizes");
+	m_lodHysteresisLocation = glGetUniformLocation(program, "lodHysteresis");
+	m_occlusionLocation = glGetUniformLocation(program, "bOcclusion");
+	m_hiZPyramidLocation = glGetUniformLocation(program, "hiZPyramid");
+	m_occlusionViewProjectionLocation = glGetUniformLocation(program, "occlusionViewProjection");
+
+	// the switch sizes never change, so they are set once
+	float switchSizes[MeshManager::LOD_COUNT - 1];
+	for (int lod = 0; lod < MeshManager::LOD_COUNT - 1; lod++)
+	{
+		switchSizes[lod] = MeshManager::GetLodSwitchSize(lod);
+	}
+	glUseProgram(program);
+	glUniform1fv(m_lodSwitchSizesLocation, MeshManager::LOD_COUNT - 1, switchSizes);
+	glUniform1f(m_lodHysteresisLocation, MeshManager::GetLodHysteresis());
+	glUseProgram(0);
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+	glGenBuffers(1, &m_instanceBuffer);
+	glGenBuffers(READBACK_LATENCY, m_readbackBuffers);
+
+	return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the program and buffers.
+ ***********************************************************/
+void GpuCuller::Destroy()
+{
+	if (m_program != 0)
+	{
+		ClearReadbacks();
+		for (int i = 0; i < READBACK_LATENCY; i++)
+		{
+			GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_readbackBuffers[i]);
+		}
+		glDeleteBuffers(READBACK_LATENCY, m_readbackBuffers);
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_instanceBuffer);
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_commandBuffer);
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_objectBuffer);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		glDeleteBuffers(1, &m_commandBuffer);
+		glDeleteBuffers(1, &m_objectBuffer);
+		glDeleteProgram(m_program);
+	}
+
+	m_program = 0;
+	m_objectBuffer = 0;
+	m_commandBuffer = 0;
+	m_instanceBuffer = 0;
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		m_readbackBuffers[i] = 0;
+	}
+	m_objectCount = 0;
+	m_commands.clear();
+	m_culledCommands.clear();
+	m_objects.clear();
+	m_changedObjects.clear();
+	m_visibleCount = -1;
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the objects and their
+ *  draw commands.  Every command has a slot for each object
+ *  that could be drawn with it, so all of them fit when
+ *  nothing is culled whatever level they choose.
+ ***********************************************************/
+void GpuCuller::SetObjects(const std::vector<GPU_OBJECT>& objects, const std::vector<DRAW_COMMAND>& commands, int instanceSlots)
+{
+	if (m_program == 0)
+	{
+		return;
+	}
+
+	m_objectCount = (int)objects.size();
+	m_objects = objects;
+	m_changedObjects.clear();
+	m_commands = commands;
+	for (DRAW_COMMAND& command : m_commands)
+	{
+		command.instanceCount = 0;
+	}
+	m_culledCommands.resize(m_commands.size());
+
+	// the copies of the previous commands no longer match them
+	ClearReadbacks();
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_readbackBuffers[i]);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_commands.size() * sizeof(DRAW_COMMAND), NULL, GL_STREAM_READ);
+		GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_readbackBuffers[i], GpuMemory::MEMORY_BUFFERS, m_commands.size() * sizeof(DRAW_COMMAND));
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(GPU_OBJECT), objects.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instanceSlots * sizeof(MeshManager::INSTANCE_DATA), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DRAW_COMMAND), m_commands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_objectBuffer, GpuMemory::MEMORY_BUFFERS, objects.size() * sizeof(GPU_OBJECT));
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_instanceBuffer, GpuMemory::MEMORY_BUFFERS, instanceSlots * sizeof(MeshManager::INSTANCE_DATA));
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_commandBuffer, GpuMemory::MEMORY_BUFFERS, m_commands.size() * sizeof(DRAW_COMMAND));
+}
+
+/***********************************************************
+ *  UpdateObject()
+ *
+ *  This method is used for moving one object without handing
+ *  the culler all of the objects again.  Only the transform
+ *  and the bounds are uploaded, so the level of detail the
+ *  compute shader keeps in the object stays as it is.
+ ***********************************************************/
+void GpuCuller::UpdateObject(int objectIndex, const glm::mat4& model, const glm::vec3& boundsCenter, const glm::vec3& boundsExtents)
+{
+	if ((objectIndex < 0) || (objectIndex >= m_objectCount))
+	{
+		return;
+	}
+
+	GPU_OBJECT& object = m_objects[objectIndex];
+	object.model = model;
+	object.boundsCenter = glm::vec4(boundsCenter, 0.0f);
+	object.boundsExtents = glm::vec4(boundsExtents, 0.0f);
+	m_changedObjects.push_back(objectIndex);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for culling the objects on the GPU.
+ *  The moved objects are uploaded, the instance counts of the
+ *  commands are cleared, one invocation per object tests its
+ *  bounds and appends it to its command, and the barrier makes
+ *  the results visible to the indirect draws and the instance
+ *  attributes.  The culled commands are then copied for the
+ *  read back of the visible count.  The frame waits on nothing,
+ *  the draws are queued behind the dispatch.
+ ***********************************************************/
+void GpuCuller::Cull(const glm::vec4* planes, const glm::vec3& cameraPosition, float lodScale)
+{
+	if ((m_program == 0) || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	CollectVisibleCount();
+
+	// an object moved twice is uploaded twice, with the same
+	// values, which is cheaper than sorting out the duplicates
+	if (!m_changedObjects.empty())
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+		for (int objectIndex : m_changedObjects)
+		{
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, objectIndex * sizeof(GPU_OBJECT), offsetof(GPU_OBJECT, command),
+				&m_objects[objectIndex]);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		UniformCache::CountUploads((int)m_changedObjects.size());
+		m_changedObjects.clear();
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(DRAW_COMMAND), m_commands.data());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	UniformCache::CountUploads(1);
+
+	glUseProgram(m_program);
+	glUniform4fv(m_planesLocation, 6, &planes[0].x);
+	glUniform1ui(m_objectCountLocation, (GLuint)m_objectCount);
+	glUniform3fv(m_cameraPositionLocation, 1, &cameraPosition.x);
+	glUniform1f(m_lodScaleLocation, lodScale);
+	glUniform1i(m_occlusionLocation, (m_occlusionUnit >= 0) ? 1 : 0);
+	if (m_occlusionUnit >= 0)
+	{
+		glUniform1i(m_hiZPyramidLocation, m_occlusionUnit);
+		glUniformMatrix4fv(m_occlusionViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(m_occlusionViewProjection));
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_instanceBuffer);
+	glDispatchCompute((GLuint)((m_objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// a copy still in flight is not waited for, this cull is just
+	// not counted
+	if (m_readbackFences[m_readbackSlot] == NULL)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_readbackBuffers[m_readbackSlot]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_commands.size() * sizeof(DRAW_COMMAND));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		m_readbackFences[m_readbackSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_readbackSlot = (m_readbackSlot + 1) % READBACK_LATENCY;
+	}
+}
+
+/***********************************************************
+ *  CollectVisibleCount()
+ *
+ *  This method is used for reading back the command copies
+ *  whose fences the GPU has passed, oldest first so that the
+ *  newest count wins.  Each visible object added one instance
+ *  to the command of its level, so the instance counts sum up
+ *  to the visible objects.
+ ***********************************************************/
+void GpuCuller::CollectVisibleCount()
+{
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		int slot = (m_readbackSlot + i) % READBACK_LATENCY;
+		GLsync fence = m_readbackFences[slot];
+		if (fence == NULL)
+		{
+			continue;
+		}
+
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+		{
+			continue;
+		}
+		glDeleteSync(fence);
+		m_readbackFences[slot] = NULL;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, m_readbackBuffers[slot]);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_culledCommands.size() * sizeof(DRAW_COMMAND), m_culledCommands.data());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+		int visibleCount = 0;
+		for (const DRAW_COMMAND& command : m_culledCommands)
+		{
+			visibleCount += (int)command.instanceCount;
+		}
+		m_visibleCount = visibleCount;
+	}
+}
+
+/***********************************************************
+ *  ClearReadbacks()
+ *
+ *  This method is used for dropping the command copies that
+ *  were not read back yet, along with the latest count.
+ ***********************************************************/
+void GpuCuller::ClearReadbacks()
+{
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (m_readbackFences[i] != NULL)
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = NULL;
+		}
+	}
+	m_visibleCount = -1;
+}
+
+/***********************************************************
+ *  SetOcclusion()
+ *
+ *  This method is used for choosing the Hi-Z pyramid the next
+ *  culls test the objects against.  The pyramid has to match
+ *  the frustum planes of the cull, so it is set again for
+ *  every frame that has one.
+ ***********************************************************/
+void GpuCuller::SetOcclusion(int textureUnit, const glm::mat4& viewProjection)
+{
+	m_occlusionUnit = textureUnit;
+	m_occlusionViewProjection = viewProjection;
+}
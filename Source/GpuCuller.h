@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the scene objects in a compute shader and draw the visible ones with
+// indirect draw commands
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class keeps the objects of the scene in a shader
+ *  storage buffer, with the model matrix, the world bounds and
+ *  the indirect draw commands of every object, one for each
+ *  level of detail of its mesh.  Each frame a compute shader
+ *  tests the objects against the frustum and, when there is
+ *  one, the Hi-Z pyramid of the occluders, chooses their level
+ *  from their size on screen and appends the visible ones to
+ *  the instances of the command of that level,
+ *  so the CPU neither culls nor streams instance data, and the
+ *  commands are drawn with glMultiDrawElementsIndirect.  The
+ *  commands are copied after each cull and read back once the
+ *  GPU is done with them, which gives the number of visible
+ *  objects a few frames late without ever waiting.  It needs
+ *  OpenGL 4.3, without it the scene keeps culling and batching
+ *  the objects on the CPU.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// GPU_OBJECT struct is one object of the std430 object buffer
+	struct GPU_OBJECT
+	{
+		glm::mat4 model;
+		glm::vec4 boundsCenter;  // world bounding box center
+		glm::vec4 boundsExtents; // world bounding box half extents
+		GLint command;           // indirect draw command of level 0, the
+		                         // other levels follow it
+		GLint materialIndex;
+		GLint textureIndex;
+		GLint lodState;          // number of levels in the low byte, the
+		                         // level drawn last in the next byte,
+		                         // and LOD_STATE_OCCLUDER
+	};
+
+	// lodState bit of the objects drawn into the Hi-Z pyramid, which
+	// are tested with a small depth bias so their own depth in the
+	// pyramid never hides them
+	static const GLint LOD_STATE_OCCLUDER = 1 << 16;
+
+	// DRAW_COMMAND struct is the DrawElementsIndirectCommand
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;    // set by the compute shader
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;     // first instance slot of the command
+	};
+
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// build the culling program and the buffers, returns false
+	// when the GPU cannot cull
+	bool Initialize(const char* computeFile);
+	// free the program and the buffers
+	void Destroy();
+	// true when the objects are culled on the GPU
+	bool IsAvailable() const { return(m_program != 0); }
+
+	// replace the objects and their draw commands - the objects
+	// of a command need as many instance slots after its base
+	// instance, out of the passed in number of slots
+	void SetObjects(const std::vector<GPU_OBJECT>& objects, const std::vector<DRAW_COMMAND>& commands, int instanceSlots);
+	// replace the transform and the bounds of one object in place,
+	// the change is uploaded by the next cull
+	void UpdateObject(int objectIndex, const glm::mat4& model, const glm::vec3& boundsCenter, const glm::vec3& boundsExtents);
+	// cull the objects against the frustum planes, choose their
+	// levels of detail and fill in the instances of the draw
+	// commands, a level scale of 0 keeps the finest level
+	void Cull(const glm::vec4* planes, const glm::vec3& cameraPosition, float lodScale);
+	// test the objects of the next culls against the Hi-Z pyramid
+	// bound to the texture unit, rendered with the passed in camera,
+	// a negative unit turns the occlusion test off
+	void SetOcclusion(int textureUnit, const glm::mat4& viewProjection);
+
+	// get the buffer the visible instances are written into, in
+	// the layout of the instance vertex attributes
+	GLuint GetInstanceBuffer() const { return(m_instanceBuffer); }
+	// get the buffer of the indirect draw commands
+	GLuint GetCommandBuffer() const { return(m_commandBuffer); }
+	// get the number of objects
+	int GetObjectCount() const { return(m_objectCount); }
+	// get the number of objects the latest read back cull found
+	// visible, -1 until a cull of the current objects is read back
+	int GetVisibleCount() const { return(m_visibleCount); }
+
+private:
+	// number of command copies in flight for the read back
+	static const int READBACK_LATENCY = 3;
+
+	// compute program culling the objects
+	GLuint m_program;
+	// storage buffer of the objects
+	GLuint m_objectBuffer;
+	// indirect draw commands, also written by the compute shader
+	GLuint m_commandBuffer;
+	// instance attributes of the visible objects
+	GLuint m_instanceBuffer;
+	// number of objects in the object buffer
+	int m_objectCount;
+	// draw commands with no instances, uploaded before each cull
+	std::vector<DRAW_COMMAND> m_commands;
+	// scratch copy of the culled commands read back, sized with the
+	// commands so reading them back allocates nothing
+	std::vector<DRAW_COMMAND> m_culledCommands;
+	// CPU copy of the objects, and the ones changed since the last
+	// cull, whose transform and bounds are uploaded by it
+	std::vector<GPU_OBJECT> m_objects;
+	std::vector<int> m_changedObjects;
+	// copies of the culled commands waiting to be read back, each
+	// with the fence placed after its copy
+	GLuint m_readbackBuffers[READBACK_LATENCY];
+	GLsync m_readbackFences[READBACK_LATENCY];
+	// next copy of the ring to write
+	int m_readbackSlot;
+	// visible objects of the latest copy read back, -1 for none
+	int m_visibleCount;
+	// uniform locations of the culling program
+	GLint m_planesLocation;
+	GLint m_objectCountLocation;
+	GLint m_cameraPositionLocation;
+	GLint m_lodScaleLocation;
+	GLint m_lodSwitchSizesLocation;
+	GLint m_lodHysteresisLocation;
+	GLint m_occlusionLocation;
+	GLint m_hiZPyramidLocation;
+	GLint m_occlusionViewProjectionLocation;
+	// texture unit of the Hi-Z pyramid, negative when not tested
+	int m_occlusionUnit;
+	glm::mat4 m_occlusionViewProjection;
+
+	// read back the command copies the GPU has finished, newest last
+	void CollectVisibleCount();
+	// drop the command copies still waiting to be read back
+	void ClearReadbacks();
+};
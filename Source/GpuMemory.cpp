@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpumemory.cpp
+// ============
+// account for the video memory held by the OpenGL objects of the scene
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuMemory.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+// declaration of the global variables and defines
+namespace
+{
+	// ALLOCATION struct holds the recorded size of one object
+	struct ALLOCATION
+	{
+		GpuMemory::Category category;
+		size_t bytes;
+	};
+
+	// recorded objects, keyed by their type and name since the
+	// buffers and the textures have separate name spaces - only
+	// the GL thread allocates, so nothing here is locked
+	std::unordered_map<uint64_t, ALLOCATION> g_allocations;
+	// bytes held by each category
+	size_t g_usage[GpuMemory::MEMORY_CATEGORY_COUNT] = { 0 };
+	// bytes the scene may hold, 0 for no limit
+	size_t g_budget = 0;
+
+	const char* CATEGORY_NAMES[GpuMemory::MEMORY_CATEGORY_COUNT] =
+	{
+		"textures",
+		"meshes",
+		"buffers",
+		"targets"
+	};
+
+	uint64_t MakeKey(GpuMemory::ObjectType type, GLuint name)
+	{
+		return(((uint64_t)type << 32) | (uint64_t)name);
+	}
+}
+
+/***********************************************************
+ *  ParseOptions()
+ *
+ *  This method is used for reading the memory budget in
+ *  megabytes from the command line:
+ *
+ *      [--vram-budget MB]
+ ***********************************************************/
+void GpuMemory::ParseOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "--vram-budget") == 0)
+		{
+			int megabytes = atoi(argv[i + 1]);
+			SetBudget((megabytes > 0) ? (size_t)megabytes * 1024 * 1024 : 0);
+			i++;
+		}
+	}
+}
+
+/***********************************************************
+ *  Track()
+ *
+ *  This method is used for recording the size an object was
+ *  allocated with.  Tracking an object again, such as after
+ *  its storage was reallocated, replaces its previous size.
+ ***********************************************************/
+void GpuMemory::Track(ObjectType type, GLuint name, Category category, size_t bytes)
+{
+	if (name == 0)
+	{
+		return;
+	}
+
+	ALLOCATION& allocation = g_allocations[MakeKey(type, name)];
+	if (allocation.bytes > 0)
+	{
+		g_usage[allocation.category] -= allocation.bytes;
+	}
+	allocation.category = category;
+	allocation.bytes = bytes;
+	g_usage[category] += bytes;
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for forgetting an object before it is
+ *  deleted, objects that were never tracked are ignored.
+ ***********************************************************/
+void GpuMemory::Release(ObjectType type, GLuint name)
+{
+	std::unordered_map<uint64_t, ALLOCATION>::iterator it = g_allocations.find(MakeKey(type, name));
+	if (it != g_allocations.end())
+	{
+		g_usage[it->second.category] -= it->second.bytes;
+		g_allocations.erase(it);
+	}
+}
+
+/***********************************************************
+ *  GetObjectBytes()
+ *
+ *  This method is used for getting the recorded size of an
+ *  object.
+ ***********************************************************/
+size_t GpuMemory::GetObjectBytes(ObjectType type, GLuint name)
+{
+	std::unordered_map<uint64_t, ALLOCATION>::const_iterator it = g_allocations.find(MakeKey(type, name));
+
+	return((it != g_allocations.end()) ? it->second.bytes : 0);
+}
+
+/***********************************************************
+ *  GetUsage() / GetTotalUsage()
+ *
+ *  These methods are used for getting the bytes held by a
+ *  category of allocations, or by all of them.
+ ***********************************************************/
+size_t GpuMemory::GetUsage(Category category)
+{
+	return(g_usage[category]);
+}
+
+size_t GpuMemory::GetTotalUsage()
+{
+	size_t total = 0;
+	for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		total += g_usage[i];
+	}
+
+	return(total);
+}
+
+/***********************************************************
+ *  GetCategoryName()
+ *
+ *  This method is used for getting the name of a category of
+ *  allocations.
+ ***********************************************************/
+const char* GpuMemory::GetCategoryName(Category category)
+{
+	return(CATEGORY_NAMES[category]);
+}
+
+/***********************************************************
+ *  SetBudget() / GetBudget()
+ *
+ *  These methods are used for setting and getting the bytes
+ *  the scene may hold in video memory.
+ ***********************************************************/
+void GpuMemory::SetBudget(size_t bytes)
+{
+	g_budget = bytes;
+	if (bytes > 0)
+	{
+		std::cout << "INFO: video memory budget " << (bytes / (1024 * 1024)) << " MB" << std::endl;
+	}
+}
+
+size_t GpuMemory::GetBudget()
+{
+	return(g_budget);
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpumemory.h
+// ============
+// account for the video memory held by the OpenGL objects of the scene
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  GpuMemory
+ *
+ *  This class keeps the number of bytes every buffer, texture
+ *  and renderbuffer was allocated with, as each owner reports
+ *  them next to its glBufferData or glTexImage call and again
+ *  before it deletes the object.  OpenGL has no portable query
+ *  for the memory in use, so the totals are the sizes asked
+ *  for and leave out the padding the driver adds.  They are
+ *  summed per category for the profiler, and the texture
+ *  streaming keeps the total under the memory budget.
+ ***********************************************************/
+class GpuMemory
+{
+public:
+	// Category enum groups the allocations for the reports
+	enum Category
+	{
+		MEMORY_TEXTURES = 0,
+		MEMORY_MESHES,
+		MEMORY_BUFFERS,
+		MEMORY_TARGETS,
+		MEMORY_CATEGORY_COUNT
+	};
+
+	// ObjectType enum tells apart the GL name spaces
+	enum ObjectType
+	{
+		OBJECT_BUFFER = 0,
+		OBJECT_TEXTURE,
+		OBJECT_RENDERBUFFER
+	};
+
+	// read the memory budget from the command line
+	static void ParseOptions(int argc, char* argv[]);
+
+	// record the size of an object, replacing its previous size
+	static void Track(ObjectType type, GLuint name, Category category, size_t bytes);
+	// forget an object that is about to be deleted
+	static void Release(ObjectType type, GLuint name);
+	// get the recorded size of an object, 0 if it is not tracked
+	static size_t GetObjectBytes(ObjectType type, GLuint name);
+
+	// get the bytes held by a category of allocations
+	static size_t GetUsage(Category category);
+	// get the bytes held by every tracked object
+	static size_t GetTotalUsage();
+	// get the name shown for a category in the reports
+	static const char* GetCategoryName(Category category);
+
+	// bytes the scene may hold in video memory, 0 for no limit
+	static void SetBudget(size_t bytes);
+	static size_t GetBudget();
+};
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// split the per-frame loops of the scene across all of the CPU cores
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int workerCount)
+{
+	m_pJob = NULL;
+	m_count = 0;
+	m_grainSize = 1;
+	m_nextChunk = 0;
+	m_loopNumber = 0;
+	m_busyWorkers = 0;
+	m_bStopping = false;
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+	}
+	m_workerCount = std::max(workerCount, 0);
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_loopStarted.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a job over a range of
+ *  items.  The calling thread takes chunks like the workers
+ *  do, and the method returns once no worker is inside the
+ *  loop any more, so the job and whatever it writes can be
+ *  used right away.  A range that fits in a single chunk runs
+ *  on the calling thread alone.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, int grainSize, const RangeJob& job)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	grainSize = std::max(grainSize, 1);
+	if ((count <= grainSize) || (m_workerCount == 0))
+	{
+		job(0, count, 0);
+		return;
+	}
+
+	if (m_workers.empty())
+	{
+		for (int i = 0; i < m_workerCount; i++)
+		{
+			m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pJob = &job;
+		m_count = count;
+		m_grainSize = grainSize;
+		m_nextChunk = 0;
+		m_busyWorkers = m_workerCount;
+		m_loopNumber++;
+	}
+	m_loopStarted.notify_all();
+
+	RunChunks(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_loopFinished.wait(lock, [this]() { return(m_busyWorkers == 0); });
+	m_pJob = NULL;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the main loop of each worker thread.  It
+ *  waits for the next loop, helps with its chunks and reports
+ *  back when none are left.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int thread)
+{
+	uint64_t lastLoop = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loopStarted.wait(lock, [this, lastLoop]() { return(m_bStopping || (m_loopNumber != lastLoop)); });
+			if (m_bStopping)
+			{
+				return;
+			}
+			lastLoop = m_loopNumber;
+		}
+
+		RunChunks(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyWorkers--;
+			if (m_busyWorkers == 0)
+			{
+				m_loopFinished.notify_all();
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RunChunks()
+ *
+ *  This method is used for taking chunks of the current loop
+ *  off the shared counter and running them until the range
+ *  is used up.
+ ***********************************************************/
+void JobSystem::RunChunks(int thread)
+{
+	for (;;)
+	{
+		int begin = m_nextChunk.fetch_add(1) * m_grainSize;
+		if (begin >= m_count)
+		{
+			return;
+		}
+
+		(*m_pJob)(begin, std::min(begin + m_grainSize, m_count), thread);
+	}
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// split the per-frame loops of the scene across all of the CPU cores
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs a loop over a range of items on a set of
+ *  worker threads and the calling thread, and returns once
+ *  every item is done.  The range is cut into chunks that the
+ *  threads take from a shared counter as they finish their
+ *  previous chunk, so a thread that runs ahead takes over the
+ *  work the slower ones have not started, the way a work
+ *  stealing scheduler balances a loop.  The job is told which
+ *  thread runs it, so each thread can write into its own
+ *  scratch memory.  Unlike the ThreadPool, the caller works
+ *  too and waits for the result, and jobs must not make
+ *  OpenGL calls either.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// job run on the items [begin, end) by the thread numbered
+	// thread, the calling thread is number zero
+	typedef std::function<void(int begin, int end, int thread)> RangeJob;
+
+	// constructor - zero workers picks one less than the number of
+	// hardware threads, the workers start on the first loop
+	JobSystem(int workerCount = 0);
+	// destructor - stops the worker threads
+	~JobSystem();
+
+	// run a job over count items in chunks of grainSize items
+	void ParallelFor(int count, int grainSize, const RangeJob& job);
+	// get the number of threads that run the jobs, with the caller
+	int GetThreadCount() const { return(m_workerCount + 1); }
+
+private:
+	// number of worker threads next to the calling thread
+	int m_workerCount;
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// guards the loop hand over and the counters below
+	std::mutex m_mutex;
+	// signaled when a loop starts or the workers stop
+	std::condition_variable m_loopStarted;
+	// signaled when the last worker leaves a loop
+	std::condition_variable m_loopFinished;
+	// loop being run, only valid while a loop runs
+	const RangeJob* m_pJob;
+	int m_count;
+	int m_grainSize;
+	// next chunk to be taken by a thread
+	std::atomic<int> m_nextChunk;
+	// incremented for every loop, so the workers see a new one
+	uint64_t m_loopNumber;
+	// number of workers still inside the current loop
+	int m_busyWorkers;
+	// true when the workers should exit
+	bool m_bStopping;
+
+	// main loop of each worker thread
+	void WorkerLoop(int thread);
+	// take and run chunks until none are left
+	void RunChunks(int thread);
+};
@@ -0,0 +1,308 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// bin the scene point lights into view-space clusters for clustered
+// forward shading
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+	// RGBA32F texels of light data per light
+	const int LIGHT_TEXELS = 4;
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightClusters::LightClusters()
+{
+	m_lightBuffer = 0;
+	m_lightTexture = 0;
+	m_gridBuffer = 0;
+	m_gridTexture = 0;
+	m_indexBuffer = 0;
+	m_indexTexture = 0;
+	m_lightCount = 0;
+	m_globalLightCount = 0;
+	m_tileScale = glm::vec2(0.0f);
+	m_depthScale = 0.0f;
+	m_depthBias = 0.0f;
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the three buffers and
+ *  the buffer textures the fragment shader reads them with.
+ *  The grid starts out empty, so nothing is lit by the
+ *  ranged lights until the first update.
+ ***********************************************************/
+void LightClusters::Initialize()
+{
+	glGenBuffers(1, &m_lightBuffer);
+	glGenBuffers(1, &m_gridBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	glGenTextures(1, &m_lightTexture);
+	glGenTextures(1, &m_gridTexture);
+	glGenTextures(1, &m_indexTexture);
+
+	// a buffer texture needs a data store, so each buffer starts
+	// with one zero element
+	const GLuint zero[4] = { 0, 0, 0, 0 };
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(zero), zero, GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(zero), zero, GL_STREAM_DRAW);
+
+	m_grid.assign(CLUSTER_COUNT * 2, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_grid.size() * sizeof(GLuint), m_grid.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_lightBuffer, GpuMemory::MEMORY_BUFFERS, sizeof(zero));
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_indexBuffer, GpuMemory::MEMORY_BUFFERS, sizeof(zero));
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_gridBuffer, GpuMemory::MEMORY_BUFFERS, m_grid.size() * sizeof(GLuint));
+
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gridTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_gridBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_indexBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffers and the
+ *  buffer textures.
+ ***********************************************************/
+void LightClusters::Destroy()
+{
+	GLuint textures[3] = { m_lightTexture, m_gridTexture, m_indexTexture };
+	GLuint buffers[3] = { m_lightBuffer, m_gridBuffer, m_indexBuffer };
+
+	if (m_lightTexture != 0)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			GpuMemory::Release(GpuMemory::OBJECT_BUFFER, buffers[i]);
+		}
+		glDeleteTextures(3, textures);
+		glDeleteBuffers(3, buffers);
+	}
+
+	m_lightBuffer = 0;
+	m_lightTexture = 0;
+	m_gridBuffer = 0;
+	m_gridTexture = 0;
+	m_indexBuffer = 0;
+	m_indexTexture = 0;
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for replacing the lights.  The lights
+ *  without a range are moved to the front, so the shader can
+ *  loop over them before it reads the cluster list.
+ ***********************************************************/
+void LightClusters::SetLights(const std::vector<CLUSTER_LIGHT>& lights)
+{
+	m_lights.clear();
+	for (const CLUSTER_LIGHT& light : lights)
+	{
+		if (light.range <= 0.0f)
+		{
+			m_lights.push_back(light);
+		}
+	}
+	m_globalLightCount = (int)m_lights.size();
+	for (const CLUSTER_LIGHT& light : lights)
+	{
+		if (light.range > 0.0f)
+		{
+			m_lights.push_back(light);
+		}
+	}
+	m_lightCount = (int)m_lights.size();
+
+	std::vector<glm::vec4> texels;
+	texels.reserve(std::max(m_lightCount, 1) * LIGHT_TEXELS);
+	for (const CLUSTER_LIGHT& light : m_lights)
+	{
+		texels.push_back(glm::vec4(light.position, light.range));
+		texels.push_back(glm::vec4(light.ambient, (float)light.shadowMap));
+		texels.push_back(glm::vec4(light.diffuse, 0.0f));
+		texels.push_back(glm::vec4(light.specular, 0.0f));
+	}
+	if (texels.size() == 0)
+	{
+		texels.push_back(glm::vec4(0.0f));
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_lightBuffer, GpuMemory::MEMORY_BUFFERS, texels.size() * sizeof(glm::vec4));
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for binning the ranged lights into
+ *  the clusters.  Each light sphere is bounded by a view-space
+ *  box, whose projected corners give the tiles it covers and
+ *  whose depth range gives the slices.  The bounds are
+ *  conservative, so a cluster may list a light that misses
+ *  it, but never misses a light that reaches it.  The lists
+ *  are built with a count pass and a fill pass, so the light
+ *  indices of a cluster end up next to each other.
+ ***********************************************************/
+void LightClusters::Update(const glm::mat4& view, const glm::mat4& projection, int viewportWidth, int viewportHeight)
+{
+	// the near and far planes come from the projection, which is
+	// either a perspective or an orthographic one
+	float nearPlane = 0.0f;
+	float farPlane = 0.0f;
+	if (projection[2][3] < -0.5f)
+	{
+		nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		nearPlane = (projection[3][2] + 1.0f) / projection[2][2];
+		farPlane = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	nearPlane = std::max(nearPlane, 0.001f);
+	farPlane = std::max(farPlane, nearPlane * 2.0f);
+
+	m_tileScale = glm::vec2((float)GRID_X / (float)std::max(viewportWidth, 1),
+		(float)GRID_Y / (float)std::max(viewportHeight, 1));
+	m_depthScale = (float)GRID_Z / logf(farPlane / nearPlane);
+	m_depthBias = -logf(nearPlane) * m_depthScale;
+
+	m_bounds.clear();
+	m_grid.assign(CLUSTER_COUNT * 2, 0);
+	for (int i = m_globalLightCount; i < m_lightCount; i++)
+	{
+		const CLUSTER_LIGHT& light = m_lights[i];
+		glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+		float nearDepth = std::max(-center.z - light.range, nearPlane);
+		float farDepth = std::min(-center.z + light.range, farPlane);
+		if (nearDepth > farDepth)
+		{
+			continue;
+		}
+
+		glm::vec2 ndcMin = glm::vec2(FLT_MAX);
+		glm::vec2 ndcMax = glm::vec2(-FLT_MAX);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec4 position(
+				center.x + ((corner & 1) ? light.range : -light.range),
+				center.y + ((corner & 2) ? light.range : -light.range),
+				(corner & 4) ? -farDepth : -nearDepth,
+				1.0f);
+			glm::vec4 clip = projection * position;
+			glm::vec2 ndc = glm::vec2(clip.x / clip.w, clip.y / clip.w);
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+		if ((ndcMax.x < -1.0f) || (ndcMin.x > 1.0f) || (ndcMax.y < -1.0f) || (ndcMin.y > 1.0f))
+		{
+			continue;
+		}
+
+		LIGHT_BOUNDS bounds;
+		bounds.light = i;
+		bounds.minX = std::max((int)floorf((ndcMin.x * 0.5f + 0.5f) * GRID_X), 0);
+		bounds.maxX = std::min((int)floorf((ndcMax.x * 0.5f + 0.5f) * GRID_X), GRID_X - 1);
+		bounds.minY = std::max((int)floorf((ndcMin.y * 0.5f + 0.5f) * GRID_Y), 0);
+		bounds.maxY = std::min((int)floorf((ndcMax.y * 0.5f + 0.5f) * GRID_Y), GRID_Y - 1);
+		bounds.minZ = std::max((int)floorf(logf(nearDepth) * m_depthScale + m_depthBias), 0);
+		bounds.maxZ = std::min((int)floorf(logf(farDepth) * m_depthScale + m_depthBias), GRID_Z - 1);
+		m_bounds.push_back(bounds);
+
+		// count pass, the second entry of each cluster is its count
+		for (int z = bounds.minZ; z <= bounds.maxZ; z++)
+			for (int y = bounds.minY; y <= bounds.maxY; y++)
+				for (int x = bounds.minX; x <= bounds.maxX; x++)
+				{
+					m_grid[(x + GRID_X * (y + GRID_Y * z)) * 2 + 1]++;
+				}
+	}
+
+	// the first entry of each cluster is where its list starts, and
+	// the count is rebuilt while the list is filled
+	GLuint indexCount = 0;
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		m_grid[cluster * 2] = indexCount;
+		indexCount += m_grid[cluster * 2 + 1];
+		m_grid[cluster * 2 + 1] = 0;
+	}
+
+	m_indices.resize(std::max(indexCount, (GLuint)1));
+	for (const LIGHT_BOUNDS& bounds : m_bounds)
+	{
+		for (int z = bounds.minZ; z <= bounds.maxZ; z++)
+			for (int y = bounds.minY; y <= bounds.maxY; y++)
+				for (int x = bounds.minX; x <= bounds.maxX; x++)
+				{
+					GLuint* pCluster = &m_grid[(x + GRID_X * (y + GRID_Y * z)) * 2];
+					m_indices[pCluster[0] + pCluster[1]] = (GLuint)bounds.light;
+					pCluster[1]++;
+				}
+	}
+
+	// the lists are rebuilt every frame, so the old stores are
+	// orphaned instead of waiting for the GPU to finish with them
+	glBindBuffer(GL_TEXTURE_BUFFER, m_gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_grid.size() * sizeof(GLuint), m_grid.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_indices.size() * sizeof(GLuint), m_indices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_indexBuffer, GpuMemory::MEMORY_BUFFERS, m_indices.size() * sizeof(GLuint));
+	m_indices.resize(indexCount);
+}
+
+/***********************************************************
+ *  BindTextures()
+ *
+ *  This method is used for binding the light data, cluster
+ *  grid and light index textures to consecutive texture units.
+ ***********************************************************/
+void LightClusters::BindTextures(int firstUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gridTexture);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// bin the scene point lights into view-space clusters for clustered
+// forward shading
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  This class splits the view frustum into a grid of clusters,
+ *  screen tiles along x and y and exponential depth slices
+ *  along z, and lists the point lights whose range reaches
+ *  each cluster.  The binning runs on the CPU every frame and
+ *  the results are read by the fragment shader from buffer
+ *  textures, since OpenGL 3.3 has neither compute shaders nor
+ *  storage buffers:
+ *
+ *   - light data, four RGBA32F texels per light
+ *   - cluster grid, an RG32UI (first index, count) per cluster
+ *   - light indices, an R32UI list the clusters point into
+ *
+ *  Lights without a range light every fragment, as the scene
+ *  lights always did.  They are stored first and are never
+ *  binned.
+ ***********************************************************/
+class LightClusters
+{
+public:
+	// size of the cluster grid, these match the fragment shader
+	static const int GRID_X = 16;
+	static const int GRID_Y = 9;
+	static const int GRID_Z = 24;
+	static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+	// CLUSTER_LIGHT struct is a point light as the shader sees it
+	struct CLUSTER_LIGHT
+	{
+		glm::vec3 position;
+		float range;             // radius of influence, 0 lights everything
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		int shadowMap;           // slot of its shadow map, -1 for none
+	};
+
+	// constructor
+	LightClusters();
+	// destructor
+	~LightClusters();
+
+	// create the buffers and buffer textures
+	void Initialize();
+	// free the buffers and buffer textures
+	void Destroy();
+
+	// replace the lights and upload their data
+	void SetLights(const std::vector<CLUSTER_LIGHT>& lights);
+	// bin the ranged lights into the clusters of the passed in
+	// camera and viewport, and upload the cluster lists
+	void Update(const glm::mat4& view, const glm::mat4& projection, int viewportWidth, int viewportHeight);
+	// bind the buffer textures to three texture units from firstUnit
+	void BindTextures(int firstUnit) const;
+
+	// get the number of lights that light every fragment
+	int GetGlobalLightCount() const { return(m_globalLightCount); }
+	// get the number of lights, including the global lights
+	int GetLightCount() const { return(m_lightCount); }
+	// get the number of light indices written by the last update
+	int GetIndexCount() const { return((int)m_indices.size()); }
+	// get the scale from window pixels to cluster tiles
+	const glm::vec2& GetTileScale() const { return(m_tileScale); }
+	// get the scale and bias from log view depth to depth slices
+	float GetDepthScale() const { return(m_depthScale); }
+	float GetDepthBias() const { return(m_depthBias); }
+
+private:
+	// LIGHT_BOUNDS struct is the cluster range a light reaches
+	struct LIGHT_BOUNDS
+	{
+		int light;
+		int minX, maxX;
+		int minY, maxY;
+		int minZ, maxZ;
+	};
+
+	// buffers and the buffer textures reading them
+	GLuint m_lightBuffer;
+	GLuint m_lightTexture;
+	GLuint m_gridBuffer;
+	GLuint m_gridTexture;
+	GLuint m_indexBuffer;
+	GLuint m_indexTexture;
+
+	// lights ordered with the global lights first
+	std::vector<CLUSTER_LIGHT> m_lights;
+	int m_lightCount;
+	int m_globalLightCount;
+
+	// scratch lists reused by every update
+	std::vector<LIGHT_BOUNDS> m_bounds;
+	std::vector<GLuint> m_grid;
+	std::vector<GLuint> m_indices;
+	// cluster lookup parameters of the last update
+	glm::vec2 m_tileScale;
+	float m_depthScale;
+	float m_depthBias;
+};
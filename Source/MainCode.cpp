@@ -9,6 +9,7 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -21,14 +22,23 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include "TextureCooker.h"
 
 // Namespace for declaring global variables
 namespace
 {
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
+	// shaders upscaling the scene into the window
+	const char* const UPSCALE_VERTEX_SHADER = "shaders/upscaleVertexShader.glsl";
+	const char* const UPSCALE_FRAGMENT_SHADER = "shaders/upscaleFragmentShader.glsl";
 
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
@@ -39,6 +49,8 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// profiler object for measuring and reporting the frame times
+	Profiler* g_Profiler = nullptr;
 }
 
 // Function declarations - all functions that are called manually
@@ -55,6 +67,18 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// cooking the textures runs offline, without a window
+	if ((argc > 1) && (strcmp(argv[1], "--cook-textures") == 0))
+	{
+		return(TextureCooker::Run(argc - 2, argv + 2));
+	}
+	// packing the scene runs offline as well
+	if ((argc > 1) && (strcmp(argv[1], "--pack-scene") == 0))
+	{
+		SceneManager packer(NULL);
+		return(packer.WriteScenePack((argc > 2) ? argv[2] : NULL) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -67,8 +91,12 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
+	// the benchmark renders offscreen, so its window stays hidden
+	Benchmark::OPTIONS benchmarkOptions;
+	bool bBenchmark = Benchmark::ParseOptions(argc, argv, benchmarkOptions);
+
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE, !bBenchmark);
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -76,20 +104,92 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// --no-vsync, --fps-cap <fps> and --on-demand pace the main loop,
+	// the benchmark always measures without vsync
+	FramePacer framePacer;
+	framePacer.ParseOptions(argc, argv);
+	framePacer.SetVsync(framePacer.IsVsyncEnabled() && !bBenchmark);
+
+	// --vram-budget <MB> keeps the streamed texture levels within a
+	// video memory budget
+	GpuMemory::ParseOptions(argc, argv);
+
+	// the scene manager builds its own specialized variants of the
+	// scene shaders and keeps their binaries between runs, so the
+	// shader files are not compiled here as well
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
 	g_SceneManager->PrepareScene();
+	// edited shader and texture files are reloaded while the scene
+	// runs, but not while it is measured
+	if (!bBenchmark)
+	{
+		g_SceneManager->EnableHotReload();
+	}
+
+	// the benchmark renders its fixed number of frames in place
+	// of the main loop
+	int exitCode = EXIT_SUCCESS;
+	if (bBenchmark)
+	{
+		Benchmark benchmark(benchmarkOptions);
+		exitCode = benchmark.Run(g_Window, g_ViewManager, g_SceneManager);
+		glfwSetWindowShouldClose(g_Window, true);
+	}
+
+	// the profiler reports the frame statistics in the window title,
+	// and --profile-csv <file> also writes every frame into a file
+	g_Profiler = new Profiler(WINDOW_TITLE);
+	g_Profiler->Initialize();
+	// each render pass of the scene is timed on its own
+	g_SceneManager->SetProfiler(g_Profiler);
+	// --record-camera-path <file> writes the camera pose of every
+	// frame, which the benchmark can replay with --camera-path
+	CameraPath cameraRecording;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "--profile-csv") == 0)
+		{
+			g_Profiler->OpenCsv(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--record-camera-path") == 0)
+		{
+			cameraRecording.OpenRecording(argv[i + 1]);
+		}
+	}
+	bool bOverlayKeyDown = false;
+	bool bPrepassKeyDown = false;
+	bool bVsyncKeyDown = false;
+	bool bRedrawModeKeyDown = false;
+	bool bResolutionKeyDown = false;
+
+	// the scene is drawn offscreen at a resolution that keeps the GPU
+	// time in the frame budget, --target-fps <fps> sets the budget and
+	// --resolution-scale <scale> fixes the resolution instead
+	DynamicResolution dynamicResolution;
+	dynamicResolution.ParseOptions(argc, argv);
+	if (!dynamicResolution.Initialize(UPSCALE_VERTEX_SHADER, UPSCALE_FRAGMENT_SHADER))
+	{
+		std::cout << "INFO: the scene is drawn at the window resolution" << std::endl;
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		g_Profiler->BeginFrame();
+		UniformCache::ResetUploadCount();
+
+		// wait until the GPU is done with the oldest frame in flight,
+		// every other frame is built while the GPU draws the last ones
+		g_Profiler->BeginCpuScope(Profiler::CPU_WAIT_FRAME);
+		bool bFrameStalled = g_SceneManager->BeginFrame();
+		g_Profiler->EndCpuScope(Profiler::CPU_WAIT_FRAME);
+
+		// draw into the offscreen target at the current resolution
+		dynamicResolution.BeginScene(ViewManager::GetWindowWidth(), ViewManager::GetWindowHeight());
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -98,20 +198,103 @@ int main(int argc, char* argv[])
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
+		g_Profiler->BeginCpuScope(Profiler::CPU_PREPARE_VIEW);
 		g_ViewManager->PrepareSceneView();
+		g_Profiler->EndCpuScope(Profiler::CPU_PREPARE_VIEW);
+		cameraRecording.Record(g_ViewManager->GetCameraPosition(), g_ViewManager->GetCameraFront());
+		g_SceneManager->SetViewProjection(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+
+		// a left click picks the object in the center of the view
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+		if (g_ViewManager->ConsumePickRequest(pickOrigin, pickDirection))
+		{
+			float pickDistance = 0.0f;
+			int pickedObject = g_SceneManager->PickObject(pickOrigin, pickDirection, pickDistance);
+			if (pickedObject >= 0)
+			{
+				std::cout << "INFO: Picked object " << pickedObject << " at distance " << pickDistance << std::endl;
+			}
+		}
 
 		// refresh the 3D scene
+		g_Profiler->BeginCpuScope(Profiler::CPU_RENDER_SCENE);
 		g_SceneManager->RenderScene();
+		g_Profiler->EndCpuScope(Profiler::CPU_RENDER_SCENE);
+		g_Profiler->BeginGpuPass(Profiler::GPU_UPSCALE);
+		dynamicResolution.EndScene();
+		g_Profiler->EndGpuPass(Profiler::GPU_UPSCALE);
+		g_SceneManager->EndFrame();
 
+		const SceneManager::FRAME_STATS& frameStats = g_SceneManager->GetFrameStats();
+		Profiler::FRAME_COUNTERS counters;
+		counters.drawCalls = frameStats.drawCalls;
+		counters.stateChanges = frameStats.stateChanges;
+		counters.uniformUploads = UniformCache::GetUploadCount();
+		counters.fenceStalls = bFrameStalled ? 1 : 0;
+		counters.resolutionScale = dynamicResolution.GetScale();
+		g_Profiler->SetFrameCounters(counters);
+
+		// F3 shows and hides the frame time graph
+		bool bOverlayKey = (glfwGetKey(g_Window, GLFW_KEY_F3) == GLFW_PRESS);
+		if (bOverlayKey && !bOverlayKeyDown)
+		{
+			g_Profiler->ToggleOverlay();
+		}
+		bOverlayKeyDown = bOverlayKey;
+		// F4 turns the depth pre-pass of the opaque objects on and off
+		bool bPrepassKey = (glfwGetKey(g_Window, GLFW_KEY_F4) == GLFW_PRESS);
+		if (bPrepassKey && !bPrepassKeyDown)
+		{
+			g_SceneManager->SetDepthPrepass(!g_SceneManager->IsDepthPrepassEnabled());
+		}
+		bPrepassKeyDown = bPrepassKey;
+		// F5 turns vsync on and off
+		bool bVsyncKey = (glfwGetKey(g_Window, GLFW_KEY_F5) == GLFW_PRESS);
+		if (bVsyncKey && !bVsyncKeyDown)
+		{
+			framePacer.SetVsync(!framePacer.IsVsyncEnabled());
+		}
+		bVsyncKeyDown = bVsyncKey;
+		// F6 switches between drawing continuously and on demand
+		bool bRedrawModeKey = (glfwGetKey(g_Window, GLFW_KEY_F6) == GLFW_PRESS);
+		if (bRedrawModeKey && !bRedrawModeKeyDown)
+		{
+			framePacer.SetRedrawMode((framePacer.GetRedrawMode() == FramePacer::REDRAW_ON_DEMAND) ?
+				FramePacer::REDRAW_CONTINUOUS : FramePacer::REDRAW_ON_DEMAND);
+		}
+		bRedrawModeKeyDown = bRedrawModeKey;
+		// F7 turns the dynamic resolution on and off
+		bool bResolutionKey = (glfwGetKey(g_Window, GLFW_KEY_F7) == GLFW_PRESS);
+		if (bResolutionKey && !bResolutionKeyDown)
+		{
+			dynamicResolution.SetAutomatic(!dynamicResolution.IsAutomatic());
+		}
+		bResolutionKeyDown = bResolutionKey;
+		g_Profiler->DrawOverlay(g_Window);
 
 		// Flips the the back buffer with the front buffer every frame.
+		g_Profiler->BeginCpuScope(Profiler::CPU_SWAP_BUFFERS);
 		glfwSwapBuffers(g_Window);
+		g_Profiler->EndCpuScope(Profiler::CPU_SWAP_BUFFERS);
+
+		// the frame time is measured before the loop waits, so the
+		// idle time of the frame cap or on demand mode is not in it
+		g_Profiler->EndFrame(g_Window);
+		// the resolution follows the latest GPU time of the scene
+		dynamicResolution.Update(g_Profiler->GetGpuSceneTime());
 
-		// query the latest GLFW events
-		glfwPollEvents();
+		// query the latest GLFW events, and wait for the next frame
+		// when it is capped or only drawn on demand
+		framePacer.WaitForNextFrame(g_Window, []() { return(g_SceneManager->HasPendingChanges()); });
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_Profiler)
+	{
+		delete g_Profiler;
+		g_Profiler = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -128,8 +311,8 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program, with the benchmark result if one ran
+	exit(exitCode); 
 }
 
 /***********************************************************
@@ -149,10 +332,12 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #else
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+	// set the version of OpenGL and profile to use - 4.3 culls and
+	// draws the scene on the GPU, and the window falls back to 3.1
+	// when the driver cannot create it
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
 #endif
 	// GLFW: end -------------------------------
 
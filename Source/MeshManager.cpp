@@ -0,0 +1,912 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshmanager.cpp
+// ============
+// manage the shared vertex/index buffers of the procedural basic meshes and
+// the instanced drawing of them
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshManager.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// declaration of the global variables and defines
+namespace
+{
+	// tessellation of the procedural round meshes at each level of
+	// detail, from the closest level to the farthest
+	const int CYLINDER_SLICES[MeshManager::LOD_COUNT] = { 36, 16, 8 };
+	const int SPHERE_SECTORS[MeshManager::LOD_COUNT] = { 36, 16, 8 };
+	const int SPHERE_STACKS[MeshManager::LOD_COUNT] = { 18, 8, 4 };
+
+	// projected radius in pixels below which a mesh switches to its
+	// next level of detail
+	const float LOD_SWITCH_PIXELS[MeshManager::LOD_COUNT - 1] = { 48.0f, 16.0f };
+	// part of a switch size the projected size has to pass it by
+	// before the level changes, so objects close to it do not pop
+	const float LOD_HYSTERESIS = 0.15f;
+
+	// initial number of instances the instance buffer can hold
+	const int INITIAL_INSTANCE_CAPACITY = 256;
+
+	// vertex attribute locations used by the vertex shader
+	const GLuint ATTRIB_POSITION = 0;
+	const GLuint ATTRIB_NORMAL = 1;
+	const GLuint ATTRIB_TEXCOORD = 2;
+	const GLuint ATTRIB_INSTANCE_MODEL = 3;      // uses locations 3 to 6
+	const GLuint ATTRIB_INSTANCE_INDICES = 7;
+
+	const float PI = 3.14159265358979f;
+}
+
+/***********************************************************
+ *  MeshManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshManager::MeshManager()
+{
+	m_vao = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_indirectVao = 0;
+	m_indirectInstanceBuffer = 0;
+	m_bufferVao = 0;
+	m_bufferInstanceBuffer = 0;
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < LOD_COUNT; lod++)
+		{
+			m_meshRanges[i][lod].baseVertex = 0;
+			m_meshRanges[i][lod].vertexCount = 0;
+			m_meshRanges[i][lod].firstIndex = 0;
+			m_meshRanges[i][lod].indexCount = 0;
+			m_meshRanges[i][lod].boundsMin = glm::vec3(0.0f);
+			m_meshRanges[i][lod].boundsMax = glm::vec3(0.0f);
+		}
+		m_lodCounts[i] = 1;
+	}
+}
+
+/***********************************************************
+ *  ~MeshManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshManager::~MeshManager()
+{
+	DestroyMeshes();
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for generating the basic meshes into
+ *  one shared vertex buffer and index buffer, and for setting
+ *  up the vertex array object with both the mesh attributes
+ *  and the per-instance attributes.
+ ***********************************************************/
+void MeshManager::LoadMeshes()
+{
+	std::vector<VERTEX> vertices;
+	std::vector<GLuint> indices;
+	std::vector<VERTEX> meshVertices;
+	std::vector<GLuint> meshIndices;
+
+	// generate the meshes in MeshType order, the round meshes once
+	// for each level of detail, the flat ones only have one level
+	GeneratePlane(meshVertices, meshIndices);
+	SetMeshLod(MeshType::Plane, 0, AppendMesh(vertices, indices, meshVertices, meshIndices));
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		GenerateSphere(SPHERE_SECTORS[lod], SPHERE_STACKS[lod], meshVertices, meshIndices);
+		SetMeshLod(MeshType::Sphere, lod, AppendMesh(vertices, indices, meshVertices, meshIndices));
+	}
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		GenerateCylinder(CYLINDER_SLICES[lod], meshVertices, meshIndices);
+		SetMeshLod(MeshType::Cylinder, lod, AppendMesh(vertices, indices, meshVertices, meshIndices));
+	}
+	GenerateBox(meshVertices, meshIndices);
+	SetMeshLod(MeshType::Box, 0, AppendMesh(vertices, indices, meshVertices, meshIndices));
+	// the static batches are baked from the same geometry
+	m_vertices = vertices;
+	m_indices = indices;
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	// upload the shared mesh geometry
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VERTEX), vertices.data(), GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_vertexBuffer, GpuMemory::MEMORY_MESHES, vertices.size() * sizeof(VERTEX));
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_indexBuffer, GpuMemory::MEMORY_MESHES, indices.size() * sizeof(GLuint));
+
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	ReserveInstances(INITIAL_INSTANCE_CAPACITY);
+	SetupVertexArray(m_instanceBuffer);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetupVertexArray()
+ *
+ *  This method is used for pointing the bound vertex array
+ *  object at the shared mesh geometry and at an instance
+ *  buffer holding INSTANCE_DATA records.
+ ***********************************************************/
+void MeshManager::SetupVertexArray(GLuint instanceBuffer)
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	// the per-vertex attributes
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, position));
+	glEnableVertexAttribArray(ATTRIB_NORMAL);
+	glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, normal));
+	glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, uv));
+
+	// the per-instance attributes - a mat4 attribute takes
+	// four consecutive locations, one per column
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(ATTRIB_INSTANCE_MODEL + column);
+		glVertexAttribPointer(ATTRIB_INSTANCE_MODEL + column, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+			(void*)(offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(ATTRIB_INSTANCE_MODEL + column, 1);
+	}
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_INDICES);
+	glVertexAttribIPointer(ATTRIB_INSTANCE_INDICES, 2, GL_INT, sizeof(INSTANCE_DATA),
+		(void*)offsetof(INSTANCE_DATA, materialIndex));
+	glVertexAttribDivisor(ATTRIB_INSTANCE_INDICES, 1);
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used for freeing the GPU buffers of the
+ *  basic meshes.
+ ***********************************************************/
+void MeshManager::DestroyMeshes()
+{
+	DestroyStaticBatches();
+	m_vertices.clear();
+	m_indices.clear();
+
+	if (m_indirectVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_indirectVao);
+		m_indirectVao = 0;
+	}
+	m_indirectInstanceBuffer = 0;
+	if (m_bufferVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_bufferVao);
+		m_bufferVao = 0;
+	}
+	m_bufferInstanceBuffer = 0;
+
+	if (m_instanceBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_instanceBuffer);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_indexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (m_vertexBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_vertexBuffer);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	m_instanceCapacity = 0;
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a number of instances of
+ *  a mesh.  The instance data is streamed into the instance
+ *  buffer and all of the instances are drawn with a single
+ *  draw call.
+ ***********************************************************/
+void MeshManager::DrawMeshInstanced(MeshType type, const INSTANCE_DATA* instances, int count, int lod)
+{
+	if ((m_vao == 0) || (count <= 0))
+	{
+		return;
+	}
+
+	const MESH_RANGE& range = m_meshRanges[(int)type][lod];
+
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	ReserveInstances(count);
+
+	// orphan the previous contents so the driver does not have
+	// to wait for the draws still reading them
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(INSTANCE_DATA), instances);
+
+	glDrawElementsInstancedBaseVertex(
+		GL_TRIANGLES,
+		range.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(GLuint)),
+		count,
+		range.baseVertex);
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a number of instances of
+ *  a mesh when only the model matrices are known.  The
+ *  material and texture indices of the instances are zero.
+ ***********************************************************/
+void MeshManager::DrawMeshInstanced(MeshType type, const glm::mat4* models, int count)
+{
+	m_scratchInstances.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		m_scratchInstances[i].model = models[i];
+		m_scratchInstances[i].materialIndex = 0;
+		m_scratchInstances[i].textureIndex = 0;
+	}
+
+	DrawMeshInstanced(type, m_scratchInstances.data(), count);
+}
+
+/***********************************************************
+ *  DrawMeshInstances()
+ *
+ *  This method is used for drawing a number of instances of
+ *  a mesh whose instance data the caller already wrote into
+ *  an instance buffer, starting at the passed in instance.
+ *  Nothing is uploaded here, and the vertex array reading the
+ *  buffer is only set up again when the buffer changes.
+ ***********************************************************/
+void MeshManager::DrawMeshInstances(MeshType type, GLuint instanceBuffer, int firstInstance, int count, int lod)
+{
+	if ((m_vao == 0) || (count <= 0))
+	{
+		return;
+	}
+
+	if ((m_bufferVao == 0) || (m_bufferInstanceBuffer != instanceBuffer))
+	{
+		if (m_bufferVao == 0)
+		{
+			glGenVertexArrays(1, &m_bufferVao);
+		}
+		glBindVertexArray(m_bufferVao);
+		SetupVertexArray(instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_bufferInstanceBuffer = instanceBuffer;
+	}
+
+	const MESH_RANGE& range = m_meshRanges[(int)type][lod];
+
+	glBindVertexArray(m_bufferVao);
+	glDrawElementsInstancedBaseVertexBaseInstance(
+		GL_TRIANGLES,
+		range.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(GLuint)),
+		count,
+		range.baseVertex,
+		(GLuint)firstInstance);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a range of indirect draw
+ *  commands with one call.  The instances come from a buffer
+ *  filled on the GPU, read through a second vertex array
+ *  object, and the base instance of each command selects its
+ *  records in that buffer.
+ ***********************************************************/
+void MeshManager::DrawIndirect(GLuint instanceBuffer, GLuint commandBuffer, int firstCommand, int commandCount)
+{
+	if ((m_vao == 0) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	if ((m_indirectVao == 0) || (m_indirectInstanceBuffer != instanceBuffer))
+	{
+		if (m_indirectVao == 0)
+		{
+			glGenVertexArrays(1, &m_indirectVao);
+		}
+		glBindVertexArray(m_indirectVao);
+		SetupVertexArray(instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_indirectInstanceBuffer = instanceBuffer;
+	}
+
+	// the indirect command layout of five unsigned values
+	const size_t COMMAND_SIZE = 5 * sizeof(GLuint);
+
+	glBindVertexArray(m_indirectVao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		(void*)(firstCommand * COMMAND_SIZE), commandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  CreateStaticBatch()
+ *
+ *  This method is used for baking objects that never move into
+ *  one vertex and index buffer.  Each vertex is moved by the
+ *  model matrix of its object and carries the material and
+ *  texture indices of the object, so the batch has nothing
+ *  left to stream per instance.  The normals are kept as the
+ *  meshes define them, which is how the vertex shader passes
+ *  them on for the instanced objects as well.  Every level of
+ *  detail of each object is baked, the objects of one level
+ *  after the other in the order they are passed in, so the
+ *  indices of an object at a level stay one range.  A mesh
+ *  with fewer levels repeats the range of its last one, and
+ *  the ranges of level 0 alone make up the whole batch.
+ ***********************************************************/
+int MeshManager::CreateStaticBatch(const MeshType* types, const INSTANCE_DATA* instances, int count, std::vector<STATIC_RANGE>& ranges)
+{
+	ranges.clear();
+	if ((m_vao == 0) || (count <= 0))
+	{
+		return(-1);
+	}
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		for (int lod = 0; lod < m_lodCounts[(int)types[i]]; lod++)
+		{
+			const MESH_RANGE& range = m_meshRanges[(int)types[i]][lod];
+			vertexCount += range.vertexCount;
+			indexCount += range.indexCount;
+		}
+	}
+
+	std::vector<STATIC_VERTEX> vertices;
+	std::vector<GLuint> indices;
+	vertices.reserve(vertexCount);
+	indices.reserve(indexCount);
+	ranges.resize(count * LOD_COUNT);
+	GLsizei batchIndexCount = 0;
+
+	for (int n = 0; n < count * LOD_COUNT; n++)
+	{
+		const int i = n % count;
+		const int lod = n / count;
+		if (lod >= m_lodCounts[(int)types[i]])
+		{
+			ranges[i * LOD_COUNT + lod] = ranges[i * LOD_COUNT + lod - 1];
+			continue;
+		}
+
+		const MESH_RANGE& range = m_meshRanges[(int)types[i]][lod];
+		GLuint firstVertex = (GLuint)vertices.size();
+		ranges[i * LOD_COUNT + lod].firstIndex = (GLuint)indices.size();
+		ranges[i * LOD_COUNT + lod].indexCount = range.indexCount;
+		if (lod == 0)
+		{
+			batchIndexCount += range.indexCount;
+		}
+
+		for (int v = range.baseVertex; v < range.baseVertex + range.vertexCount; v++)
+		{
+			STATIC_VERTEX vertex;
+			vertex.position = glm::vec3(instances[i].model * glm::vec4(m_vertices[v].position, 1.0f));
+			vertex.normal = m_vertices[v].normal;
+			vertex.uv = m_vertices[v].uv;
+			vertex.materialIndex = instances[i].materialIndex;
+			vertex.textureIndex = instances[i].textureIndex;
+			vertices.push_back(vertex);
+		}
+		for (GLsizei index = 0; index < range.indexCount; index++)
+		{
+			indices.push_back(firstVertex + m_indices[range.firstIndex + index]);
+		}
+	}
+
+	STATIC_BATCH batch;
+	batch.indexCount = batchIndexCount;
+
+	glGenVertexArrays(1, &batch.vao);
+	glBindVertexArray(batch.vao);
+
+	glGenBuffers(1, &batch.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(STATIC_VERTEX), vertices.data(), GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, batch.vertexBuffer, GpuMemory::MEMORY_MESHES, vertices.size() * sizeof(STATIC_VERTEX));
+
+	glGenBuffers(1, &batch.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, batch.indexBuffer, GpuMemory::MEMORY_MESHES, indices.size() * sizeof(GLuint));
+
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(STATIC_VERTEX), (void*)offsetof(STATIC_VERTEX, position));
+	glEnableVertexAttribArray(ATTRIB_NORMAL);
+	glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(STATIC_VERTEX), (void*)offsetof(STATIC_VERTEX, normal));
+	glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(STATIC_VERTEX), (void*)offsetof(STATIC_VERTEX, uv));
+	// the indices the instanced draws stream per instance come
+	// from every vertex here, and the model matrix attributes stay
+	// disabled so they read the identity set before drawing
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_INDICES);
+	glVertexAttribIPointer(ATTRIB_INSTANCE_INDICES, 2, GL_INT, sizeof(STATIC_VERTEX),
+		(void*)offsetof(STATIC_VERTEX, materialIndex));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_staticBatches.push_back(batch);
+
+	return((int)m_staticBatches.size() - 1);
+}
+
+/***********************************************************
+ *  DestroyStaticBatches()
+ *
+ *  This method is used for freeing the buffers of all of the
+ *  static batches.
+ ***********************************************************/
+void MeshManager::DestroyStaticBatches()
+{
+	for (STATIC_BATCH& batch : m_staticBatches)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, batch.indexBuffer);
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, batch.vertexBuffer);
+		glDeleteBuffers(1, &batch.indexBuffer);
+		glDeleteBuffers(1, &batch.vertexBuffer);
+		glDeleteVertexArrays(1, &batch.vao);
+	}
+	m_staticBatches.clear();
+}
+
+/***********************************************************
+ *  DrawStaticBatch()
+ *
+ *  This method is used for drawing every object of a static
+ *  batch at level 0 with one draw call.
+ ***********************************************************/
+void MeshManager::DrawStaticBatch(int batch)
+{
+	if ((batch < 0) || (batch >= (int)m_staticBatches.size()))
+	{
+		return;
+	}
+
+	SetStaticModel();
+	glBindVertexArray(m_staticBatches[batch].vao);
+	glDrawElements(GL_TRIANGLES, m_staticBatches[batch].indexCount, GL_UNSIGNED_INT, (void*)0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawStaticRanges()
+ *
+ *  This method is used for drawing some of the objects of a
+ *  static batch, such as the ones in view, with one multi-draw
+ *  call over their index ranges.
+ ***********************************************************/
+void MeshManager::DrawStaticRanges(int batch, const GLsizei* counts, const GLvoid* const* offsets, int rangeCount)
+{
+	if ((batch < 0) || (batch >= (int)m_staticBatches.size()) || (rangeCount <= 0))
+	{
+		return;
+	}
+
+	SetStaticModel();
+	glBindVertexArray(m_staticBatches[batch].vao);
+	glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, rangeCount);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawStaticIndirect()
+ *
+ *  This method is used for drawing the objects of a static
+ *  batch from indirect commands, one command per object range,
+ *  which the GPU culling gives no instances when the object is
+ *  hidden.  The batch has no instance attributes, so the
+ *  instances of a command only decide whether it draws.
+ ***********************************************************/
+void MeshManager::DrawStaticIndirect(int batch, GLuint commandBuffer, int firstCommand, int commandCount)
+{
+	if ((batch < 0) || (batch >= (int)m_staticBatches.size()) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	// the indirect command layout of five unsigned values
+	const size_t COMMAND_SIZE = 5 * sizeof(GLuint);
+
+	SetStaticModel();
+	glBindVertexArray(m_staticBatches[batch].vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		(void*)(firstCommand * COMMAND_SIZE), commandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  SetStaticModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  static batches.  The vertices are already in world space,
+ *  so the model matrix attributes, which are disabled in the
+ *  batches, are given the identity matrix.
+ ***********************************************************/
+void MeshManager::SetStaticModel()
+{
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttrib4f(ATTRIB_INSTANCE_MODEL + column,
+			(column == 0) ? 1.0f : 0.0f,
+			(column == 1) ? 1.0f : 0.0f,
+			(column == 2) ? 1.0f : 0.0f,
+			(column == 3) ? 1.0f : 0.0f);
+	}
+}
+
+void MeshManager::DrawPlaneMeshInstanced(const glm::mat4* models, int count)
+{
+	DrawMeshInstanced(MeshType::Plane, models, count);
+}
+
+void MeshManager::DrawSphereMeshInstanced(const glm::mat4* models, int count)
+{
+	DrawMeshInstanced(MeshType::Sphere, models, count);
+}
+
+void MeshManager::DrawCylinderMeshInstanced(const glm::mat4* models, int count)
+{
+	DrawMeshInstanced(MeshType::Cylinder, models, count);
+}
+
+void MeshManager::DrawBoxMeshInstanced(const glm::mat4* models, int count)
+{
+	DrawMeshInstanced(MeshType::Box, models, count);
+}
+
+/***********************************************************
+ *  ReserveInstances()
+ *
+ *  This method is used for growing the instance buffer, which
+ *  must be bound, so that it can hold the passed in number of
+ *  instances.  The capacity is doubled to limit reallocation.
+ ***********************************************************/
+void MeshManager::ReserveInstances(int count)
+{
+	if (count <= m_instanceCapacity)
+	{
+		return;
+	}
+
+	int capacity = (m_instanceCapacity > 0) ? m_instanceCapacity : INITIAL_INSTANCE_CAPACITY;
+	while (capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_instanceBuffer, GpuMemory::MEMORY_BUFFERS, capacity * sizeof(INSTANCE_DATA));
+	m_instanceCapacity = capacity;
+}
+
+/***********************************************************
+ *  SetMeshLod()
+ *
+ *  This method is used for keeping where a level of detail of
+ *  a mesh was placed.  The levels past the last one generated
+ *  repeat it, so any level can be drawn for any mesh.
+ ***********************************************************/
+void MeshManager::SetMeshLod(MeshType type, int lod, const MESH_RANGE& range)
+{
+	for (int i = lod; i < LOD_COUNT; i++)
+	{
+		m_meshRanges[(int)type][i] = range;
+	}
+	m_lodCounts[(int)type] = lod + 1;
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method is used for choosing the level of detail of a
+ *  mesh from the radius it covers on screen in pixels.  The
+ *  level only moves once the size is past a switch size by
+ *  the hysteresis, so an object hovering at a switch distance
+ *  keeps the level it was drawn with.
+ ***********************************************************/
+int MeshManager::SelectLod(MeshType type, float projectedSize, int currentLod) const
+{
+	const int lastLod = m_lodCounts[(int)type] - 1;
+	int lod = std::min(std::max(currentLod, 0), lastLod);
+
+	while ((lod > 0) && (projectedSize > LOD_SWITCH_PIXELS[lod - 1] * (1.0f + LOD_HYSTERESIS)))
+	{
+		lod--;
+	}
+	while ((lod < lastLod) && (projectedSize < LOD_SWITCH_PIXELS[lod] * (1.0f - LOD_HYSTERESIS)))
+	{
+		lod++;
+	}
+
+	return(lod);
+}
+
+/***********************************************************
+ *  GetLodSwitchSize()
+ *
+ *  This method is used for getting the projected radius in
+ *  pixels below which a mesh moves past the passed in level.
+ ***********************************************************/
+float MeshManager::GetLodSwitchSize(int lod)
+{
+	return(LOD_SWITCH_PIXELS[std::min(std::max(lod, 0), LOD_COUNT - 2)]);
+}
+
+/***********************************************************
+ *  GetLodHysteresis()
+ *
+ *  This method is used for getting the part of a switch size
+ *  a projected size has to pass it by to change the level.
+ ***********************************************************/
+float MeshManager::GetLodHysteresis()
+{
+	return(LOD_HYSTERESIS);
+}
+
+/***********************************************************
+ *  AppendMesh()
+ *
+ *  This method is used for appending the geometry of one mesh
+ *  to the shared geometry, and returns where it was placed
+ *  along with the local bounding box of the mesh.
+ ***********************************************************/
+MeshManager::MESH_RANGE MeshManager::AppendMesh(
+	std::vector<VERTEX>& vertices,
+	std::vector<GLuint>& indices,
+	const std::vector<VERTEX>& meshVertices,
+	const std::vector<GLuint>& meshIndices)
+{
+	MESH_RANGE range;
+
+	range.baseVertex = (GLint)vertices.size();
+	range.vertexCount = (GLsizei)meshVertices.size();
+	range.firstIndex = (GLuint)indices.size();
+	range.indexCount = (GLsizei)meshIndices.size();
+	range.boundsMin = glm::vec3(0.0f);
+	range.boundsMax = glm::vec3(0.0f);
+
+	for (size_t i = 0; i < meshVertices.size(); i++)
+	{
+		const glm::vec3& position = meshVertices[i].position;
+		range.boundsMin = (i == 0) ? position : glm::min(range.boundsMin, position);
+		range.boundsMax = (i == 0) ? position : glm::max(range.boundsMax, position);
+	}
+
+	vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+	indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+
+	return(range);
+}
+
+/***********************************************************
+ *  GeneratePlane()
+ *
+ *  This method is used for generating a flat plane on the XZ
+ *  axes from -1 to 1, facing up.
+ ***********************************************************/
+void MeshManager::GeneratePlane(std::vector<VERTEX>& vertices, std::vector<GLuint>& indices)
+{
+	const glm::vec3 normal(0.0f, 1.0f, 0.0f);
+
+	vertices.clear();
+	indices.clear();
+
+	vertices.push_back({ glm::vec3(-1.0f, 0.0f,  1.0f), normal, glm::vec2(0.0f, 0.0f) });
+	vertices.push_back({ glm::vec3( 1.0f, 0.0f,  1.0f), normal, glm::vec2(1.0f, 0.0f) });
+	vertices.push_back({ glm::vec3( 1.0f, 0.0f, -1.0f), normal, glm::vec2(1.0f, 1.0f) });
+	vertices.push_back({ glm::vec3(-1.0f, 0.0f, -1.0f), normal, glm::vec2(0.0f, 1.0f) });
+
+	indices = { 0, 1, 2, 0, 2, 3 };
+}
+
+/***********************************************************
+ *  GenerateBox()
+ *
+ *  This method is used for generating a unit box centered on
+ *  the origin, with the full texture mapped onto each side.
+ ***********************************************************/
+void MeshManager::GenerateBox(std::vector<VERTEX>& vertices, std::vector<GLuint>& indices)
+{
+	// each side is described by its normal and the two axes
+	// across it, chosen so that cross(u, v) == normal
+	const glm::vec3 sides[6][3] = {
+		{ glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 1.0f, 0.0f,  0.0f), glm::vec3(0.0f, 1.0f,  0.0f) },
+		{ glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(-1.0f, 0.0f,  0.0f), glm::vec3(0.0f, 1.0f,  0.0f) },
+		{ glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3( 0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f,  0.0f) },
+		{ glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3( 0.0f, 0.0f,  1.0f), glm::vec3(0.0f, 1.0f,  0.0f) },
+		{ glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 1.0f, 0.0f,  0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 1.0f, 0.0f,  0.0f), glm::vec3(0.0f, 0.0f,  1.0f) },
+	};
+
+	vertices.clear();
+	indices.clear();
+
+	for (int side = 0; side < 6; side++)
+	{
+		const glm::vec3& n = sides[side][0];
+		const glm::vec3& u = sides[side][1];
+		const glm::vec3& v = sides[side][2];
+		const glm::vec3 center = n * 0.5f;
+		const GLuint first = (GLuint)vertices.size();
+
+		vertices.push_back({ center - u * 0.5f - v * 0.5f, n, glm::vec2(0.0f, 0.0f) });
+		vertices.push_back({ center + u * 0.5f - v * 0.5f, n, glm::vec2(1.0f, 0.0f) });
+		vertices.push_back({ center + u * 0.5f + v * 0.5f, n, glm::vec2(1.0f, 1.0f) });
+		vertices.push_back({ center - u * 0.5f + v * 0.5f, n, glm::vec2(0.0f, 1.0f) });
+
+		indices.push_back(first + 0);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+		indices.push_back(first + 0);
+		indices.push_back(first + 2);
+		indices.push_back(first + 3);
+	}
+}
+
+/***********************************************************
+ *  GenerateCylinder()
+ *
+ *  This method is used for generating a cylinder of radius 1
+ *  standing on the XZ plane from a height of 0 to 1, with the
+ *  top and bottom closed.  The slices set the tessellation.
+ ***********************************************************/
+void MeshManager::GenerateCylinder(int slices, std::vector<VERTEX>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	// the sides - one extra column of vertices closes the
+	// texture seam
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = 2.0f * PI * (float)i / (float)slices;
+		float x = std::cos(angle);
+		float z = -std::sin(angle);
+		float u = (float)i / (float)slices;
+
+		vertices.push_back({ glm::vec3(x, 0.0f, z), glm::vec3(x, 0.0f, z), glm::vec2(u, 0.0f) });
+		vertices.push_back({ glm::vec3(x, 1.0f, z), glm::vec3(x, 0.0f, z), glm::vec2(u, 1.0f) });
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint bottom = i * 2;
+		GLuint top = bottom + 1;
+
+		indices.push_back(bottom);
+		indices.push_back(bottom + 2);
+		indices.push_back(top + 2);
+		indices.push_back(bottom);
+		indices.push_back(top + 2);
+		indices.push_back(top);
+	}
+
+	// the top and bottom caps as triangle fans
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float y = (cap == 0) ? 1.0f : 0.0f;
+		glm::vec3 normal(0.0f, (cap == 0) ? 1.0f : -1.0f, 0.0f);
+		GLuint center = (GLuint)vertices.size();
+
+		vertices.push_back({ glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f) });
+		for (int i = 0; i <= slices; i++)
+		{
+			float angle = 2.0f * PI * (float)i / (float)slices;
+			float x = std::cos(angle);
+			float z = -std::sin(angle);
+
+			vertices.push_back({ glm::vec3(x, y, z), normal, glm::vec2(0.5f + 0.5f * x, 0.5f - 0.5f * z) });
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			indices.push_back(center);
+			if (cap == 0)
+			{
+				indices.push_back(center + 1 + i);
+				indices.push_back(center + 2 + i);
+			}
+			else
+			{
+				indices.push_back(center + 2 + i);
+				indices.push_back(center + 1 + i);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateSphere()
+ *
+ *  This method is used for generating a sphere of radius 1
+ *  centered on the origin.  The sectors and stacks set the
+ *  tessellation around and along the Y axis.
+ ***********************************************************/
+void MeshManager::GenerateSphere(int sectors, int stacks, std::vector<VERTEX>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	for (int i = 0; i <= stacks; i++)
+	{
+		float phi = PI * (float)i / (float)stacks;
+		float y = std::cos(phi);
+		float ring = std::sin(phi);
+
+		for (int j = 0; j <= sectors; j++)
+		{
+			float theta = 2.0f * PI * (float)j / (float)sectors;
+			glm::vec3 position(ring * std::cos(theta), y, -ring * std::sin(theta));
+
+			vertices.push_back({ position, position,
+				glm::vec2((float)j / (float)sectors, 1.0f - (float)i / (float)stacks) });
+		}
+	}
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < sectors; j++)
+		{
+			GLuint upper = i * (sectors + 1) + j;
+			GLuint lower = upper + sectors + 1;
+
+			indices.push_back(lower);
+			indices.push_back(lower + 1);
+			indices.push_back(upper + 1);
+			indices.push_back(lower);
+			indices.push_back(upper + 1);
+			indices.push_back(upper);
+		}
+	}
+}
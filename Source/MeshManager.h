@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshmanager.h
+// ============
+// manage the shared vertex/index buffers of the procedural basic meshes and
+// the instanced drawing of them
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshManager
+ *
+ *  This class generates the basic plane, sphere, cylinder and
+ *  box meshes into one shared vertex buffer and index buffer,
+ *  and draws them with hardware instancing.  The per-instance
+ *  model matrix and material/texture indices are streamed
+ *  through an instance buffer that is read by the vertex
+ *  shader as vertex attributes.
+ *
+ *  The round meshes are generated at several tessellations,
+ *  the levels of detail, which share the same buffers, and a
+ *  level is chosen from the size an object covers on screen.
+ *
+ *  Objects that never move can also be baked into static
+ *  batches, where the meshes are transformed once into one
+ *  vertex and index buffer with the indices in every vertex.
+ *  Each object keeps its own range of the indices at every
+ *  level of detail, so one multi-draw call draws only the
+ *  objects in view at their levels, and the whole batch at
+ *  level 0 can still be drawn with one plain draw call.
+ *
+ *  The meshes use the same conventions as the ShapeMeshes they
+ *  replace, so they can be scaled and placed with the same
+ *  transformations.
+ ***********************************************************/
+class MeshManager
+{
+public:
+	// constructor
+	MeshManager();
+	// destructor
+	~MeshManager();
+
+	// MeshType enum identifies one of the basic meshes
+	enum class MeshType { Plane, Sphere, Cylinder, Box };
+	// total number of basic meshes
+	static const int MESH_COUNT = 4;
+	// levels of detail of a mesh, level 0 is the finest
+	static const int LOD_COUNT = 3;
+
+	// MESH_RANGE struct locates a mesh inside the shared buffers
+	struct MESH_RANGE
+	{
+		GLint baseVertex;        // first vertex in the vertex buffer
+		GLsizei vertexCount;     // number of vertices of the mesh
+		GLuint firstIndex;       // first index in the index buffer
+		GLsizei indexCount;      // number of indices to draw
+		glm::vec3 boundsMin;     // local bounding box of the mesh
+		glm::vec3 boundsMax;
+	};
+
+	// INSTANCE_DATA struct holds the per-instance vertex attributes
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;         // model matrix of the instance
+		GLint materialIndex;     // index of the instance material
+		GLint textureIndex;      // index of the instance texture
+	};
+
+	// STATIC_RANGE struct locates the indices of one object at one
+	// level of detail inside the index buffer of a static batch
+	struct STATIC_RANGE
+	{
+		GLuint firstIndex;       // first index of the object
+		GLsizei indexCount;      // number of indices of the object
+	};
+
+	// generate the basic meshes and upload them to the GPU
+	void LoadMeshes();
+	// free the GPU buffers of the basic meshes
+	void DestroyMeshes();
+
+	// get the location of a level of detail of a mesh inside the
+	// shared buffers
+	const MESH_RANGE& GetMeshRange(MeshType type, int lod = 0) const { return(m_meshRanges[(int)type][lod]); }
+	// get the number of distinct levels of detail of a mesh
+	int GetLodCount(MeshType type) const { return(m_lodCounts[(int)type]); }
+	// choose the level of detail of a mesh covering the passed in
+	// radius on screen in pixels, given the level drawn last
+	int SelectLod(MeshType type, float projectedSize, int currentLod) const;
+	// get the projected radius in pixels below which a mesh moves
+	// past a level, and the hysteresis around it
+	static float GetLodSwitchSize(int lod);
+	static float GetLodHysteresis();
+
+	// draw a number of instances of a mesh in a single draw call
+	void DrawMeshInstanced(MeshType type, const INSTANCE_DATA* instances, int count, int lod = 0);
+	void DrawMeshInstanced(MeshType type, const glm::mat4* models, int count);
+
+	// draw a number of instances of a mesh from instance data already
+	// in the passed in buffer, starting at the first instance
+	void DrawMeshInstances(MeshType type, GLuint instanceBuffer, int firstInstance, int count, int lod = 0);
+
+	// draw a range of the indirect commands of a command buffer,
+	// with the instances read from the passed in instance buffer
+	void DrawIndirect(GLuint instanceBuffer, GLuint commandBuffer, int firstCommand, int commandCount);
+
+	// bake the passed in instances of the meshes into a new static
+	// batch, filling in LOD_COUNT index ranges for each instance,
+	// one per level, returns the batch id or -1 when there is
+	// nothing to bake
+	int CreateStaticBatch(const MeshType* types, const INSTANCE_DATA* instances, int count, std::vector<STATIC_RANGE>& ranges);
+	// free all of the static batches
+	void DestroyStaticBatches();
+	// draw all of the objects of a static batch at level 0 in one
+	// draw call
+	void DrawStaticBatch(int batch);
+	// draw index ranges of a static batch in one draw call, each
+	// given by its count and its byte offset in the index buffer
+	void DrawStaticRanges(int batch, const GLsizei* counts, const GLvoid* const* offsets, int rangeCount);
+	// draw a range of the indirect commands of a command buffer
+	// from a static batch, the commands index the batch from vertex 0
+	void DrawStaticIndirect(int batch, GLuint commandBuffer, int firstCommand, int commandCount);
+	// get the number of static batches
+	int GetStaticBatchCount() const { return((int)m_staticBatches.size()); }
+
+	// draw a number of instances of a specific mesh
+	void DrawPlaneMeshInstanced(const glm::mat4* models, int count);
+	void DrawSphereMeshInstanced(const glm::mat4* models, int count);
+	void DrawCylinderMeshInstanced(const glm::mat4* models, int count);
+	void DrawBoxMeshInstanced(const glm::mat4* models, int count);
+
+private:
+	// interleaved vertex layout - position, normal, texture coordinate
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// STATIC_VERTEX struct is a pre-transformed vertex of a static
+	// batch, carrying the indices of the object it belongs to
+	struct STATIC_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+		GLint materialIndex;
+		GLint textureIndex;
+	};
+
+	// STATIC_BATCH struct holds the buffers of one static batch
+	struct STATIC_BATCH
+	{
+		GLuint vao;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLsizei indexCount;      // indices of level 0, which come first
+	};
+
+	// vertex array object with the mesh and instance attributes
+	GLuint m_vao;
+	// shared vertex buffer of all the meshes
+	GLuint m_vertexBuffer;
+	// shared index buffer of all the meshes
+	GLuint m_indexBuffer;
+	// streamed per-instance attribute buffer
+	GLuint m_instanceBuffer;
+	// number of instances the instance buffer can hold
+	int m_instanceCapacity;
+	// vertex array object reading the instances of the indirect
+	// draws, and the instance buffer it was set up with
+	GLuint m_indirectVao;
+	GLuint m_indirectInstanceBuffer;
+	// vertex array object reading instances written by the caller,
+	// and the instance buffer it was set up with
+	GLuint m_bufferVao;
+	GLuint m_bufferInstanceBuffer;
+	// location of each level of detail of each mesh in the shared
+	// buffers, and the number of distinct levels of each mesh
+	MESH_RANGE m_meshRanges[MESH_COUNT][LOD_COUNT];
+	int m_lodCounts[MESH_COUNT];
+	// scratch instances used by the matrix-only draw methods
+	std::vector<INSTANCE_DATA> m_scratchInstances;
+	// geometry of the meshes kept for baking the static batches
+	std::vector<VERTEX> m_vertices;
+	std::vector<GLuint> m_indices;
+	// baked static batches by id
+	std::vector<STATIC_BATCH> m_staticBatches;
+
+	// keep the location of a level of detail of a mesh
+	void SetMeshLod(MeshType type, int lod, const MESH_RANGE& range);
+	// append a mesh's generated geometry to the shared geometry
+	static MESH_RANGE AppendMesh(
+		std::vector<VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		const std::vector<VERTEX>& meshVertices,
+		const std::vector<GLuint>& meshIndices);
+
+	// generate the geometry of the basic meshes
+	static void GeneratePlane(std::vector<VERTEX>& vertices, std::vector<GLuint>& indices);
+	static void GenerateBox(std::vector<VERTEX>& vertices, std::vector<GLuint>& indices);
+	static void GenerateCylinder(int slices, std::vector<VERTEX>& vertices, std::vector<GLuint>& indices);
+	static void GenerateSphere(int sectors, int stacks, std::vector<VERTEX>& vertices, std::vector<GLuint>& indices);
+
+	// point the bound vertex array at the meshes and an instance buffer
+	void SetupVertexArray(GLuint instanceBuffer);
+	// give the model matrix attributes, which the static batches
+	// leave disabled, the identity matrix
+	static void SetStaticModel();
+	// make sure the instance buffer can hold the passed in count
+	void ReserveInstances(int count);
+};
@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// render the large occluders of the scene into a hierarchical depth buffer
+// the GPU culling tests the object bounds against
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+#include "GpuMemory.h"
+#include "ShaderVariants.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// declaration of the global variables and defines
+namespace
+{
+	// texels reduced by each compute work group along x and y, this
+	// matches the shader
+	const int PYRAMID_GROUP_SIZE = 8;
+
+	/***********************************************************
+	 *  BuildProgram()
+	 *
+	 *  This function is used for building a program from a
+	 *  single shader file, returns 0 when it fails.
+	 ***********************************************************/
+	GLuint BuildProgram(GLenum stage, const char* filename)
+	{
+		std::string source;
+		if (!ShaderVariants::ReadShaderFile(filename, source))
+		{
+			return(0);
+		}
+		GLuint shader = ShaderVariants::CompileStage(stage, source);
+		if (shader == 0)
+		{
+			return(0);
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shader);
+		glLinkProgram(program);
+		glDetachShader(program, shader);
+		glDeleteShader(shader);
+
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "ERROR: " << filename << " failed to link:" << std::endl << log << std::endl;
+			glDeleteProgram(program);
+			return(0);
+		}
+
+		return(program);
+	}
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+{
+	m_occluderProgram = 0;
+	m_pyramidProgram = 0;
+	m_depthTexture = 0;
+	m_framebuffer = 0;
+	m_pyramidTexture = 0;
+	m_levelCount = 0;
+	m_textureUnit = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_previousFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_previousViewport[i] = 0;
+	}
+	m_viewProjectionLocation = -1;
+	m_sourceLevelLocation = -1;
+}
+
+/***********************************************************
+ *  ~OcclusionCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionCuller::~OcclusionCuller()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the programs and creating
+ *  the occluder target and the pyramid.  The occluders are
+ *  drawn with a vertex shader alone, so only their depth is
+ *  written.
+ ***********************************************************/
+bool OcclusionCuller::Initialize(const char* occluderVertexFile, const char* pyramidComputeFile, int textureUnit)
+{
+	Destroy();
+
+	if (!GLEW_VERSION_4_3)
+	{
+		return false;
+	}
+
+	GLuint occluderProgram = BuildProgram(GL_VERTEX_SHADER, occluderVertexFile);
+	GLuint pyramidProgram = BuildProgram(GL_COMPUTE_SHADER, pyramidComputeFile);
+	if ((occluderProgram == 0) || (pyramidProgram == 0))
+	{
+		glDeleteProgram(occluderProgram);
+		glDeleteProgram(pyramidProgram);
+		return false;
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, DEPTH_WIDTH, DEPTH_HEIGHT);
+	GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_depthTexture, GpuMemory::MEMORY_TARGETS, (size_t)DEPTH_WIDTH * DEPTH_HEIGHT * sizeof(float));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	m_levelCount = 1;
+	while ((DEPTH_WIDTH >> m_levelCount) > 0 || (DEPTH_HEIGHT >> m_levelCount) > 0)
+	{
+		m_levelCount++;
+	}
+	glGenTextures(1, &m_pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_levelCount, GL_R32F, DEPTH_WIDTH, DEPTH_HEIGHT);
+	size_t pyramidBytes = 0;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		pyramidBytes += (size_t)std::max(DEPTH_WIDTH >> level, 1) * std::max(DEPTH_HEIGHT >> level, 1) * sizeof(float);
+	}
+	GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_pyramidTexture, GpuMemory::MEMORY_TARGETS, pyramidBytes);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	m_occluderProgram = occluderProgram;
+	m_pyramidProgram = pyramidProgram;
+	m_textureUnit = textureUnit;
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: the occluder depth target is incomplete" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	m_viewProjectionLocation = glGetUniformLocation(occluderProgram, "viewProjection");
+	m_sourceLevelLocation = glGetUniformLocation(pyramidProgram, "sourceLevel");
+
+	// the depth is always read from the same unit
+	glUseProgram(pyramidProgram);
+	glUniform1i(glGetUniformLocation(pyramidProgram, "depthTexture"), m_textureUnit);
+	glUseProgram(0);
+
+	return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the programs and targets.
+ ***********************************************************/
+void OcclusionCuller::Destroy()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+	}
+	if (m_pyramidTexture != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_pyramidTexture);
+		glDeleteTextures(1, &m_pyramidTexture);
+	}
+	if (m_depthTexture != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_depthTexture);
+		glDeleteTextures(1, &m_depthTexture);
+	}
+	if (m_pyramidProgram != 0)
+	{
+		glDeleteProgram(m_pyramidProgram);
+	}
+	if (m_occluderProgram != 0)
+	{
+		glDeleteProgram(m_occluderProgram);
+	}
+
+	m_occluderProgram = 0;
+	m_pyramidProgram = 0;
+	m_depthTexture = 0;
+	m_framebuffer = 0;
+	m_pyramidTexture = 0;
+	m_levelCount = 0;
+}
+
+/***********************************************************
+ *  BeginOccluders()
+ *
+ *  This method is used for starting the depth pass of the
+ *  occluders.  The bound framebuffer and viewport are kept so
+ *  that the frame carries on where it was drawing.
+ ***********************************************************/
+void OcclusionCuller::BeginOccluders(const glm::mat4& viewProjection)
+{
+	if (m_pyramidProgram == 0)
+	{
+		return;
+	}
+
+	m_viewProjection = viewProjection;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+	glDepthMask(GL_TRUE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(m_occluderProgram);
+	glUniformMatrix4fv(m_viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+}
+
+/***********************************************************
+ *  EndOccluders()
+ *
+ *  This method is used for finishing the depth pass and
+ *  reducing it into the pyramid, one dispatch per level with
+ *  a barrier between them.  The pyramid is left bound to its
+ *  texture unit for the culling shader.
+ ***********************************************************/
+void OcclusionCuller::EndOccluders()
+{
+	if (m_pyramidProgram == 0)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+
+	glUseProgram(m_pyramidProgram);
+	glActiveTexture(GL_TEXTURE0 + m_textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		// level 0 is copied from the depth, the image read is unused
+		int sourceLevel = level - 1;
+		glUniform1i(m_sourceLevelLocation, sourceLevel);
+		glBindImageTexture(0, m_pyramidTexture, (sourceLevel < 0) ? 0 : sourceLevel, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		int width = (DEPTH_WIDTH >> level) > 0 ? (DEPTH_WIDTH >> level) : 1;
+		int height = (DEPTH_HEIGHT >> level) > 0 ? (DEPTH_HEIGHT >> level) : 1;
+		glDispatchCompute((GLuint)((width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE),
+			(GLuint)((height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE), 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
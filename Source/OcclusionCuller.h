@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// render the large occluders of the scene into a hierarchical depth buffer
+// the GPU culling tests the object bounds against
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class draws the occluders of a frame, the baked static
+ *  scenery, depth only into a small offscreen target before the
+ *  objects are culled.  A compute shader reduces the depth into
+ *  a Hi-Z pyramid, every texel of a level holding the farthest
+ *  depth of the four texels below it.  An object whose nearest
+ *  depth is behind the farthest occluder depth over its screen
+ *  rectangle is hidden, which the culling shader finds with at
+ *  most four texel reads from the level that rectangle spans.
+ *  The pyramid is built from the current frame, so it never
+ *  lags the camera.  It needs OpenGL 4.3 like the GPU culling,
+ *  and the OpenGL 3.3 path culls nothing by occlusion.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	// size of the occluder depth target, a power of two on both
+	// axes so every level halves exactly
+	static const int DEPTH_WIDTH = 512;
+	static const int DEPTH_HEIGHT = 256;
+
+	// constructor
+	OcclusionCuller();
+	// destructor
+	~OcclusionCuller();
+
+	// build the occluder and pyramid programs and the targets,
+	// the texture unit is used to read the depth and to bind the
+	// pyramid, returns false when the GPU cannot cull
+	bool Initialize(const char* occluderVertexFile, const char* pyramidComputeFile, int textureUnit);
+	// free the programs and the targets
+	void Destroy();
+	// true when the occluders can be rendered
+	bool IsAvailable() const { return(m_pyramidProgram != 0); }
+
+	// bind the occluder target and program, the static batches
+	// drawn until EndOccluders() are the occluders of the frame
+	void BeginOccluders(const glm::mat4& viewProjection);
+	// restore the previous target and build the pyramid
+	void EndOccluders();
+
+	// get the texture unit the pyramid is bound to
+	int GetTextureUnit() const { return(m_textureUnit); }
+	// get the camera the pyramid was rendered with
+	const glm::mat4& GetViewProjection() const { return(m_viewProjection); }
+
+private:
+	// programs drawing the occluders and reducing the pyramid
+	GLuint m_occluderProgram;
+	GLuint m_pyramidProgram;
+	// occluder depth target and the framebuffer it is attached to
+	GLuint m_depthTexture;
+	GLuint m_framebuffer;
+	// R32F pyramid with a full chain of levels
+	GLuint m_pyramidTexture;
+	int m_levelCount;
+	// unit the depth is read from and the pyramid is bound to
+	int m_textureUnit;
+	// camera of the occluders
+	glm::mat4 m_viewProjection;
+	// framebuffer and viewport restored after the occluders
+	GLint m_previousFramebuffer;
+	GLint m_previousViewport[4];
+	// uniform locations of the programs
+	GLint m_viewProjectionLocation;
+	GLint m_sourceLevelLocation;
+};
@@ -0,0 +1,535 @@
+///////////////////////////////////////////////////////////////////////////////
+// profiler.cpp
+// ============
+// measure the CPU and GPU time of each frame and report it on screen and
+// optionally into a CSV file
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Profiler.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// how often the statistics in the window title refresh
+	const double TITLE_UPDATE_SECONDS = 0.5;
+
+	// layout of the frame time graph in pixels
+	const int GRAPH_MARGIN = 8;
+	const int GRAPH_BAR_WIDTH = 2;
+	const int GRAPH_BARS = 120;
+	const int GRAPH_HEIGHT = 100;
+	// frame time at the top of the graph in milliseconds
+	const float GRAPH_MAX_MS = 33.3f;
+	// frame time of 60 frames per second, drawn as a marker line
+	const float TARGET_FRAME_MS = 1000.0f / 60.0f;
+	// height of the video memory bar above the graph in pixels
+	const int MEMORY_BAR_HEIGHT = 8;
+	// colors of the video memory categories in the bar
+	const float g_MemoryColors[GpuMemory::MEMORY_CATEGORY_COUNT][3] =
+	{
+		{ 0.3f, 0.5f, 0.9f },
+		{ 0.2f, 0.8f, 0.8f },
+		{ 0.8f, 0.4f, 0.9f },
+		{ 0.9f, 0.6f, 0.2f }
+	};
+	const size_t BYTES_PER_MB = 1024 * 1024;
+
+	// names of the CPU scopes and GPU passes in the CSV header
+	const char* const g_CpuScopeNames[Profiler::CPU_SCOPE_COUNT] =
+	{
+		"prepare_view_ms",
+		"render_scene_ms",
+		"swap_buffers_ms",
+		"wait_frame_ms"
+	};
+	const char* const g_GpuPassNames[Profiler::GPU_PASS_COUNT] =
+	{
+		"gpu_shadows_ms",
+		"gpu_occlusion_ms",
+		"gpu_prepass_ms",
+		"gpu_shading_ms",
+		"gpu_transparent_ms",
+		"gpu_upscale_ms"
+	};
+
+	/***********************************************************
+	 *  ElapsedMilliseconds()
+	 *
+	 *  This function is used for getting the milliseconds
+	 *  between two steady clock time points.
+	 ***********************************************************/
+	float ElapsedMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<float, std::milli>(end - start).count());
+	}
+}
+
+/***********************************************************
+ *  Profiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Profiler::Profiler(const char* windowTitle)
+{
+	m_windowTitle = windowTitle;
+	m_bGpuTimers = false;
+	m_frameCount = 0;
+	m_counters.drawCalls = 0;
+	m_counters.stateChanges = 0;
+	m_counters.uniformUploads = 0;
+	m_counters.fenceStalls = 0;
+	m_counters.resolutionScale = 1.0f;
+	m_fenceStallCount = 0;
+	m_bShowOverlay = true;
+	m_pCsvFile = NULL;
+	m_frameTimes.reserve(FRAME_HISTORY);
+	m_frameStart = Clock::now();
+	m_lastTitleUpdate = m_frameStart;
+
+	for (int i = 0; i < CPU_SCOPE_COUNT; i++)
+	{
+		m_cpuStarts[i] = m_frameStart;
+		m_cpuTimes[i] = 0.0f;
+	}
+	for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+	{
+		m_gpuTimes[pass] = -1.0f;
+		m_bPassBegun[pass] = false;
+		for (int i = 0; i < GPU_QUERY_LATENCY; i++)
+		{
+			m_gpuQueries[pass][i] = 0;
+			m_bQueryPending[pass][i] = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  ~Profiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Profiler::~Profiler()
+{
+	if (m_bGpuTimers)
+	{
+		glDeleteQueries(GPU_PASS_COUNT * GPU_QUERY_LATENCY, &m_gpuQueries[0][0]);
+	}
+	if (m_pCsvFile != NULL)
+	{
+		fclose(m_pCsvFile);
+		m_pCsvFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the GPU timer queries.
+ *  Without timer query support only the CPU is measured.
+ ***********************************************************/
+void Profiler::Initialize()
+{
+	m_bGpuTimers = (GLEW_ARB_timer_query != 0);
+	if (m_bGpuTimers)
+	{
+		glGenQueries(GPU_PASS_COUNT * GPU_QUERY_LATENCY, &m_gpuQueries[0][0]);
+	}
+	else
+	{
+		std::cout << "GPU timer queries are not supported, only the CPU is profiled" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  OpenCsv()
+ *
+ *  This method is used for writing the measurements of every
+ *  frame into a CSV file, one line per frame.
+ ***********************************************************/
+bool Profiler::OpenCsv(const char* filename)
+{
+	m_pCsvFile = fopen(filename, "w");
+	if (m_pCsvFile == NULL)
+	{
+		std::cout << "Could not create profile file:" << filename << std::endl;
+		return false;
+	}
+
+	fprintf(m_pCsvFile, "frame,frame_ms");
+	for (int i = 0; i < CPU_SCOPE_COUNT; i++)
+	{
+		fprintf(m_pCsvFile, ",%s", g_CpuScopeNames[i]);
+	}
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		fprintf(m_pCsvFile, ",%s", g_GpuPassNames[i]);
+	}
+	fprintf(m_pCsvFile, ",draw_calls,state_changes,uniform_uploads,fence_stalls,resolution_scale");
+	for (int i = 0; i < GpuMemory::MEMORY_CATEGORY_COUNT; i++)
+	{
+		fprintf(m_pCsvFile, ",%s_mb", GpuMemory::GetCategoryName((GpuMemory::Category)i));
+	}
+	fprintf(m_pCsvFile, "\n");
+
+	return true;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for marking the start of a frame.
+ ***********************************************************/
+void Profiler::BeginFrame()
+{
+	m_frameStart = Clock::now();
+	for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+	{
+		m_bPassBegun[pass] = false;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for marking the end of a frame.  It
+ *  records the frame time, collects the finished GPU timings
+ *  and writes the frame to the CSV file.
+ ***********************************************************/
+void Profiler::EndFrame(GLFWwindow* window)
+{
+	Clock::time_point frameEnd = Clock::now();
+	float frameTime = ElapsedMilliseconds(m_frameStart, frameEnd);
+
+	// the rolling window overwrites its oldest frame
+	if (m_frameTimes.size() < FRAME_HISTORY)
+	{
+		m_frameTimes.push_back(frameTime);
+	}
+	else
+	{
+		m_frameTimes[m_frameCount % FRAME_HISTORY] = frameTime;
+	}
+
+	CollectGpuResults();
+	// a pass the frame did not draw, such as the pre-pass while it
+	// is off, took no time rather than its last measured one
+	for (int pass = 0; (pass < GPU_PASS_COUNT) && m_bGpuTimers; pass++)
+	{
+		if (!m_bPassBegun[pass])
+		{
+			m_gpuTimes[pass] = 0.0f;
+		}
+	}
+	m_fenceStallCount += m_counters.fenceStalls;
+
+	if (m_pCsvFile != NULL)
+	{
+		fprintf(m_pCsvFile, "%lld,%.3f", m_frameCount, frameTime);
+		for (int i = 0; i < CPU_SCOPE_COUNT; i++)
+		{
+			fprintf(m_pCsvFile, ",%.3f", m_cpuTimes[i]);
+		}
+		for (int i = 0; i < GPU_PASS_COUNT; i++)
+		{
+			fprintf(m_pCsvFile, ",%.3f", m_gpuTimes[i]);
+		}
+		fprintf(m_pCsvFile, ",%d,%d,%d,%d,%.3f", m_counters.drawCalls, m_counters.stateChanges,
+			m_counters.uniformUploads, m_counters.fenceStalls, m_counters.resolutionScale);
+		for (int i = 0; i < GpuMemory::MEMORY_CATEGORY_COUNT; i++)
+		{
+			fprintf(m_pCsvFile, ",%.2f", (double)GpuMemory::GetUsage((GpuMemory::Category)i) / BYTES_PER_MB);
+		}
+		fprintf(m_pCsvFile, "\n");
+	}
+
+	m_frameCount++;
+
+	if (std::chrono::duration<double>(frameEnd - m_lastTitleUpdate).count() >= TITLE_UPDATE_SECONDS)
+	{
+		UpdateWindowTitle(window);
+		m_lastTitleUpdate = frameEnd;
+	}
+}
+
+/***********************************************************
+ *  BeginCpuScope() / EndCpuScope()
+ *
+ *  These methods are used for timing a part of the frame on
+ *  the CPU.
+ ***********************************************************/
+void Profiler::BeginCpuScope(CpuScope scope)
+{
+	m_cpuStarts[scope] = Clock::now();
+}
+
+void Profiler::EndCpuScope(CpuScope scope)
+{
+	m_cpuTimes[scope] = ElapsedMilliseconds(m_cpuStarts[scope], Clock::now());
+}
+
+/***********************************************************
+ *  BeginGpuPass() / EndGpuPass()
+ *
+ *  These methods are used for timing a render pass on the GPU
+ *  with the next query of the pass ring.  If that query still
+ *  has no result the frame is not timed, rather than waiting.
+ ***********************************************************/
+void Profiler::BeginGpuPass(GpuPass pass)
+{
+	int slot = (int)(m_frameCount % GPU_QUERY_LATENCY);
+
+	m_bPassBegun[pass] = true;
+	if (!m_bGpuTimers || m_bQueryPending[pass][slot])
+	{
+		return;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, m_gpuQueries[pass][slot]);
+	m_bQueryPending[pass][slot] = true;
+}
+
+void Profiler::EndGpuPass(GpuPass pass)
+{
+	int slot = (int)(m_frameCount % GPU_QUERY_LATENCY);
+
+	if (!m_bGpuTimers)
+	{
+		return;
+	}
+
+	GLint activeQuery = 0;
+	glGetQueryiv(GL_TIME_ELAPSED, GL_CURRENT_QUERY, &activeQuery);
+	if ((GLuint)activeQuery == m_gpuQueries[pass][slot])
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+}
+
+/***********************************************************
+ *  CollectGpuResults()
+ *
+ *  This method is used for reading back every pending timer
+ *  query whose result is already available.
+ ***********************************************************/
+void Profiler::CollectGpuResults()
+{
+	if (!m_bGpuTimers)
+	{
+		return;
+	}
+
+	for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+	{
+		// oldest first, so the latest result wins
+		for (int i = 1; i <= GPU_QUERY_LATENCY; i++)
+		{
+			int slot = (int)((m_frameCount + i) % GPU_QUERY_LATENCY);
+			if (!m_bQueryPending[pass][slot])
+			{
+				continue;
+			}
+
+			GLint available = 0;
+			glGetQueryObjectiv(m_gpuQueries[pass][slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(m_gpuQueries[pass][slot], GL_QUERY_RESULT, &elapsed);
+				m_gpuTimes[pass] = (float)((double)elapsed / 1000000.0);
+				m_bQueryPending[pass][slot] = false;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetGpuSceneTime()
+ *
+ *  This method is used for getting the summed GPU time of the
+ *  passes that are drawn at the scene resolution, which is
+ *  what the dynamic resolution scales.
+ ***********************************************************/
+float Profiler::GetGpuSceneTime() const
+{
+	if (!m_bGpuTimers)
+	{
+		return(-1.0f);
+	}
+
+	float sceneTime = 0.0f;
+	for (int pass = 0; pass < GPU_UPSCALE; pass++)
+	{
+		sceneTime += std::max(m_gpuTimes[pass], 0.0f);
+	}
+
+	return(sceneTime);
+}
+
+/***********************************************************
+ *  GetFramePercentile()
+ *
+ *  This method is used for getting a percentile between 0 and
+ *  100 of the rolling frame times.
+ ***********************************************************/
+float Profiler::GetFramePercentile(float percentile) const
+{
+	if (m_frameTimes.size() == 0)
+	{
+		return(0.0f);
+	}
+
+	std::vector<float> sorted = m_frameTimes;
+	size_t rank = (size_t)(percentile / 100.0f * (float)(sorted.size() - 1) + 0.5f);
+	rank = std::min(rank, sorted.size() - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+	return(sorted[rank]);
+}
+
+/***********************************************************
+ *  UpdateWindowTitle()
+ *
+ *  This method is used for showing the frame statistics in
+ *  the window title, with the video memory in use against the
+ *  budget when there is one.
+ ***********************************************************/
+void Profiler::UpdateWindowTitle(GLFWwindow* window)
+{
+	char stats[384];
+	char memory[64];
+
+	if (m_bGpuTimers)
+	{
+		snprintf(stats, sizeof(stats),
+			" | p50 %.2f ms  p99 %.2f ms | GPU %.2f ms at %d%% (shadows %.2f  occlusion %.2f  prepass %.2f"
+			"  shading %.2f  transparent %.2f  upscale %.2f) | %d draws  %d state changes  %d uniforms | %lld stalls",
+			GetFramePercentile(50.0f), GetFramePercentile(99.0f), GetGpuSceneTime() + m_gpuTimes[GPU_UPSCALE],
+			(int)(m_counters.resolutionScale * 100.0f + 0.5f),
+			m_gpuTimes[GPU_SHADOWS], m_gpuTimes[GPU_OCCLUSION], m_gpuTimes[GPU_PREPASS],
+			m_gpuTimes[GPU_SHADING], m_gpuTimes[GPU_TRANSPARENT], m_gpuTimes[GPU_UPSCALE],
+			m_counters.drawCalls, m_counters.stateChanges, m_counters.uniformUploads, m_fenceStallCount);
+	}
+	else
+	{
+		snprintf(stats, sizeof(stats),
+			" | p50 %.2f ms  p99 %.2f ms | %d draws  %d state changes  %d uniforms | %lld stalls",
+			GetFramePercentile(50.0f), GetFramePercentile(99.0f),
+			m_counters.drawCalls, m_counters.stateChanges, m_counters.uniformUploads, m_fenceStallCount);
+	}
+
+	int usedMB = (int)(GpuMemory::GetTotalUsage() / BYTES_PER_MB);
+	if (GpuMemory::GetBudget() > 0)
+	{
+		snprintf(memory, sizeof(memory), " | VRAM %d/%d MB", usedMB, (int)(GpuMemory::GetBudget() / BYTES_PER_MB));
+	}
+	else
+	{
+		snprintf(memory, sizeof(memory), " | VRAM %d MB", usedMB);
+	}
+
+	glfwSetWindowTitle(window, (m_windowTitle + stats + memory).c_str());
+}
+
+/***********************************************************
+ *  DrawOverlay()
+ *
+ *  This method is used for drawing a bar graph of the latest
+ *  frame times into the lower left corner of the window.  The
+ *  bars are scissored clears, so the graph needs no shader or
+ *  geometry and cannot disturb the scene state.  Bars over the
+ *  60 Hz budget are drawn yellow, and over twice of it red.
+ *  A bar above the graph splits the video memory in use by
+ *  category, and spans the memory budget when there is one.
+ ***********************************************************/
+void Profiler::DrawOverlay(GLFWwindow* window)
+{
+	if (!m_bShowOverlay || (m_frameTimes.size() == 0))
+	{
+		return;
+	}
+
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+
+	GLfloat clearColor[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glEnable(GL_SCISSOR_TEST);
+
+	// dark background behind the bars
+	glScissor(GRAPH_MARGIN, GRAPH_MARGIN, GRAPH_BARS * GRAPH_BAR_WIDTH, GRAPH_HEIGHT);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	int bars = std::min((int)m_frameTimes.size(), GRAPH_BARS);
+	for (int i = 0; i < bars; i++)
+	{
+		// the newest frame is drawn at the right edge
+		long long frame = m_frameCount - bars + i;
+		float frameTime = m_frameTimes[frame % FRAME_HISTORY];
+		int barHeight = std::max((int)(std::min(frameTime / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT), 1);
+
+		if (frameTime <= TARGET_FRAME_MS)
+		{
+			glClearColor(0.2f, 0.8f, 0.2f, 1.0f);
+		}
+		else if (frameTime <= TARGET_FRAME_MS * 2.0f)
+		{
+			glClearColor(0.9f, 0.8f, 0.1f, 1.0f);
+		}
+		else
+		{
+			glClearColor(0.9f, 0.2f, 0.1f, 1.0f);
+		}
+
+		glScissor(GRAPH_MARGIN + i * GRAPH_BAR_WIDTH, GRAPH_MARGIN, GRAPH_BAR_WIDTH, barHeight);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	// marker line at the 60 Hz budget
+	glScissor(GRAPH_MARGIN, GRAPH_MARGIN + (int)(TARGET_FRAME_MS / GRAPH_MAX_MS * GRAPH_HEIGHT),
+		GRAPH_BARS * GRAPH_BAR_WIDTH, 1);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// video memory bar, scaled to the budget or to the usage when
+	// that is larger or there is no budget
+	const int memoryBarWidth = GRAPH_BARS * GRAPH_BAR_WIDTH;
+	const int memoryBarY = GRAPH_MARGIN * 2 + GRAPH_HEIGHT;
+	const size_t totalBytes = GpuMemory::GetTotalUsage();
+	const size_t scaleBytes = std::max(std::max(totalBytes, GpuMemory::GetBudget()), (size_t)1);
+	glScissor(GRAPH_MARGIN, memoryBarY, memoryBarWidth, MEMORY_BAR_HEIGHT);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	int segmentX = GRAPH_MARGIN;
+	for (int i = 0; i < GpuMemory::MEMORY_CATEGORY_COUNT; i++)
+	{
+		int segmentWidth = (int)((double)GpuMemory::GetUsage((GpuMemory::Category)i) / scaleBytes * memoryBarWidth);
+		if (segmentWidth > 0)
+		{
+			glClearColor(g_MemoryColors[i][0], g_MemoryColors[i][1], g_MemoryColors[i][2], 1.0f);
+			glScissor(segmentX, memoryBarY, segmentWidth, MEMORY_BAR_HEIGHT);
+			glClear(GL_COLOR_BUFFER_BIT);
+			segmentX += segmentWidth;
+		}
+	}
+
+	// marker at the budget, at the right end unless it was exceeded
+	if (GpuMemory::GetBudget() > 0)
+	{
+		glScissor(GRAPH_MARGIN + (int)((double)GpuMemory::GetBudget() / scaleBytes * memoryBarWidth) - 1,
+			memoryBarY, 1, MEMORY_BAR_HEIGHT);
+		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
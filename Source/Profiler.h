@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// profiler.h
+// ============
+// measure the CPU and GPU time of each frame and report it on screen and
+// optionally into a CSV file
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  Profiler
+ *
+ *  This class times named CPU scopes with a steady clock and
+ *  the render passes with GL_TIME_ELAPSED queries.  The GPU
+ *  queries of each pass are kept in a small ring, so a result
+ *  is only read once it is available and reading it never
+ *  stalls the pipeline.  The rolling frame times give the
+ *  p50/p99 percentiles, which are shown with the draw call
+ *  and uniform upload counts, the frames that stalled on a
+ *  fence and the video memory in use in the window title,
+ *  next to a frame time graph and a video memory bar in the
+ *  corner of the window.
+ ***********************************************************/
+class Profiler
+{
+public:
+	// CpuScope enum identifies a timed part of the frame on the CPU
+	enum CpuScope
+	{
+		CPU_PREPARE_VIEW = 0,
+		CPU_RENDER_SCENE,
+		CPU_SWAP_BUFFERS,
+		CPU_WAIT_FRAME,
+		CPU_SCOPE_COUNT
+	};
+
+	// GpuPass enum identifies a timed render pass on the GPU, in
+	// the order the passes are drawn
+	enum GpuPass
+	{
+		GPU_SHADOWS = 0,
+		GPU_OCCLUSION,        // occluders, Hi-Z pyramid and GPU culling
+		GPU_PREPASS,
+		GPU_SHADING,
+		GPU_TRANSPARENT,
+		GPU_UPSCALE,
+		GPU_PASS_COUNT
+	};
+
+	// FRAME_COUNTERS struct holds the work counters of a frame
+	struct FRAME_COUNTERS
+	{
+		int drawCalls;
+		int stateChanges;
+		int uniformUploads;
+		int fenceStalls;         // 1 when the frame waited for the GPU
+		                         // to free a frame in flight
+		float resolutionScale;   // share of the window size the scene
+		                         // was drawn at
+	};
+
+	// constructor - the title is shown in front of the statistics
+	Profiler(const char* windowTitle);
+	// destructor
+	~Profiler();
+
+	// create the GPU timer queries, needs a current GL context
+	void Initialize();
+	// write one line per frame into a CSV file
+	bool OpenCsv(const char* filename);
+
+	// mark the start and the end of a frame
+	void BeginFrame();
+	void EndFrame(GLFWwindow* window);
+
+	// time a part of the frame on the CPU
+	void BeginCpuScope(CpuScope scope);
+	void EndCpuScope(CpuScope scope);
+	// time a render pass on the GPU, passes cannot nest
+	void BeginGpuPass(GpuPass pass);
+	void EndGpuPass(GpuPass pass);
+
+	// record the work counters of the frame
+	void SetFrameCounters(const FRAME_COUNTERS& counters) { m_counters = counters; }
+
+	// draw the frame time graph into the window
+	void DrawOverlay(GLFWwindow* window);
+	// show or hide the frame time graph
+	void ToggleOverlay() { m_bShowOverlay = !m_bShowOverlay; }
+
+	// get a percentile of the rolling frame times in milliseconds
+	float GetFramePercentile(float percentile) const;
+	// get the time of the last measured frame in milliseconds
+	float GetLastFrameTime() const { return((m_frameCount > 0) ? m_frameTimes[(m_frameCount - 1) % FRAME_HISTORY] : 0.0f); }
+	// get the latest CPU time of a scope in milliseconds
+	float GetCpuTime(CpuScope scope) const { return(m_cpuTimes[scope]); }
+	// get the latest available GPU time of a pass in milliseconds,
+	// negative when the GPU has no timer queries
+	float GetGpuTime(GpuPass pass) const { return(m_gpuTimes[pass]); }
+	// get the GPU time of the passes drawn at the scene resolution,
+	// everything but the upscale, negative without timer queries
+	float GetGpuSceneTime() const;
+	// get the number of frames measured so far
+	long long GetFrameCount() const { return(m_frameCount); }
+	// get the number of frames that stalled on a fence so far
+	long long GetFenceStallCount() const { return(m_fenceStallCount); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// number of queries in flight for each GPU pass
+	static const int GPU_QUERY_LATENCY = 4;
+	// number of frames kept for the percentiles and the graph
+	static const int FRAME_HISTORY = 240;
+
+	// text shown in front of the statistics in the window title
+	std::string m_windowTitle;
+	// start of the current frame
+	Clock::time_point m_frameStart;
+	// start of each CPU scope in the current frame
+	Clock::time_point m_cpuStarts[CPU_SCOPE_COUNT];
+	// latest CPU time of each scope in milliseconds
+	float m_cpuTimes[CPU_SCOPE_COUNT];
+
+	// true when the GPU supports timer queries
+	bool m_bGpuTimers;
+	// ring of timer queries of each pass
+	GLuint m_gpuQueries[GPU_PASS_COUNT][GPU_QUERY_LATENCY];
+	// true while a query of the ring waits for its result
+	bool m_bQueryPending[GPU_PASS_COUNT][GPU_QUERY_LATENCY];
+	// true for the passes begun in the current frame
+	bool m_bPassBegun[GPU_PASS_COUNT];
+	// latest available GPU time of each pass in milliseconds
+	float m_gpuTimes[GPU_PASS_COUNT];
+
+	// rolling window of frame times in milliseconds
+	std::vector<float> m_frameTimes;
+	// number of frames measured so far
+	long long m_frameCount;
+	// work counters of the current frame
+	FRAME_COUNTERS m_counters;
+	// frames that stalled on a fence so far
+	long long m_fenceStallCount;
+
+	// time the window title was last refreshed
+	Clock::time_point m_lastTitleUpdate;
+	// true when the frame time graph is drawn
+	bool m_bShowOverlay;
+	// CSV file receiving one line per frame, NULL if disabled
+	FILE* m_pCsvFile;
+
+	// read back the timer queries whose results are available
+	void CollectGpuResults();
+	// refresh the statistics in the window title
+	void UpdateWindowTitle(GLFWwindow* window);
+};
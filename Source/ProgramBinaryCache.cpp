@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbinarycache.cpp
+// ============
+// keep linked shader programs on disk so later runs skip compiling them
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramBinaryCache.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// CACHE_HEADER struct starts every cache file
+	struct CACHE_HEADER
+	{
+		char magic[4];           // "SPBC"
+		uint32_t version;
+		uint64_t key;            // key the binary was saved under
+		uint32_t format;         // driver binary format
+		uint32_t size;           // size of the binary after the header
+	};
+
+	const char CACHE_MAGIC[4] = { 'S', 'P', 'B', 'C' };
+	const uint32_t CACHE_VERSION = 1;
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  This function is used for adding bytes into a 64-bit
+	 *  FNV-1a hash.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const char* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (uint8_t)data[i];
+			hash *= 1099511628211ull;
+		}
+
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  GetString()
+	 *
+	 *  This function is used for reading a GL string, which is
+	 *  empty when the driver does not return it.
+	 ***********************************************************/
+	std::string GetString(GLenum name)
+	{
+		const GLubyte* pText = glGetString(name);
+		return((pText != NULL) ? std::string((const char*)pText) : std::string());
+	}
+}
+
+/***********************************************************
+ *  ProgramBinaryCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramBinaryCache::ProgramBinaryCache()
+{
+	m_bEnabled = false;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for checking that the driver can
+ *  return program binaries and creating the cache directory.
+ ***********************************************************/
+void ProgramBinaryCache::Initialize(const char* directory)
+{
+	GLint formatCount = 0;
+	if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	}
+	m_bEnabled = (formatCount > 0);
+	if (!m_bEnabled)
+	{
+		return;
+	}
+
+	m_directory = directory;
+	m_driver = GetString(GL_VENDOR) + "\n" + GetString(GL_RENDERER) + "\n" + GetString(GL_VERSION);
+
+	// an existing directory fails to be created again, which is fine
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for building the cache key of a
+ *  program.  Any change to the sources or to the driver gives
+ *  a different key, so a stale binary is never looked up.
+ ***********************************************************/
+uint64_t ProgramBinaryCache::MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	const char separator = '\0';
+	uint64_t hash = 14695981039346656037ull;
+
+	hash = HashBytes(hash, m_driver.data(), m_driver.size());
+	hash = HashBytes(hash, &separator, 1);
+	hash = HashBytes(hash, vertexSource.data(), vertexSource.size());
+	hash = HashBytes(hash, &separator, 1);
+	hash = HashBytes(hash, fragmentSource.data(), fragmentSource.size());
+
+	return(hash);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for creating a program from a cached
+ *  binary.  The header has to match the key, and the driver
+ *  has to link the binary, otherwise 0 is returned and the
+ *  program has to be compiled from source.
+ ***********************************************************/
+GLuint ProgramBinaryCache::Load(uint64_t key) const
+{
+	if (!m_bEnabled)
+	{
+		return(0);
+	}
+
+	FILE* file = fopen(GetPath(key).c_str(), "rb");
+	if (file == NULL)
+	{
+		return(0);
+	}
+
+	CACHE_HEADER header;
+	std::vector<unsigned char> binary;
+	bool bValid = (fread(&header, sizeof(header), 1, file) == 1) &&
+		(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0) &&
+		(header.version == CACHE_VERSION) &&
+		(header.key == key) &&
+		(header.size > 0);
+	if (bValid)
+	{
+		binary.resize(header.size);
+		bValid = (fread(binary.data(), 1, binary.size(), file) == binary.size());
+	}
+	fclose(file);
+
+	if (!bValid)
+	{
+		return(0);
+	}
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, (GLenum)header.format, binary.data(), (GLsizei)binary.size());
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &bLinked);
+	if (bLinked != GL_TRUE)
+	{
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program into its cache file.  The program should have been
+ *  linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+ ***********************************************************/
+bool ProgramBinaryCache::Save(uint64_t key, GLuint programID) const
+{
+	if (!m_bEnabled)
+	{
+		return false;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> binary((size_t)length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(programID, length, &written, &format, binary.data());
+	if (written <= 0)
+	{
+		return false;
+	}
+
+	CACHE_HEADER header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.key = key;
+	header.format = (uint32_t)format;
+	header.size = (uint32_t)written;
+
+	FILE* file = fopen(GetPath(key).c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+		(fwrite(binary.data(), 1, (size_t)written, file) == (size_t)written);
+	fclose(file);
+
+	// a partly written file would only be rejected by the next load
+	if (!bSuccess)
+	{
+		remove(GetPath(key).c_str());
+	}
+
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  GetPath()
+ *
+ *  This method is used for building the file name of a key
+ *  inside the cache directory.
+ ***********************************************************/
+std::string ProgramBinaryCache::GetPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+
+	return(m_directory + "/" + name);
+}
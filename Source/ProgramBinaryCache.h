@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbinarycache.h
+// ============
+// keep linked shader programs on disk so later runs skip compiling them
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramBinaryCache
+ *
+ *  This class stores the driver binaries of linked programs
+ *  in a cache directory, one file per program, named by a key
+ *  that hashes the shader sources together with the vendor,
+ *  renderer and version strings of the driver.  A binary the
+ *  driver rejects - after a driver update, for example - is
+ *  treated as missing, so the caller compiles the program
+ *  from source and saves it again.
+ ***********************************************************/
+class ProgramBinaryCache
+{
+public:
+	// constructor
+	ProgramBinaryCache();
+
+	// use the passed in directory for the cache files, needs a
+	// current GL context - the cache stays off when the driver
+	// cannot return program binaries
+	void Initialize(const char* directory);
+	// true when programs are loaded from and saved to the cache
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// build the cache key of a program from its sources
+	uint64_t MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+	// create a linked program from the cached binary of a key,
+	// returns 0 when there is none or the driver rejects it
+	GLuint Load(uint64_t key) const;
+	// save the binary of a linked program under a key
+	bool Save(uint64_t key, GLuint programID) const;
+
+private:
+	// directory holding the cache files
+	std::string m_directory;
+	// vendor, renderer and version of the driver
+	std::string m_driver;
+	// true when the driver supports program binaries
+	bool m_bEnabled;
+
+	// get the cache file of a key
+	std::string GetPath(uint64_t key) const;
+};
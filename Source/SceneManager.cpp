@@ -23,24 +23,249 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#endif
+#include "TagHash.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <iostream>
 
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// bits of the draw order key that hold the material and the texture
+	const uint64_t MATERIAL_KEY_MASK = 0xFFFFull << 32;
+	const uint64_t TEXTURE_KEY_MASK = 0xFFFFull << 16;
+	// top bit of the draw order key, set for the transparent objects
+	// so they sort after every opaque one
+	const uint64_t TRANSPARENT_KEY_BIT = 1ull << 63;
+	// draw lists of at least this many objects are culled through
+	// the bounding volume hierarchy instead of testing every object
+	const int HIERARCHY_CULLING_OBJECTS = 4096;
+	// draw list objects culled and filled in by one job, which
+	// keeps the jobs long enough to be worth handing out
+	const int FRAME_TASK_OBJECTS = 2048;
+	// farthest distance a picking ray is traced
+	const float MAX_PICK_DISTANCE = 1000.0f;
+	// decoded textures uploaded per frame, which bounds the
+	// upload time so that streaming textures in never hitches
+	const int MAX_TEXTURE_UPLOADS_PER_FRAME = 2;
+	// frames between the texture size requests of the objects in
+	// view, and the texture levels streamed in per frame
+	const int STREAMING_INTERVAL_FRAMES = 8;
+	const int MAX_STREAMED_LEVELS_PER_FRAME = 1;
+	// per-frame blocks that fit into a region of the frame ring, the
+	// scene is rendered once a frame but a few more passes fit
+	const int FRAME_RING_BLOCKS = 4;
+	// instances a region of the instance ring starts out with, it
+	// grows to the largest frame
+	const int INITIAL_RING_INSTANCES = 16384;
+
+	// asset pack with the whole scene, used instead of the scene
+	// description below when it exists
+	const char* const SCENE_PACK_FILE = "scene.pak";
+	// names of the scene entries in the asset pack
+	const char* const PACK_OBJECTS = "objects";
+	const char* const PACK_MATERIALS = "materials";
+	const char* const PACK_LIGHTS = "lights";
+	// shader files the scene shader variants are built from
+	const char* const SCENE_VERTEX_SHADER = "shaders/vertexShader.glsl";
+	const char* const SCENE_FRAGMENT_SHADER = "shaders/fragmentShader.glsl";
+	// compute shader culling the dynamic objects on the GPU
+	const char* const CULL_COMPUTE_SHADER = "shaders/cullShader.glsl";
+	// shaders drawing the occluders and reducing them into the Hi-Z pyramid
+	const char* const OCCLUDER_VERTEX_SHADER = "shaders/occluderShader.glsl";
+	const char* const HIZ_COMPUTE_SHADER = "shaders/hizShader.glsl";
+	// shader drawing the shadow casters into the shadow maps
+	const char* const SHADOW_VERTEX_SHADER = "shaders/shadowShader.glsl";
+	// directory of the cached shader program binaries
+	const char* const SHADER_CACHE_DIRECTORY = "shadercache";
+	// first texture unit of the light cluster buffer textures, the
+	// texture arrays use the units below it
+	const int LIGHT_CLUSTER_TEXTURE_UNIT = TextureManager::TOTAL_TEXTURE_ARRAYS;
+	// texture unit of the Hi-Z pyramid, after the three cluster units
+	const int OCCLUSION_TEXTURE_UNIT = LIGHT_CLUSTER_TEXTURE_UNIT + 3;
+	// texture unit of the shadow map atlas, after the Hi-Z pyramid
+	const int SHADOW_TEXTURE_UNIT = LIGHT_CLUSTER_TEXTURE_UNIT + 4;
+	// shadow distance of the global lights, which have no range to
+	// end their shadow maps at
+	const float GLOBAL_SHADOW_DISTANCE = 60.0f;
+	// radius of influence of the generated point lights
+	const float SYNTHETIC_LIGHT_RANGE = 3.0f;
+	// time between two checks of the hot reloaded files
+	const int HOT_RELOAD_POLL_MS = 250;
+
+	typedef SceneManager::MeshType MeshType;
+
+	// TEXTURE_FILE struct names a scene texture image and its tag
+	struct TEXTURE_FILE
+	{
+		const char* filename;
+		const char* tag;
+	};
+
+	// Scene textures, each is mapped onto objects by its tag
+	const TEXTURE_FILE SCENE_TEXTURES[] = {
+		{ "textures/Lid.png",             "Lid" },
+		{ "textures/Stone.png",           "Stone" },
+		{ "textures/Pasta.png",           "pasta" },
+		{ "textures/glass.png",           "glass" },
+		{ "textures/jar.png",             "jar" },
+		{ "textures/beanContainer.png",   "beancontainer" },
+		{ "textures/beanContainer1.png",  "beancontainer1" },
+		{ "textures/painting.png",        "painting" },
+		{ "textures/table.png",           "table" },
+		{ "textures/wall.png",            "wall" },
+		{ "textures/plastic.png",         "plastic" },
+	};
+
+	// Scene objects as a tidy list of commands
+	const SceneManager::DrawCmd SCENE_OBJECTS[] = {
+		// Ground plane
+		{ MeshType::Plane,   {20.0f, 1.0f, 10.0f}, {90.0f, 0.0f,   0.0f}, { 0.0f, 9.0f,  -10.0f}, "stone",   "wall" },
+
+		// Table plane
+		{ MeshType::Plane,   {20.0f, 1.0f, 10.0f}, { 0.0f, 0.0f,   0.0f}, { 0.0f, 0.0f,    0.0f}, "wood",    "table" },
+
+		// Stone sphere
+		{ MeshType::Sphere,  { 0.3f, 0.3f, 0.3f},  { 0.0f, 0.0f,   0.0f}, {-6.0f, 0.3f,   -3.0f}, "stone",   "Stone" },
+
+		// Cylinders (bean container)
+		{ MeshType::Cylinder,{ 1.0f, 2.5f, 1.0f},  { 0.0f, 0.0f,   0.0f}, {-3.0f, 0.3f,    0.0f}, "glass", "glass" },
+		{ MeshType::Cylinder,{ 3.0f, 1.0f, 3.0f},  { 0.0f, 0.0f,   0.0f}, { 1.0f, 0.2f,    0.98f},"plastic", "beancontainer1" },
+		{ MeshType::Cylinder,{ 3.0f, 3.0f, 3.0f},  { 0.0f, 2.0f,   0.0f}, { 1.0f, 1.2f,    0.98f},"plastic", "beancontainer" },
+		{ MeshType::Cylinder,{ 2.8f, 0.5f, 2.8f},  { 0.0f, 0.0f,   0.0f}, { 1.0f, 4.2f,    0.98f},"plastic", "plastic" },
+
+		// Glass jar + lid
+		{ MeshType::Cylinder,{ 1.5f, 3.5f, 1.5f},  { 0.0f, 0.0f,   0.0f}, { 6.0f, 0.1f,    0.0f}, "glass",   "jar" },
+		{ MeshType::Cylinder,{ 1.0f, 0.3f, 1.0f},  { 0.0f, 0.0f,   0.0f}, { 6.0f, 3.5f,    0.0f}, "plastic", "Lid" },
+
+		// Painting (thin box)
+		{ MeshType::Box,     { 3.5f, 0.01f, 5.5f}, {90.0f,180.0f,  0.0f}, { 6.0f, 8.5f,  -10.0f}, "plastic", "painting" },
+
+		// Pasta boxes
+		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 80.0f,  0.0f}, { 3.0f, 0.3f,   5.5f}, "plastic", "pasta" },
+		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 65.0f,  0.0f}, { 3.0f, 0.6f,   5.5f}, "plastic", "pasta" },
+		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 65.0f,  0.0f}, { 3.0f, 1.0f,   5.5f}, "plastic", "pasta" },
+	};
+
+	// longest tag stored in an asset pack record, including the
+	// terminator
+	const int PACK_TAG_LENGTH = 32;
+
+	// PACK_OBJECT struct is the asset pack record of a scene object,
+	// an empty tag means none
+	struct PACK_OBJECT
+	{
+		uint32_t type;
+		float scale[3];
+		float rotationDeg[3];
+		float translation[3];
+		char material[PACK_TAG_LENGTH];
+		char texture[PACK_TAG_LENGTH];
+	};
+
+	// PACK_MATERIAL struct is the asset pack record of a material
+	struct PACK_MATERIAL
+	{
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+		uint32_t bTransparent;
+		char tag[PACK_TAG_LENGTH];
+	};
+
+	// PACK_LIGHT struct is the asset pack record of a light source
+	struct PACK_LIGHT
+	{
+		float position[3];
+		float direction[3];
+		float ambient[3];
+		float diffuse[3];
+		float specular[3];
+		float focalStrength;
+		float specularIntensity;
+		float range;
+		uint32_t bUseDirection;
+		uint32_t bActive;
+	};
+
+	/***********************************************************
+	 *  CopyTag()
+	 *
+	 *  This function is used for storing a tag in a fixed size
+	 *  asset pack record field.
+	 ***********************************************************/
+	bool CopyTag(char* dest, const char* tag)
+	{
+		memset(dest, 0, PACK_TAG_LENGTH);
+		if (tag == NULL)
+		{
+			return true;
+		}
+		if (strlen(tag) >= PACK_TAG_LENGTH)
+		{
+			std::cout << "Tag is too long for the asset pack:" << tag << std::endl;
+			return false;
+		}
+		memcpy(dest, tag, strlen(tag));
+		return true;
+	}
+
+	/***********************************************************
+	 *  ReadFileBytes()
+	 *
+	 *  This function is used for reading a whole file into
+	 *  memory, returns false if it cannot be read.
+	 ***********************************************************/
+	bool ReadFileBytes(const char* filename, std::vector<unsigned char>& data)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (file == NULL)
+		{
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		bool bSuccess = (size >= 0);
+		if (bSuccess)
+		{
+			data.resize((size_t)size);
+			bSuccess = (fread(data.data(), 1, data.size(), file) == data.size());
+		}
+		fclose(file);
+
+		return(bSuccess);
+	}
+
+	/***********************************************************
+	 *  AppendRecords()
+	 *
+	 *  This function is used for storing an array of asset pack
+	 *  records as a payload.
+	 ***********************************************************/
+	template <typename T>
+	void AppendRecords(
+		std::vector<AssetPack::PACK_SOURCE>& sources,
+		AssetPack::EntryType type, const char* name, const std::vector<T>& records)
+	{
+		AssetPack::PACK_SOURCE source;
+		source.type = type;
+		source.name = name;
+		source.data.resize(records.size() * sizeof(T));
+		if (records.size() > 0)
+		{
+			memcpy(source.data.data(), records.data(), source.data.size());
+		}
+		sources.push_back(std::move(source));
+	}
 }
 
 /***********************************************************
@@ -51,7 +276,36 @@ namespace
 SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_basicMeshes = new MeshManager();
+	m_pTextureManager = new TextureManager();
+	m_bDrawOrderDirty = false;
+	m_bBoundsDirty = false;
+	m_bTransformsDirty = false;
+	m_bCullingEnabled = false;
+	m_bStaticBatchesDirty = false;
+	m_bGpuObjectsDirty = false;
+	m_pUniforms = NULL;
+	m_pProfiler = NULL;
+	m_ringFirstInstance = -1;
+	m_lodScale = 0.0f;
+	m_bDepthPrepass = false;
+	m_streamingFrames = STREAMING_INTERVAL_FRAMES;
+	m_bUseLighting = false;
+	m_frameData.view = glm::mat4(1.0f);
+	m_frameData.projection = glm::mat4(1.0f);
+	m_frameData.viewPosition = glm::vec3(0.0f);
+	m_frameData.padding0 = 0.0f;
+	m_frameData.clusterTileScale = glm::vec2(0.0f);
+	m_frameData.clusterDepthScale = 0.0f;
+	m_frameData.clusterDepthBias = 0.0f;
+	m_frameData.globalLightCount = 0;
+	m_frameData.padding1[0] = m_frameData.padding1[1] = m_frameData.padding1[2] = 0;
+	m_frameStats.drawCalls = 0;
+	m_frameStats.stateChanges = 0;
+	m_frameStats.skippedStateChanges = 0;
+	m_frameStats.culledObjects = 0;
+	m_frameStats.shadowUpdates = 0;
+	InvalidateRenderState();
 }
 
 /***********************************************************
@@ -64,162 +318,112 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_pTextureManager;
+	m_pTextureManager = NULL;
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
-	}
-
-	std::cout << "Could not load image:" << filename << std::endl;
-
-	// Error loading the image
-	return false;
+ *  This method is used for loading textures from image files.
+ *  The texture manager assigns the image to the next free
+ *  layer of one of the texture arrays and decodes it in the
+ *  background.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const char* tag)
+{
+	return(m_pTextureManager->LoadTexture(filename, tag));
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for allocating the texture arrays and
+ *  binding them to their texture units.  The decoded images
+ *  are uploaded while rendering, and objects sample the
+ *  placeholder until then.  Objects select a texture by its
+ *  layer index, so the bindings never change while rendering.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
+	m_pTextureManager->BuildTextureArrays();
+	m_pTextureManager->BindTextureArrays();
 }
 
 /***********************************************************
  *  DestroyGLTextures()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for freeing the memory of all the
+ *  loaded textures.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
+	m_pTextureManager->DestroyTextures();
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  RefreshTextureLayers()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for updating the texture layers of the
+ *  scene objects after textures finished loading.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::RefreshTextureLayers()
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (SCENE_OBJECT& object : m_sceneObjects)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		int textureLayer = m_pTextureManager->GetShaderIndex(object.textureIndex);
+		// the baked vertices and the objects on the GPU carry the
+		// layer of the objects
+		if (object.textureLayer != textureLayer)
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			m_bStaticBatchesDirty = m_bStaticBatchesDirty || object.bStatic;
+			m_bGpuObjectsDirty = true;
 		}
-		else
-			index++;
+		object.textureLayer = textureLayer;
 	}
-
-	return(textureID);
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  UpdateTextureStreaming()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for asking the texture manager for the
+ *  texture levels the objects in view need, from the pixels
+ *  their bounds cover on screen, every few frames.  A texture
+ *  is mapped once across its object, so it needs as many
+ *  texels as that size.  The levels are streamed in a few per
+ *  frame, and until a camera is set nothing is asked for.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+void SceneManager::UpdateTextureStreaming()
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (m_bCullingEnabled && (++m_streamingFrames >= STREAMING_INTERVAL_FRAMES))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		m_streamingFrames = 0;
+		m_pTextureManager->BeginStreamingRequests();
+		for (const SCENE_OBJECT& object : m_sceneObjects)
 		{
-			textureSlot = index;
-			bFound = true;
+			if ((object.textureIndex < 0) || !m_culler.IsBoxVisible(object.boundsCenter, object.boundsExtents))
+			{
+				continue;
+			}
+
+			float distance = std::max(glm::length(object.boundsCenter - m_frameData.viewPosition), 0.001f);
+			float projectedSize = 2.0f * glm::length(object.boundsExtents) * m_lodScale / distance;
+			m_pTextureManager->RequestTextureSize(object.textureIndex, projectedSize);
 		}
-		else
-			index++;
 	}
 
-	return(textureSlot);
+	m_pTextureManager->UpdateStreaming(MAX_STREAMED_LEVELS_PER_FRAME);
+}
+
+/***********************************************************
+ *  FindTextureIndex()
+ *
+ *  This method is used for getting the index of the previously
+ *  loaded texture associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureIndex(const char* tag)
+{
+	return(m_pTextureManager->FindTexture(tag));
 }
 
 /***********************************************************
@@ -228,31 +432,89 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	material.diffuseColor = m_objectMaterials[index].diffuseColor;
+	material.specularColor = m_objectMaterials[index].specularColor;
+	material.shininess = m_objectMaterials[index].shininess;
+	material.bTransparent = m_objectMaterials[index].bTransparent;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material in
+ *  the previously defined materials list that is associated
+ *  with the passed in tag.  Tags that share a hash are told
+ *  apart by comparing the stored tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag)
+{
+	typedef std::unordered_multimap<uint32_t, int>::const_iterator IndexIterator;
+	std::pair<IndexIterator, IndexIterator> range = m_materialIndex.equal_range(HashTag(tag));
+
+	for (IndexIterator it = range.first; it != range.second; ++it)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		if (m_objectMaterials[it->second].tag.compare(tag) == 0)
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			return(it->second);
 		}
-		else
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  BuildMaterialIndex()
+ *
+ *  This method is used for rebuilding the tag index over the
+ *  defined materials list.  If a tag is defined more than once
+ *  the first definition is used.
+ ***********************************************************/
+void SceneManager::BuildMaterialIndex()
+{
+	m_materialIndex.clear();
+	m_materialIndex.reserve(m_objectMaterials.size());
+
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
+	{
+		const char* tag = m_objectMaterials[index].tag.c_str();
+		// a tag that shares its hash with another tag gets an entry
+		// of its own, a repeated tag keeps its first definition
+		if (FindMaterialIndex(tag) < 0)
 		{
-			index++;
+			m_materialIndex.emplace(HashTag(tag), index);
 		}
 	}
+}
 
-	return(true);
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for building the model matrix from
+ *  the passed in transformation values.  The matrix is
+ *  written out directly instead of multiplying a scale,
+ *  three rotations and a translation.
+ ***********************************************************/
+glm::mat4 SceneManager::ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	return(TransformBatch::Compose(
+		scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ));
 }
 
 /***********************************************************
@@ -268,28 +530,26 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	SetTransformations(ComposeModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ));
+}
 
-	if (NULL != m_pShaderManager)
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using a previously composed model matrix.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	const glm::mat4& modelView)
+{
+	if (NULL != m_pUniforms)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pUniforms->SetMat4(UniformCache::MODEL, modelView);
 	}
 }
 
@@ -313,10 +573,10 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
+	// a plain color is drawn by the untextured shader variant
+	if (UseShaderVariant(m_bUseLighting ? ShaderVariants::FEATURE_LIT : 0))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pUniforms->SetVec4(UniformCache::OBJECT_COLOR, currentColor);
 	}
 }
 
@@ -327,15 +587,40 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
+{
+	SetShaderTextureIndex(FindTextureIndex(textureTag));
+}
+
+/***********************************************************
+ *  SetShaderTextureIndex()
+ *
+ *  This method is used for setting a previously resolved
+ *  texture into the shader.  The untextured shader variant is
+ *  used when the texture index is not valid.  Values that are
+ *  unchanged since the previous draw are not sent again.
+ ***********************************************************/
+void SceneManager::SetShaderTextureIndex(
+	int textureIndex)
 {
-	if (NULL != m_pShaderManager)
+	unsigned int features = m_bUseLighting ? ShaderVariants::FEATURE_LIT : 0;
+	if (textureIndex >= 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		features |= ShaderVariants::FEATURE_TEXTURED;
+	}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+	if (UseShaderVariant(features) && (textureIndex >= 0))
+	{
+		if (m_renderState.textureIndex != textureIndex)
+		{
+			m_pUniforms->SetInt(UniformCache::OBJECT_TEXTURE_INDEX, m_pTextureManager->GetShaderIndex(textureIndex));
+			m_renderState.textureIndex = textureIndex;
+			m_frameStats.stateChanges++;
+		}
+		else
+		{
+			m_frameStats.skippedStateChanges++;
+		}
 	}
 }
 
@@ -347,9 +632,9 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
+	if (NULL != m_pUniforms)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pUniforms->SetVec2(UniformCache::UV_SCALE, glm::vec2(u, v));
 	}
 }
 
@@ -363,59 +648,18 @@ void SceneManager::SetTextureUVScale(float u, float v)
 void SceneManager::LoadSceneTextures()
 {
 	/*** STUDENTS - add the code BELOW for loading the textures that ***/
-	/*** will be used for mapping to objects in the 3D scene. Up to  ***/
-	/*** 16 textures can be loaded per scene. Refer to the code in   ***/
-	/*** the OpenGL Sample for help.                                 ***/
-
-	bool bReturn = false;
-	bReturn = CreateGLTexture(
-		"textures/Lid.png",
-		"Lid");
-
-	bReturn = CreateGLTexture(
-		"textures/Stone.png",
-		"Stone");
-
-	bReturn = CreateGLTexture(
-		"textures/Pasta.png",
-		"pasta");
-
-	bReturn = CreateGLTexture(
-		"textures/glass.png",
-		"glass");
-
-	bReturn = CreateGLTexture(
-		"textures/jar.png",
-		"jar");
-
-	bReturn = CreateGLTexture(
-		"textures/beanContainer.png",
-		"beancontainer");
-
+	/*** will be used for mapping to objects in the 3D scene to the  ***/
+	/*** SCENE_TEXTURES table. Each texture array holds up to 256    ***/
+	/*** textures. Refer to the code in the OpenGL Sample for help.  ***/
 
-	bReturn = CreateGLTexture(
-		"textures/beanContainer1.png",
-		"beancontainer1");
-
-	bReturn = CreateGLTexture(
-		"textures/painting.png",
-		"painting");
-
-	bReturn = CreateGLTexture(
-		"textures/table.png",
-		"table");
-
-	bReturn = CreateGLTexture(
-		"textures/wall.png",
-		"wall");
-
-	bReturn = CreateGLTexture(
-		"textures/plastic.png",
-		"plastic");
+	for (const TEXTURE_FILE& texture : SCENE_TEXTURES)
+	{
+		CreateGLTexture(texture.filename, texture.tag);
+	}
 
 	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
+	// loaded textures need to be uploaded into the texture arrays
+	// and the arrays bound to their texture units
 	BindGLTextures();
 }
 
@@ -426,140 +670,1712 @@ void SceneManager::LoadSceneTextures()
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for selecting a previously resolved
+ *  material of the material table in the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	if ((NULL != m_pUniforms) && (materialIndex >= 0) && (materialIndex < (int)m_objectMaterials.size()))
+	{
+		// skip the upload when the previous draw used the same material
+		if (m_renderState.materialIndex == materialIndex)
 		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			m_frameStats.skippedStateChanges++;
+			return;
 		}
+
+		// the material values are in the material table already
+		m_pUniforms->SetInt(UniformCache::OBJECT_MATERIAL_INDEX, materialIndex);
+		m_renderState.materialIndex = materialIndex;
+		m_frameStats.stateChanges++;
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
- /***********************************************************
-  *  DefineObjectMaterials()
-  *
-  *  This method is used for configuring the various material
-  *  settings for all of the objects within the 3D scene.
-  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for building the draw order key of a
+ *  scene object.  From the most to the least significant bits
+ *  the key holds the shader, mesh, material and texture, so
+ *  sorting by key groups the draws that share the most
+ *  expensive state.  Textures are selected per instance from
+ *  the texture arrays, so objects that only differ in texture
+ *  still share one instanced draw.  The top bit is set for the
+ *  transparent objects, which moves them behind the opaque
+ *  ones.  The low 16 bits are currently unused.
+ ***********************************************************/
+uint64_t SceneManager::MakeSortKey(
+	int shader,
+	MeshType type,
+	int textureIndex,
+	int materialIndex,
+	bool bTransparent)
 {
-	/*** STUDENTS - add the code BELOW for defining object materials. ***/
-	/*** There is no limit to the number of object materials that can ***/
-	/*** be defined. Refer to the code in the OpenGL Sample for help  ***/
+	uint64_t key = bTransparent ? TRANSPARENT_KEY_BIT : 0;
 
-	// Plastic Material
-	OBJECT_MATERIAL plasticMaterial;
-	plasticMaterial.diffuseColor = glm::vec3(0.8f, 0.4f, 0.8f);
-	plasticMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	plasticMaterial.shininess = 1.0;
-	plasticMaterial.tag = "plastic";
-	m_objectMaterials.push_back(plasticMaterial);
+	key |= ((uint64_t)(shader & 0x7F)) << 56;
+	key |= ((uint64_t)((int)type & 0xFF)) << 48;
+	key |= ((uint64_t)((materialIndex + 1) & 0xFFFF)) << 32;
+	key |= ((uint64_t)((textureIndex + 1) & 0xFFFF)) << 16;
 
-	// Wood Material
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.diffuseColor = glm::vec3(0.6f, 0.5f, 0.2f);
-	woodMaterial.specularColor = glm::vec3(0.1f, 0.2f, 0.2f);
-	woodMaterial.shininess = 1.0;
-	woodMaterial.tag = "wood";
+	return(key);
+}
 
-	// Metal Material
-	m_objectMaterials.push_back(woodMaterial);
-	OBJECT_MATERIAL metalMaterial;
-	metalMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	metalMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.8f);
-	metalMaterial.shininess = 8.0;
-	metalMaterial.tag = "metal";
-	m_objectMaterials.push_back(metalMaterial);
+/***********************************************************
+ *  SortDrawList()
+ *
+ *  This method is used for sorting the draw list by the draw
+ *  order keys, so that consecutive draws share as much state
+ *  as possible.  The handle table is updated to follow the
+ *  moved objects.
+ ***********************************************************/
+void SceneManager::SortDrawList()
+{
+	std::stable_sort(m_sceneObjects.begin(), m_sceneObjects.end(),
+		[](const SCENE_OBJECT& a, const SCENE_OBJECT& b) {
+			return(a.sortKey < b.sortKey);
+		});
 
-	// Glass Material
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	glassMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.8f);
-	glassMaterial.shininess = 10.0;
-	glassMaterial.tag = "glass";
-	m_objectMaterials.push_back(glassMaterial);
+	for (int index = 0; index < (int)m_sceneObjects.size(); index++)
+	{
+		m_handleToIndex[m_sceneObjects[index].handle] = index;
+	}
 
-	// Tile Material
-	OBJECT_MATERIAL tileMaterial;
-	tileMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	tileMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.7f);
-	tileMaterial.shininess = 6.0;
-	tileMaterial.tag = "tile";
-	m_objectMaterials.push_back(tileMaterial);
+	m_bDrawOrderDirty = false;
+	// the packed bounds follow the draw list order
+	m_bBoundsDirty = true;
+}
 
-	// Stone Material
-	OBJECT_MATERIAL stoneMaterial;
-	stoneMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	stoneMaterial.specularColor = glm::vec3(0.73f, 0.3f, 0.3f);
-	stoneMaterial.shininess = 6.0;
-	stoneMaterial.tag = "stone";
-	m_objectMaterials.push_back(stoneMaterial);
+/***********************************************************
+ *  GetOpaqueCount()
+ *
+ *  This method is used for finding where the transparent
+ *  objects start in the sorted draw list.  Removing the last
+ *  object keeps the list sorted, so the search holds between
+ *  two sorts as well.
+ ***********************************************************/
+int SceneManager::GetOpaqueCount() const
+{
+	std::vector<SCENE_OBJECT>::const_iterator it = std::partition_point(m_sceneObjects.begin(), m_sceneObjects.end(),
+		[](const SCENE_OBJECT& object) {
+			return((object.sortKey & TRANSPARENT_KEY_BIT) == 0);
+		});
 
+	return((int)(it - m_sceneObjects.begin()));
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  UpdateCullingBounds()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  This method is used for copying the world bounds of the
+ *  draw list into the packed arrays of the frustum culler, so
+ *  that the bounds of an object share its draw list index.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::UpdateCullingBounds()
 {
-	// this line of code is NEEDED for telling the shaders to render 
-	// the 3D scene with custom lighting, if no light sources have
+	m_culler.SetBoundsCount((int)m_sceneObjects.size());
+	for (int index = 0; index < (int)m_sceneObjects.size(); index++)
+	{
+		m_culler.SetBounds(index, m_sceneObjects[index].boundsCenter, m_sceneObjects[index].boundsExtents);
+	}
+
+	m_bBoundsDirty = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame in the next
+ *  regions of the rings.  When the CPU is a whole ring ahead
+ *  of the GPU it waits here for the oldest frame in flight,
+ *  instead of overwriting data the GPU still reads.
+ ***********************************************************/
+bool SceneManager::BeginFrame()
+{
+	bool bStalled = m_frameRing.BeginFrame();
+	bStalled = m_instanceRing.BeginFrame() || bStalled;
+
+	return(bStalled);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the commands of the frame,
+ *  so its ring regions are reused once the GPU is past them.
+ ***********************************************************/
+void SceneManager::EndFrame()
+{
+	m_frameRing.EndFrame();
+	m_instanceRing.EndFrame();
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the camera matrices of the
+ *  next rendered frame.  Objects outside of their frustum are
+ *  skipped by RenderScene(), which also uploads the matrices
+ *  with the per-frame uniform block.
+ ***********************************************************/
+void SceneManager::SetViewProjection(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_culler.SetViewProjection(projection * view);
+	m_frameData.view = view;
+	m_frameData.projection = projection;
+	// the camera sits at the origin of the view space
+	m_frameData.viewPosition = glm::vec3(glm::inverse(view)[3]);
+	m_bCullingEnabled = true;
+
+	// the projected radius of an object is its world radius times
+	// this scale over its distance
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_lodScale = projection[1][1] * 0.5f * (float)viewport[3];
+}
+
+/***********************************************************
+ *  InvalidateRenderState()
+ *
+ *  This method is used for forgetting the tracked shader
+ *  state, so that the next draw sends all of its state.
+ ***********************************************************/
+void SceneManager::InvalidateRenderState()
+{
+	m_renderState.shader = -1;
+	m_renderState.mesh = -1;
+	m_renderState.textureIndex = -1;
+	m_renderState.materialIndex = -1;
+}
+
+/***********************************************************
+ *  UseShaderVariant()
+ *
+ *  This method is used for switching to the shader variant
+ *  with the passed in features, which is compiled the first
+ *  time it is used.  The lit variants are specialized on the
+ *  number of global lights.  The tracked texture and material
+ *  belong to the previous program, so they are forgotten when
+ *  the program changes.
+ ***********************************************************/
+bool SceneManager::UseShaderVariant(unsigned int features)
+{
+	bool bCreated = false;
+	int slot = m_shaderVariants.GetVariant(features, m_lightClusters.GetGlobalLightCount(), &bCreated);
+	if (slot < 0)
+	{
+		return false;
+	}
+
+	if (m_renderState.shader == slot)
+	{
+		m_frameStats.skippedStateChanges++;
+		return true;
+	}
+
+	glUseProgram(m_shaderVariants.GetProgram(slot));
+	m_pUniforms = &m_shaderVariants.GetUniforms(slot);
+	if (bCreated)
+	{
+		InitializeShaderVariant();
+	}
+
+	m_renderState.shader = slot;
+	m_renderState.textureIndex = -1;
+	m_renderState.materialIndex = -1;
+	m_frameStats.stateChanges++;
+
+	return true;
+}
+
+/***********************************************************
+ *  InitializeShaderVariant()
+ *
+ *  This method is used for setting the values that never
+ *  change into the shader variant just put in use - the
+ *  texture units of the samplers and the binding points of
+ *  the uniform blocks.
+ ***********************************************************/
+void SceneManager::InitializeShaderVariant()
+{
+	GLuint programID = m_pUniforms->GetProgram();
+	UniformBuffer::BindBlock(programID, "FrameBlock", UniformBuffer::FRAME_BINDING);
+	UniformBuffer::BindBlock(programID, "MaterialBlock", UniformBuffer::MATERIAL_BINDING);
+	UniformBuffer::BindBlock(programID, "ShadowBlock", UniformBuffer::SHADOW_BINDING);
+	UniformBuffer::BindBlock(programID, "TextureBlock", UniformBuffer::TEXTURE_BINDING);
+
+	// each texture array is bound to the texture unit matching
+	// its array slot
+	int textureUnits[TextureManager::TOTAL_TEXTURE_ARRAYS];
+	for (int i = 0; i < TextureManager::TOTAL_TEXTURE_ARRAYS; i++)
+	{
+		textureUnits[i] = i;
+	}
+	m_pUniforms->SetIntArray(UniformCache::TEXTURE_ARRAYS, textureUnits, TextureManager::TOTAL_TEXTURE_ARRAYS);
+
+	// the light cluster buffer textures follow the texture arrays
+	m_pUniforms->SetInt(UniformCache::LIGHT_DATA, LIGHT_CLUSTER_TEXTURE_UNIT);
+	m_pUniforms->SetInt(UniformCache::CLUSTER_GRID, LIGHT_CLUSTER_TEXTURE_UNIT + 1);
+	m_pUniforms->SetInt(UniformCache::CLUSTER_LIGHT_INDICES, LIGHT_CLUSTER_TEXTURE_UNIT + 2);
+	// the shadow sampler is set even without shadows, so it never
+	// shares a unit with a texture array
+	m_pUniforms->SetInt(UniformCache::SHADOW_ATLAS, SHADOW_TEXTURE_UNIT);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object to the retained
+ *  draw list.  The material index and texture slot are
+ *  resolved once here so that RenderScene() does no
+ *  per-frame lookups, and the model matrix is composed with
+ *  the other new and moved objects before the next query or
+ *  frame.  The returned handle can be passed to
+ *  RemoveObject().
+ ***********************************************************/
+int SceneManager::AddObject(const DrawCmd& cmd)
+{
+	SCENE_OBJECT object;
+
+	object.type = cmd.type;
+	object.model = glm::mat4(1.0f);
+	object.materialIndex = (cmd.material != NULL) ? FindMaterialIndex(cmd.material) : -1;
+	object.textureIndex = (cmd.texture != NULL) ? FindTextureIndex(cmd.texture) : -1;
+	object.textureLayer = m_pTextureManager->GetShaderIndex(object.textureIndex);
+	object.bTransparent = (object.materialIndex >= 0) && m_objectMaterials[object.materialIndex].bTransparent;
+	// textured objects use their own shader variant
+	object.sortKey = MakeSortKey((object.textureIndex >= 0) ? ShaderVariants::FEATURE_TEXTURED : 0,
+		object.type, object.textureIndex, object.materialIndex, object.bTransparent);
+	object.bStatic = false;
+	object.lod = 0;
+	object.boundsCenter = glm::vec3(0.0f);
+	object.boundsExtents = glm::vec3(0.0f);
+
+	// reuse a released handle when one is available
+	if (m_freeHandles.size() > 0)
+	{
+		object.handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		object.handle = (int)m_handleToIndex.size();
+		m_handleToIndex.push_back(-1);
+	}
+
+	m_handleToIndex[object.handle] = (int)m_sceneObjects.size();
+	m_sceneObjects.push_back(object);
+	m_transforms.SetTransform(object.handle, cmd.scale, cmd.rotationDeg, cmd.translation);
+	m_bTransformsDirty = true;
+	m_bDrawOrderDirty = true;
+	m_bBoundsDirty = true;
+	m_bGpuObjectsDirty = true;
+
+	return(object.handle);
+}
+
+/***********************************************************
+ *  RemoveObject()
+ *
+ *  This method is used for removing an object from the
+ *  retained draw list.  The last object is moved into the
+ *  freed entry so the list stays packed.
+ ***********************************************************/
+bool SceneManager::RemoveObject(int handle)
+{
+	if ((handle < 0) || (handle >= (int)m_handleToIndex.size()) ||
+		(m_handleToIndex[handle] < 0))
+	{
+		return(false);
+	}
+
+	int index = m_handleToIndex[handle];
+	int lastIndex = (int)m_sceneObjects.size() - 1;
+	if (m_sceneObjects[index].bStatic)
+	{
+		m_bStaticBatchesDirty = true;
+	}
+	else if (!m_sceneObjects[index].bTransparent)
+	{
+		// the shadow of the object goes with it
+		m_shadowMaps.InvalidateBounds(m_sceneObjects[index].boundsCenter, m_sceneObjects[index].boundsExtents);
+	}
+
+	if (index != lastIndex)
+	{
+		m_sceneObjects[index] = m_sceneObjects[lastIndex];
+		m_handleToIndex[m_sceneObjects[index].handle] = index;
+		m_bDrawOrderDirty = true;
+	}
+	m_sceneObjects.pop_back();
+	m_bBoundsDirty = true;
+	m_bGpuObjectsDirty = true;
+
+	m_handleToIndex[handle] = -1;
+	m_freeHandles.push_back(handle);
+	m_bvh.RemoveObject(handle);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving an object of the draw list.
+ *  Only the new transform values are stored here, so moving
+ *  many objects costs one batched update of their model
+ *  matrices and bounds before the next query or frame.
+ ***********************************************************/
+bool SceneManager::SetObjectTransform(int handle, const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& translation)
+{
+	if ((handle < 0) || (handle >= (int)m_handleToIndex.size()) ||
+		(m_handleToIndex[handle] < 0))
+	{
+		return(false);
+	}
+
+	SCENE_OBJECT& object = m_sceneObjects[m_handleToIndex[handle]];
+	// an object that moves is drawn with the instanced objects from
+	// now on, instead of baking its batch again every time
+	if (object.bStatic)
+	{
+		object.bStatic = false;
+		m_bStaticBatchesDirty = true;
+		m_bGpuObjectsDirty = true;
+	}
+	m_transforms.SetTransform(handle, scale, rotationDeg, translation);
+	m_bTransformsDirty = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for composing the model matrices of
+ *  the objects added or moved since the last update, all in
+ *  one batch.  The world bounds of those objects follow from
+ *  the new matrices, and the bounding volume hierarchy is
+ *  refitted on its next query.  The GPU culler gets the new
+ *  matrices and bounds of the objects it already holds in
+ *  place.
+ ***********************************************************/
+void SceneManager::UpdateTransforms()
+{
+	if (!m_bTransformsDirty)
+	{
+		return;
+	}
+
+	const std::vector<int>& updated = m_transforms.Update();
+	for (int handle : updated)
+	{
+		// the object may have been removed since it was moved
+		int index = m_handleToIndex[handle];
+		if (index < 0)
+		{
+			continue;
+		}
+
+		SCENE_OBJECT& object = m_sceneObjects[index];
+		object.model = m_transforms.GetMatrix(handle);
+
+		// a dynamic caster refreshes the shadows of the lights it
+		// leaves and the lights it moves to, a new object has no
+		// bounds to leave yet
+		const bool bShadowCaster = !object.bStatic && !object.bTransparent;
+		if (bShadowCaster && (object.boundsExtents != glm::vec3(0.0f)))
+		{
+			m_shadowMaps.InvalidateBounds(object.boundsCenter, object.boundsExtents);
+		}
+
+		const MeshManager::MESH_RANGE& mesh = m_basicMeshes->GetMeshRange(object.type);
+		FrustumCuller::TransformBounds(object.model, mesh.boundsMin, mesh.boundsMax,
+			object.boundsCenter, object.boundsExtents);
+		if (bShadowCaster)
+		{
+			m_shadowMaps.InvalidateBounds(object.boundsCenter, object.boundsExtents);
+		}
+		// the packed bounds share the draw list index unless they are
+		// about to be copied again anyway
+		if (!m_bBoundsDirty)
+		{
+			m_culler.SetBounds(index, object.boundsCenter, object.boundsExtents);
+		}
+		m_bvh.SetObjectBounds(handle, object.boundsCenter, object.boundsExtents);
+
+		// a new object is in none of the uploaded objects, and the
+		// whole list is uploaded again for it anyway
+		if (!m_bGpuObjectsDirty && (handle < (int)m_gpuObjectIndices.size()) && (m_gpuObjectIndices[handle] >= 0))
+		{
+			m_gpuCuller.UpdateObject(m_gpuObjectIndices[handle], object.model, object.boundsCenter, object.boundsExtents);
+		}
+	}
+
+	m_bTransformsDirty = false;
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the closest object whose
+ *  bounds are hit by a ray, such as the ray through the
+ *  center of the view.
+ ***********************************************************/
+int SceneManager::PickObject(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	UpdateTransforms();
+	return(m_bvh.Raycast(origin, glm::normalize(direction), MAX_PICK_DISTANCE, distance));
+}
+
+/***********************************************************
+ *  FindNearestObject()
+ *
+ *  This method is used for finding the object whose bounds
+ *  are closest to a point.
+ ***********************************************************/
+int SceneManager::FindNearestObject(const glm::vec3& point, float maxDistance, float& distance)
+{
+	UpdateTransforms();
+	return(m_bvh.FindNearest(point, maxDistance, distance));
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+ /***********************************************************
+  *  DefineObjectMaterials()
+  *
+  *  This method is used for configuring the various material
+  *  settings for all of the objects within the 3D scene.
+  ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	/*** STUDENTS - add the code BELOW for defining object materials. ***/
+	/*** There is no limit to the number of object materials that can ***/
+	/*** be defined. Refer to the code in the OpenGL Sample for help  ***/
+
+	// Plastic Material
+	OBJECT_MATERIAL plasticMaterial;
+	plasticMaterial.diffuseColor = glm::vec3(0.8f, 0.4f, 0.8f);
+	plasticMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	plasticMaterial.shininess = 1.0;
+	plasticMaterial.bTransparent = false;
+	plasticMaterial.tag = "plastic";
+	m_objectMaterials.push_back(plasticMaterial);
+
+	// Wood Material
+	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.diffuseColor = glm::vec3(0.6f, 0.5f, 0.2f);
+	woodMaterial.specularColor = glm::vec3(0.1f, 0.2f, 0.2f);
+	woodMaterial.shininess = 1.0;
+	woodMaterial.bTransparent = false;
+	woodMaterial.tag = "wood";
+
+	// Metal Material
+	m_objectMaterials.push_back(woodMaterial);
+	OBJECT_MATERIAL metalMaterial;
+	metalMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
+	metalMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.8f);
+	metalMaterial.shininess = 8.0;
+	metalMaterial.bTransparent = false;
+	metalMaterial.tag = "metal";
+	m_objectMaterials.push_back(metalMaterial);
+
+	// Glass Material
+	OBJECT_MATERIAL glassMaterial;
+	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
+	glassMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.8f);
+	glassMaterial.shininess = 10.0;
+	glassMaterial.bTransparent = true;
+	glassMaterial.tag = "glass";
+	m_objectMaterials.push_back(glassMaterial);
+
+	// Tile Material
+	OBJECT_MATERIAL tileMaterial;
+	tileMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
+	tileMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.7f);
+	tileMaterial.shininess = 6.0;
+	tileMaterial.bTransparent = false;
+	tileMaterial.tag = "tile";
+	m_objectMaterials.push_back(tileMaterial);
+
+	// Stone Material
+	OBJECT_MATERIAL stoneMaterial;
+	stoneMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
+	stoneMaterial.specularColor = glm::vec3(0.73f, 0.3f, 0.3f);
+	stoneMaterial.shininess = 6.0;
+	stoneMaterial.bTransparent = false;
+	stoneMaterial.tag = "stone";
+	m_objectMaterials.push_back(stoneMaterial);
+
+}
+
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  A light without a range lights
+ *  the whole scene, a light with a range only lights what is
+ *  inside of it and costs nothing elsewhere.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	// Warm light for direction
+	float warmLightX = 1.0f;
+	float warmLightY = 0.994f;
+	float warmLightZ = 0.75f;
+
+	// Cool light for ambient
+	float coolLightX = 0.6f;
+	float coolLightY = 0.77f;
+	float coolLightZ = 0.9f;
+
+	/*** STUDENTS - add the code BELOW for setting up light sources ***/
+	/*** Any number of ranged light sources can be defined. Refer to the code ***/
+	/*** in the OpenGL Sample for help                              ***/
+
+	// A warm directional light
+	LIGHT_SOURCE warmLight;
+	warmLight.position = glm::vec3(-20.5f, 10.0f, -10.0f);
+	warmLight.direction = glm::vec3(20.5f, -10.0f, 10.0f);
+	warmLight.bUseDirection = true;
+	warmLight.ambient = glm::vec3(warmLightX * 0.51f, warmLightY * 0.51f, warmLightZ * 0.51f);
+	warmLight.diffuse = glm::vec3(warmLightX * 0.56f, warmLightY * 0.56f, warmLightZ * 0.56f);
+	warmLight.specular = glm::vec3(warmLightX * 0.54f, warmLightY * 0.54f, warmLightZ * 0.54f);
+	warmLight.focalStrength = 102.0f;
+	warmLight.specularIntensity = 2.1f;
+	warmLight.range = 0.0f;
+	warmLight.bActive = true;
+	m_lights.push_back(warmLight);
+
+	// A cool ambient light
+	LIGHT_SOURCE coolLight;
+	coolLight.position = glm::vec3(4.0f, 4.0f, 4.0f);
+	coolLight.direction = glm::vec3(0.0f, 0.0f, 0.0f);
+	coolLight.bUseDirection = false;
+	coolLight.ambient = glm::vec3(coolLightX * 0.5f, coolLightY * 0.5f, coolLightZ * 0.5f);
+	coolLight.diffuse = glm::vec3(coolLightX * 0.2f, coolLightY * 0.2f, coolLightZ * 0.2f);
+	coolLight.specular = glm::vec3(coolLightX * 0.0f, coolLightY * 0.0f, coolLightZ * 0.0f);
+	coolLight.focalStrength = 12.0f;
+	coolLight.specularIntensity = 0.0f;
+	coolLight.range = 0.0f;
+	coolLight.bActive = true;
+	m_lights.push_back(coolLight);
+}
+
+/***********************************************************
+ *  ApplySceneLights()
+ *
+ *  This method is used for passing the defined light sources
+ *  into the shader.  The active lights are uploaded once into
+ *  the light clusters, which bin them again for every frame.
+ ***********************************************************/
+void SceneManager::ApplySceneLights()
+{
+	// this line of code is NEEDED for telling the shaders to render 
+	// the 3D scene with custom lighting, if no light sources have
 	// been added then the display window will be black - to use the 
 	// default OpenGL lighting then comment out the following line
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseLighting = true;
+
+	std::vector<LightClusters::CLUSTER_LIGHT> lights;
+	lights.reserve(m_lights.size());
+	// the first global lights cast shadows, the ranged lights are
+	// too many and too small to be worth a shadow map each
+	glm::vec3 shadowPositions[ShadowMaps::MAX_LIGHTS];
+	float shadowDistances[ShadowMaps::MAX_LIGHTS];
+	int shadowCount = 0;
+	for (const LIGHT_SOURCE& light : m_lights)
+	{
+		if (!light.bActive)
+		{
+			continue;
+		}
+
+		LightClusters::CLUSTER_LIGHT clusterLight;
+		clusterLight.position = light.position;
+		clusterLight.range = light.range;
+		clusterLight.ambient = light.ambient;
+		clusterLight.diffuse = light.diffuse;
+		clusterLight.specular = light.specular;
+		clusterLight.shadowMap = -1;
+		if ((light.range <= 0.0f) && m_shadowMaps.IsAvailable() && (shadowCount < ShadowMaps::MAX_LIGHTS))
+		{
+			clusterLight.shadowMap = shadowCount;
+			shadowPositions[shadowCount] = light.position;
+			shadowDistances[shadowCount] = GLOBAL_SHADOW_DISTANCE;
+			shadowCount++;
+		}
+		lights.push_back(clusterLight);
+	}
+
+	m_lightClusters.SetLights(lights);
+	m_shadowMaps.SetLights(shadowPositions, shadowDistances, shadowCount);
+	m_frameData.globalLightCount = m_lightClusters.GetGlobalLightCount();
+}
+
+/***********************************************************
+ *  ApplySceneMaterials()
+ *
+ *  This method is used for uploading the defined materials
+ *  into the material table, where the shaders look them up
+ *  by the material index of each object.
+ ***********************************************************/
+void SceneManager::ApplySceneMaterials()
+{
+	int materialCount = (int)m_objectMaterials.size();
+	if (materialCount > UniformBuffer::MAX_SHADER_MATERIALS)
+	{
+		std::cout << "Only " << UniformBuffer::MAX_SHADER_MATERIALS << " of " << materialCount
+			<< " materials fit in the material table" << std::endl;
+		materialCount = UniformBuffer::MAX_SHADER_MATERIALS;
+	}
+
+	// a scene without materials still uploads one black material
+	std::vector<UniformBuffer::SHADER_MATERIAL> table(std::max(materialCount, 1));
+	for (int i = 0; i < (int)table.size(); i++)
+	{
+		bool bDefined = (i < materialCount);
+		table[i].diffuseColor = bDefined ? m_objectMaterials[i].diffuseColor : glm::vec3(0.0f);
+		table[i].shininess = bDefined ? m_objectMaterials[i].shininess : 1.0f;
+		table[i].specularColor = bDefined ? m_objectMaterials[i].specularColor : glm::vec3(0.0f);
+		table[i].padding = 0.0f;
+	}
+
+	m_materialBuffer.Update(table.data(), table.size() * sizeof(UniformBuffer::SHADER_MATERIAL));
+}
+
+/***********************************************************
+ *  AddSyntheticObjects()
+ *
+ *  This method is used for adding a square grid of generated
+ *  boxes above the table, so that the render cost can be
+ *  measured against the object count.  The boxes cycle
+ *  through the defined materials and the loaded textures, and
+ *  the same count always generates the same scene.
+ ***********************************************************/
+void SceneManager::AddSyntheticObjects(int boxCount)
+{
+	if (boxCount <= 0)
+	{
+		return;
+	}
+
+	// spread the grid over the table top, the boxes get smaller
+	// as the grid gets denser
+	const float gridExtent = 18.0f;
+	int gridSize = (int)ceil(sqrt((double)boxCount));
+	float spacing = gridExtent / (float)gridSize;
+	float boxSize = spacing * 0.6f;
+
+	m_sceneObjects.reserve(m_sceneObjects.size() + boxCount);
+	for (int i = 0; i < boxCount; i++)
+	{
+		int column = i % gridSize;
+		int row = i / gridSize;
+
+		DrawCmd cmd;
+		cmd.type = MeshType::Box;
+		cmd.scale = glm::vec3(boxSize, boxSize, boxSize);
+		cmd.rotationDeg = glm::vec3(0.0f, (float)((i * 37) % 360), 0.0f);
+		cmd.translation = glm::vec3(
+			-gridExtent * 0.5f + spacing * (column + 0.5f),
+			boxSize * 0.5f + (float)(i % 3) * boxSize,
+			-gridExtent * 0.5f + spacing * (row + 0.5f));
+		cmd.material = (m_objectMaterials.size() > 0) ?
+			m_objectMaterials[i % m_objectMaterials.size()].tag.c_str() : NULL;
+		cmd.texture = (m_pTextureManager->GetTextureCount() > 0) ?
+			m_pTextureManager->GetTextureInfo(i % m_pTextureManager->GetTextureCount()).tag.c_str() : NULL;
+		AddObject(cmd);
+	}
+}
+
+/***********************************************************
+ *  AddSyntheticLights()
+ *
+ *  This method is used for adding generated ranged point
+ *  lights just above the table.  The lights are spread on a
+ *  spiral with the golden angle between them, so any count
+ *  covers the table evenly, and each one only lights the
+ *  objects close to it.
+ ***********************************************************/
+void SceneManager::AddSyntheticLights(int lightCount)
+{
+	const float goldenAngle = glm::radians(137.50776f);
+	const float spiralRadius = 9.0f;
+
+	m_lights.reserve(m_lights.size() + std::max(lightCount, 0));
+	for (int i = 0; i < lightCount; i++)
+	{
+		float angle = goldenAngle * (float)i;
+		float radius = spiralRadius * sqrt(((float)i + 0.5f) / (float)lightCount);
+		// alternate warm and cool colors so the lights are told apart
+		glm::vec3 color = (i % 2 == 0) ? glm::vec3(1.0f, 0.9f, 0.7f) : glm::vec3(0.6f, 0.75f, 1.0f);
+
+		LIGHT_SOURCE light;
+		light.position = glm::vec3(cos(angle) * radius, 1.5f, sin(angle) * radius);
+		light.direction = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.bUseDirection = false;
+		light.ambient = color * 0.05f;
+		light.diffuse = color * 0.4f;
+		light.specular = color * 0.3f;
+		light.focalStrength = 16.0f;
+		light.specularIntensity = 0.5f;
+		light.range = SYNTHETIC_LIGHT_RANGE;
+		light.bActive = true;
+		m_lights.push_back(light);
+	}
+
+	ApplySceneLights();
+}
+
+/***********************************************************
+ *  WaitForTextures()
+ *
+ *  This method is used for blocking until every texture has
+ *  been decoded and uploaded, so that rendering is measured
+ *  with the final textures instead of the placeholder.
+ ***********************************************************/
+void SceneManager::WaitForTextures()
+{
+	m_pTextureManager->WaitForLoads();
+	RefreshTextureLayers();
+}
+
+/***********************************************************
+ *  BakeStaticObjects()
+ *
+ *  This method is used for marking the objects already in the
+ *  draw list as static.  Their meshes are transformed once into
+ *  a few shared buffers, and each buffer is drawn with a single
+ *  draw call and no instance data to stream.  Objects added
+ *  later stay dynamic, and so do the transparent objects,
+ *  which are sorted by distance every frame.
+ ***********************************************************/
+int SceneManager::BakeStaticObjects()
+{
+	int count = 0;
+	for (SCENE_OBJECT& object : m_sceneObjects)
+	{
+		if (!object.bStatic && !object.bTransparent)
+		{
+			object.bStatic = true;
+			count++;
+		}
+	}
+
+	if (count > 0)
+	{
+		m_bStaticBatchesDirty = true;
+		m_bGpuObjectsDirty = true;
+	}
+
+	return(count);
+}
+
+/***********************************************************
+ *  BuildStaticBatches()
+ *
+ *  This method is used for baking the static objects into one
+ *  batch per shader variant and texture array.  The material
+ *  and the texture layer are stored in every vertex, so the
+ *  objects of a batch need no state between them, and they are
+ *  baked in draw list order so that objects sharing a material
+ *  are next to each other.  Each object keeps its own index
+ *  range at every level of detail, which is drawn only while
+ *  the object is in view, at the level it chose.
+ ***********************************************************/
+void SceneManager::BuildStaticBatches()
+{
+	m_basicMeshes->DestroyStaticBatches();
+	m_staticGroups.clear();
+	m_staticHandles.clear();
+	m_staticRanges.clear();
+	m_bStaticBatchesDirty = false;
+	// the indirect commands of the static objects index the batches
+	m_bGpuObjectsDirty = true;
+
+	// the shader variants and texture arrays of the static objects
+	auto textureArray = [this](const SCENE_OBJECT& object) {
+		return((object.textureIndex >= 0) ? m_pTextureManager->GetTextureInfo(object.textureIndex).arraySlot : -1);
+	};
+	std::vector<std::pair<unsigned int, int>> groupKeys;
+	for (const SCENE_OBJECT& object : m_sceneObjects)
+	{
+		std::pair<unsigned int, int> key((unsigned int)(object.sortKey >> 56), textureArray(object));
+		if (object.bStatic && (std::find(groupKeys.begin(), groupKeys.end(), key) == groupKeys.end()))
+		{
+			groupKeys.push_back(key);
+		}
+	}
+
+	std::vector<MeshType> types;
+	std::vector<MeshManager::INSTANCE_DATA> instances;
+	std::vector<MeshManager::STATIC_RANGE> ranges;
+	for (const std::pair<unsigned int, int>& key : groupKeys)
+	{
+		STATIC_GROUP group;
+		group.features = key.first;
+		group.textureArray = key.second;
+		group.firstObject = (int)m_staticHandles.size();
+		group.firstDraw = 0;
+		group.drawCount = 0;
+		group.firstCommand = 0;
+		group.commandCount = 0;
+		types.clear();
+		instances.clear();
+		glm::vec3 boundsMin(0.0f);
+		glm::vec3 boundsMax(0.0f);
+
+		for (const SCENE_OBJECT& object : m_sceneObjects)
+		{
+			if (!object.bStatic || ((unsigned int)(object.sortKey >> 56) != key.first) || (textureArray(object) != key.second))
+			{
+				continue;
+			}
+			MeshManager::INSTANCE_DATA instance;
+			instance.model = object.model;
+			instance.materialIndex = object.materialIndex;
+			instance.textureIndex = object.textureLayer;
+			instances.push_back(instance);
+			types.push_back(object.type);
+			m_staticHandles.push_back(object.handle);
+
+			glm::vec3 objectMin = object.boundsCenter - object.boundsExtents;
+			glm::vec3 objectMax = object.boundsCenter + object.boundsExtents;
+			boundsMin = (types.size() == 1) ? objectMin : glm::min(boundsMin, objectMin);
+			boundsMax = (types.size() == 1) ? objectMax : glm::max(boundsMax, objectMax);
+		}
+
+		group.objectCount = (int)types.size();
+		group.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		group.boundsExtents = (boundsMax - boundsMin) * 0.5f;
+
+		group.batch = m_basicMeshes->CreateStaticBatch(types.data(), instances.data(), (int)types.size(), ranges);
+		if (group.batch >= 0)
+		{
+			m_staticRanges.insert(m_staticRanges.end(), ranges.begin(), ranges.end());
+			m_staticGroups.push_back(group);
+		}
+		else
+		{
+			m_staticHandles.resize(group.firstObject);
+		}
+	}
+
+	// the cached static shadows no longer match the batches
+	m_shadowMaps.InvalidateStatic();
+}
+
+/***********************************************************
+ *  BuildStaticDraws()
+ *
+ *  This method is used for collecting the index ranges of the
+ *  static objects the CPU culling found in view, at the level
+ *  of detail each chose, which each group then draws with one
+ *  multi-draw call.  The objects of a level of a batch follow
+ *  each other in its index buffer, so a run of neighbours in
+ *  view at the same level is merged into one range.  There is
+ *  no occlusion test on this path, a static object behind the
+ *  others is still drawn.
+ ***********************************************************/
+void SceneManager::BuildStaticDraws()
+{
+	m_staticDrawCounts.clear();
+	m_staticDrawOffsets.clear();
+
+	for (STATIC_GROUP& group : m_staticGroups)
+	{
+		group.firstDraw = (int)m_staticDrawCounts.size();
+		GLuint drawEnd = 0;
+		for (int i = group.firstObject; i < group.firstObject + group.objectCount; i++)
+		{
+			const int index = m_handleToIndex[m_staticHandles[i]];
+			if (m_visible[index] == 0)
+			{
+				continue;
+			}
+
+			const MeshManager::STATIC_RANGE& range = m_staticRanges[i * MeshManager::LOD_COUNT + m_sceneObjects[index].lod];
+			if (((int)m_staticDrawCounts.size() > group.firstDraw) && (range.firstIndex == drawEnd))
+			{
+				m_staticDrawCounts.back() += range.indexCount;
+			}
+			else
+			{
+				m_staticDrawCounts.push_back(range.indexCount);
+				m_staticDrawOffsets.push_back((const GLvoid*)(range.firstIndex * sizeof(GLuint)));
+			}
+			drawEnd = range.firstIndex + (GLuint)range.indexCount;
+		}
+		group.drawCount = (int)m_staticDrawCounts.size() - group.firstDraw;
+	}
+}
+
+/***********************************************************
+ *  BuildFrameInstances()
+ *
+ *  This method is used for culling the draw list and filling
+ *  in the instances of every batch on all of the CPU cores.
+ *  The sorted list is cut into batches, which share a shader
+ *  variant and a mesh, and the batches into tasks of a few
+ *  thousand objects.  The first pass culls and counts the
+ *  instances of each task, and the second writes them into
+ *  the slice of the frame instance array its offset reserves,
+ *  so no two threads write to the same memory and the slices
+ *  of a batch follow each other for its draw call.  Only the
+ *  draws stay on the thread with the GL context.  Only the
+ *  opaque objects are batched.  Returns the number of opaque
+ *  objects in view.
+ ***********************************************************/
+int SceneManager::BuildFrameInstances()
+{
+	const int objectCount = (int)m_sceneObjects.size();
+	const int opaqueCount = GetOpaqueCount();
+	m_frameBatches.clear();
+	m_frameTasks.clear();
+
+	// objects that only differ in material or texture share
+	// the batch, both are selected per instance
+	const uint64_t batchMask = ~(MATERIAL_KEY_MASK | TEXTURE_KEY_MASK);
+	int first = 0;
+	while (first < opaqueCount) {
+		const uint64_t batchKey = m_sceneObjects[first].sortKey & batchMask;
+		int last = first + 1;
+		while ((last < opaqueCount) && ((m_sceneObjects[last].sortKey & batchMask) == batchKey)) {
+			last++;
+		}
+
+		FRAME_BATCH batch;
+		batch.first = first;
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			batch.instanceOffset[lod] = 0;
+			batch.instanceCount[lod] = 0;
+		}
+		m_frameBatches.push_back(batch);
+
+		for (int taskFirst = first; taskFirst < last; taskFirst += FRAME_TASK_OBJECTS) {
+			FRAME_TASK task;
+			task.first = taskFirst;
+			task.last = std::min(taskFirst + FRAME_TASK_OBJECTS, last);
+			task.batch = (int)m_frameBatches.size() - 1;
+			task.visibleCount = 0;
+			for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+				task.instanceCount[lod] = 0;
+				task.instanceOffset[lod] = 0;
+			}
+			m_frameTasks.push_back(task);
+		}
+
+		first = last;
+	}
+
+	// large scenes take their visibility from the hierarchy, the
+	// others test the frustum in the tasks
+	const bool bTestFrustum = m_bCullingEnabled && (objectCount < HIERARCHY_CULLING_OBJECTS);
+	if (m_bCullingEnabled && !bTestFrustum) {
+		m_bvh.QueryFrustum(m_culler.GetPlanes(), m_queryResults);
+		m_visible.assign(objectCount, 0);
+		for (int handle : m_queryResults) {
+			m_visible[m_handleToIndex[handle]] = 1;
+		}
+	}
+	else if (!m_bCullingEnabled) {
+		m_visible.assign(objectCount, 1);
+	}
+	else {
+		m_visible.resize(objectCount);
+	}
+
+	// the visible objects also choose their level of detail from
+	// the radius of their bounds on screen, the finest level is
+	// drawn until a camera is set
+	const glm::vec3 cameraPosition = m_frameData.viewPosition;
+	const float lodScale = m_bCullingEnabled ? m_lodScale : 0.0f;
+	m_jobs.ParallelFor((int)m_frameTasks.size(), 1, [this, bTestFrustum, cameraPosition, lodScale](int begin, int end, int /*thread*/) {
+		for (int t = begin; t < end; t++) {
+			FRAME_TASK& task = m_frameTasks[t];
+			if (bTestFrustum) {
+				m_culler.Cull(m_visible, task.first, task.last);
+			}
+			for (int i = task.first; i < task.last; i++) {
+				task.visibleCount += m_visible[i];
+				SCENE_OBJECT& object = m_sceneObjects[i];
+				if (m_visible[i] == 0) {
+					continue;
+				}
+				if (lodScale > 0.0f) {
+					float distance = std::max(glm::length(object.boundsCenter - cameraPosition), 0.001f);
+					float projectedSize = glm::length(object.boundsExtents) * lodScale / distance;
+					object.lod = m_basicMeshes->SelectLod(object.type, projectedSize, object.lod);
+				}
+				else {
+					object.lod = 0;
+				}
+				// the static objects are drawn from their batches
+				if (!object.bStatic) {
+					task.instanceCount[object.lod]++;
+				}
+			}
+		}
+	});
+
+	// reserve the slices of the batches in draw list order, one per
+	// level of detail, then the part of each slice every task fills
+	int visibleCount = 0;
+	for (const FRAME_TASK& task : m_frameTasks) {
+		FRAME_BATCH& batch = m_frameBatches[task.batch];
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			batch.instanceCount[lod] += task.instanceCount[lod];
+		}
+		visibleCount += task.visibleCount;
+	}
+	int instanceCount = 0;
+	for (FRAME_BATCH& batch : m_frameBatches) {
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			batch.instanceOffset[lod] = instanceCount;
+			instanceCount += batch.instanceCount[lod];
+		}
+	}
+	int sliceOffsets[MeshManager::LOD_COUNT] = { 0 };
+	for (FRAME_TASK& task : m_frameTasks) {
+		const FRAME_BATCH& batch = m_frameBatches[task.batch];
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			if (task.first == batch.first) {
+				sliceOffsets[lod] = batch.instanceOffset[lod];
+			}
+			task.instanceOffset[lod] = sliceOffsets[lod];
+			sliceOffsets[lod] += task.instanceCount[lod];
+		}
+	}
+
+	// the workers write the instances straight into the region of
+	// the frame in the instance ring, which grows to hold them
+	MeshManager::INSTANCE_DATA* pInstances = NULL;
+	m_ringFirstInstance = -1;
+	if (m_instanceRing.IsAvailable() && (instanceCount > 0)) {
+		const size_t size = instanceCount * sizeof(MeshManager::INSTANCE_DATA);
+		if (size > m_instanceRing.GetRegionSize()) {
+			m_instanceRing.Initialize(GL_ARRAY_BUFFER, std::max(size, 2 * m_instanceRing.GetRegionSize()),
+				sizeof(MeshManager::INSTANCE_DATA));
+		}
+		size_t offset = 0;
+		pInstances = (MeshManager::INSTANCE_DATA*)m_instanceRing.Allocate(size, offset);
+		if (pInstances != NULL) {
+			m_ringFirstInstance = (int)(offset / sizeof(MeshManager::INSTANCE_DATA));
+		}
+	}
+	if (pInstances == NULL) {
+		m_instanceData.resize(instanceCount);
+		pInstances = m_instanceData.data();
+	}
+
+	m_jobs.ParallelFor((int)m_frameTasks.size(), 1, [this, pInstances](int begin, int end, int /*thread*/) {
+		for (int t = begin; t < end; t++) {
+			const FRAME_TASK& task = m_frameTasks[t];
+			MeshManager::INSTANCE_DATA* pLodInstances[MeshManager::LOD_COUNT];
+			for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+				pLodInstances[lod] = pInstances + task.instanceOffset[lod];
+			}
+			for (int i = task.first; i < task.last; i++) {
+				const SCENE_OBJECT& object = m_sceneObjects[i];
+				if ((m_visible[i] == 0) || object.bStatic) {
+					continue;
+				}
+				MeshManager::INSTANCE_DATA* pInstance = pLodInstances[object.lod]++;
+				pInstance->model = object.model;
+				pInstance->materialIndex = object.materialIndex;
+				pInstance->textureIndex = object.textureLayer;
+			}
+		}
+	});
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  UploadGpuObjects()
+ *
+ *  This method is used for handing the opaque objects to the
+ *  GPU culler.  The sorted draw list keeps the dynamic objects
+ *  of one shader variant and mesh together, so each run becomes
+ *  one indirect draw command for every level of detail of the
+ *  mesh, each with an instance slot per object of the run, and
+ *  the commands of a shader variant are drawn together.  Every
+ *  static object gets a command of its own for each level of
+ *  detail over its range of the static batch, and the culling
+ *  gives the command of the level it chose one instance when
+ *  the object is in view.  The whole list is uploaded again
+ *  when objects are added, removed or change their draw state,
+ *  at most once per frame, while the moved objects are updated
+ *  in place by UpdateTransforms().
+ ***********************************************************/
+void SceneManager::UploadGpuObjects()
+{
+	m_bGpuObjectsDirty = false;
+	m_gpuGroups.clear();
+	m_gpuObjectIndices.assign(m_handleToIndex.size(), -1);
+
+	std::vector<GpuCuller::GPU_OBJECT> objects;
+	std::vector<GpuCuller::DRAW_COMMAND> commands;
+	objects.reserve(m_sceneObjects.size());
+
+	const uint64_t batchMask = ~(MATERIAL_KEY_MASK | TEXTURE_KEY_MASK);
+	uint64_t commandKey = 0;
+	// first command and first object of the current run
+	size_t runCommand = 0;
+	size_t runObject = 0;
+	GLuint instanceSlots = 0;
+
+	// the objects of a run may all choose the same level, so every
+	// level of the run gets a slot for each of them
+	auto closeRun = [&]() {
+		GLuint runCount = (GLuint)(objects.size() - runObject);
+		for (size_t i = runCommand; i < commands.size(); i++) {
+			commands[i].baseInstance = instanceSlots;
+			instanceSlots += runCount;
+		}
+	};
+
+	for (const SCENE_OBJECT& object : m_sceneObjects)
+	{
+		// the transparent objects are sorted and drawn on the CPU
+		if (object.bStatic || object.bTransparent)
+		{
+			continue;
+		}
+
+		int lodCount = m_basicMeshes->GetLodCount(object.type);
+		if (commands.empty() || ((object.sortKey & batchMask) != commandKey))
+		{
+			if (!commands.empty())
+			{
+				closeRun();
+			}
+			runCommand = commands.size();
+			runObject = objects.size();
+
+			for (int lod = 0; lod < lodCount; lod++)
+			{
+				const MeshManager::MESH_RANGE& mesh = m_basicMeshes->GetMeshRange(object.type, lod);
+				GpuCuller::DRAW_COMMAND command;
+				command.count = (GLuint)mesh.indexCount;
+				command.instanceCount = 0;
+				command.firstIndex = mesh.firstIndex;
+				command.baseVertex = mesh.baseVertex;
+				command.baseInstance = 0;
+				commands.push_back(command);
+			}
+			commandKey = object.sortKey & batchMask;
+
+			unsigned int features = (unsigned int)(commandKey >> 56);
+			if (m_gpuGroups.empty() || (m_gpuGroups.back().features != features))
+			{
+				GPU_DRAW_GROUP group;
+				group.features = features;
+				group.firstCommand = (int)runCommand;
+				group.commandCount = 0;
+				m_gpuGroups.push_back(group);
+			}
+			m_gpuGroups.back().commandCount += lodCount;
+		}
+
+		GpuCuller::GPU_OBJECT gpuObject;
+		gpuObject.model = object.model;
+		gpuObject.boundsCenter = glm::vec4(object.boundsCenter, 0.0f);
+		gpuObject.boundsExtents = glm::vec4(object.boundsExtents, 0.0f);
+		gpuObject.command = (GLint)runCommand;
+		gpuObject.materialIndex = object.materialIndex;
+		gpuObject.textureIndex = object.textureLayer;
+		gpuObject.lodState = lodCount | (object.lod << 8);
+		m_gpuObjectIndices[object.handle] = (int)objects.size();
+		objects.push_back(gpuObject);
+	}
+	if (!commands.empty())
+	{
+		closeRun();
+	}
+
+	// the static objects are the occluders of the Hi-Z pyramid as
+	// well, their own depth there is never in front of their bounds,
+	// so only the other occluders can hide them
+	for (STATIC_GROUP& group : m_staticGroups)
+	{
+		group.firstCommand = (int)commands.size();
+		for (int i = group.firstObject; i < group.firstObject + group.objectCount; i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_handleToIndex[m_staticHandles[i]]];
+			const int lodCount = m_basicMeshes->GetLodCount(object.type);
+
+			GpuCuller::GPU_OBJECT gpuObject;
+			gpuObject.model = object.model;
+			gpuObject.boundsCenter = glm::vec4(object.boundsCenter, 0.0f);
+			gpuObject.boundsExtents = glm::vec4(object.boundsExtents, 0.0f);
+			gpuObject.command = (GLint)commands.size();
+			gpuObject.materialIndex = object.materialIndex;
+			gpuObject.textureIndex = object.textureLayer;
+			gpuObject.lodState = lodCount | (object.lod << 8) | GpuCuller::LOD_STATE_OCCLUDER;
+			m_gpuObjectIndices[object.handle] = (int)objects.size();
+			objects.push_back(gpuObject);
+
+			for (int lod = 0; lod < lodCount; lod++)
+			{
+				const MeshManager::STATIC_RANGE& range = m_staticRanges[i * MeshManager::LOD_COUNT + lod];
+				GpuCuller::DRAW_COMMAND command;
+				command.count = (GLuint)range.indexCount;
+				command.instanceCount = 0;
+				command.firstIndex = range.firstIndex;
+				command.baseVertex = 0;
+				command.baseInstance = instanceSlots++;
+				commands.push_back(command);
+			}
+		}
+		group.commandCount = (int)commands.size() - group.firstCommand;
+	}
+
+	m_gpuCuller.SetObjects(objects, commands, (int)instanceSlots);
+}
+
+/***********************************************************
+ *  RenderOccluders()
+ *
+ *  This method is used for drawing the static batches in view
+ *  depth only into the occlusion pyramid.  The walls, floors
+ *  and shelves of the scene are all static, so they are the
+ *  large occluders, and drawing them costs one call per batch.
+ ***********************************************************/
+void SceneManager::RenderOccluders()
+{
+	m_occlusionCuller.BeginOccluders(m_frameData.projection * m_frameData.view);
+	for (const STATIC_GROUP& group : m_staticGroups)
+	{
+		if (m_culler.IsBoxVisible(group.boundsCenter, group.boundsExtents))
+		{
+			m_basicMeshes->DrawStaticBatch(group.batch);
+		}
+	}
+	m_occlusionCuller.EndOccluders();
+}
+
+/***********************************************************
+ *  RenderShadows()
+ *
+ *  This method is used for refreshing the shadow maps of the
+ *  lights whose casters changed since they were rendered.  The
+ *  static batches are only drawn into the cache when the light
+ *  or the batches changed, every other refresh copies the
+ *  cache and draws the dynamic casters within the range of
+ *  the light, one instanced call per mesh and face.
+ ***********************************************************/
+void SceneManager::RenderShadows()
+{
+	m_frameStats.shadowUpdates = 0;
+	if (!m_shadowMaps.IsAvailable())
+	{
+		return;
+	}
+
+	for (int slot = 0; slot < m_shadowMaps.GetLightCount(); slot++)
+	{
+		if (!m_shadowMaps.IsDirty(slot))
+		{
+			continue;
+		}
+		if (m_frameStats.shadowUpdates == 0)
+		{
+			m_shadowMaps.BeginUpdate();
+		}
+		m_frameStats.shadowUpdates++;
+
+		if (m_shadowMaps.IsStaticDirty(slot))
+		{
+			for (int face = 0; face < ShadowMaps::FACE_COUNT; face++)
+			{
+				m_shadowMaps.BeginStaticFace(slot, face);
+				for (const STATIC_GROUP& group : m_staticGroups)
+				{
+					m_basicMeshes->DrawStaticBatch(group.batch);
+					m_frameStats.drawCalls++;
+				}
+			}
+		}
+
+		// the dynamic opaque objects within the shadow distance
+		const glm::vec3& lightPosition = m_shadowMaps.GetLightPosition(slot);
+		const float farDistance = m_shadowMaps.GetFarDistance(slot);
+		for (int i = 0; i < MeshManager::MESH_COUNT; i++)
+		{
+			m_shadowCasters[i].clear();
+		}
+		for (const SCENE_OBJECT& object : m_sceneObjects)
+		{
+			if (object.bStatic || object.bTransparent)
+			{
+				continue;
+			}
+			glm::vec3 offset = glm::max(glm::abs(lightPosition - object.boundsCenter) - object.boundsExtents, glm::vec3(0.0f));
+			if (glm::dot(offset, offset) >= farDistance * farDistance)
+			{
+				continue;
+			}
+			MeshManager::INSTANCE_DATA instance;
+			instance.model = object.model;
+			instance.materialIndex = object.materialIndex;
+			instance.textureIndex = object.textureLayer;
+			m_shadowCasters[(int)object.type].push_back(instance);
+		}
+
+		for (int face = 0; face < ShadowMaps::FACE_COUNT; face++)
+		{
+			m_shadowMaps.BeginFace(slot, face);
+			for (int i = 0; i < MeshManager::MESH_COUNT; i++)
+			{
+				if (!m_shadowCasters[i].empty())
+				{
+					m_basicMeshes->DrawMeshInstanced((MeshType)i, m_shadowCasters[i].data(), (int)m_shadowCasters[i].size());
+					m_frameStats.drawCalls++;
+				}
+			}
+		}
+		m_shadowMaps.EndLight(slot);
+	}
+
+	if (m_frameStats.shadowUpdates > 0)
+	{
+		m_shadowMaps.EndUpdate();
+	}
+}
 
-	// Warm light for direction
-	float warmLightX = 1.0f;
-	float warmLightY = 0.994f;
-	float warmLightZ = 0.75f;
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for watching the scene shader files and
+ *  the files of the loaded textures, so that editing them shows
+ *  up in the running scene.  Textures loaded from the asset
+ *  pack have no file of their own and are not watched.
+ ***********************************************************/
+void SceneManager::EnableHotReload()
+{
+	// files are only added while the watcher is stopped
+	m_fileWatcher.Stop();
 
-	// Cool light for ambient
-	float coolLightX = 0.6f;
-	float coolLightY = 0.77f;
-	float coolLightZ = 0.9f;
+	// the shader files map to no texture
+	m_fileWatcher.Watch(SCENE_VERTEX_SHADER);
+	m_fileWatcher.Watch(SCENE_FRAGMENT_SHADER);
+	m_watchedTextures.assign(m_fileWatcher.GetWatchCount(), -1);
 
-	/*** STUDENTS - add the code BELOW for setting up light sources ***/
-	/*** Up to four light sources can be defined. Refer to the code ***/
-	/*** in the OpenGL Sample for help                              ***/
+	for (int i = 0; i < m_pTextureManager->GetTextureCount(); i++)
+	{
+		const std::string& sourceFile = m_pTextureManager->GetTextureInfo(i).sourceFile;
+		if (!sourceFile.empty())
+		{
+			int watchId = m_fileWatcher.Watch(sourceFile);
+			m_watchedTextures.resize(m_fileWatcher.GetWatchCount(), -1);
+			m_watchedTextures[watchId] = i;
+		}
+	}
 
-	// A warm directional light
-	m_pShaderManager->setVec3Value("pointLights[0].position", -20.5f, 10.0f, -10.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].direction", 20.5f, -10.0f, 10.0f);
-	m_pShaderManager->setBoolValue("pointLights[0].bUseDirection", true);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", warmLightX * 0.51f, warmLightY * 0.51f, warmLightZ * 0.51f);
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", warmLightX * 0.56f, warmLightY * 0.56f, warmLightZ * 0.56f);
-	m_pShaderManager->setVec3Value("pointLights[0].specular", warmLightX * 0.54f, warmLightY * 0.54f, warmLightZ * 0.54f);
-	m_pShaderManager->setFloatValue("pointLights[0].focalStrength", 102.0f);
-	m_pShaderManager->setFloatValue("pointLights[0].specularIntensity", 2.1f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	m_fileWatcher.Start(HOT_RELOAD_POLL_MS);
+	std::cout << "INFO: watching " << m_fileWatcher.GetWatchCount() << " files for hot reloading" << std::endl;
+}
 
-	// A cool ambient light
-	m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 4.0f, 4.0f);
-	m_pShaderManager->setBoolValue("pointLights[1].bUseDirection", false);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", coolLightX * 0.5f, coolLightY * 0.5f, coolLightZ * 0.5f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", coolLightX * 0.2f, coolLightY * 0.2f, coolLightZ * 0.2f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", coolLightX * 0.0f, coolLightY * 0.0f, coolLightZ * 0.0f);
-	m_pShaderManager->setFloatValue("pointLights[1].focalStrength", 12.0f);
-	m_pShaderManager->setFloatValue("pointLights[1].specularIntensity", 0.0f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+/***********************************************************
+ *  ProcessReloads()
+ *
+ *  This method is used for reloading the files the watcher
+ *  found changed.  The shader variants are rebuilt right away
+ *  and put back in use with their fixed values set again.  The
+ *  textures are decoded on the loader threads and swapped in
+ *  by the regular uploads, so a large image never stalls the
+ *  frame.  Whatever fails to reload keeps its old version.
+ ***********************************************************/
+void SceneManager::ProcessReloads()
+{
+	if (!m_fileWatcher.TakeChanges(m_changedFiles)) {
+		return;
+	}
+
+	bool bShadersChanged = false;
+	for (int watchId : m_changedFiles) {
+		int textureIndex = m_watchedTextures[watchId];
+		if (textureIndex < 0) {
+			bShadersChanged = true;
+		}
+		else if (m_pTextureManager->ReloadTexture(textureIndex)) {
+			std::cout << "INFO: reloading texture " << m_fileWatcher.GetFilename(watchId) << std::endl;
+		}
+	}
+
+	if (bShadersChanged) {
+		std::vector<int> rebuiltSlots;
+		if (m_shaderVariants.Reload(rebuiltSlots)) {
+			for (int slot : rebuiltSlots) {
+				glUseProgram(m_shaderVariants.GetProgram(slot));
+				m_pUniforms = &m_shaderVariants.GetUniforms(slot);
+				InitializeShaderVariant();
+			}
+			std::cout << "INFO: reloaded " << rebuiltSlots.size() << " of "
+				<< m_shaderVariants.GetVariantCount() << " shader variants" << std::endl;
+		}
+		InvalidateRenderState();
+	}
+}
+
+/***********************************************************
+ *  HasPendingChanges()
+ *
+ *  This method is used for checking whether the next frame
+ *  would differ from the last one when nothing moved the
+ *  camera - objects were added, moved or removed, a watched
+ *  file changed, or a texture or one of its levels is still on
+ *  its way in.
+ ***********************************************************/
+bool SceneManager::HasPendingChanges()
+{
+	return(m_bTransformsDirty || m_bDrawOrderDirty || m_bStaticBatchesDirty ||
+		m_pTextureManager->IsLoading() || m_pTextureManager->IsStreaming() || m_fileWatcher.HasChanges());
+}
+
+/***********************************************************
+ *  AddSceneObjects()
+ *
+ *  This method is used for adding the objects of the scene
+ *  description to the retained draw list.
+ ***********************************************************/
+void SceneManager::AddSceneObjects()
+{
+	// build the retained draw list once - the textures and
+	// materials must already be loaded so the tags resolve
+	m_sceneObjects.reserve(sizeof(SCENE_OBJECTS) / sizeof(SCENE_OBJECTS[0]));
+	for (const auto& c : SCENE_OBJECTS) {
+		AddObject(c);
+	}
+}
+
+/***********************************************************
+ *  LoadScenePack()
+ *
+ *  This method is used for loading the whole scene from a
+ *  memory-mapped asset pack - textures, materials, lights and
+ *  objects.  The texture payloads are handed to the texture
+ *  manager in place, so the pack stays mapped for the life of
+ *  the scene.  Returns false if there is no usable pack.
+ ***********************************************************/
+bool SceneManager::LoadScenePack(const char* filename)
+{
+	if (!m_assetPack.Open(filename))
+	{
+		return false;
+	}
+
+	const AssetPack::PACK_ENTRY* pObjects = m_assetPack.FindEntry(AssetPack::EntryType::Objects, PACK_OBJECTS);
+	const AssetPack::PACK_ENTRY* pMaterials = m_assetPack.FindEntry(AssetPack::EntryType::Materials, PACK_MATERIALS);
+	const AssetPack::PACK_ENTRY* pLights = m_assetPack.FindEntry(AssetPack::EntryType::Lights, PACK_LIGHTS);
+	if ((pObjects == NULL) || (pMaterials == NULL) || (pLights == NULL) ||
+		(pObjects->size % sizeof(PACK_OBJECT) != 0) ||
+		(pMaterials->size % sizeof(PACK_MATERIAL) != 0) ||
+		(pLights->size % sizeof(PACK_LIGHT) != 0))
+	{
+		std::cout << "Asset pack does not hold a scene:" << filename << std::endl;
+		m_assetPack.Close();
+		return false;
+	}
+
+	for (int i = 0; i < m_assetPack.GetEntryCount(); i++)
+	{
+		const AssetPack::PACK_ENTRY& entry = m_assetPack.GetEntry(i);
+		if (entry.type == (uint32_t)AssetPack::EntryType::Texture)
+		{
+			m_pTextureManager->LoadTextureFromMemory(m_assetPack.GetPayload(entry), (size_t)entry.size, entry.name);
+		}
+	}
+	BindGLTextures();
+
+	// the records are copied out, since their payloads are only
+	// aligned to the pack alignment
+	size_t materialCount = (size_t)(pMaterials->size / sizeof(PACK_MATERIAL));
+	for (size_t i = 0; i < materialCount; i++)
+	{
+		PACK_MATERIAL record;
+		memcpy(&record, m_assetPack.GetPayload(*pMaterials) + i * sizeof(PACK_MATERIAL), sizeof(record));
+		record.tag[PACK_TAG_LENGTH - 1] = '\0';
+
+		OBJECT_MATERIAL material;
+		material.diffuseColor = glm::vec3(record.diffuseColor[0], record.diffuseColor[1], record.diffuseColor[2]);
+		material.specularColor = glm::vec3(record.specularColor[0], record.specularColor[1], record.specularColor[2]);
+		material.shininess = record.shininess;
+		material.bTransparent = (record.bTransparent != 0);
+		material.tag = record.tag;
+		m_objectMaterials.push_back(material);
+	}
+	BuildMaterialIndex();
+
+	size_t lightCount = (size_t)(pLights->size / sizeof(PACK_LIGHT));
+	for (size_t i = 0; i < lightCount; i++)
+	{
+		PACK_LIGHT record;
+		memcpy(&record, m_assetPack.GetPayload(*pLights) + i * sizeof(PACK_LIGHT), sizeof(record));
+
+		LIGHT_SOURCE light;
+		light.position = glm::vec3(record.position[0], record.position[1], record.position[2]);
+		light.direction = glm::vec3(record.direction[0], record.direction[1], record.direction[2]);
+		light.ambient = glm::vec3(record.ambient[0], record.ambient[1], record.ambient[2]);
+		light.diffuse = glm::vec3(record.diffuse[0], record.diffuse[1], record.diffuse[2]);
+		light.specular = glm::vec3(record.specular[0], record.specular[1], record.specular[2]);
+		light.focalStrength = record.focalStrength;
+		light.specularIntensity = record.specularIntensity;
+		light.range = record.range;
+		light.bUseDirection = (record.bUseDirection != 0);
+		light.bActive = (record.bActive != 0);
+		m_lights.push_back(light);
+	}
+
+	size_t objectCount = (size_t)(pObjects->size / sizeof(PACK_OBJECT));
+	m_sceneObjects.reserve(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		PACK_OBJECT record;
+		memcpy(&record, m_assetPack.GetPayload(*pObjects) + i * sizeof(PACK_OBJECT), sizeof(record));
+		record.material[PACK_TAG_LENGTH - 1] = '\0';
+		record.texture[PACK_TAG_LENGTH - 1] = '\0';
+		if (record.type >= (uint32_t)MeshManager::MESH_COUNT)
+		{
+			continue;
+		}
+
+		DrawCmd cmd;
+		cmd.type = (MeshType)record.type;
+		cmd.scale = glm::vec3(record.scale[0], record.scale[1], record.scale[2]);
+		cmd.rotationDeg = glm::vec3(record.rotationDeg[0], record.rotationDeg[1], record.rotationDeg[2]);
+		cmd.translation = glm::vec3(record.translation[0], record.translation[1], record.translation[2]);
+		cmd.material = (record.material[0] != '\0') ? record.material : NULL;
+		cmd.texture = (record.texture[0] != '\0') ? record.texture : NULL;
+		AddObject(cmd);
+	}
+
+	std::cout << "Loaded scene from asset pack:" << filename << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  WriteScenePack()
+ *
+ *  This method is used for writing the scene description into
+ *  an asset pack, so later runs start from one mapped file.
+ *  Cooked DDS textures are packed in place of their images
+ *  when they exist.  No OpenGL context is needed, and NULL
+ *  writes the default scene pack.
+ ***********************************************************/
+bool SceneManager::WriteScenePack(const char* filename)
+{
+	if (filename == NULL)
+	{
+		filename = SCENE_PACK_FILE;
+	}
+
+	m_objectMaterials.clear();
+	m_lights.clear();
+	DefineObjectMaterials();
+	SetupSceneLights();
+
+	std::vector<AssetPack::PACK_SOURCE> sources;
+	bool bSuccess = true;
+
+	for (const TEXTURE_FILE& texture : SCENE_TEXTURES)
+	{
+		AssetPack::PACK_SOURCE source;
+		source.type = AssetPack::EntryType::Texture;
+		source.name = texture.tag;
+
+		// prefer the cooked texture, it uploads without a decode
+		std::string cookedPath = TextureCodec::GetCookedFilename(texture.filename);
+		if (!ReadFileBytes(cookedPath.c_str(), source.data) &&
+			!ReadFileBytes(texture.filename, source.data))
+		{
+			std::cout << "Could not read texture for the asset pack:" << texture.filename << std::endl;
+			bSuccess = false;
+			continue;
+		}
+		sources.push_back(std::move(source));
+	}
+
+	std::vector<PACK_MATERIAL> materials;
+	for (const OBJECT_MATERIAL& material : m_objectMaterials)
+	{
+		PACK_MATERIAL record;
+		record.diffuseColor[0] = material.diffuseColor.x;
+		record.diffuseColor[1] = material.diffuseColor.y;
+		record.diffuseColor[2] = material.diffuseColor.z;
+		record.specularColor[0] = material.specularColor.x;
+		record.specularColor[1] = material.specularColor.y;
+		record.specularColor[2] = material.specularColor.z;
+		record.shininess = material.shininess;
+		record.bTransparent = material.bTransparent ? 1 : 0;
+		bSuccess = CopyTag(record.tag, material.tag.c_str()) && bSuccess;
+		materials.push_back(record);
+	}
+
+	std::vector<PACK_LIGHT> lights;
+	for (const LIGHT_SOURCE& light : m_lights)
+	{
+		PACK_LIGHT record;
+		for (int c = 0; c < 3; c++)
+		{
+			record.position[c] = light.position[c];
+			record.direction[c] = light.direction[c];
+			record.ambient[c] = light.ambient[c];
+			record.diffuse[c] = light.diffuse[c];
+			record.specular[c] = light.specular[c];
+		}
+		record.focalStrength = light.focalStrength;
+		record.specularIntensity = light.specularIntensity;
+		record.range = light.range;
+		record.bUseDirection = light.bUseDirection ? 1 : 0;
+		record.bActive = light.bActive ? 1 : 0;
+		lights.push_back(record);
+	}
+
+	std::vector<PACK_OBJECT> objects;
+	for (const DrawCmd& cmd : SCENE_OBJECTS)
+	{
+		PACK_OBJECT record;
+		record.type = (uint32_t)cmd.type;
+		for (int c = 0; c < 3; c++)
+		{
+			record.scale[c] = cmd.scale[c];
+			record.rotationDeg[c] = cmd.rotationDeg[c];
+			record.translation[c] = cmd.translation[c];
+		}
+		bSuccess = CopyTag(record.material, cmd.material) && bSuccess;
+		bSuccess = CopyTag(record.texture, cmd.texture) && bSuccess;
+		objects.push_back(record);
+	}
+
+	AppendRecords(sources, AssetPack::EntryType::Materials, PACK_MATERIALS, materials);
+	AppendRecords(sources, AssetPack::EntryType::Lights, PACK_LIGHTS, lights);
+	AppendRecords(sources, AssetPack::EntryType::Objects, PACK_OBJECTS, objects);
+
+	if (!bSuccess || !AssetPack::Write(filename, sources))
+	{
+		return false;
+	}
+
+	std::cout << "Wrote scene asset pack:" << filename << std::endl;
+	return true;
 }
 
 /***********************************************************
@@ -571,19 +2387,93 @@ void SceneManager::SetupSceneLights()
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
+	// the scene is drawn with specialized variants of the scene
+	// shaders, each compiled the first time a draw needs it
+	if (!m_shaderVariants.Load(SCENE_VERTEX_SHADER, SCENE_FRAGMENT_SHADER))
+	{
+		std::cerr << "ERROR: the scene shaders could not be read\n";
+	}
+	// the linked variants are kept on disk, so later runs load them
+	// instead of compiling them again
+	m_shaderVariants.EnableBinaryCache(SHADER_CACHE_DIRECTORY);
+
+	// the frame values and the material table live in uniform
+	// blocks that any program pointed at the binding points shares
+	m_frameBuffer.Initialize(UniformBuffer::FRAME_BINDING, sizeof(UniformBuffer::FRAME_BLOCK));
+	m_materialBuffer.Initialize(UniformBuffer::MATERIAL_BINDING,
+		UniformBuffer::MAX_SHADER_MATERIALS * sizeof(UniformBuffer::SHADER_MATERIAL));
+	m_lightClusters.Initialize();
+	// the per-frame block and the instances are written into mapped
+	// rings when the buffers can stay mapped, so the CPU builds the
+	// next frame while the GPU still draws the previous ones
+	if (FrameRing::IsSupported())
+	{
+		GLint uniformAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		size_t blockSize = (sizeof(UniformBuffer::FRAME_BLOCK) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+		m_frameRing.Initialize(GL_UNIFORM_BUFFER, FRAME_RING_BLOCKS * blockSize, (size_t)uniformAlignment);
+
+		// the instances of a batch are found through the base instance
+		if (GLEW_VERSION_4_2 || GLEW_ARB_base_instance)
+		{
+			m_instanceRing.Initialize(GL_ARRAY_BUFFER, INITIAL_RING_INSTANCES * sizeof(MeshManager::INSTANCE_DATA),
+				sizeof(MeshManager::INSTANCE_DATA));
+		}
+		if (m_frameRing.IsAvailable())
+		{
+			std::cout << "INFO: " << FrameRing::FRAMES_IN_FLIGHT << " frames in flight through mapped ring buffers" << std::endl;
+		}
+	}
+	// with OpenGL 4.3 the dynamic objects are culled on the GPU and
+	// drawn with indirect commands, otherwise on the CPU as before
+	if (m_gpuCuller.Initialize(CULL_COMPUTE_SHADER))
+	{
+		std::cout << "INFO: the scene objects are culled on the GPU" << std::endl;
+
+		// the static scenery hides the dynamic objects behind it
+		if (m_occlusionCuller.Initialize(OCCLUDER_VERTEX_SHADER, HIZ_COMPUTE_SHADER, OCCLUSION_TEXTURE_UNIT))
+		{
+			std::cout << "INFO: the scene objects are occlusion culled against the static scenery" << std::endl;
+		}
+	}
+	// the global lights cast shadows from cached shadow maps
+	if (m_shadowMaps.Initialize(SHADOW_VERTEX_SHADER, SHADOW_TEXTURE_UNIT))
+	{
+		std::cout << "INFO: the global lights cast shadows" << std::endl;
+	}
+
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
-	LoadSceneTextures();
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
-	// add and define the light sources for the scene
-	SetupSceneLights();
+	m_basicMeshes->LoadMeshes();
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadSphereMesh();
+	// the whole scene comes from the asset pack when there is one,
+	// otherwise from the scene description in this file
+	if (!LoadScenePack(SCENE_PACK_FILE))
+	{
+		LoadSceneTextures();
+		// define the materials for objects in the scene
+		DefineObjectMaterials();
+		BuildMaterialIndex();
+		// add and define the light sources for the scene
+		SetupSceneLights();
+		AddSceneObjects();
+	}
+	ApplySceneMaterials();
+	ApplySceneLights();
+	// the objects of the scene never move, so they are drawn from
+	// baked batches instead of one instance each
+	int staticCount = BakeStaticObjects();
+	std::cout << "INFO: " << staticCount << " scene objects baked into static batches" << std::endl;
+
+	// build the variants of the scene up front, so the first frame
+	// does not stall on them, and start out with the textured one
+	// so the per-draw setters always have a program to set into
+	const unsigned int sceneFeatures = m_bUseLighting ? ShaderVariants::FEATURE_LIT : 0;
+	UseShaderVariant(sceneFeatures);
+	UseShaderVariant(sceneFeatures | ShaderVariants::FEATURE_TEXTURED);
+	std::cout << "INFO: " << m_shaderVariants.GetCachedVariantCount() << " of "
+		<< m_shaderVariants.GetVariantCount() << " shader variants loaded from the cache" << std::endl;
 }
 
 /***********************************************************
@@ -601,53 +2491,401 @@ void SceneManager::RenderScene()
 		return;
 	}
 
-	// Set up a function template to handle all our drawing opperations.
-	auto drawOne = [&](const DrawCmd& c) {
-		SetTransformations(c.scale, c.rotationDeg.x, c.rotationDeg.y, c.rotationDeg.z, c.translation);
-		SetShaderMaterial(c.material);
-		SetShaderTexture(c.texture);
+	// pick up the shaders and textures edited since the last frame
+	ProcessReloads();
 
-		switch (c.type) {
-		case MeshType::Plane:    m_basicMeshes->DrawPlaneMesh();    break;
-		case MeshType::Sphere:   m_basicMeshes->DrawSphereMesh();   break;
-		case MeshType::Cylinder: m_basicMeshes->DrawCylinderMesh(); break;
-		case MeshType::Box:      m_basicMeshes->DrawBoxMesh();      break;
-		}
-		};
+	// compose the model matrices of the objects added or moved
+	// since the last frame
+	UpdateTransforms();
 
-	// Scene objects as a tidy list of commands
-	const std::vector<DrawCmd> cmds = {
-		// Ground plane
-		{ MeshType::Plane,   {20.0f, 1.0f, 10.0f}, {90.0f, 0.0f,   0.0f}, { 0.0f, 9.0f,  -10.0f}, "stone",   "wall" },
+	// upload the textures that finished decoding since the last
+	// frame, objects switch from the placeholder once it is there
+	if (m_pTextureManager->ProcessCompletedLoads(MAX_TEXTURE_UPLOADS_PER_FRAME) > 0) {
+		RefreshTextureLayers();
+	}
+	// the finer texture levels follow the objects in view, within
+	// the video memory budget
+	UpdateTextureStreaming();
+
+	// keep the draw list in state order so that consecutive
+	// draws can skip the state they share
+	if (m_bDrawOrderDirty) {
+		SortDrawList();
+	}
+	if (m_bBoundsDirty) {
+		UpdateCullingBounds();
+	}
+	if (m_bStaticBatchesDirty) {
+		BuildStaticBatches();
+	}
 
-		// Table plane
-		{ MeshType::Plane,   {20.0f, 1.0f, 10.0f}, { 0.0f, 0.0f,   0.0f}, { 0.0f, 0.0f,    0.0f}, "wood",    "table" },
+	// test every object against the camera frustum up front, so
+	// the hidden objects cost no state changes or draw calls - large
+	// scenes skip whole regions of objects through the hierarchy
+	int visibleCount = (int)m_sceneObjects.size();
+	if (m_gpuCuller.IsAvailable()) {
+		// the GPU culls the objects into the indirect draw commands,
+		// with planes that keep everything until a camera is set
+		if (m_bGpuObjectsDirty) {
+			UploadGpuObjects();
+		}
+		BeginGpuPass(Profiler::GPU_OCCLUSION);
+		// the objects hidden behind the static scenery are culled
+		// as well, once there is a camera to draw it with
+		if (m_bCullingEnabled && m_occlusionCuller.IsAvailable() && !m_staticGroups.empty()) {
+			RenderOccluders();
+			m_gpuCuller.SetOcclusion(m_occlusionCuller.GetTextureUnit(), m_occlusionCuller.GetViewProjection());
+		}
+		else {
+			m_gpuCuller.SetOcclusion(-1, glm::mat4(1.0f));
+		}
+		m_gpuCuller.Cull(m_culler.GetPlanes(), m_frameData.viewPosition, m_bCullingEnabled ? m_lodScale : 0.0f);
+		EndGpuPass(Profiler::GPU_OCCLUSION);
+	}
+	else {
+		// the CPU cores cull and fill in the instances together -
+		// without the GPU culling there is no occlusion culling, the
+		// objects behind the static scenery are only frustum culled
+		visibleCount = BuildFrameInstances();
+		BuildStaticDraws();
+	}
+	// the few transparent objects are culled and sorted on this
+	// thread, whichever way the opaque ones are culled
+	const int transparentCount = CollectTransparentObjects();
+	if (!m_gpuCuller.IsAvailable()) {
+		visibleCount += transparentCount;
+	}
+	else if ((m_gpuCuller.GetObjectCount() > 0) && (m_gpuCuller.GetVisibleCount() < 0)) {
+		// the culled commands of the current objects are not read
+		// back yet
+		visibleCount = -1;
+	}
+	else {
+		// the objects the GPU culls are counted a few frames late
+		const int gpuCulled = m_gpuCuller.GetObjectCount() - std::max(m_gpuCuller.GetVisibleCount(), 0);
+		const int transparentTotal = (int)m_sceneObjects.size() - GetOpaqueCount();
+		visibleCount = (int)m_sceneObjects.size() - gpuCulled - (transparentTotal - transparentCount);
+	}
 
-		// Stone sphere
-		{ MeshType::Sphere,  { 0.3f, 0.3f, 0.3f},  { 0.0f, 0.0f,   0.0f}, {-6.0f, 0.3f,   -3.0f}, "stone",   "Stone" },
+	// other code may have changed the shader state between
+	// frames, so the first draw sends everything
+	InvalidateRenderState();
+	m_frameStats.drawCalls = 0;
+	m_frameStats.stateChanges = 0;
+	m_frameStats.skippedStateChanges = 0;
+	m_frameStats.culledObjects = (visibleCount >= 0) ? (int)m_sceneObjects.size() - visibleCount : -1;
+
+	// the shadow maps are only drawn for the lights whose casters
+	// changed, a still scene reuses them all
+	BeginGpuPass(Profiler::GPU_SHADOWS);
+	RenderShadows();
+	EndGpuPass(Profiler::GPU_SHADOWS);
+	m_shadowMaps.BindTexture();
+
+	// bin the ranged lights into the clusters of this camera, until
+	// a camera is set only the global lights are shaded
+	if (m_bCullingEnabled) {
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		m_lightClusters.Update(m_frameData.view, m_frameData.projection, viewport[2], viewport[3]);
+	}
+	m_lightClusters.BindTextures(LIGHT_CLUSTER_TEXTURE_UNIT);
+
+	// the camera and the cluster lookup reach every shader stage
+	// through one upload of the per-frame block
+	m_frameData.clusterTileScale = m_lightClusters.GetTileScale();
+	m_frameData.clusterDepthScale = m_lightClusters.GetDepthScale();
+	m_frameData.clusterDepthBias = m_lightClusters.GetDepthBias();
+	size_t frameOffset = 0;
+	void* pFrameData = m_frameRing.Allocate(sizeof(m_frameData), frameOffset);
+	if (pFrameData != NULL) {
+		memcpy(pFrameData, &m_frameData, sizeof(m_frameData));
+		glBindBufferRange(GL_UNIFORM_BUFFER, UniformBuffer::FRAME_BINDING, m_frameRing.GetBuffer(),
+			(GLintptr)frameOffset, sizeof(m_frameData));
+	}
+	else {
+		// out of ring space, or no ring at all
+		if (m_frameRing.IsAvailable()) {
+			m_frameBuffer.Bind();
+		}
+		m_frameBuffer.Update(&m_frameData, sizeof(m_frameData));
+	}
 
-		// Cylinders (bean container)
-		{ MeshType::Cylinder,{ 1.0f, 2.5f, 1.0f},  { 0.0f, 0.0f,   0.0f}, {-3.0f, 0.3f,    0.0f}, "glass", "glass" },
-		{ MeshType::Cylinder,{ 3.0f, 1.0f, 3.0f},  { 0.0f, 0.0f,   0.0f}, { 1.0f, 0.2f,    0.98f},"plastic", "beancontainer1" },
-		{ MeshType::Cylinder,{ 3.0f, 3.0f, 3.0f},  { 0.0f, 2.0f,   0.0f}, { 1.0f, 1.2f,    0.98f},"plastic", "beancontainer" },
-		{ MeshType::Cylinder,{ 2.8f, 0.5f, 2.8f},  { 0.0f, 0.0f,   0.0f}, { 1.0f, 4.2f,    0.98f},"plastic", "plastic" },
+	// with the depth pre-pass the opaque objects are drawn depth
+	// only first, and the shading pass then only shades the nearest
+	// fragment of each pixel - it tests for equal depth and writes
+	// none
+	if (m_bDepthPrepass) {
+		BeginGpuPass(Profiler::GPU_PREPASS);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		DrawOpaqueObjects(true);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+		EndGpuPass(Profiler::GPU_PREPASS);
+	}
+	BeginGpuPass(Profiler::GPU_SHADING);
+	DrawOpaqueObjects(false);
+	if (m_bDepthPrepass) {
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+	EndGpuPass(Profiler::GPU_SHADING);
 
-		// Glass jar + lid
-		{ MeshType::Cylinder,{ 1.5f, 3.5f, 1.5f},  { 0.0f, 0.0f,   0.0f}, { 6.0f, 0.1f,    0.0f}, "glass",   "jar" },
-		{ MeshType::Cylinder,{ 1.0f, 0.3f, 1.0f},  { 0.0f, 0.0f,   0.0f}, { 6.0f, 3.5f,    0.0f}, "plastic", "Lid" },
+	BeginGpuPass(Profiler::GPU_TRANSPARENT);
+	DrawTransparentObjects();
+	EndGpuPass(Profiler::GPU_TRANSPARENT);
+}
 
-		// Painting (thin box)
-		{ MeshType::Box,     { 3.5f, 0.01f, 5.5f}, {90.0f,180.0f,  0.0f}, { 6.0f, 8.5f,  -10.0f}, "plastic", "painting" },
+/***********************************************************
+ *  BeginGpuPass() / EndGpuPass()
+ *
+ *  These methods are used for timing a render pass on the GPU
+ *  with the profiler, when the scene has one.
+ ***********************************************************/
+void SceneManager::BeginGpuPass(Profiler::GpuPass pass)
+{
+	if (m_pProfiler != NULL) {
+		m_pProfiler->BeginGpuPass(pass);
+	}
+}
 
-		// Pasta boxes
-		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 80.0f,  0.0f}, { 3.0f, 0.3f,   5.5f}, "plastic", "pasta" },
-		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 65.0f,  0.0f}, { 3.0f, 0.6f,   5.5f}, "plastic", "pasta" },
-		{ MeshType::Box,     { 1.5f, 0.4f, 3.0f},  { 0.0f, 65.0f,  0.0f}, { 3.0f, 1.0f,   5.5f}, "plastic", "pasta" },
+void SceneManager::EndGpuPass(Profiler::GpuPass pass)
+{
+	if (m_pProfiler != NULL) {
+		m_pProfiler->EndGpuPass(pass);
+	}
+}
+
+/***********************************************************
+ *  DrawOpaqueObjects()
+ *
+ *  This method is used for drawing the opaque objects, the
+ *  static objects in view first and then the culled dynamic
+ *  objects.
+ *  The depth pre-pass draws every object with the one depth
+ *  only variant, so it switches no shader state at all.
+ ***********************************************************/
+void SceneManager::DrawOpaqueObjects(bool bDepthOnly)
+{
+	// the lit variants are used once the scene has light sources
+	const unsigned int sceneFeatures = m_bUseLighting ? ShaderVariants::FEATURE_LIT : 0;
+	auto passFeatures = [sceneFeatures, bDepthOnly](unsigned int features) {
+		return(bDepthOnly ? (unsigned int)ShaderVariants::FEATURE_DEPTH_ONLY : (features | sceneFeatures));
 	};
 
-	// Draw all our objects
-	for (const auto& c : cmds) {
-		drawOne(c);
+	// draw the baked static objects in view first, one call per
+	// batch over the ranges of the objects the CPU found in view,
+	// or over the commands the GPU culling filled in
+	const bool bGpuCulled = m_gpuCuller.IsAvailable();
+	for (const STATIC_GROUP& group : m_staticGroups) {
+		const int previousShader = m_renderState.shader;
+		if ((bGpuCulled ? !m_culler.IsBoxVisible(group.boundsCenter, group.boundsExtents) : (group.drawCount == 0)) ||
+			!UseShaderVariant(passFeatures(group.features))) {
+			continue;
+		}
+		if (m_renderState.shader != previousShader) {
+			m_pUniforms->SetBool(UniformCache::USE_INSTANCING, true);
+		}
+
+		// the batch binds its own vertex array, so the next
+		// instanced draw counts its mesh as changed
+		m_renderState.mesh = -1;
+		m_frameStats.stateChanges++;
+
+		if (bGpuCulled) {
+			m_basicMeshes->DrawStaticIndirect(group.batch, m_gpuCuller.GetCommandBuffer(),
+				group.firstCommand, group.commandCount);
+		}
+		else {
+			m_basicMeshes->DrawStaticRanges(group.batch, m_staticDrawCounts.data() + group.firstDraw,
+				m_staticDrawOffsets.data() + group.firstDraw, group.drawCount);
+		}
+		m_frameStats.drawCalls++;
+	}
+
+	// the GPU culled objects are drawn with one indirect call per
+	// shader variant, which replaces the batching below
+	if (bGpuCulled) {
+		for (const GPU_DRAW_GROUP& group : m_gpuGroups) {
+			const int previousShader = m_renderState.shader;
+			if (!UseShaderVariant(passFeatures(group.features))) {
+				continue;
+			}
+			if (m_renderState.shader != previousShader) {
+				m_pUniforms->SetBool(UniformCache::USE_INSTANCING, true);
+			}
+			m_renderState.mesh = -1;
+			m_frameStats.stateChanges++;
+
+			m_basicMeshes->DrawIndirect(m_gpuCuller.GetInstanceBuffer(), m_gpuCuller.GetCommandBuffer(),
+				group.firstCommand, group.commandCount);
+			m_frameStats.drawCalls++;
+		}
+		return;
+	}
+
+	// Draw all our objects from the retained draw list - the
+	// sorted list stores objects with the same state next to
+	// each other, and each run is drawn with one instanced call
+	// from the instances the workers filled in, one call for each
+	// level of detail the run uses
+	for (const FRAME_BATCH& frameBatch : m_frameBatches) {
+		const SCENE_OBJECT& batch = m_sceneObjects[frameBatch.first];
+
+		int batchInstances = 0;
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			batchInstances += frameBatch.instanceCount[lod];
+		}
+
+		// a batch that is entirely outside the frustum sets no
+		// state, neither does one whose variant does not compile
+		const unsigned int batchFeatures = passFeatures((unsigned int)(batch.sortKey >> 56));
+		const int previousShader = m_renderState.shader;
+		if ((batchInstances == 0) || !UseShaderVariant(batchFeatures)) {
+			continue;
+		}
+
+		// the model matrices, materials and textures of a batch
+		// come from the instance attributes
+		if (m_renderState.shader != previousShader) {
+			m_pUniforms->SetBool(UniformCache::USE_INSTANCING, true);
+		}
+
+		// the mesh vertex array is bound by the draw call, but
+		// a change of mesh is still tracked as a state change
+		if (m_renderState.mesh != (int)batch.type) {
+			m_renderState.mesh = (int)batch.type;
+			m_frameStats.stateChanges++;
+		}
+		else {
+			m_frameStats.skippedStateChanges++;
+		}
+
+		for (int lod = 0; lod < MeshManager::LOD_COUNT; lod++) {
+			if (frameBatch.instanceCount[lod] == 0) {
+				continue;
+			}
+			if (m_ringFirstInstance >= 0) {
+				m_basicMeshes->DrawMeshInstances(batch.type, m_instanceRing.GetBuffer(),
+					m_ringFirstInstance + frameBatch.instanceOffset[lod], frameBatch.instanceCount[lod], lod);
+			}
+			else {
+				m_basicMeshes->DrawMeshInstanced(batch.type, m_instanceData.data() + frameBatch.instanceOffset[lod],
+					frameBatch.instanceCount[lod], lod);
+			}
+			m_frameStats.drawCalls++;
+		}
+	}
+}
+
+/***********************************************************
+ *  CollectTransparentObjects()
+ *
+ *  This method is used for culling the transparent objects,
+ *  which are the tail of the sorted draw list, and sorting the
+ *  ones in view from the farthest to the nearest.  There are
+ *  few of them, so this stays on the thread with the context
+ *  whether the opaque objects are culled on the CPU or the GPU.
+ ***********************************************************/
+int SceneManager::CollectTransparentObjects()
+{
+	m_transparentDraws.clear();
+
+	const glm::vec3 cameraPosition = m_frameData.viewPosition;
+	for (int index = GetOpaqueCount(); index < (int)m_sceneObjects.size(); index++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[index];
+		if (!m_culler.IsBoxVisible(object.boundsCenter, object.boundsExtents))
+		{
+			continue;
+		}
+
+		glm::vec3 offset = object.boundsCenter - cameraPosition;
+		TRANSPARENT_DRAW draw;
+		draw.distance = glm::dot(offset, offset);
+		draw.index = index;
+		m_transparentDraws.push_back(draw);
 	}
+
+	std::sort(m_transparentDraws.begin(), m_transparentDraws.end(),
+		[](const TRANSPARENT_DRAW& a, const TRANSPARENT_DRAW& b) {
+			return(a.distance > b.distance);
+		});
+
+	return((int)m_transparentDraws.size());
 }
 
+/***********************************************************
+ *  DrawTransparentObjects()
+ *
+ *  This method is used for blending the transparent objects
+ *  over the frame in their back to front order.  Blending is
+ *  only turned on for this pass, and the depth is tested but
+ *  not written, so a transparent object never hides the ones
+ *  drawn after it.  Neighbours in the order that share their
+ *  shader variant and mesh are drawn with one instanced call,
+ *  which draws its instances in order.
+ ***********************************************************/
+void SceneManager::DrawTransparentObjects()
+{
+	if (m_transparentDraws.empty())
+	{
+		return;
+	}
+
+	const unsigned int sceneFeatures = m_bUseLighting ? ShaderVariants::FEATURE_LIT : 0;
+	const uint64_t batchMask = ~(MATERIAL_KEY_MASK | TEXTURE_KEY_MASK);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+
+	size_t first = 0;
+	while (first < m_transparentDraws.size())
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[m_transparentDraws[first].index];
+		const uint64_t runKey = object.sortKey & batchMask;
+
+		m_transparentInstances.clear();
+		size_t last = first;
+		while ((last < m_transparentDraws.size()) &&
+			((m_sceneObjects[m_transparentDraws[last].index].sortKey & batchMask) == runKey))
+		{
+			const SCENE_OBJECT& runObject = m_sceneObjects[m_transparentDraws[last].index];
+			MeshManager::INSTANCE_DATA instance;
+			instance.model = runObject.model;
+			instance.materialIndex = runObject.materialIndex;
+			instance.textureIndex = runObject.textureLayer;
+			m_transparentInstances.push_back(instance);
+			last++;
+		}
+		first = last;
+
+		const unsigned int features = (unsigned int)((runKey >> 56) & 0x7F) | sceneFeatures;
+		const int previousShader = m_renderState.shader;
+		if (!UseShaderVariant(features))
+		{
+			continue;
+		}
+		if (m_renderState.shader != previousShader)
+		{
+			m_pUniforms->SetBool(UniformCache::USE_INSTANCING, true);
+		}
+		if (m_renderState.mesh != (int)object.type)
+		{
+			m_renderState.mesh = (int)object.type;
+			m_frameStats.stateChanges++;
+		}
+		else
+		{
+			m_frameStats.skippedStateChanges++;
+		}
+
+		m_basicMeshes->DrawMeshInstanced(object.type, m_transparentInstances.data(), (int)m_transparentInstances.size());
+		m_frameStats.drawCalls++;
+	}
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+}
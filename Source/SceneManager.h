@@ -10,9 +10,27 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "AssetPack.h"
+#include "BoundingVolumeHierarchy.h"
+#include "FileWatcher.h"
+#include "FrameRing.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "MeshManager.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "ShaderVariants.h"
+#include "ShadowMaps.h"
+#include "TextureManager.h"
+#include "TransformBatch.h"
+#include "UniformBuffer.h"
+#include "UniformCache.h"
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -29,22 +47,32 @@ public:
 	// destructor
 	~SceneManager();
 
-	struct TEXTURE_INFO
-	{
-		std::string tag;
-		uint32_t ID;
-	};
-
 	struct OBJECT_MATERIAL
 	{
 		glm::vec3 diffuseColor;
 		glm::vec3 specularColor;
 		float shininess;
+		bool bTransparent;       // blended over the opaque objects
 		std::string tag;
 	};
 
+	// LIGHT_SOURCE struct holds the settings of one light source
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 direction;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		float focalStrength;
+		float specularIntensity;
+		float range;             // radius of a clustered point light, 0 lights everything
+		bool bUseDirection;
+		bool bActive;
+	};
+
 	// MeshType enum used for templated draw command methods
-	enum class MeshType { Plane, Sphere, Cylinder, Box };
+	typedef MeshManager::MeshType MeshType;
 
 	// DrawCmd struct used for templated draw command methods, leading to cleaner code.
 	struct DrawCmd {
@@ -56,29 +84,237 @@ public:
 		const char* texture;
 	};
 
+	// SCENE_OBJECT struct holds a retained draw list entry with all of
+	// its per-draw state resolved once at insert time
+	struct SCENE_OBJECT {
+		MeshType type;
+		glm::mat4 model;         // cached model matrix
+		int materialIndex;       // index into m_objectMaterials, -1 if none
+		int textureIndex;        // index of the loaded texture, -1 if none
+		int textureLayer;        // texture array layer the shaders sample
+		int handle;              // handle returned from AddObject()
+		uint64_t sortKey;        // (shader, mesh, material, texture) draw order key
+		bool bStatic;            // baked into a static batch
+		bool bTransparent;       // drawn back to front after the opaque objects
+		int lod;                 // level of detail it was last drawn with
+		glm::vec3 boundsCenter;  // world bounding box center
+		glm::vec3 boundsExtents; // world bounding box half extents
+	};
+
+	// FRAME_STATS struct holds the render queue counters for the last frame
+	struct FRAME_STATS {
+		int drawCalls;           // number of issued draw calls
+		int stateChanges;        // shader state actually changed between draws
+		int skippedStateChanges; // redundant state changes that were skipped
+		int culledObjects;       // objects outside the camera frustum or
+		                         // hidden, read back a few frames late
+		                         // when culled on the GPU and -1 until
+		                         // the first count arrives
+		int shadowUpdates;       // lights whose shadow maps were rendered
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	MeshManager* m_basicMeshes;
+	// specialized variants of the scene shaders
+	ShaderVariants m_shaderVariants;
+	// cached uniform locations of the shader variant in use
+	UniformCache* m_pUniforms;
+	// profiler timing the render passes, NULL if they are not timed
+	Profiler* m_pProfiler;
+	// true when the scene is shaded with the light sources
+	bool m_bUseLighting;
+	// pointer to the texture manager holding the texture arrays
+	TextureManager* m_pTextureManager;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// maps a hashed material tag to its index in m_objectMaterials,
+	// tags sharing a hash each keep an entry
+	std::unordered_multimap<uint32_t, int> m_materialIndex;
+	// defined light sources
+	std::vector<LIGHT_SOURCE> m_lights;
+	// point lights binned into view-space clusters for the shader
+	LightClusters m_lightClusters;
+	// per-frame uniform block and the values of the next frame
+	UniformBuffer m_frameBuffer;
+	UniformBuffer::FRAME_BLOCK m_frameData;
+	// uniform block holding the material table
+	UniformBuffer m_materialBuffer;
+	// mapped regions the per-frame block and the instances of each
+	// frame are written into while the GPU draws the previous frames
+	FrameRing m_frameRing;
+	FrameRing m_instanceRing;
+	// first instance of the current frame in the instance ring, -1
+	// when the instances are streamed from m_instanceData instead
+	int m_ringFirstInstance;
+	// mapped asset pack the scene was loaded from, kept open while
+	// the textures upload from it
+	AssetPack m_assetPack;
+	// retained draw list of scene objects
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// maps an object handle to its index in m_sceneObjects, -1 if removed
+	std::vector<int> m_handleToIndex;
+	// handles released by RemoveObject() available for reuse
+	std::vector<int> m_freeHandles;
+	// transform values and model matrices of the objects by handle
+	TransformBatch m_transforms;
+	// true when object transforms changed since they were composed
+	bool m_bTransformsDirty;
+	// true when the draw list needs to be re-sorted before rendering
+	bool m_bDrawOrderDirty;
+	// packed world bounds of the draw list, in draw list order
+	FrustumCuller m_culler;
+	// visibility flag of each object in the draw list
+	std::vector<unsigned char> m_visible;
+	// true when the packed bounds no longer match the draw list
+	bool m_bBoundsDirty;
+	// true once a camera frustum has been set for culling
+	bool m_bCullingEnabled;
+	// hierarchy over the object bounds by handle, used for picking
+	// and for culling large scenes
+	BoundingVolumeHierarchy m_bvh;
+	// handles of the objects found by the last hierarchy query
+	std::vector<int> m_queryResults;
+	// STATIC_GROUP struct holds the static objects baked into one
+	// batch, which share a shader variant and a texture array
+	struct STATIC_GROUP {
+		unsigned int features;   // shader variant bits of the objects
+		int textureArray;        // texture array slot, -1 for none
+		int batch;               // static batch id in the mesh manager
+		glm::vec3 boundsCenter;  // world bounds of all of the objects
+		glm::vec3 boundsExtents;
+		int firstObject;         // first entry in m_staticHandles
+		int objectCount;
+		int firstDraw;           // first visible range in m_staticDrawCounts
+		int drawCount;
+		int firstCommand;        // first indirect command of the objects
+		int commandCount;
+	};
+	// baked groups of the static objects
+	std::vector<STATIC_GROUP> m_staticGroups;
+	// handles of the static objects in the order of their groups,
+	// and the index ranges of each in its batch, LOD_COUNT per
+	// object
+	std::vector<int> m_staticHandles;
+	std::vector<MeshManager::STATIC_RANGE> m_staticRanges;
+	// index counts and byte offsets of the static ranges in view,
+	// with the neighbouring ranges of a group merged
+	std::vector<GLsizei> m_staticDrawCounts;
+	std::vector<const GLvoid*> m_staticDrawOffsets;
+	// true when the static batches no longer match their objects
+	bool m_bStaticBatchesDirty;
+	// culls the opaque objects and draws them with indirect
+	// commands when the GPU supports it
+	GpuCuller m_gpuCuller;
+	// GPU_DRAW_GROUP struct is a range of indirect draw commands
+	// that share a shader variant
+	struct GPU_DRAW_GROUP {
+		unsigned int features;
+		int firstCommand;
+		int commandCount;
+	};
+	// indirect draw commands by shader variant
+	std::vector<GPU_DRAW_GROUP> m_gpuGroups;
+	// Hi-Z pyramid of the static scenery the GPU culled objects are
+	// tested against
+	OcclusionCuller m_occlusionCuller;
+	// cached shadow maps of the global lights
+	ShadowMaps m_shadowMaps;
+	// dynamic casters of the light being refreshed, by mesh
+	std::vector<MeshManager::INSTANCE_DATA> m_shadowCasters[MeshManager::MESH_COUNT];
+	// true when the objects on the GPU no longer match the draw list
+	bool m_bGpuObjectsDirty;
+	// index of each object in the GPU culler by handle, -1 for the
+	// objects it does not cull
+	std::vector<int> m_gpuObjectIndices;
+
+	// watches the shader and texture files for hot reloading
+	FileWatcher m_fileWatcher;
+	// texture of each watch id, -1 for the shader files
+	std::vector<int> m_watchedTextures;
+	// watch ids of the files changed since the last frame
+	std::vector<int> m_changedFiles;
+
+	// RENDER_STATE struct tracks the state set by the previous draw,
+	// -1 means the value is unknown and has to be sent
+	struct RENDER_STATE {
+		int shader;
+		int mesh;
+		int textureIndex;
+		int materialIndex;
+	};
+	// shader state left behind by the previous draw
+	RENDER_STATE m_renderState;
+	// render queue counters for the current frame
+	FRAME_STATS m_frameStats;
+	// per-instance data of the frame, one slice per batch, when
+	// there is no instance ring
+	std::vector<MeshManager::INSTANCE_DATA> m_instanceData;
+	// spreads the culling and the instance building of each frame
+	// over the CPU cores
+	JobSystem m_jobs;
+	// FRAME_BATCH struct is a run of the draw list drawn with one call
+	// for each level of detail its instances use
+	struct FRAME_BATCH {
+		int first;               // first object in the draw list
+		int instanceOffset[MeshManager::LOD_COUNT]; // first instance of each level
+		int instanceCount[MeshManager::LOD_COUNT];
+	};
+	// FRAME_TASK struct is a part of a batch culled and filled in
+	// by one job
+	struct FRAME_TASK {
+		int first;               // draw list range of the job
+		int last;
+		int batch;               // batch the objects belong to
+		int visibleCount;        // objects in view
+		int instanceCount[MeshManager::LOD_COUNT];  // instances written of each level
+		int instanceOffset[MeshManager::LOD_COUNT]; // first instance of each level
+	};
+	// pixels covered on screen by one world unit at a distance of one
+	// unit, 0 until a camera is set
+	float m_lodScale;
+	// batches and jobs of the current frame
+	std::vector<FRAME_BATCH> m_frameBatches;
+	std::vector<FRAME_TASK> m_frameTasks;
+	// true when the opaque objects are drawn depth only first and
+	// then shaded where their depth is equal
+	bool m_bDepthPrepass;
+	// frames rendered since the textures last got their size
+	// requests
+	int m_streamingFrames;
+	// TRANSPARENT_DRAW struct is a transparent object in view
+	struct TRANSPARENT_DRAW {
+		float distance;          // squared distance from the camera
+		int index;               // index in the draw list
+	};
+	// transparent objects in view, farthest first
+	std::vector<TRANSPARENT_DRAW> m_transparentDraws;
+	// instances of one transparent draw call
+	std::vector<MeshManager::INSTANCE_DATA> m_transparentInstances;
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
+	bool CreateGLTexture(const char* filename, const char* tag);
+	// upload and bind the loaded OpenGL textures
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureIndex(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const char* tag);
+	// rebuild the tag index over the defined materials
+	void BuildMaterialIndex();
+
+	// build the model matrix from the transformation values
+	glm::mat4 ComposeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -88,6 +324,8 @@ private:
 		float YrotationDegrees,
 		float ZrotationDegrees,
 		glm::vec3 positionXYZ);
+	void SetTransformations(
+		const glm::mat4& modelView);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -98,7 +336,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
+	void SetShaderTextureIndex(
+		int textureIndex);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -106,7 +346,73 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
+
+	// build the draw order key for a scene object
+	static uint64_t MakeSortKey(
+		int shader,
+		MeshType type,
+		int textureIndex,
+		int materialIndex,
+		bool bTransparent);
+	// sort the draw list by its draw order keys
+	void SortDrawList();
+	// get the number of opaque objects, which come first in the draw list
+	int GetOpaqueCount() const;
+	// forget the tracked shader state so the next draw sends it all
+	void InvalidateRenderState();
+	// switch to the shader variant with the passed in features,
+	// returns false if the variant is not available
+	bool UseShaderVariant(unsigned int features);
+	// set the values that never change into a new shader variant
+	void InitializeShaderVariant();
+	// copy the object bounds into the packed culling arrays
+	void UpdateCullingBounds();
+	// compose the changed object transforms and update their bounds
+	void UpdateTransforms();
+	// update the object texture layers after textures finished loading
+	void RefreshTextureLayers();
+	// ask for the texture levels the objects in view need and
+	// stream them in
+	void UpdateTextureStreaming();
+	// reload the shaders and textures whose files changed
+	void ProcessReloads();
+	// bake the static objects into one batch per shader variant
+	// and texture array
+	void BuildStaticBatches();
+	// collect the index ranges of the static objects in view
+	void BuildStaticDraws();
+	// cull the draw list and fill in the instances on all cores,
+	// returns the number of objects in view
+	int BuildFrameInstances();
+	// upload the opaque objects and their draw commands for GPU culling
+	void UploadGpuObjects();
+	// draw the static batches in view into the occlusion pyramid
+	void RenderOccluders();
+	// render the shadow maps of the lights whose casters changed
+	void RenderShadows();
+	// time a render pass on the GPU when there is a profiler
+	void BeginGpuPass(Profiler::GpuPass pass);
+	void EndGpuPass(Profiler::GpuPass pass);
+	// draw the opaque objects, with the depth only variant for the
+	// depth pre-pass
+	void DrawOpaqueObjects(bool bDepthOnly);
+	// cull the transparent objects and sort them back to front,
+	// returns the number of them in view
+	int CollectTransparentObjects();
+	// blend the sorted transparent objects over the frame
+	void DrawTransparentObjects();
+
+	// load the whole scene from an asset pack
+	bool LoadScenePack(const char* filename);
+	// add the objects of the scene description to the draw list
+	void AddSceneObjects();
+	// pass the defined light sources into the shader
+	void ApplySceneLights();
+	// upload the defined materials into the material table
+	void ApplySceneMaterials();
 
 public:
 
@@ -115,6 +421,67 @@ public:
 	void PrepareScene();
 	void RenderScene();
 
+	// add an object to the retained draw list, returns its handle
+	int AddObject(const DrawCmd& cmd);
+	// remove a previously added object from the draw list
+	bool RemoveObject(int handle);
+	// move a previously added object to a new transformation
+	bool SetObjectTransform(int handle, const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& translation);
+
+	// find the closest object whose bounds the ray hits, returns
+	// its handle or -1
+	int PickObject(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+	// find the object whose bounds are closest to a point, returns
+	// its handle or -1 if none is within the distance
+	int FindNearestObject(const glm::vec3& point, float maxDistance, float& distance);
+
+	// start a frame, waiting for the GPU to finish the frame that
+	// last used its ring regions, returns true if it had to wait
+	bool BeginFrame();
+	// fence the commands of the frame after it was rendered
+	void EndFrame();
+
+	// set the camera matrices the objects are culled against
+	void SetViewProjection(const glm::mat4& view, const glm::mat4& projection);
+
+	// write the scene description into an asset pack, NULL
+	// writes the default scene pack
+	bool WriteScenePack(const char* filename);
+
+	// mark every object in the draw list as static, so it is drawn
+	// from the baked batches until it is moved, returns the number
+	// of objects marked
+	int BakeStaticObjects();
+
+	// add a grid of generated boxes to the draw list
+	void AddSyntheticObjects(int boxCount);
+	// add generated point lights to the scene
+	void AddSyntheticLights(int lightCount);
+	// block until every scene texture is resident
+	void WaitForTextures();
+	// watch the shader and texture files and reload them when
+	// they change on disk
+	void EnableHotReload();
+	// get the number of objects in the draw list
+	int GetObjectCount() const { return((int)m_sceneObjects.size()); }
+	// get the number of defined light sources
+	int GetLightCount() const { return((int)m_lights.size()); }
+
+	// get the render queue counters of the last rendered frame
+	const FRAME_STATS& GetFrameStats() const { return(m_frameStats); }
+	// true when the scene changed since the last frame, or textures
+	// are still loading into it
+	bool HasPendingChanges();
+
+	// draw the opaque objects depth only before shading them, so
+	// each pixel is shaded once however many objects overlap it
+	void SetDepthPrepass(bool bEnabled) { m_bDepthPrepass = bEnabled; }
+	bool IsDepthPrepassEnabled() const { return(m_bDepthPrepass); }
+
+	// time each render pass of the scene with a profiler, NULL to
+	// stop timing them
+	void SetProfiler(Profiler* pProfiler) { m_pProfiler = pProfiler; }
+
 	// loads textures from image files
 	void LoadSceneTextures();
 
@@ -122,4 +489,4 @@ public:
 	void SetupSceneLights();
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
-};
\ No newline at end of file
+};
@@ -0,0 +1,380 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+// ============
+// compile and cache the specialized variants of the scene shaders
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderVariants.h"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	/***********************************************************
+	 *  ReadTextFile()
+	 *
+	 *  This function is used for reading a whole text file into
+	 *  a string, returns false if it cannot be read.
+	 ***********************************************************/
+	bool ReadTextFile(const char* filename, std::string& text)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (file == NULL)
+		{
+			std::cout << "Could not open shader:" << filename << std::endl;
+			return false;
+		}
+
+		text.clear();
+		char buffer[4096];
+		size_t count = 0;
+		while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			text.append(buffer, count);
+		}
+		fclose(file);
+
+		return(!text.empty());
+	}
+}
+
+/***********************************************************
+ *  ShaderVariants()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderVariants::ShaderVariants()
+{
+	m_cachedVariantCount = 0;
+}
+
+/***********************************************************
+ *  ~ShaderVariants()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderVariants::~ShaderVariants()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the vertex and fragment
+ *  shader files the variants are built from.  No variant is
+ *  compiled until it is asked for.
+ ***********************************************************/
+bool ShaderVariants::Load(const char* vertexFile, const char* fragmentFile)
+{
+	Destroy();
+
+	m_vertexFile = vertexFile;
+	m_fragmentFile = fragmentFile;
+	return(ReadTextFile(vertexFile, m_vertexSource) &&
+		ReadTextFile(fragmentFile, m_fragmentSource));
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the compiled variants.
+ ***********************************************************/
+void ShaderVariants::Destroy()
+{
+	for (VARIANT& variant : m_variants)
+	{
+		glDeleteProgram(variant.program);
+	}
+	m_variants.clear();
+	m_slots.clear();
+	m_cachedVariantCount = 0;
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for finding the slot of a variant.  A
+ *  variant that was not asked for before is loaded from the
+ *  binary cache, or compiled and linked and then saved into
+ *  the cache, and its uniforms are resolved.  A variant that
+ *  failed is not compiled again.
+ ***********************************************************/
+int ShaderVariants::GetVariant(unsigned int features, int globalLightCount, bool* pbCreated)
+{
+	if (pbCreated != NULL)
+	{
+		*pbCreated = false;
+	}
+
+	// the light count only matters to the lit variants, and too many
+	// lights fall back to the loop over the count in the frame block
+	if (((features & FEATURE_LIT) == 0) || (globalLightCount > MAX_UNROLLED_LIGHTS))
+	{
+		globalLightCount = -1;
+	}
+	uint32_t key = (uint32_t)features | ((uint32_t)(globalLightCount + 1) << 8);
+
+	std::unordered_map<uint32_t, int>::const_iterator it = m_slots.find(key);
+	if (it != m_slots.end())
+	{
+		return(it->second);
+	}
+
+	GLuint program = CreateProgram(key);
+	if (program == 0)
+	{
+		m_slots[key] = -1;
+		return(-1);
+	}
+
+	int slot = (int)m_variants.size();
+	m_variants.push_back(VARIANT());
+	m_variants[slot].key = key;
+	m_variants[slot].program = program;
+	m_variants[slot].uniforms.Resolve(program);
+	m_slots[key] = slot;
+
+	if (pbCreated != NULL)
+	{
+		*pbCreated = true;
+	}
+
+	return(slot);
+}
+
+/***********************************************************
+ *  Reload()
+ *
+ *  This method is used for rebuilding the variants after the
+ *  shader files changed on disk.  The slots stay the same, so
+ *  the draw order keys remain valid, and a variant only swaps
+ *  to its new program once that program has linked - a shader
+ *  with an error leaves the scene drawing with the old one.
+ *  Variants that failed before are tried again on their next
+ *  use.
+ ***********************************************************/
+bool ShaderVariants::Reload(std::vector<int>& rebuiltSlots)
+{
+	rebuiltSlots.clear();
+
+	std::string vertexSource;
+	std::string fragmentSource;
+	if (!ReadTextFile(m_vertexFile.c_str(), vertexSource) ||
+		!ReadTextFile(m_fragmentFile.c_str(), fragmentSource))
+	{
+		return false;
+	}
+	m_vertexSource.swap(vertexSource);
+	m_fragmentSource.swap(fragmentSource);
+
+	for (int slot = 0; slot < (int)m_variants.size(); slot++)
+	{
+		VARIANT& variant = m_variants[slot];
+		GLuint program = CreateProgram(variant.key);
+		if (program == 0)
+		{
+			continue;
+		}
+
+		glDeleteProgram(variant.program);
+		variant.program = program;
+		variant.uniforms.Resolve(program);
+		rebuiltSlots.push_back(slot);
+	}
+
+	for (std::unordered_map<uint32_t, int>::iterator it = m_slots.begin(); it != m_slots.end();)
+	{
+		if (it->second < 0)
+		{
+			it = m_slots.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for getting the linked program of a
+ *  variant key, either from the binary cache or by compiling
+ *  and linking the sources with the defines of the variant
+ *  and then saving it into the cache.
+ ***********************************************************/
+GLuint ShaderVariants::CreateProgram(uint32_t key)
+{
+	// the key holds the features in its low byte and the light
+	// count plus one above them
+	std::string defines = MakeDefines(key & 0xFF, (int)(key >> 8) - 1);
+	std::string vertexSource = AddDefines(m_vertexSource, defines);
+	std::string fragmentSource = AddDefines(m_fragmentSource, defines);
+
+	// the cached binary is keyed by the final sources, so editing a
+	// shader file or changing the defines never loads a stale one
+	uint64_t cacheKey = m_binaryCache.MakeKey(vertexSource, fragmentSource);
+	GLuint program = m_binaryCache.Load(cacheKey);
+	if (program != 0)
+	{
+		m_cachedVariantCount++;
+	}
+	else
+	{
+		program = BuildProgram(vertexSource, fragmentSource);
+		if (program != 0)
+		{
+			m_binaryCache.Save(cacheKey, program);
+		}
+	}
+
+	if (program == 0)
+	{
+		std::cout << "ERROR: shader variant is disabled:" << std::endl << defines << std::endl;
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  ReadShaderFile()
+ *
+ *  This method is used for reading a shader file for the
+ *  programs that are built outside of the variants.
+ ***********************************************************/
+bool ShaderVariants::ReadShaderFile(const char* filename, std::string& source)
+{
+	return(ReadTextFile(filename, source));
+}
+
+/***********************************************************
+ *  MakeDefines()
+ *
+ *  This method is used for building the #define lines that
+ *  select the features of a variant in the shader sources.
+ ***********************************************************/
+std::string ShaderVariants::MakeDefines(unsigned int features, int globalLightCount)
+{
+	std::string defines;
+
+	if ((features & FEATURE_TEXTURED) != 0)
+	{
+		defines += "#define VARIANT_TEXTURED\n";
+	}
+	if ((features & FEATURE_LIT) != 0)
+	{
+		defines += "#define VARIANT_LIT\n";
+	}
+	if ((features & FEATURE_DEPTH_ONLY) != 0)
+	{
+		defines += "#define VARIANT_DEPTH_ONLY\n";
+	}
+	if (globalLightCount >= 0)
+	{
+		defines += "#define VARIANT_GLOBAL_LIGHTS " + std::to_string(globalLightCount) + "\n";
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  AddDefines()
+ *
+ *  This method is used for placing the defines of a variant
+ *  right after the #version line, which has to stay the first
+ *  line of the source.
+ ***********************************************************/
+std::string ShaderVariants::AddDefines(const std::string& source, const std::string& defines)
+{
+	size_t versionEnd = 0;
+	if (source.compare(0, 8, "#version") == 0)
+	{
+		versionEnd = source.find('\n');
+		versionEnd = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+	}
+
+	std::string header = source.substr(0, versionEnd);
+	if (!header.empty() && (header.back() != '\n'))
+	{
+		header += '\n';
+	}
+
+	return(header + defines + source.substr(versionEnd));
+}
+
+/***********************************************************
+ *  CompileStage()
+ *
+ *  This method is used for compiling one shader stage, the
+ *  compile log is printed when it fails.
+ ***********************************************************/
+GLuint ShaderVariants::CompileStage(GLenum stage, const std::string& source)
+{
+	const GLchar* pSource = source.c_str();
+	GLuint shader = glCreateShader(stage);
+	glShaderSource(shader, 1, &pSource, NULL);
+	glCompileShader(shader);
+
+	GLint bCompiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &bCompiled);
+	if (bCompiled != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "ERROR: shader failed to compile:" << std::endl << log << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	return(shader);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for compiling and linking a variant
+ *  from its sources.  The driver is told that the binary will
+ *  be read back, so that it can be saved into the cache.
+ ***********************************************************/
+GLuint ShaderVariants::BuildProgram(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	GLuint vertexShader = CompileStage(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CompileStage(GL_FRAGMENT_SHADER, fragmentSource);
+
+	GLuint program = 0;
+	if ((vertexShader != 0) && (fragmentShader != 0))
+	{
+		program = glCreateProgram();
+		if (m_binaryCache.IsEnabled())
+		{
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "ERROR: shader variant failed to link:" << std::endl << log << std::endl;
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+	// the linked program keeps the compiled code
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	return(program);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+// ============
+// compile and cache the specialized variants of the scene shaders
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ProgramBinaryCache.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderVariants
+ *
+ *  This class builds specialized programs from one pair of
+ *  shader files.  A variant is a set of features, each turned
+ *  into a #define placed after the #version line, so that the
+ *  compiler removes the code of the features a draw does not
+ *  use instead of branching on uniforms for every fragment.
+ *  The variants are compiled on first use and kept for the
+ *  life of the object, each with its own uniform cache, and
+ *  are known by a small slot number that fits the shader bits
+ *  of the draw order key.  With the binary cache turned on, a
+ *  variant that was linked in an earlier run is loaded from
+ *  its driver binary instead of being compiled.
+ ***********************************************************/
+class ShaderVariants
+{
+public:
+	// Feature enum holds the bits of a variant
+	enum Feature
+	{
+		FEATURE_TEXTURED = 1 << 0,   // VARIANT_TEXTURED, sample the object texture
+		FEATURE_LIT = 1 << 1,        // VARIANT_LIT, shade with the scene lights
+		FEATURE_DEPTH_ONLY = 1 << 2  // VARIANT_DEPTH_ONLY, write the depth only
+	};
+
+	// up to this many global lights the lit variants unroll their
+	// loop, scenes with more share a variant reading the count
+	static const int MAX_UNROLLED_LIGHTS = 8;
+
+	// constructor
+	ShaderVariants();
+	// destructor
+	~ShaderVariants();
+
+	// read the shader sources, removes the compiled variants
+	bool Load(const char* vertexFile, const char* fragmentFile);
+	// delete the compiled variants
+	void Destroy();
+	// read the shader files again and rebuild every variant from
+	// them, a variant that no longer builds keeps its old program -
+	// the slots that got a new program are listed, returns false
+	// when the files cannot be read
+	bool Reload(std::vector<int>& rebuiltSlots);
+	// keep the linked variants in a cache directory, needs a
+	// current GL context
+	void EnableBinaryCache(const char* directory) { m_binaryCache.Initialize(directory); }
+
+	// get the slot of a variant, compiling it on first use - the
+	// optional flag is set when the variant was just created, -1
+	// is returned when the variant does not compile
+	int GetVariant(unsigned int features, int globalLightCount, bool* pbCreated = NULL);
+	// get the program of a variant slot
+	GLuint GetProgram(int slot) const { return(m_variants[slot].program); }
+	// get the uniform cache of a variant slot
+	UniformCache& GetUniforms(int slot) { return(m_variants[slot].uniforms); }
+	// get the number of compiled variants
+	int GetVariantCount() const { return((int)m_variants.size()); }
+	// get the number of variants loaded from the binary cache
+	int GetCachedVariantCount() const { return(m_cachedVariantCount); }
+
+	// read a whole shader file, returns false if it cannot be read
+	static bool ReadShaderFile(const char* filename, std::string& source);
+	// compile one stage, 0 on failure
+	static GLuint CompileStage(GLenum stage, const std::string& source);
+
+private:
+	// VARIANT struct is one compiled program
+	struct VARIANT
+	{
+		uint32_t key;
+		GLuint program;
+		UniformCache uniforms;
+	};
+
+	// shader files the variants are built from
+	std::string m_vertexFile;
+	std::string m_fragmentFile;
+	// sources of the shader files
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	// compiled variants by slot, a deque keeps the uniform caches
+	// in place while more variants are added
+	std::deque<VARIANT> m_variants;
+	// maps a variant key to its slot, -1 for a variant that failed
+	std::unordered_map<uint32_t, int> m_slots;
+	// linked programs kept on disk between runs
+	ProgramBinaryCache m_binaryCache;
+	// number of variants loaded from the binary cache
+	int m_cachedVariantCount;
+
+	// load or compile the program of a variant key, 0 on failure
+	GLuint CreateProgram(uint32_t key);
+	// build the #define lines of a variant
+	static std::string MakeDefines(unsigned int features, int globalLightCount);
+	// place the defines right after the #version line of a source
+	static std::string AddDefines(const std::string& source, const std::string& defines);
+	// compile and link a program, 0 on failure
+	GLuint BuildProgram(const std::string& vertexSource, const std::string& fragmentSource) const;
+};
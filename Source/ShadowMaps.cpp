@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.cpp
+// ============
+// render and cache the shadow maps of the shadow casting point lights
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowMaps.h"
+#include "GpuMemory.h"
+#include "ShaderVariants.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <string>
+
+// declaration of the global variables and defines
+namespace
+{
+	// near plane of the shadow map faces
+	const float SHADOW_NEAR = 0.05f;
+	// slope scaled depth offset of the casters, which keeps lit
+	// surfaces from shadowing themselves
+	const float SHADOW_OFFSET_FACTOR = 2.0f;
+	const float SHADOW_OFFSET_UNITS = 4.0f;
+
+	// direction and up vector of each face, in the order the
+	// shader picks them by the major axis: +x, -x, +y, -y, +z, -z
+	const glm::vec3 FACE_DIRECTIONS[ShadowMaps::FACE_COUNT] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+	};
+	const glm::vec3 FACE_UPS[ShadowMaps::FACE_COUNT] = {
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+	};
+
+	/***********************************************************
+	 *  BuildProgram()
+	 *
+	 *  This function is used for building a program from a
+	 *  single shader file, returns 0 when it fails.
+	 ***********************************************************/
+	GLuint BuildProgram(GLenum stage, const char* filename)
+	{
+		std::string source;
+		if (!ShaderVariants::ReadShaderFile(filename, source))
+		{
+			return(0);
+		}
+		GLuint shader = ShaderVariants::CompileStage(stage, source);
+		if (shader == 0)
+		{
+			return(0);
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shader);
+		glLinkProgram(program);
+		glDetachShader(program, shader);
+		glDeleteShader(shader);
+
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "ERROR: " << filename << " failed to link:" << std::endl << log << std::endl;
+			glDeleteProgram(program);
+			return(0);
+		}
+
+		return(program);
+	}
+
+	/***********************************************************
+	 *  CreateAtlas()
+	 *
+	 *  This function is used for creating a depth atlas and the
+	 *  framebuffer drawing into it, returns false if the
+	 *  framebuffer is incomplete.
+	 ***********************************************************/
+	bool CreateAtlas(bool bCompare, GLuint& texture, GLuint& framebuffer)
+	{
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+			ShadowMaps::TILE_SIZE * ShadowMaps::FACE_COUNT, ShadowMaps::TILE_SIZE * ShadowMaps::MAX_LIGHTS,
+			0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+		// a 24-bit depth texel takes 4 bytes
+		GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, texture, GpuMemory::MEMORY_TARGETS,
+			(size_t)ShadowMaps::TILE_SIZE * ShadowMaps::FACE_COUNT * ShadowMaps::TILE_SIZE * ShadowMaps::MAX_LIGHTS * 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		// the live atlas compares in the sampler, and its linear
+		// filter blends four comparisons into every PCF tap
+		GLint filter = bCompare ? GL_LINEAR : GL_NEAREST;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		if (bCompare)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		GLint previousFramebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+		return(status == GL_FRAMEBUFFER_COMPLETE);
+	}
+}
+
+/***********************************************************
+ *  ShadowMaps()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowMaps::ShadowMaps()
+{
+	m_program = 0;
+	m_faceViewProjectionLocation = -1;
+	m_atlasTexture = 0;
+	m_atlasFramebuffer = 0;
+	m_staticTexture = 0;
+	m_staticFramebuffer = 0;
+	m_textureUnit = 0;
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		m_lights[i].position = glm::vec3(0.0f);
+		m_lights[i].farDistance = 0.0f;
+		m_lights[i].bStaticDirty = false;
+		m_lights[i].bDirty = false;
+	}
+	m_lightCount = 0;
+	for (int i = 0; i < MAX_LIGHTS * FACE_COUNT; i++)
+	{
+		m_blockData.faceMatrices[i] = glm::mat4(1.0f);
+	}
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		m_blockData.lights[i] = glm::vec4(0.0f);
+	}
+	m_blockData.tileScale = glm::vec2(1.0f / FACE_COUNT, 1.0f / MAX_LIGHTS);
+	m_blockData.lightCount = 0;
+	m_blockData.padding = 0;
+	m_bBlockDirty = false;
+	m_previousFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_previousViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ShadowMaps()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowMaps::~ShadowMaps()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the caster program and
+ *  creating the two atlases.  The shadow block is created
+ *  either way, so the scene shaders always have a buffer
+ *  behind it and simply see no shadow casting lights when
+ *  the atlases are missing.
+ ***********************************************************/
+bool ShadowMaps::Initialize(const char* vertexFile, int textureUnit)
+{
+	Destroy();
+
+	m_textureUnit = textureUnit;
+	m_block.Initialize(UniformBuffer::SHADOW_BINDING, sizeof(UniformBuffer::SHADOW_BLOCK));
+	m_block.Update(&m_blockData, sizeof(m_blockData));
+
+	GLuint program = BuildProgram(GL_VERTEX_SHADER, vertexFile);
+	if (program == 0)
+	{
+		return false;
+	}
+	m_program = program;
+	m_faceViewProjectionLocation = glGetUniformLocation(program, "faceViewProjection");
+
+	if (!CreateAtlas(true, m_atlasTexture, m_atlasFramebuffer) ||
+		!CreateAtlas(false, m_staticTexture, m_staticFramebuffer))
+	{
+		std::cout << "ERROR: the shadow map atlas is incomplete" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	BindTexture();
+	return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the program and the
+ *  atlases.  The shadow block is kept, with no lights in it,
+ *  until the class itself is freed.
+ ***********************************************************/
+void ShadowMaps::Destroy()
+{
+	if (m_staticFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_staticFramebuffer);
+	}
+	if (m_staticTexture != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_staticTexture);
+		glDeleteTextures(1, &m_staticTexture);
+	}
+	if (m_atlasFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_atlasFramebuffer);
+	}
+	if (m_atlasTexture != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_atlasTexture);
+		glDeleteTextures(1, &m_atlasTexture);
+	}
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+	}
+
+	m_program = 0;
+	m_atlasTexture = 0;
+	m_atlasFramebuffer = 0;
+	m_staticTexture = 0;
+	m_staticFramebuffer = 0;
+	m_lightCount = 0;
+	if (m_blockData.lightCount != 0)
+	{
+		m_blockData.lightCount = 0;
+		m_block.Update(&m_blockData, sizeof(m_blockData));
+	}
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the lights that cast
+ *  shadows.  Handing in the same lights again keeps their
+ *  shadow maps, so the lights can be set whenever the scene
+ *  lights are applied.
+ ***********************************************************/
+void ShadowMaps::SetLights(const glm::vec3* positions, const float* farDistances, int count)
+{
+	if (!IsAvailable())
+	{
+		return;
+	}
+
+	count = (count < MAX_LIGHTS) ? count : MAX_LIGHTS;
+	for (int i = 0; i < count; i++)
+	{
+		SHADOW_LIGHT& light = m_lights[i];
+		if ((i < m_lightCount) && (light.position == positions[i]) && (light.farDistance == farDistances[i]))
+		{
+			continue;
+		}
+
+		light.position = positions[i];
+		light.farDistance = farDistances[i];
+		light.bStaticDirty = true;
+		light.bDirty = true;
+		UpdateFaceMatrices(i);
+	}
+
+	if ((count != m_lightCount) || (m_blockData.lightCount != count))
+	{
+		m_lightCount = count;
+		m_blockData.lightCount = count;
+		m_bBlockDirty = true;
+	}
+}
+
+/***********************************************************
+ *  InvalidateStatic()
+ *
+ *  This method is used for rendering the static casters of
+ *  every light again, after the static batches were baked.
+ ***********************************************************/
+void ShadowMaps::InvalidateStatic()
+{
+	for (int i = 0; i < m_lightCount; i++)
+	{
+		m_lights[i].bStaticDirty = true;
+	}
+}
+
+/***********************************************************
+ *  InvalidateBounds()
+ *
+ *  This method is used for refreshing the lights whose range
+ *  reaches a box.  A moving caster invalidates its old and its
+ *  new bounds, so the shadow it leaves behind is cleared as
+ *  well.  Lights farther away keep their shadow maps.
+ ***********************************************************/
+void ShadowMaps::InvalidateBounds(const glm::vec3& center, const glm::vec3& extents)
+{
+	for (int i = 0; i < m_lightCount; i++)
+	{
+		SHADOW_LIGHT& light = m_lights[i];
+		if (light.bDirty)
+		{
+			continue;
+		}
+
+		// distance from the light to the closest point of the box
+		glm::vec3 offset = glm::max(glm::abs(light.position - center) - extents, glm::vec3(0.0f));
+		if (glm::dot(offset, offset) < light.farDistance * light.farDistance)
+		{
+			light.bDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginUpdate()
+ *
+ *  This method is used for starting the shadow pass.  The
+ *  bound framebuffer and viewport are kept so that the frame
+ *  carries on where it was drawing.
+ ***********************************************************/
+void ShadowMaps::BeginUpdate()
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+	glUseProgram(m_program);
+	glEnable(GL_SCISSOR_TEST);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS);
+	glDepthMask(GL_TRUE);
+}
+
+/***********************************************************
+ *  BeginStaticFace()
+ *
+ *  This method is used for clearing a face of the static
+ *  cache, which the static batches are then drawn into.
+ ***********************************************************/
+void ShadowMaps::BeginStaticFace(int slot, int face)
+{
+	SetTile(m_staticFramebuffer, slot, face);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  BeginFace()
+ *
+ *  This method is used for copying a face of the static cache
+ *  into the live atlas, which restores the shadows of the
+ *  static casters without drawing them.
+ ***********************************************************/
+void ShadowMaps::BeginFace(int slot, int face)
+{
+	SetTile(m_atlasFramebuffer, slot, face);
+
+	const int x = face * TILE_SIZE;
+	const int y = slot * TILE_SIZE;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFramebuffer);
+	glBlitFramebuffer(x, y, x + TILE_SIZE, y + TILE_SIZE, x, y, x + TILE_SIZE, y + TILE_SIZE,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  EndLight()
+ *
+ *  This method is used for marking the shadow map of a light
+ *  as current once all of its faces were drawn.
+ ***********************************************************/
+void ShadowMaps::EndLight(int slot)
+{
+	m_lights[slot].bStaticDirty = false;
+	m_lights[slot].bDirty = false;
+}
+
+/***********************************************************
+ *  EndUpdate()
+ *
+ *  This method is used for finishing the shadow pass and
+ *  uploading the face matrices of the lights that moved.
+ ***********************************************************/
+void ShadowMaps::EndUpdate()
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+
+	if (m_bBlockDirty)
+	{
+		m_block.Update(&m_blockData, sizeof(m_blockData));
+		m_bBlockDirty = false;
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding the live atlas to its
+ *  texture unit for the scene shaders.
+ ***********************************************************/
+void ShadowMaps::BindTexture() const
+{
+	if (m_atlasTexture == 0)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + m_textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  UpdateFaceMatrices()
+ *
+ *  This method is used for computing the view projection of
+ *  each face of a light, a square 90 degree frustum along the
+ *  axis of the face that reaches to the shadow distance.
+ ***********************************************************/
+void ShadowMaps::UpdateFaceMatrices(int slot)
+{
+	const SHADOW_LIGHT& light = m_lights[slot];
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR, light.farDistance);
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		glm::mat4 view = glm::lookAt(light.position, light.position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+		m_blockData.faceMatrices[slot * FACE_COUNT + face] = projection * view;
+	}
+	m_blockData.lights[slot] = glm::vec4(light.position, light.farDistance);
+	m_bBlockDirty = true;
+}
+
+/***********************************************************
+ *  SetTile()
+ *
+ *  This method is used for binding a framebuffer and limiting
+ *  the drawing and the clears to one tile of its atlas.
+ ***********************************************************/
+void ShadowMaps::SetTile(GLuint framebuffer, int slot, int face)
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(face * TILE_SIZE, slot * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+	glScissor(face * TILE_SIZE, slot * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+	glUniformMatrix4fv(m_faceViewProjectionLocation, 1, GL_FALSE,
+		glm::value_ptr(m_blockData.faceMatrices[slot * FACE_COUNT + face]));
+}
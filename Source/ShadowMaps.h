@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.h
+// ============
+// render and cache the shadow maps of the shadow casting point lights
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "UniformBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShadowMaps
+ *
+ *  This class keeps the shadow maps of a few point lights in
+ *  one depth atlas, a row of six tiles for each light with a
+ *  90 degree face along each axis.  The static casters of a
+ *  light are rendered into a second atlas of the same layout
+ *  that is only touched when the light or the static batches
+ *  change.  Refreshing a light copies its cached tiles into
+ *  the live atlas and draws the dynamic casters on top, and
+ *  a light is only refreshed when it moved or a dynamic
+ *  object within its range changed, so a still scene renders
+ *  no shadows at all.  The fragment shader filters the live
+ *  atlas with hardware depth comparisons and PCF.
+ ***********************************************************/
+class ShadowMaps
+{
+public:
+	// most lights with a shadow map and the faces of each
+	static const int MAX_LIGHTS = UniformBuffer::MAX_SHADOW_LIGHTS;
+	static const int FACE_COUNT = UniformBuffer::SHADOW_FACES;
+	// size of one face of a shadow map in texels
+	static const int TILE_SIZE = 256;
+
+	// constructor
+	ShadowMaps();
+	// destructor
+	~ShadowMaps();
+
+	// build the program and the atlases, the live atlas is bound to
+	// the texture unit, returns false when they cannot be created
+	bool Initialize(const char* vertexFile, int textureUnit);
+	// free the program, the atlases and the block
+	void Destroy();
+	// true when the shadow maps can be rendered
+	bool IsAvailable() const { return(m_program != 0); }
+
+	// set the lights casting shadows, the ones that moved or whose
+	// range changed are rendered again with their static casters
+	void SetLights(const glm::vec3* positions, const float* farDistances, int count);
+	// render the static casters of every light again
+	void InvalidateStatic();
+	// refresh the lights whose range reaches a box a dynamic caster
+	// was in or moved into
+	void InvalidateBounds(const glm::vec3& center, const glm::vec3& extents);
+
+	// get the number of lights with a shadow map
+	int GetLightCount() const { return(m_lightCount); }
+	// true when the shadow map of a light has to be refreshed
+	bool IsDirty(int slot) const { return(m_lights[slot].bDirty || m_lights[slot].bStaticDirty); }
+	// true when the static casters of a light have to be rendered
+	bool IsStaticDirty(int slot) const { return(m_lights[slot].bStaticDirty); }
+	// get the position and the shadow distance of a light
+	const glm::vec3& GetLightPosition(int slot) const { return(m_lights[slot].position); }
+	float GetFarDistance(int slot) const { return(m_lights[slot].farDistance); }
+
+	// keep the bound target and program and start the shadow pass
+	void BeginUpdate();
+	// draw the static casters drawn next into the cache of a face
+	void BeginStaticFace(int slot, int face);
+	// copy the cached face into the live atlas, the dynamic casters
+	// drawn next are drawn over it
+	void BeginFace(int slot, int face);
+	// mark the shadow map of a light as current
+	void EndLight(int slot);
+	// restore the target and bind the live atlas for the shaders
+	void EndUpdate();
+
+	// bind the live atlas to its texture unit
+	void BindTexture() const;
+
+private:
+	// SHADOW_LIGHT struct holds what a shadow map was rendered with
+	struct SHADOW_LIGHT
+	{
+		glm::vec3 position;
+		float farDistance;
+		bool bStaticDirty;       // the cached static casters are stale
+		bool bDirty;             // the dynamic casters changed
+	};
+
+	// program drawing the casters depth only
+	GLuint m_program;
+	GLint m_faceViewProjectionLocation;
+	// live atlas read by the shaders and the cache of the static
+	// casters, with a framebuffer each
+	GLuint m_atlasTexture;
+	GLuint m_atlasFramebuffer;
+	GLuint m_staticTexture;
+	GLuint m_staticFramebuffer;
+	// unit the live atlas is bound to
+	int m_textureUnit;
+	// lights with a shadow map
+	SHADOW_LIGHT m_lights[MAX_LIGHTS];
+	int m_lightCount;
+	// face matrices and lights as the shaders read them
+	UniformBuffer::SHADOW_BLOCK m_blockData;
+	UniformBuffer m_block;
+	// true when the block no longer matches the lights
+	bool m_bBlockDirty;
+	// framebuffer and viewport restored after the shadow pass
+	GLint m_previousFramebuffer;
+	GLint m_previousViewport[4];
+
+	// compute the face matrices of a light into the block
+	void UpdateFaceMatrices(int slot);
+	// bind a framebuffer and limit the drawing to a tile of it
+	void SetTile(GLuint framebuffer, int slot, int face);
+};
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+// taghash.h
+// ============
+// hash tag strings into the integer keys used by the tag indices
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  This function is used for hashing a tag string into the key
+ *  used by the texture and material tag indices (32-bit FNV-1a).
+ *  Hashing the raw characters means lookups never have to
+ *  construct a std::string.
+ ***********************************************************/
+inline uint32_t HashTag(const char* tag)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*tag != '\0')
+	{
+		hash ^= (uint8_t)(*tag++);
+		hash *= 16777619u;
+	}
+
+	return(hash);
+}
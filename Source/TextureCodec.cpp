@@ -0,0 +1,801 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecodec.cpp
+// ============
+// resample, mipmap and block compress RGBA images, and read and write the
+// cooked DDS texture files
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// declaration of the global variables and defines
+namespace
+{
+	// all of the uncompressed pixels are 8-bit RGBA
+	const int TEXTURE_CHANNELS = 4;
+	// texels along each side of a compressed block
+	const int BLOCK_SIZE = 4;
+	// bytes of a compressed color block and alpha block
+	const int COLOR_BLOCK_BYTES = 8;
+	const int ALPHA_BLOCK_BYTES = 8;
+
+	// extension of the cooked texture files
+	const char* const COOKED_EXTENSION = ".dds";
+
+	// DDS file layout - the magic number followed by a header
+	// of 31 little-endian 32-bit fields
+	const uint32_t DDS_MAGIC = 0x20534444;          // "DDS "
+	const int DDS_HEADER_FIELDS = 31;
+	const int DDS_FILE_HEADER_BYTES = 4 + DDS_HEADER_FIELDS * 4;
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+	const uint32_t FOURCC_DXT1 = 0x31545844;        // "DXT1"
+	const uint32_t FOURCC_DXT5 = 0x35545844;        // "DXT5"
+
+	// indices of the header fields that are read or written
+	enum DDSField
+	{
+		DDS_SIZE = 0,
+		DDS_FLAGS = 1,
+		DDS_HEIGHT = 2,
+		DDS_WIDTH = 3,
+		DDS_LINEAR_SIZE = 4,
+		DDS_MIPMAP_COUNT = 6,
+		DDS_PF_SIZE = 18,
+		DDS_PF_FLAGS = 19,
+		DDS_PF_FOURCC = 20,
+		DDS_CAPS = 26
+	};
+
+	/***********************************************************
+	 *  PackColor565()
+	 *
+	 *  This function is used for quantizing an RGB color to the
+	 *  16-bit 5:6:5 endpoint format of the compressed blocks.
+	 ***********************************************************/
+	uint16_t PackColor565(const float* color)
+	{
+		int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+
+		return((uint16_t)((r << 11) | (g << 5) | b));
+	}
+
+	/***********************************************************
+	 *  UnpackColor565()
+	 *
+	 *  This function is used for expanding a 5:6:5 endpoint to
+	 *  8-bit RGB the way the GPU decodes it.
+	 ***********************************************************/
+	void UnpackColor565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 0x1F;
+		int g = (packed >> 5) & 0x3F;
+		int b = packed & 0x1F;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/***********************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  This function is used for compressing the colors of a 4x4
+	 *  block into an 8-byte BC1 color block.  The endpoints are
+	 *  the extremes of the block along its principal axis, and
+	 *  every texel takes the nearest of the four palette colors.
+	 ***********************************************************/
+	void EncodeColorBlock(const unsigned char* block, unsigned char* dest)
+	{
+		const int TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (int i = 0; i < TEXELS; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += block[i * TEXTURE_CHANNELS + c];
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] /= (float)TEXELS;
+		}
+
+		// covariance of the block colors
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < TEXELS; i++)
+		{
+			float r = block[i * TEXTURE_CHANNELS + 0] - mean[0];
+			float g = block[i * TEXTURE_CHANNELS + 1] - mean[1];
+			float b = block[i * TEXTURE_CHANNELS + 2] - mean[2];
+
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		// a few power iterations find the principal axis
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+
+			if (length <= 0.0f)
+			{
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		// the extremes along the axis become the endpoints
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		int minTexel = 0;
+		int maxTexel = 0;
+		for (int i = 0; i < TEXELS; i++)
+		{
+			float projection =
+				block[i * TEXTURE_CHANNELS + 0] * axis[0] +
+				block[i * TEXTURE_CHANNELS + 1] * axis[1] +
+				block[i * TEXTURE_CHANNELS + 2] * axis[2];
+
+			if ((i == 0) || (projection < minProjection))
+			{
+				minProjection = projection;
+				minTexel = i;
+			}
+			if ((i == 0) || (projection > maxProjection))
+			{
+				maxProjection = projection;
+				maxTexel = i;
+			}
+		}
+
+		float maxColor[3];
+		float minColor[3];
+		for (int c = 0; c < 3; c++)
+		{
+			maxColor[c] = block[maxTexel * TEXTURE_CHANNELS + c];
+			minColor[c] = block[minTexel * TEXTURE_CHANNELS + c];
+		}
+
+		uint16_t color0 = PackColor565(maxColor);
+		uint16_t color1 = PackColor565(minColor);
+		// the first endpoint must be larger to select the
+		// four color mode
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		int palette[4][3];
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			for (int i = 0; i < TEXELS; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = INT32_MAX;
+
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int delta = block[i * TEXTURE_CHANNELS + c] - palette[p][c];
+						distance += delta * delta;
+					}
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		dest[0] = (unsigned char)(color0 & 0xFF);
+		dest[1] = (unsigned char)(color0 >> 8);
+		dest[2] = (unsigned char)(color1 & 0xFF);
+		dest[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			dest[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeAlphaBlock()
+	 *
+	 *  This function is used for compressing the alpha of a 4x4
+	 *  block into an 8-byte BC3 alpha block, interpolating eight
+	 *  values between the smallest and largest alpha.
+	 ***********************************************************/
+	void EncodeAlphaBlock(const unsigned char* block, unsigned char* dest)
+	{
+		const int TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+		int alpha0 = 0;
+		int alpha1 = 255;
+
+		for (int i = 0; i < TEXELS; i++)
+		{
+			alpha0 = std::max(alpha0, (int)block[i * TEXTURE_CHANNELS + 3]);
+			alpha1 = std::min(alpha1, (int)block[i * TEXTURE_CHANNELS + 3]);
+		}
+
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int p = 2; p < 8; p++)
+		{
+			palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			for (int i = 0; i < TEXELS; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 256;
+
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = std::abs(block[i * TEXTURE_CHANNELS + 3] - palette[p]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		dest[0] = (unsigned char)alpha0;
+		dest[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			dest[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  ResampleLine()
+	 *
+	 *  This function is used for resampling one line of float
+	 *  RGBA pixels to a new length.  Shrinking averages all of
+	 *  the source pixels covered by a destination pixel, and
+	 *  growing interpolates linearly between source pixels.
+	 ***********************************************************/
+	void ResampleLine(
+		const float* source, int sourceLength, int sourceStride,
+		float* dest, int destLength, int destStride)
+	{
+		float scale = (float)sourceLength / (float)destLength;
+
+		for (int i = 0; i < destLength; i++)
+		{
+			float pixel[TEXTURE_CHANNELS] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			if (scale > 1.0f)
+			{
+				// box filter over the covered source pixels
+				float start = i * scale;
+				float end = start + scale;
+				int first = (int)start;
+				int last = std::min((int)std::ceil(end), sourceLength);
+
+				for (int s = first; s < last; s++)
+				{
+					float weight = std::min(end, (float)(s + 1)) - std::max(start, (float)s);
+					for (int c = 0; c < TEXTURE_CHANNELS; c++)
+					{
+						pixel[c] += source[s * sourceStride + c] * weight;
+					}
+				}
+				for (int c = 0; c < TEXTURE_CHANNELS; c++)
+				{
+					pixel[c] /= scale;
+				}
+			}
+			else
+			{
+				// linear interpolation between the nearest pixels
+				float position = std::max((i + 0.5f) * scale - 0.5f, 0.0f);
+				int s0 = std::min((int)position, sourceLength - 1);
+				int s1 = std::min(s0 + 1, sourceLength - 1);
+				float t = position - (float)s0;
+
+				for (int c = 0; c < TEXTURE_CHANNELS; c++)
+				{
+					pixel[c] = source[s0 * sourceStride + c] * (1.0f - t) + source[s1 * sourceStride + c] * t;
+				}
+			}
+
+			for (int c = 0; c < TEXTURE_CHANNELS; c++)
+			{
+				dest[i * destStride + c] = pixel[c];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  PutUint32() / GetUint32()
+	 *
+	 *  These functions are used for writing and reading the
+	 *  little-endian fields of the DDS header.
+	 ***********************************************************/
+	void PutUint32(unsigned char* dest, uint32_t value)
+	{
+		dest[0] = (unsigned char)(value & 0xFF);
+		dest[1] = (unsigned char)((value >> 8) & 0xFF);
+		dest[2] = (unsigned char)((value >> 16) & 0xFF);
+		dest[3] = (unsigned char)((value >> 24) & 0xFF);
+	}
+
+	uint32_t GetUint32(const unsigned char* source)
+	{
+		return((uint32_t)source[0] |
+			((uint32_t)source[1] << 8) |
+			((uint32_t)source[2] << 16) |
+			((uint32_t)source[3] << 24));
+	}
+
+	/***********************************************************
+	 *  ParseDDSHeader()
+	 *
+	 *  This function is used for validating the header of a DDS
+	 *  file and reading the fields the loader needs.  Only the
+	 *  DXT1 and DXT5 block formats are accepted.
+	 ***********************************************************/
+	bool ParseDDSHeader(
+		const unsigned char* header,
+		TextureCodec::Format& format, int& width, int& height, int& mipCount)
+	{
+		const unsigned char* fields = header + 4;
+
+		if ((GetUint32(header) != DDS_MAGIC) ||
+			(GetUint32(fields + DDS_SIZE * 4) != DDS_HEADER_FIELDS * 4) ||
+			((GetUint32(fields + DDS_PF_FLAGS * 4) & DDPF_FOURCC) == 0))
+		{
+			return false;
+		}
+
+		uint32_t fourCC = GetUint32(fields + DDS_PF_FOURCC * 4);
+		if (fourCC == FOURCC_DXT1)
+		{
+			format = TextureCodec::Format::BC1;
+		}
+		else if (fourCC == FOURCC_DXT5)
+		{
+			format = TextureCodec::Format::BC3;
+		}
+		else
+		{
+			return false;
+		}
+
+		width = (int)GetUint32(fields + DDS_WIDTH * 4);
+		height = (int)GetUint32(fields + DDS_HEIGHT * 4);
+		mipCount = 1;
+		if (GetUint32(fields + DDS_FLAGS * 4) & DDSD_MIPMAPCOUNT)
+		{
+			mipCount = std::max((int)GetUint32(fields + DDS_MIPMAP_COUNT * 4), 1);
+		}
+
+		return((width > 0) && (height > 0));
+	}
+}
+
+/***********************************************************
+ *  ChooseLayerSlot()
+ *
+ *  This method is used for choosing the layer size of an
+ *  image, which is the smallest layer size that holds the
+ *  larger side of the image.  Larger images use the largest
+ *  layer size and are scaled down.
+ ***********************************************************/
+int TextureCodec::ChooseLayerSlot(int width, int height)
+{
+	int size = std::max(width, height);
+	int layerSlot = 0;
+
+	while ((layerSlot < LAYER_SIZE_COUNT - 1) && (GetLayerSize(layerSlot) < size))
+	{
+		layerSlot++;
+	}
+
+	return(layerSlot);
+}
+
+/***********************************************************
+ *  GetMipCount()
+ *
+ *  This method is used for getting the number of mipmap
+ *  levels of an image, down to and including 1x1.
+ ***********************************************************/
+int TextureCodec::GetMipCount(int width, int height)
+{
+	int size = std::max(width, height);
+	int mipCount = 1;
+
+	while (size > 1)
+	{
+		size /= 2;
+		mipCount++;
+	}
+
+	return(mipCount);
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for getting the number of bytes of a
+ *  mipmap level.  Compressed levels are stored in whole 4x4
+ *  blocks, even when the level is smaller than a block.
+ ***********************************************************/
+size_t TextureCodec::GetLevelSize(Format format, int width, int height)
+{
+	if (format == Format::RGBA8)
+	{
+		return((size_t)width * height * TEXTURE_CHANNELS);
+	}
+
+	size_t blocks =
+		(size_t)((width + BLOCK_SIZE - 1) / BLOCK_SIZE) *
+		(size_t)((height + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	size_t blockBytes = (format == Format::BC1) ? COLOR_BLOCK_BYTES : (ALPHA_BLOCK_BYTES + COLOR_BLOCK_BYTES);
+
+	return(blocks * blockBytes);
+}
+
+/***********************************************************
+ *  ResampleImage()
+ *
+ *  This method is used for resampling RGBA pixels to a new
+ *  size, one axis at a time.
+ ***********************************************************/
+void TextureCodec::ResampleImage(
+	const unsigned char* source, int sourceWidth, int sourceHeight,
+	unsigned char* dest, int destWidth, int destHeight)
+{
+	std::vector<float> input(sourceWidth * sourceHeight * TEXTURE_CHANNELS);
+	std::vector<float> rows(destWidth * sourceHeight * TEXTURE_CHANNELS);
+	std::vector<float> output(destWidth * destHeight * TEXTURE_CHANNELS);
+
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		input[i] = (float)source[i];
+	}
+
+	// resample each row to the new width
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		ResampleLine(
+			&input[y * sourceWidth * TEXTURE_CHANNELS], sourceWidth, TEXTURE_CHANNELS,
+			&rows[y * destWidth * TEXTURE_CHANNELS], destWidth, TEXTURE_CHANNELS);
+	}
+
+	// resample each column to the new height
+	for (int x = 0; x < destWidth; x++)
+	{
+		ResampleLine(
+			&rows[x * TEXTURE_CHANNELS], sourceHeight, destWidth * TEXTURE_CHANNELS,
+			&output[x * TEXTURE_CHANNELS], destHeight, destWidth * TEXTURE_CHANNELS);
+	}
+
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		dest[i] = (unsigned char)std::min(std::max(output[i] + 0.5f, 0.0f), 255.0f);
+	}
+}
+
+/***********************************************************
+ *  DownsampleImage()
+ *
+ *  This method is used for making the next mipmap level of
+ *  RGBA pixels by averaging each 2x2 square.  A side that is
+ *  already 1 pixel stays 1 pixel.
+ ***********************************************************/
+void TextureCodec::DownsampleImage(
+	const unsigned char* source, int sourceWidth, int sourceHeight,
+	unsigned char* dest)
+{
+	int destWidth = std::max(sourceWidth / 2, 1);
+	int destHeight = std::max(sourceHeight / 2, 1);
+
+	for (int y = 0; y < destHeight; y++)
+	{
+		int y0 = std::min(y * 2, sourceHeight - 1);
+		int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+		for (int x = 0; x < destWidth; x++)
+		{
+			int x0 = std::min(x * 2, sourceWidth - 1);
+			int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+			for (int c = 0; c < TEXTURE_CHANNELS; c++)
+			{
+				int sum =
+					source[(y0 * sourceWidth + x0) * TEXTURE_CHANNELS + c] +
+					source[(y0 * sourceWidth + x1) * TEXTURE_CHANNELS + c] +
+					source[(y1 * sourceWidth + x0) * TEXTURE_CHANNELS + c] +
+					source[(y1 * sourceWidth + x1) * TEXTURE_CHANNELS + c];
+
+				dest[(y * destWidth + x) * TEXTURE_CHANNELS + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  HasAlpha()
+ *
+ *  This method is used for checking whether an image needs
+ *  an alpha channel, so the cooker can pick BC1 or BC3.
+ ***********************************************************/
+bool TextureCodec::HasAlpha(const unsigned char* pixels, int width, int height)
+{
+	int count = width * height;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (pixels[i * TEXTURE_CHANNELS + 3] != 255)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/***********************************************************
+ *  CompressImage()
+ *
+ *  This method is used for block compressing RGBA pixels.  The
+ *  blocks are stored in rows, and blocks that reach past the
+ *  edge of a small mipmap repeat the edge texels.
+ ***********************************************************/
+void TextureCodec::CompressImage(
+	Format format, const unsigned char* pixels, int width, int height,
+	unsigned char* dest)
+{
+	unsigned char block[BLOCK_SIZE * BLOCK_SIZE * TEXTURE_CHANNELS];
+	int blocksWide = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	int blocksHigh = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	for (int by = 0; by < blocksHigh; by++)
+	{
+		for (int bx = 0; bx < blocksWide; bx++)
+		{
+			// gather the block texels, clamped to the image
+			for (int y = 0; y < BLOCK_SIZE; y++)
+			{
+				int sourceY = std::min(by * BLOCK_SIZE + y, height - 1);
+				for (int x = 0; x < BLOCK_SIZE; x++)
+				{
+					int sourceX = std::min(bx * BLOCK_SIZE + x, width - 1);
+					for (int c = 0; c < TEXTURE_CHANNELS; c++)
+					{
+						block[(y * BLOCK_SIZE + x) * TEXTURE_CHANNELS + c] =
+							pixels[(sourceY * width + sourceX) * TEXTURE_CHANNELS + c];
+					}
+				}
+			}
+
+			if (format == Format::BC3)
+			{
+				EncodeAlphaBlock(block, dest);
+				dest += ALPHA_BLOCK_BYTES;
+			}
+			EncodeColorBlock(block, dest);
+			dest += COLOR_BLOCK_BYTES;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetCookedFilename()
+ *
+ *  This method is used for getting the name of the cooked
+ *  file of an image file, which replaces its extension.
+ ***********************************************************/
+std::string TextureCodec::GetCookedFilename(const char* filename)
+{
+	std::string cookedPath = filename;
+	size_t extension = cookedPath.find_last_of('.');
+
+	// a dot inside a directory name is not an extension
+	if ((extension == std::string::npos) || (cookedPath.find_first_of("/\\", extension) != std::string::npos))
+	{
+		extension = cookedPath.size();
+	}
+
+	return(cookedPath.substr(0, extension) + COOKED_EXTENSION);
+}
+
+/***********************************************************
+ *  WriteDDS()
+ *
+ *  This method is used for writing a block compressed image
+ *  and its mipmap levels to a DDS file.
+ ***********************************************************/
+bool TextureCodec::WriteDDS(const char* filename, const COOKED_IMAGE& image)
+{
+	if ((image.format == Format::RGBA8) || (image.levels.size() == 0))
+	{
+		return false;
+	}
+
+	unsigned char header[DDS_FILE_HEADER_BYTES] = { 0 };
+	unsigned char* fields = header + 4;
+
+	PutUint32(header, DDS_MAGIC);
+	PutUint32(fields + DDS_SIZE * 4, DDS_HEADER_FIELDS * 4);
+	PutUint32(fields + DDS_FLAGS * 4,
+		DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+	PutUint32(fields + DDS_HEIGHT * 4, (uint32_t)image.height);
+	PutUint32(fields + DDS_WIDTH * 4, (uint32_t)image.width);
+	PutUint32(fields + DDS_LINEAR_SIZE * 4, (uint32_t)image.levels[0].size());
+	PutUint32(fields + DDS_MIPMAP_COUNT * 4, (uint32_t)image.levels.size());
+	PutUint32(fields + DDS_PF_SIZE * 4, 32);
+	PutUint32(fields + DDS_PF_FLAGS * 4, DDPF_FOURCC);
+	PutUint32(fields + DDS_PF_FOURCC * 4, (image.format == Format::BC1) ? FOURCC_DXT1 : FOURCC_DXT5);
+	PutUint32(fields + DDS_CAPS * 4, DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP);
+
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool bSuccess = (fwrite(header, 1, sizeof(header), file) == sizeof(header));
+	for (size_t level = 0; bSuccess && (level < image.levels.size()); level++)
+	{
+		const std::vector<unsigned char>& data = image.levels[level];
+		bSuccess = (fwrite(data.data(), 1, data.size(), file) == data.size());
+	}
+	fclose(file);
+
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  ReadDDSHeader()
+ *
+ *  This method is used for reading the format, size and
+ *  mipmap count of a DDS file without reading the texels.
+ ***********************************************************/
+bool TextureCodec::ReadDDSHeader(const char* filename, Format& format, int& width, int& height, int& mipCount)
+{
+	unsigned char header[DDS_FILE_HEADER_BYTES];
+
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool bSuccess = (fread(header, 1, sizeof(header), file) == sizeof(header));
+	fclose(file);
+
+	return(bSuccess && ParseDDSHeader(header, format, width, height, mipCount));
+}
+
+/***********************************************************
+ *  ReadDDS()
+ *
+ *  This method is used for reading a block compressed image
+ *  and its mipmap levels from a DDS file.  When only some of
+ *  the levels are asked for, the finer ones are skipped and
+ *  the image holds the levels from the first one on, up to
+ *  the end level or the last level of the file.
+ ***********************************************************/
+bool TextureCodec::ReadDDS(const char* filename, COOKED_IMAGE& image, int firstLevel, int endLevel)
+{
+	unsigned char header[DDS_FILE_HEADER_BYTES];
+	int mipCount = 0;
+
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool bSuccess =
+		(fread(header, 1, sizeof(header), file) == sizeof(header)) &&
+		ParseDDSHeader(header, image.format, image.width, image.height, mipCount);
+
+	image.levels.clear();
+	int levelWidth = image.width;
+	int levelHeight = image.height;
+	for (int level = 0; bSuccess && (level < std::min(mipCount, endLevel)); level++)
+	{
+		size_t levelSize = GetLevelSize(image.format, levelWidth, levelHeight);
+		if (level < firstLevel)
+		{
+			bSuccess = (fseek(file, (long)levelSize, SEEK_CUR) == 0);
+		}
+		else
+		{
+			std::vector<unsigned char> data(levelSize);
+
+			bSuccess = (fread(data.data(), 1, data.size(), file) == data.size());
+			image.levels.push_back(std::move(data));
+		}
+
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+	fclose(file);
+
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  ParseDDS()
+ *
+ *  This method is used for reading the header of a DDS file
+ *  that is already in memory, such as inside a mapped asset
+ *  pack.  It fails unless the data holds every mipmap level,
+ *  so the texels can be uploaded straight from memory.
+ ***********************************************************/
+bool TextureCodec::ParseDDS(
+	const unsigned char* data, size_t size,
+	Format& format, int& width, int& height, int& mipCount, size_t& texelOffset)
+{
+	if ((size < (size_t)DDS_FILE_HEADER_BYTES) ||
+		!ParseDDSHeader(data, format, width, height, mipCount))
+	{
+		return false;
+	}
+
+	size_t texelBytes = 0;
+	int levelWidth = width;
+	int levelHeight = height;
+	for (int level = 0; level < mipCount; level++)
+	{
+		texelBytes += GetLevelSize(format, levelWidth, levelHeight);
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+
+	texelOffset = DDS_FILE_HEADER_BYTES;
+	return(size - texelOffset >= texelBytes);
+}
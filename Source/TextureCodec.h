@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecodec.h
+// ============
+// resample, mipmap and block compress RGBA images, and read and write the
+// cooked DDS texture files
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCodec
+ *
+ *  This class holds the image processing shared by the
+ *  texture loader and the offline texture cooker.  Every
+ *  texture is stored at one of a few power-of-two layer
+ *  sizes, either as 8-bit RGBA or block compressed as BC1
+ *  (opaque) or BC3 (with alpha).  Cooked textures are stored
+ *  in DDS files with the complete mipmap chain, so loading
+ *  them needs no decode and no mipmap generation.
+ ***********************************************************/
+class TextureCodec
+{
+public:
+	// Format enum identifies how the texels are stored
+	enum class Format { RGBA8, BC1, BC3 };
+	// total number of texel formats
+	static const int FORMAT_COUNT = 3;
+
+	// number of supported layer sizes
+	static const int LAYER_SIZE_COUNT = 4;
+	// smallest layer size, each following size doubles it
+	static const int MIN_LAYER_SIZE = 256;
+
+	// COOKED_IMAGE struct holds an image with all of its mipmaps
+	struct COOKED_IMAGE
+	{
+		Format format;
+		int width;
+		int height;
+		std::vector<std::vector<unsigned char>> levels;
+	};
+
+	// get the index of the smallest layer size that holds the
+	// larger side of an image, larger images use the last size
+	static int ChooseLayerSlot(int width, int height);
+	// get the layer size of a layer size index
+	static int GetLayerSize(int layerSlot) { return(MIN_LAYER_SIZE << layerSlot); }
+
+	// get the number of mipmap levels down to 1x1
+	static int GetMipCount(int width, int height);
+	// get the number of bytes of one mipmap level
+	static size_t GetLevelSize(Format format, int width, int height);
+
+	// resample RGBA pixels to a new size
+	static void ResampleImage(
+		const unsigned char* source, int sourceWidth, int sourceHeight,
+		unsigned char* dest, int destWidth, int destHeight);
+	// halve the size of RGBA pixels with a 2x2 box filter
+	static void DownsampleImage(
+		const unsigned char* source, int sourceWidth, int sourceHeight,
+		unsigned char* dest);
+	// true if any of the RGBA pixels is not fully opaque
+	static bool HasAlpha(const unsigned char* pixels, int width, int height);
+	// block compress RGBA pixels as BC1 or BC3
+	static void CompressImage(
+		Format format, const unsigned char* pixels, int width, int height,
+		unsigned char* dest);
+
+	// get the name of the cooked file that belongs to an image file
+	static std::string GetCookedFilename(const char* filename);
+	// write a block compressed image with its mipmaps to a DDS file
+	static bool WriteDDS(const char* filename, const COOKED_IMAGE& image);
+	// read the format, size and mipmap count of a DDS file
+	static bool ReadDDSHeader(const char* filename, Format& format, int& width, int& height, int& mipCount);
+	// read a block compressed image with its mipmaps from a DDS file,
+	// or only the levels from the first up to the end level
+	static bool ReadDDS(const char* filename, COOKED_IMAGE& image, int firstLevel = 0, int endLevel = INT_MAX);
+	// read the header of a DDS file in memory and locate its texels,
+	// which hold every mipmap level one after the other
+	static bool ParseDDS(
+		const unsigned char* data, size_t size,
+		Format& format, int& width, int& height, int& mipCount, size_t& texelOffset);
+};
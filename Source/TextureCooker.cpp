@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecooker.cpp
+// ============
+// offline conversion of the scene images into block compressed DDS files
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCooker.h"
+
+#include "stb_image.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of the global variables and defines
+namespace
+{
+	// all of the uncompressed pixels are 8-bit RGBA
+	const int TEXTURE_CHANNELS = 4;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for cooking every image file passed
+ *  on the command line.  The --bc1 and --bc3 options force the
+ *  format of the files that follow them.
+ ***********************************************************/
+int TextureCooker::Run(int argc, char* argv[])
+{
+	TextureCodec::Format format = TextureCodec::Format::RGBA8;
+	int cooked = 0;
+	int failed = 0;
+
+	for (int i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bc1") == 0)
+		{
+			format = TextureCodec::Format::BC1;
+		}
+		else if (strcmp(argv[i], "--bc3") == 0)
+		{
+			format = TextureCodec::Format::BC3;
+		}
+		else if (CookFile(argv[i], format))
+		{
+			cooked++;
+		}
+		else
+		{
+			failed++;
+		}
+	}
+
+	if ((cooked == 0) && (failed == 0))
+	{
+		std::cout << "Usage: --cook-textures [--bc1 | --bc3] <image files>" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	std::cout << "Cooked " << cooked << " textures, " << failed << " failed" << std::endl;
+	return((failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *  CookFile()
+ *
+ *  This method is used for cooking one image file into a DDS
+ *  file with the same name.  The image is flipped the same
+ *  way the loader flips decoded images, so the cooked texels
+ *  match the decoded ones.
+ ***********************************************************/
+bool TextureCooker::CookFile(const char* filename, TextureCodec::Format format)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, TEXTURE_CHANNELS);
+	if (!image)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	// resample to the layer size the loader uses
+	int layerSize = TextureCodec::GetLayerSize(TextureCodec::ChooseLayerSlot(width, height));
+	std::vector<unsigned char> pixels(layerSize * layerSize * TEXTURE_CHANNELS);
+	TextureCodec::ResampleImage(image, width, height, pixels.data(), layerSize, layerSize);
+	stbi_image_free(image);
+
+	if (format == TextureCodec::Format::RGBA8)
+	{
+		format = TextureCodec::HasAlpha(pixels.data(), layerSize, layerSize) ?
+			TextureCodec::Format::BC3 : TextureCodec::Format::BC1;
+	}
+
+	// compress each mipmap level, halving the pixels between levels
+	TextureCodec::COOKED_IMAGE cooked;
+	cooked.format = format;
+	cooked.width = layerSize;
+	cooked.height = layerSize;
+
+	int mipCount = TextureCodec::GetMipCount(layerSize, layerSize);
+	int levelSize = layerSize;
+	size_t cookedBytes = 0;
+	std::vector<unsigned char> nextPixels;
+	for (int level = 0; level < mipCount; level++)
+	{
+		std::vector<unsigned char> data(TextureCodec::GetLevelSize(format, levelSize, levelSize));
+		TextureCodec::CompressImage(format, pixels.data(), levelSize, levelSize, data.data());
+		cookedBytes += data.size();
+		cooked.levels.push_back(std::move(data));
+
+		if (level < mipCount - 1)
+		{
+			nextPixels.resize(TextureCodec::GetLevelSize(TextureCodec::Format::RGBA8, levelSize / 2, levelSize / 2));
+			TextureCodec::DownsampleImage(pixels.data(), levelSize, levelSize, nextPixels.data());
+			pixels.swap(nextPixels);
+			levelSize /= 2;
+		}
+	}
+
+	std::string cookedPath = TextureCodec::GetCookedFilename(filename);
+	if (!TextureCodec::WriteDDS(cookedPath.c_str(), cooked))
+	{
+		std::cout << "Could not write cooked texture:" << cookedPath << std::endl;
+		return false;
+	}
+
+	std::cout << "Cooked " << filename << " to " << cookedPath
+		<< ((format == TextureCodec::Format::BC1) ? " (BC1, " : " (BC3, ")
+		<< layerSize << "x" << layerSize << ", " << mipCount << " mipmaps, "
+		<< cookedBytes / 1024 << " KB)" << std::endl;
+
+	return true;
+}
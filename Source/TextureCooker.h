@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecooker.h
+// ============
+// offline conversion of the scene images into block compressed DDS files
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCodec.h"
+
+/***********************************************************
+ *  TextureCooker
+ *
+ *  This class converts image files into the cooked DDS files
+ *  the texture loader prefers.  Each image is resampled to
+ *  the layer size the loader would pick, its mipmaps are
+ *  built down to 1x1, and every level is compressed as BC1,
+ *  or BC3 when the image has transparent pixels.  It runs
+ *  from the command line with:
+ *
+ *      --cook-textures [--bc1 | --bc3] <image files>
+ *
+ *  and writes each cooked file next to its image.
+ ***********************************************************/
+class TextureCooker
+{
+public:
+	// cook the image files named on the command line, returns
+	// the process exit code
+	static int Run(int argc, char* argv[]);
+
+	// cook one image file, the automatic format is chosen by
+	// passing RGBA8
+	static bool CookFile(const char* filename, TextureCodec::Format format);
+};
@@ -0,0 +1,1321 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturemanager.cpp
+// ============
+// manage the scene textures packed into OpenGL 2D texture arrays
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureManager.h"
+#include "GpuMemory.h"
+#include "TagHash.h"
+#include "TextureCooker.h"
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// every OpenGL 3.x implementation supports at least this
+	// many layers in a texture array
+	const int MAX_ARRAY_LAYERS = 256;
+	// all of the textures are stored as 8-bit RGBA
+	const int TEXTURE_CHANNELS = 4;
+	// grey value of the placeholder layer
+	const unsigned char PLACEHOLDER_VALUE = 128;
+	// the arrays start out with their mipmaps from this size down,
+	// small enough for every texture that is far away
+	const int STREAM_START_SIZE = 128;
+
+	// resample a decoded RGBA image to the layer size and halve it
+	// down to the end level, keeping the levels from the first one on
+	void BuildLevels(const unsigned char* image, int width, int height, int layerSize,
+		int firstLevel, int endLevel, std::vector<std::vector<unsigned char>>& levels)
+	{
+		std::vector<unsigned char> texels(layerSize * layerSize * TEXTURE_CHANNELS);
+		TextureCodec::ResampleImage(image, width, height, texels.data(), layerSize, layerSize);
+
+		int size = layerSize;
+		for (int level = 0; level < endLevel; level++)
+		{
+			if (level >= firstLevel)
+			{
+				levels.push_back(texels);
+			}
+			if (size == 1)
+			{
+				break;
+			}
+
+			int nextSize = size / 2;
+			std::vector<unsigned char> next(nextSize * nextSize * TEXTURE_CHANNELS);
+			TextureCodec::DownsampleImage(texels.data(), size, size, next.data());
+			texels = std::move(next);
+			size = nextSize;
+		}
+	}
+}
+
+// the level table of the shaders has a byte for every layer
+static_assert(TextureManager::TOTAL_TEXTURE_ARRAYS * MAX_ARRAY_LAYERS == UniformBuffer::MAX_TEXTURE_LAYERS,
+	"the texture arrays do not match the TextureBlock of the shaders");
+
+/***********************************************************
+ *  TextureManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureManager::TextureManager()
+{
+	m_bArraysBuilt = false;
+	m_pLoader = NULL;
+	m_pendingLoads = 0;
+	m_uploadBuffer = 0;
+	m_streamingRound = 0;
+	m_bStreamingPending = false;
+	m_bLevelsDirty = false;
+	memset(&m_levelData, 0, sizeof(m_levelData));
+	for (int i = 0; i < TOTAL_TEXTURE_ARRAYS; i++)
+	{
+		m_textureArrays[i] = 0;
+		m_layerCounts[i] = 0;
+		m_topLevels[i] = 0;
+		m_wantedLevels[i] = 0;
+		m_lastUsed[i] = 0;
+	}
+
+	// the first layer of the first array is the placeholder
+	m_layerCounts[0] = 1;
+}
+
+/***********************************************************
+ *  ~TextureManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureManager::~TextureManager()
+{
+	DestroyTextures();
+
+	// joins the worker threads
+	delete m_pLoader;
+	m_pLoader = NULL;
+}
+
+/***********************************************************
+ *  LoadTexture()
+ *
+ *  This method is used for loading a texture from an image
+ *  file.  Only the file header is read here to assign the
+ *  texture to a layer of one of the texture arrays.  A cooked
+ *  file is read as is on a worker thread, otherwise the image
+ *  is decoded to RGBA and resampled to the layer size there.
+ *  Only the starting levels are read, and the texels are
+ *  uploaded by ProcessCompletedLoads().
+ ***********************************************************/
+bool TextureManager::LoadTexture(const char* filename, const char* tag)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// prefer the cooked file, which needs no decode and carries
+	// its mipmaps
+	TextureCodec::Format format = TextureCodec::Format::RGBA8;
+	int layerSlot = 0;
+	std::string cookedPath = FindCookedFile(filename, format, layerSlot);
+
+	// read the image size without decoding the pixels
+	bool bHasImage = (stbi_info(filename, &width, &height, &colorChannels) != 0);
+	if (!bHasImage && cookedPath.empty())
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	if (cookedPath.empty())
+	{
+		layerSlot = TextureCodec::ChooseLayerSlot(width, height);
+	}
+	else if ((width == 0) || (height == 0))
+	{
+		// only the cooked file exists
+		width = TextureCodec::GetLayerSize(layerSlot);
+		height = width;
+	}
+
+	int textureIndex = RegisterTexture(tag, format, layerSlot, width, height);
+	if (textureIndex < 0)
+	{
+		return false;
+	}
+
+	// the image is watched even when the cooked file is read, so
+	// that editing the image reloads the texture
+	std::string path = filename;
+	m_textures[textureIndex].sourceFile = bHasImage ? path : cookedPath;
+	m_textures[textureIndex].cookedFile = cookedPath;
+	QueueRead(textureIndex, m_textures[textureIndex].residentLevel, INT_MAX, false, false);
+
+	return true;
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for reading the source file of a loaded
+ *  texture again, when it was changed on disk.  An image that
+ *  was loaded through its cooked file is cooked again on the
+ *  worker, which also keeps the cooked file current for the
+ *  next start.  The texture stays in its texture array layer,
+ *  so the new texels are only used while they still match the
+ *  format and the size of that array.  Until they are uploaded,
+ *  and for good if they cannot be read, the texture keeps its
+ *  current texels.  The levels it holds are read again, and
+ *  the finer ones are streamed in from the new source.
+ ***********************************************************/
+bool TextureManager::ReloadTexture(int textureIndex)
+{
+	if ((textureIndex < 0) || (textureIndex >= (int)m_textures.size()) || m_textures[textureIndex].sourceFile.empty())
+	{
+		return false;
+	}
+
+	TEXTURE_INFO& info = m_textures[textureIndex];
+	const std::string& path = info.sourceFile;
+	bool bCookFirst = false;
+	if (!info.cookedFile.empty() && (path != info.cookedFile))
+	{
+		// the image is cooked again to the same format, which only
+		// fits the array while it picks the same layer size
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		if (!stbi_info(path.c_str(), &width, &height, &colorChannels) ||
+			(TextureCodec::GetLayerSize(TextureCodec::ChooseLayerSlot(width, height)) != GetLayerSize(info.arraySlot)))
+		{
+			std::cout << "Changed image no longer fits its texture array, restart to reload:" << path << std::endl;
+			return false;
+		}
+		bCookFirst = true;
+	}
+	else if (!info.cookedFile.empty())
+	{
+		// only the header is read here, the texels are read on a worker
+		TextureCodec::Format format;
+		int width = 0;
+		int height = 0;
+		int mipCount = 0;
+		int layerSlot = 0;
+		if (!TextureCodec::ReadDDSHeader(path.c_str(), format, width, height, mipCount) ||
+			!IsUsableCooked(format, width, height, mipCount, layerSlot) ||
+			(GetArraySlot(format, layerSlot) != info.arraySlot))
+		{
+			std::cout << "Cooked texture no longer fits its texture array, restart to reload:" << path << std::endl;
+			return false;
+		}
+	}
+
+	// the levels still on their way from the previous source are dropped
+	info.version++;
+	info.finestLevel = 0;
+	QueueRead(textureIndex, info.residentLevel, INT_MAX, bCookFirst, false);
+
+	return true;
+}
+
+/***********************************************************
+ *  QueueRead()
+ *
+ *  This method is used for reading levels of a texture on a
+ *  worker thread, either from its cooked file as is or by
+ *  decoding its image to RGBA and resampling it to the layer
+ *  size.  The texture coordinates are normalized, so
+ *  resampling does not change the mapping onto the objects.
+ *  The levels of a cooked file in memory need no read at all.
+ *  The levels are uploaded by ProcessCompletedLoads().
+ ***********************************************************/
+void TextureManager::QueueRead(int textureIndex, int firstLevel, int endLevel, bool bCookFirst, bool bStreamed)
+{
+	TEXTURE_INFO& info = m_textures[textureIndex];
+	DECODED_IMAGE result;
+	result.textureIndex = textureIndex;
+	result.bSuccess = false;
+	result.bStreamed = bStreamed;
+	result.version = info.version;
+	result.firstLevel = firstLevel;
+	result.pMappedTexels = NULL;
+
+	if (bStreamed)
+	{
+		info.bReading = true;
+	}
+	else
+	{
+		m_pendingLoads++;
+	}
+
+	if (info.pMappedTexels != NULL)
+	{
+		// nothing to read, the texels are ready for the upload
+		result.bSuccess = true;
+		result.pMappedTexels = info.pMappedTexels;
+
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completedImages.push_back(std::move(result));
+		return;
+	}
+
+	TextureCodec::Format format = info.format;
+	int layerSize = GetLayerSize(info.arraySlot);
+	std::string path = info.sourceFile;
+	std::string cookedPath = info.cookedFile;
+	const unsigned char* pImageData = info.pImageData;
+	size_t imageSize = info.imageSize;
+
+	m_pLoader->Submit([this, result, path, cookedPath, pImageData, imageSize, layerSize, format, endLevel, bCookFirst]() mutable {
+		int imageWidth = 0;
+		int imageHeight = 0;
+		int imageChannels = 0;
+		int levelCount = std::min(endLevel, TextureCodec::GetMipCount(layerSize, layerSize)) - result.firstLevel;
+
+		if (!cookedPath.empty())
+		{
+			// a cooked file that does not match the array, such as one
+			// another tool wrote meanwhile, is not uploaded
+			TextureCodec::COOKED_IMAGE cooked;
+			if ((!bCookFirst || TextureCooker::CookFile(path.c_str(), format)) &&
+				TextureCodec::ReadDDS(cookedPath.c_str(), cooked, result.firstLevel, endLevel) &&
+				(cooked.format == format) && (cooked.width == layerSize) && (cooked.height == layerSize) &&
+				((int)cooked.levels.size() == levelCount))
+			{
+				result.levels = std::move(cooked.levels);
+				result.bSuccess = true;
+			}
+		}
+		else
+		{
+			// always expanded to RGBA so that every layer has one format
+			unsigned char* image = (pImageData != NULL) ?
+				stbi_load_from_memory(pImageData, (int)imageSize, &imageWidth, &imageHeight, &imageChannels, TEXTURE_CHANNELS) :
+				stbi_load(path.c_str(), &imageWidth, &imageHeight, &imageChannels, TEXTURE_CHANNELS);
+			if (image)
+			{
+				// the whole image is decoded again for finer levels, so
+				// the mipmaps are built here instead of on the GPU
+				BuildLevels(image, imageWidth, imageHeight, layerSize, result.firstLevel, endLevel, result.levels);
+				stbi_image_free(image);
+				result.bSuccess = true;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completedImages.push_back(std::move(result));
+	});
+}
+
+/***********************************************************
+ *  LoadTextureFromMemory()
+ *
+ *  This method is used for loading a texture from an image or
+ *  cooked DDS file that is already in memory, such as inside
+ *  a mapped asset pack.  Cooked texels are uploaded straight
+ *  from that memory without any copy, and other images are
+ *  decoded on a worker thread.  The memory must stay valid
+ *  while the texture is loaded, since the finer levels are
+ *  streamed in from it, or decoded from it again.
+ ***********************************************************/
+bool TextureManager::LoadTextureFromMemory(const unsigned char* data, size_t size, const char* tag)
+{
+	TextureCodec::Format format = TextureCodec::Format::RGBA8;
+	int width = 0;
+	int height = 0;
+	int mipCount = 0;
+	size_t texelOffset = 0;
+	int layerSlot = 0;
+
+	if (TextureCodec::ParseDDS(data, size, format, width, height, mipCount, texelOffset))
+	{
+		if (!IsUsableCooked(format, width, height, mipCount, layerSlot))
+		{
+			std::cout << "Ignoring unusable cooked texture:" << tag << std::endl;
+			return false;
+		}
+
+		int textureIndex = RegisterTexture(tag, format, layerSlot, width, height);
+		if (textureIndex < 0)
+		{
+			return false;
+		}
+
+		m_textures[textureIndex].pMappedTexels = data + texelOffset;
+		QueueRead(textureIndex, m_textures[textureIndex].residentLevel, INT_MAX, false, false);
+		return true;
+	}
+
+	int colorChannels = 0;
+	if (!stbi_info_from_memory(data, (int)size, &width, &height, &colorChannels))
+	{
+		std::cout << "Could not load image:" << tag << std::endl;
+		return false;
+	}
+
+	layerSlot = TextureCodec::ChooseLayerSlot(width, height);
+	int textureIndex = RegisterTexture(tag, format, layerSlot, width, height);
+	if (textureIndex < 0)
+	{
+		return false;
+	}
+
+	m_textures[textureIndex].pImageData = data;
+	m_textures[textureIndex].imageSize = size;
+	QueueRead(textureIndex, m_textures[textureIndex].residentLevel, INT_MAX, false, false);
+
+	return true;
+}
+
+/***********************************************************
+ *  RegisterTexture()
+ *
+ *  This method is used for assigning a new texture to the
+ *  next free layer of its texture array and associating it
+ *  with the special tag string.  Returns the texture index,
+ *  or -1 if the texture cannot be added.
+ ***********************************************************/
+int TextureManager::RegisterTexture(const char* tag, TextureCodec::Format format, int layerSlot, int width, int height)
+{
+	if (m_bArraysBuilt)
+	{
+		std::cout << "Textures must be loaded before the texture arrays are built:" << tag << std::endl;
+		return(-1);
+	}
+	if (FindTexture(tag) >= 0)
+	{
+		std::cout << "Texture tag already registered:" << tag << std::endl;
+		return(-1);
+	}
+
+	int arraySlot = GetArraySlot(format, layerSlot);
+	if (m_layerCounts[arraySlot] >= MAX_ARRAY_LAYERS)
+	{
+		std::cout << "Texture array " << arraySlot << " is full, could not add texture:" << tag << std::endl;
+		return(-1);
+	}
+
+	TEXTURE_INFO info;
+	info.tag = tag;
+	info.format = format;
+	info.arraySlot = arraySlot;
+	info.layer = m_layerCounts[arraySlot]++;
+	info.width = width;
+	info.height = height;
+	info.bResident = false;
+	info.residentLevel = GetStartLevel(arraySlot);
+	info.wantedLevel = info.residentLevel;
+	info.finestLevel = 0;
+	info.bReading = false;
+	info.version = 0;
+	info.pMappedTexels = NULL;
+	info.pImageData = NULL;
+	info.imageSize = 0;
+
+	int textureIndex = (int)m_textures.size();
+	m_textureIndex.emplace(HashTag(tag), textureIndex);
+	m_textures.push_back(info);
+
+	if (m_pLoader == NULL)
+	{
+		m_pLoader = new ThreadPool();
+	}
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	return(textureIndex);
+}
+
+/***********************************************************
+ *  BuildTextureArrays()
+ *
+ *  This method is used for allocating the texture arrays for
+ *  all of the queued textures and filling in the placeholder
+ *  layer.  Only the coarse levels are allocated here, and the
+ *  finer ones are streamed in once objects need them.  The
+ *  images are uploaded as they finish decoding.
+ ***********************************************************/
+void TextureManager::BuildTextureArrays()
+{
+	if (m_bArraysBuilt)
+	{
+		return;
+	}
+
+	for (int arraySlot = 0; arraySlot < TOTAL_TEXTURE_ARRAYS; arraySlot++)
+	{
+		if (m_layerCounts[arraySlot] == 0)
+		{
+			continue;
+		}
+
+		int layerSize = GetLayerSize(arraySlot);
+		int mipCount = TextureCodec::GetMipCount(layerSize, layerSize);
+		m_topLevels[arraySlot] = GetStartLevel(arraySlot);
+		m_wantedLevels[arraySlot] = m_topLevels[arraySlot];
+
+		// each array is only ever bound to the unit matching its slot
+		glGenTextures(1, &m_textureArrays[arraySlot]);
+		glActiveTexture(GL_TEXTURE0 + arraySlot);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[arraySlot]);
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters - every array has a
+		// complete mipmap chain below its finest allocated level,
+		// which the base level follows
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, m_topLevels[arraySlot]);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+
+		// allocate all of the layers, they are filled in later
+		for (int level = m_topLevels[arraySlot]; level < mipCount; level++)
+		{
+			AllocateLevel(arraySlot, level);
+		}
+		GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_textureArrays[arraySlot], GpuMemory::MEMORY_TEXTURES, GetArrayBytes(arraySlot));
+	}
+
+	glGenBuffers(1, &m_uploadBuffer);
+	m_bArraysBuilt = true;
+
+	// fill in the placeholder layer, which is a flat grey and never
+	// needs more than its starting levels
+	int placeholderSize = GetLayerSize(0);
+	DECODED_IMAGE placeholder;
+	placeholder.textureIndex = -1;
+	placeholder.bSuccess = true;
+	placeholder.bStreamed = false;
+	placeholder.version = 0;
+	placeholder.firstLevel = m_topLevels[0];
+	placeholder.pMappedTexels = NULL;
+
+	std::vector<TEXEL_UPLOAD> uploads;
+	for (int level = placeholder.firstLevel; level < TextureCodec::GetMipCount(placeholderSize, placeholderSize); level++)
+	{
+		int levelSize = std::max(placeholderSize >> level, 1);
+		placeholder.levels.push_back(std::vector<unsigned char>(levelSize * levelSize * TEXTURE_CHANNELS, PLACEHOLDER_VALUE));
+	}
+	for (int level = placeholder.firstLevel; level < placeholder.firstLevel + (int)placeholder.levels.size(); level++)
+	{
+		AddLevelUpload(placeholder, 0, 0, level, uploads);
+	}
+	UploadTexels(0, uploads);
+
+	// the layers sample their starting levels until more are streamed in
+	m_levelBlock.Initialize(UniformBuffer::TEXTURE_BINDING, sizeof(m_levelData));
+	SetLayerLevel(0, 0, placeholder.firstLevel);
+	for (const TEXTURE_INFO& info : m_textures)
+	{
+		SetLayerLevel(info.arraySlot, info.layer, info.residentLevel);
+	}
+	UpdateLevelBlock();
+
+	// upload whatever has finished decoding already
+	ProcessCompletedLoads(INT_MAX);
+}
+
+/***********************************************************
+ *  ProcessCompletedLoads()
+ *
+ *  This method is used for uploading up to the passed in
+ *  number of decoded images into their texture array layers.
+ *  It is called on the GL thread once per frame, and returns
+ *  the number of textures that became resident.
+ ***********************************************************/
+int TextureManager::ProcessCompletedLoads(int maxUploads)
+{
+	if (!m_bArraysBuilt)
+	{
+		return(0);
+	}
+
+	std::vector<DECODED_IMAGE> images;
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		int count = std::min((int)m_completedImages.size(), maxUploads);
+
+		images.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			images.push_back(std::move(m_completedImages[i]));
+		}
+		m_completedImages.erase(m_completedImages.begin(), m_completedImages.begin() + count);
+	}
+
+	int resident = 0;
+	for (const DECODED_IMAGE& image : images)
+	{
+		TEXTURE_INFO& info = m_textures[image.textureIndex];
+		if (image.bStreamed)
+		{
+			// levels read before a reload belong to the old source
+			info.bReading = false;
+			if (image.version != info.version)
+			{
+				continue;
+			}
+		}
+		else
+		{
+			m_pendingLoads--;
+		}
+
+		if (!image.bSuccess && image.bStreamed)
+		{
+			// the texture stays at the levels it has, the source is
+			// only read again once it is reloaded
+			std::cout << "Could not stream in the finer levels of texture:" << info.tag << std::endl;
+			info.finestLevel = info.residentLevel;
+			continue;
+		}
+		if (!image.bSuccess)
+		{
+			// the texture keeps sampling the placeholder, or its
+			// previous texels when it was being reloaded
+			std::cout << "Could not load image for texture:" << info.tag << std::endl;
+			continue;
+		}
+
+		UploadImage(image);
+		if (!image.bStreamed)
+		{
+			resident++;
+		}
+	}
+	UpdateLevelBlock();
+
+	return(resident);
+}
+
+/***********************************************************
+ *  WaitForLoads()
+ *
+ *  This method is used for blocking until every queued image
+ *  has been decoded and uploaded.
+ ***********************************************************/
+void TextureManager::WaitForLoads()
+{
+	if (m_pLoader != NULL)
+	{
+		m_pLoader->WaitIdle();
+	}
+	ProcessCompletedLoads(INT_MAX);
+}
+
+/***********************************************************
+ *  UploadImage()
+ *
+ *  This method is used for uploading the levels read for a
+ *  texture into its layer, as far as its texture array holds
+ *  them at the moment.  Streamed levels only join the levels
+ *  of the layer when they reach down to them, since one of
+ *  those may have been evicted meanwhile.  The texels are not
+ *  kept, the finer levels are read again when they are needed.
+ ***********************************************************/
+void TextureManager::UploadImage(const DECODED_IMAGE& image)
+{
+	TEXTURE_INFO& info = m_textures[image.textureIndex];
+	int layerSize = GetLayerSize(info.arraySlot);
+	int endLevel = (image.pMappedTexels != NULL) ?
+		TextureCodec::GetMipCount(layerSize, layerSize) : image.firstLevel + (int)image.levels.size();
+	int firstLevel = std::max(image.firstLevel, m_topLevels[info.arraySlot]);
+
+	if (image.bStreamed)
+	{
+		if ((endLevel < info.residentLevel) || (firstLevel >= info.residentLevel))
+		{
+			return;
+		}
+		endLevel = info.residentLevel;
+	}
+
+	std::vector<TEXEL_UPLOAD> uploads;
+	for (int level = firstLevel; level < endLevel; level++)
+	{
+		AddLevelUpload(image, info.arraySlot, info.layer, level, uploads);
+	}
+	UploadTexels(info.arraySlot, uploads);
+
+	if (!image.bStreamed)
+	{
+		std::cout << "Successfully loaded image:" << info.tag << ", width:" << info.width << ", height:" << info.height << std::endl;
+	}
+
+	// a reload replaces the finer levels of the previous image too
+	info.bResident = true;
+	info.residentLevel = firstLevel;
+	SetLayerLevel(info.arraySlot, info.layer, firstLevel);
+}
+
+/***********************************************************
+ *  AddLevelUpload()
+ *
+ *  This method is used for locating the texels of one level
+ *  of an image, either in the levels read for it or in the
+ *  mapped cooked file, and adding them to a list of uploads.
+ ***********************************************************/
+void TextureManager::AddLevelUpload(const DECODED_IMAGE& image, int arraySlot, int layer, int level, std::vector<TEXEL_UPLOAD>& uploads) const
+{
+	TextureCodec::Format format = GetArrayFormat(arraySlot);
+	int layerSize = GetLayerSize(arraySlot);
+	TEXEL_UPLOAD upload;
+	upload.layer = layer;
+	upload.level = level;
+
+	if (image.pMappedTexels != NULL)
+	{
+		// the cooked file holds the levels one after the other
+		upload.pTexels = image.pMappedTexels;
+		for (int i = 0; i < level; i++)
+		{
+			int levelSize = std::max(layerSize >> i, 1);
+			upload.pTexels += TextureCodec::GetLevelSize(format, levelSize, levelSize);
+		}
+		int levelSize = std::max(layerSize >> level, 1);
+		upload.size = TextureCodec::GetLevelSize(format, levelSize, levelSize);
+	}
+	else if ((level >= image.firstLevel) && (level < image.firstLevel + (int)image.levels.size()))
+	{
+		upload.pTexels = image.levels[level - image.firstLevel].data();
+		upload.size = image.levels[level - image.firstLevel].size();
+	}
+	else
+	{
+		return;
+	}
+
+	uploads.push_back(upload);
+}
+
+/***********************************************************
+ *  UploadTexels()
+ *
+ *  This method is used for uploading levels of layers into a
+ *  texture array.  The texels are copied into the pixel
+ *  buffer object, so the transfer to the texture runs
+ *  asynchronously instead of blocking on a client copy.
+ ***********************************************************/
+void TextureManager::UploadTexels(int arraySlot, const std::vector<TEXEL_UPLOAD>& uploads)
+{
+	if (uploads.empty())
+	{
+		return;
+	}
+
+	TextureCodec::Format format = GetArrayFormat(arraySlot);
+	int layerSize = GetLayerSize(arraySlot);
+
+	GLsizeiptr size = 0;
+	for (const TEXEL_UPLOAD& upload : uploads)
+	{
+		size += (GLsizeiptr)upload.size;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+	// orphan the previous upload so the copy never waits on it
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_uploadBuffer, GpuMemory::MEMORY_BUFFERS, (size_t)size);
+	unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != NULL)
+	{
+		GLsizeiptr offset = 0;
+		for (const TEXEL_UPLOAD& upload : uploads)
+		{
+			memcpy(mapped + offset, upload.pTexels, upload.size);
+			offset += (GLsizeiptr)upload.size;
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	else
+	{
+		// fall back to a direct upload if the buffer could not be mapped
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + arraySlot);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[arraySlot]);
+
+	GLsizeiptr offset = 0;
+	for (const TEXEL_UPLOAD& upload : uploads)
+	{
+		int levelSize = std::max(layerSize >> upload.level, 1);
+		const void* data = (mapped != NULL) ? (const void*)offset : (const void*)upload.pTexels;
+
+		if (format == TextureCodec::Format::RGBA8)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, 0, upload.layer, levelSize, levelSize, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, data);
+		}
+		else
+		{
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, 0, upload.layer, levelSize, levelSize, 1,
+				GetInternalFormat(format), (GLsizei)upload.size, data);
+		}
+		offset += (GLsizeiptr)upload.size;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  AllocateLevel() / FreeLevel()
+ *
+ *  These methods are used for allocating one mipmap level of
+ *  every layer of the bound texture array, and for freeing a
+ *  level again by giving it a size of zero.  A level outside
+ *  of the base and the max level is never sampled, so the
+ *  array stays complete either way.
+ ***********************************************************/
+void TextureManager::AllocateLevel(int arraySlot, int level)
+{
+	TextureCodec::Format format = GetArrayFormat(arraySlot);
+	int levelSize = std::max(GetLayerSize(arraySlot) >> level, 1);
+
+	if (format == TextureCodec::Format::RGBA8)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelSize, levelSize, m_layerCounts[arraySlot],
+			0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	else
+	{
+		// compressed mipmaps cannot be generated, so every level
+		// is uploaded from the cooked file
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GetInternalFormat(format),
+			levelSize, levelSize, m_layerCounts[arraySlot], 0, (GLsizei)GetLevelBytes(arraySlot, level), NULL);
+	}
+}
+
+void TextureManager::FreeLevel(int level)
+{
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, 0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+}
+
+/***********************************************************
+ *  BeginStreamingRequests()
+ *
+ *  This method is used for starting a new round of texture
+ *  size requests.  Every layer and array falls back to
+ *  wanting only its starting levels, until the objects ask
+ *  for more.
+ ***********************************************************/
+void TextureManager::BeginStreamingRequests()
+{
+	m_streamingRound++;
+	for (int arraySlot = 0; arraySlot < TOTAL_TEXTURE_ARRAYS; arraySlot++)
+	{
+		m_wantedLevels[arraySlot] = GetStartLevel(arraySlot);
+	}
+	for (TEXTURE_INFO& info : m_textures)
+	{
+		info.wantedLevel = GetStartLevel(info.arraySlot);
+	}
+}
+
+/***********************************************************
+ *  RequestTextureSize()
+ *
+ *  This method is used for asking for the level of a texture
+ *  that has at least as many texels across as the pixels it
+ *  covers on screen, so it is not magnified.  Only the layer
+ *  of the texture asks for the level, and its array counts
+ *  as used in this round.
+ ***********************************************************/
+void TextureManager::RequestTextureSize(int textureIndex, float pixelsOnScreen)
+{
+	if ((textureIndex < 0) || (textureIndex >= (int)m_textures.size()) || !m_textures[textureIndex].bResident)
+	{
+		return;
+	}
+
+	TEXTURE_INFO& info = m_textures[textureIndex];
+	int layerSize = GetLayerSize(info.arraySlot);
+	int startLevel = GetStartLevel(info.arraySlot);
+
+	int level = 0;
+	while ((level < startLevel) && ((float)(layerSize >> (level + 1)) >= pixelsOnScreen))
+	{
+		level++;
+	}
+	level = std::max(level, std::min(info.finestLevel, startLevel));
+
+	info.wantedLevel = std::min(info.wantedLevel, level);
+	m_wantedLevels[info.arraySlot] = std::min(m_wantedLevels[info.arraySlot], level);
+	m_lastUsed[info.arraySlot] = m_streamingRound;
+}
+
+/***********************************************************
+ *  UpdateStreaming()
+ *
+ *  This method is used for streaming in the levels the last
+ *  round of requests asked for, the layer furthest from its
+ *  wanted level first.  The array levels the layer needs are
+ *  allocated one at a time, and the levels of the layer are
+ *  then read on a worker thread.  With a memory budget, an
+ *  array level is only allocated once the levels nothing
+ *  asked for made room for it, and when the other
+ *  allocations grew over the budget the textures give up
+ *  levels in use as well.  It is called on the GL thread
+ *  once per frame.
+ ***********************************************************/
+int TextureManager::UpdateStreaming(int maxLevelUploads)
+{
+	m_bStreamingPending = false;
+	if (!m_bArraysBuilt)
+	{
+		return(0);
+	}
+
+	const size_t budget = GpuMemory::GetBudget();
+	int changes = 0;
+	while ((budget > 0) && (GpuMemory::GetTotalUsage() > budget) && EvictLevel(-1, true))
+	{
+		changes++;
+	}
+
+	int uploads = 0;
+	while (uploads < maxLevelUploads)
+	{
+		int streamIndex = -1;
+		for (int textureIndex = 0; textureIndex < (int)m_textures.size(); textureIndex++)
+		{
+			const TEXTURE_INFO& info = m_textures[textureIndex];
+			if (!info.bResident || info.bReading || (info.wantedLevel >= info.residentLevel))
+			{
+				continue;
+			}
+			if ((streamIndex < 0) ||
+				(info.residentLevel - info.wantedLevel >
+					m_textures[streamIndex].residentLevel - m_textures[streamIndex].wantedLevel))
+			{
+				streamIndex = textureIndex;
+			}
+		}
+		if (streamIndex < 0)
+		{
+			break;
+		}
+
+		TEXTURE_INFO& info = m_textures[streamIndex];
+		int arraySlot = info.arraySlot;
+		while ((m_topLevels[arraySlot] > info.wantedLevel) && (uploads < maxLevelUploads))
+		{
+			size_t bytes = GetLevelBytes(arraySlot, m_topLevels[arraySlot] - 1);
+			while ((budget > 0) && (GpuMemory::GetTotalUsage() + bytes > budget) && EvictLevel(arraySlot, false))
+			{
+				changes++;
+			}
+			if ((budget > 0) && (GpuMemory::GetTotalUsage() + bytes > budget))
+			{
+				break;
+			}
+
+			AddArrayLevel(arraySlot);
+			uploads++;
+			changes++;
+		}
+
+		int firstLevel = std::max(info.wantedLevel, m_topLevels[arraySlot]);
+		if (firstLevel >= info.residentLevel)
+		{
+			// the level does not fit until other arrays fall out of
+			// use, so it is not asked for again in this round
+			info.wantedLevel = info.residentLevel;
+			continue;
+		}
+
+		QueueRead(streamIndex, firstLevel, info.residentLevel, false, true);
+		uploads++;
+		changes++;
+	}
+	UpdateLevelBlock();
+
+	for (const TEXTURE_INFO& info : m_textures)
+	{
+		if (info.bReading || (info.bResident && (info.wantedLevel < info.residentLevel)))
+		{
+			m_bStreamingPending = true;
+		}
+	}
+
+	return(changes);
+}
+
+/***********************************************************
+ *  AddArrayLevel()
+ *
+ *  This method is used for allocating the next finer level of
+ *  a texture array for all of its layers.  The level holds no
+ *  texels until the layers asking for it are streamed in, and
+ *  the other layers are never sampled above their own levels.
+ ***********************************************************/
+void TextureManager::AddArrayLevel(int arraySlot)
+{
+	int level = m_topLevels[arraySlot] - 1;
+
+	glActiveTexture(GL_TEXTURE0 + arraySlot);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[arraySlot]);
+	AllocateLevel(arraySlot, level);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, level);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_topLevels[arraySlot] = level;
+	GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_textureArrays[arraySlot], GpuMemory::MEMORY_TEXTURES, GetArrayBytes(arraySlot));
+}
+
+/***********************************************************
+ *  EvictLevel()
+ *
+ *  This method is used for freeing the finest level of a
+ *  texture array that holds more than its starting levels.
+ *  The levels finer than the last round asked for go first,
+ *  and among those the least recently used array, so a level
+ *  still in use is only evicted when that is allowed and
+ *  nothing else is left.  The layers holding the level drop
+ *  back to the next one.
+ ***********************************************************/
+bool TextureManager::EvictLevel(int keepSlot, bool bAllowInUse)
+{
+	int evictSlot = -1;
+	bool bEvictUnused = false;
+	for (int arraySlot = 0; arraySlot < TOTAL_TEXTURE_ARRAYS; arraySlot++)
+	{
+		if ((arraySlot == keepSlot) || (m_textureArrays[arraySlot] == 0) ||
+			(m_topLevels[arraySlot] >= GetStartLevel(arraySlot)))
+		{
+			continue;
+		}
+
+		bool bUnused = (m_topLevels[arraySlot] < m_wantedLevels[arraySlot]);
+		if (!bUnused && !bAllowInUse)
+		{
+			continue;
+		}
+		if ((evictSlot < 0) || (bUnused && !bEvictUnused) ||
+			((bUnused == bEvictUnused) && (m_lastUsed[arraySlot] < m_lastUsed[evictSlot])))
+		{
+			evictSlot = arraySlot;
+			bEvictUnused = bUnused;
+		}
+	}
+	if (evictSlot < 0)
+	{
+		return(false);
+	}
+
+	// stop sampling the level before it is freed
+	int level = m_topLevels[evictSlot];
+	for (TEXTURE_INFO& info : m_textures)
+	{
+		if ((info.arraySlot == evictSlot) && (info.residentLevel <= level))
+		{
+			info.residentLevel = level + 1;
+			SetLayerLevel(evictSlot, info.layer, info.residentLevel);
+		}
+	}
+	glActiveTexture(GL_TEXTURE0 + evictSlot);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[evictSlot]);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, level + 1);
+	FreeLevel(level);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_topLevels[evictSlot] = level + 1;
+	GpuMemory::Track(GpuMemory::OBJECT_TEXTURE, m_textureArrays[evictSlot], GpuMemory::MEMORY_TEXTURES, GetArrayBytes(evictSlot));
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindTextureArrays()
+ *
+ *  This method is used for binding each texture array to the
+ *  texture unit matching its array slot.
+ ***********************************************************/
+void TextureManager::BindTextureArrays()
+{
+	for (int arraySlot = 0; arraySlot < TOTAL_TEXTURE_ARRAYS; arraySlot++)
+	{
+		glActiveTexture(GL_TEXTURE0 + arraySlot);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[arraySlot]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the texture arrays and
+ *  forgetting all of the loaded textures.
+ ***********************************************************/
+void TextureManager::DestroyTextures()
+{
+	// let the workers finish so no late results arrive
+	if (m_pLoader != NULL)
+	{
+		m_pLoader->WaitIdle();
+	}
+	m_completedImages.clear();
+	m_pendingLoads = 0;
+
+	for (int arraySlot = 0; arraySlot < TOTAL_TEXTURE_ARRAYS; arraySlot++)
+	{
+		if (m_textureArrays[arraySlot] != 0)
+		{
+			GpuMemory::Release(GpuMemory::OBJECT_TEXTURE, m_textureArrays[arraySlot]);
+			glDeleteTextures(1, &m_textureArrays[arraySlot]);
+			m_textureArrays[arraySlot] = 0;
+		}
+		m_layerCounts[arraySlot] = 0;
+		m_topLevels[arraySlot] = 0;
+		m_wantedLevels[arraySlot] = 0;
+		m_lastUsed[arraySlot] = 0;
+	}
+	m_layerCounts[0] = 1;
+	m_bStreamingPending = false;
+	m_levelBlock.Destroy();
+	memset(&m_levelData, 0, sizeof(m_levelData));
+	m_bLevelsDirty = false;
+
+	if (m_uploadBuffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_uploadBuffer);
+		glDeleteBuffers(1, &m_uploadBuffer);
+		m_uploadBuffer = 0;
+	}
+
+	m_textures.clear();
+	m_textureIndex.clear();
+	m_bArraysBuilt = false;
+}
+
+/***********************************************************
+ *  FindTexture()
+ *
+ *  This method is used for getting the index of the previously
+ *  loaded texture associated with the passed in tag.  Tags
+ *  that share a hash are told apart by comparing the stored
+ *  tag.
+ ***********************************************************/
+int TextureManager::FindTexture(const char* tag) const
+{
+	typedef std::unordered_multimap<uint32_t, int>::const_iterator IndexIterator;
+	std::pair<IndexIterator, IndexIterator> range = m_textureIndex.equal_range(HashTag(tag));
+
+	for (IndexIterator it = range.first; it != range.second; ++it)
+	{
+		if (m_textures[it->second].tag.compare(tag) == 0)
+		{
+			return(it->second);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  GetShaderIndex()
+ *
+ *  This method is used for getting the index the shaders use
+ *  to sample a loaded texture.  The array slot is stored in
+ *  the upper 16 bits and the layer in the lower 16 bits.  A
+ *  texture that is still loading samples the placeholder.
+ ***********************************************************/
+int TextureManager::GetShaderIndex(int textureIndex) const
+{
+	if ((textureIndex < 0) || (textureIndex >= (int)m_textures.size()))
+	{
+		return(-1);
+	}
+	if (!m_textures[textureIndex].bResident)
+	{
+		return(PLACEHOLDER_SHADER_INDEX);
+	}
+
+	return((m_textures[textureIndex].arraySlot << 16) | m_textures[textureIndex].layer);
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method is used for getting the bytes of video memory
+ *  the layer of a loaded texture holds in its texture array,
+ *  which follows the levels streamed into the array.
+ ***********************************************************/
+size_t TextureManager::GetTextureBytes(int textureIndex) const
+{
+	if ((textureIndex < 0) || (textureIndex >= (int)m_textures.size()) || !m_bArraysBuilt)
+	{
+		return(0);
+	}
+
+	int arraySlot = m_textures[textureIndex].arraySlot;
+
+	return(GetArrayBytes(arraySlot) / m_layerCounts[arraySlot]);
+}
+
+/***********************************************************
+ *  GetLevelBytes() / GetArrayBytes()
+ *
+ *  These methods are used for getting the bytes of one level
+ *  of every layer of a texture array, and of all of the levels
+ *  it holds at the moment.
+ ***********************************************************/
+size_t TextureManager::GetLevelBytes(int arraySlot, int level) const
+{
+	int levelSize = std::max(GetLayerSize(arraySlot) >> level, 1);
+
+	return(TextureCodec::GetLevelSize(GetArrayFormat(arraySlot), levelSize, levelSize) * m_layerCounts[arraySlot]);
+}
+
+size_t TextureManager::GetArrayBytes(int arraySlot) const
+{
+	if (m_textureArrays[arraySlot] == 0)
+	{
+		return(0);
+	}
+
+	int layerSize = GetLayerSize(arraySlot);
+	int mipCount = TextureCodec::GetMipCount(layerSize, layerSize);
+	size_t bytes = 0;
+	for (int level = m_topLevels[arraySlot]; level < mipCount; level++)
+	{
+		bytes += GetLevelBytes(arraySlot, level);
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  SetLayerLevel() / UpdateLevelBlock()
+ *
+ *  These methods are used for storing the finest resident
+ *  level of a layer in the level table of the shaders, one
+ *  byte per layer packed four to a word, and for uploading
+ *  the table once after a batch of changes.
+ ***********************************************************/
+void TextureManager::SetLayerLevel(int arraySlot, int layer, int level)
+{
+	int entry = arraySlot * MAX_ARRAY_LAYERS + layer;
+	GLuint& word = m_levelData.layerLevels[entry / 16][(entry / 4) % 4];
+	int shift = (entry % 4) * 8;
+
+	word = (word & ~(0xFFu << shift)) | ((GLuint)level << shift);
+	m_bLevelsDirty = true;
+}
+
+void TextureManager::UpdateLevelBlock()
+{
+	if (m_bLevelsDirty)
+	{
+		m_levelBlock.Update(&m_levelData, sizeof(m_levelData));
+		m_bLevelsDirty = false;
+	}
+}
+
+/***********************************************************
+ *  GetStartLevel()
+ *
+ *  This method is used for getting the finest mipmap level a
+ *  texture array is allocated with before any streaming, the
+ *  first level no larger than the starting size.  Evicting
+ *  never goes past it.
+ ***********************************************************/
+int TextureManager::GetStartLevel(int arraySlot)
+{
+	int layerSize = GetLayerSize(arraySlot);
+	int level = 0;
+	while ((layerSize >> level) > STREAM_START_SIZE)
+	{
+		level++;
+	}
+
+	return(level);
+}
+
+/***********************************************************
+ *  FindCookedFile()
+ *
+ *  This method is used for finding the cooked DDS file next
+ *  to an image file.  The file is only used when the GPU can
+ *  sample its format and it has the size of a texture array
+ *  layer with the complete mipmap chain, otherwise the loader
+ *  falls back to decoding the image.
+ ***********************************************************/
+std::string TextureManager::FindCookedFile(const char* filename, TextureCodec::Format& format, int& layerSlot)
+{
+	std::string cookedPath = TextureCodec::GetCookedFilename(filename);
+	int width = 0;
+	int height = 0;
+	int mipCount = 0;
+	if (!TextureCodec::ReadDDSHeader(cookedPath.c_str(), format, width, height, mipCount))
+	{
+		format = TextureCodec::Format::RGBA8;
+		return(std::string());
+	}
+
+	if (!IsUsableCooked(format, width, height, mipCount, layerSlot))
+	{
+		std::cout << "Ignoring unusable cooked texture:" << cookedPath << std::endl;
+		format = TextureCodec::Format::RGBA8;
+		return(std::string());
+	}
+
+	return(cookedPath);
+}
+
+/***********************************************************
+ *  IsUsableCooked()
+ *
+ *  This method is used for checking that the GPU can sample a
+ *  cooked texture, and that it has the size of a texture
+ *  array layer with the complete mipmap chain.
+ ***********************************************************/
+bool TextureManager::IsUsableCooked(TextureCodec::Format format, int width, int height, int mipCount, int& layerSlot)
+{
+	layerSlot = TextureCodec::ChooseLayerSlot(width, height);
+
+	return(GLEW_EXT_texture_compression_s3tc &&
+		(format != TextureCodec::Format::RGBA8) &&
+		(width == height) &&
+		(width == TextureCodec::GetLayerSize(layerSlot)) &&
+		(mipCount == TextureCodec::GetMipCount(width, height)));
+}
+
+/***********************************************************
+ *  GetInternalFormat()
+ *
+ *  This method is used for getting the OpenGL internal format
+ *  of the texture arrays holding a texel format.
+ ***********************************************************/
+GLenum TextureManager::GetInternalFormat(TextureCodec::Format format)
+{
+	switch (format)
+	{
+	case TextureCodec::Format::BC1:
+		return(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+	case TextureCodec::Format::BC3:
+		return(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+	default:
+		return(GL_RGBA8);
+	}
+}
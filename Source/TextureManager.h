@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturemanager.h
+// ============
+// manage the scene textures packed into OpenGL 2D texture arrays
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCodec.h"
+#include "ThreadPool.h"
+#include "UniformBuffer.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TextureManager
+ *
+ *  This class loads the scene textures and packs them into a
+ *  small, fixed set of GL_TEXTURE_2D_ARRAY textures, one per
+ *  power-of-two layer size.  Each loaded image is resampled to
+ *  the layer size of its array, so objects select a texture by
+ *  an integer layer index instead of a texture unit.  That
+ *  removes the old limit of 16 textures and the per-draw
+ *  sampler switches.
+ *
+ *  A texture that has a cooked DDS file next to its image is
+ *  loaded block compressed with its stored mipmaps, in arrays
+ *  of its own per compression format.  Images are only
+ *  decoded when there is no usable cooked file.
+ *
+ *  Images are decoded and resampled on a pool of worker
+ *  threads, and uploaded on the GL thread through a pixel
+ *  buffer object as the results arrive.  Until its image is
+ *  uploaded, a texture samples a grey placeholder layer.
+ *
+ *  The textures start out with only their mipmaps of 128x128
+ *  and smaller, and the finer levels of a layer are read
+ *  again from its cooked file, its image or its asset pack
+ *  as the objects using it grow on screen, so no decoded
+ *  copy of the texels is kept.  Each layer keeps its own
+ *  finest level, and the shaders never sample a layer above
+ *  it.  The layers of an array still share the storage of
+ *  their levels, so a level is allocated while any layer
+ *  needs it and only freed for the whole array.  Under a
+ *  video memory budget the levels nothing asked for lately
+ *  are evicted first, least recently used array first, to
+ *  make room for the levels in use.
+ ***********************************************************/
+class TextureManager
+{
+public:
+	// constructor
+	TextureManager();
+	// destructor
+	~TextureManager();
+
+	// number of texture arrays, one per texel format and layer size
+	static const int TOTAL_TEXTURE_ARRAYS = TextureCodec::FORMAT_COUNT * TextureCodec::LAYER_SIZE_COUNT;
+	// shader index of the placeholder, layer 0 of the first array
+	static const int PLACEHOLDER_SHADER_INDEX = 0;
+
+	// TEXTURE_INFO struct describes a loaded texture
+	struct TEXTURE_INFO
+	{
+		std::string tag;
+		TextureCodec::Format format;  // how the texels are stored
+		int arraySlot;       // which texture array holds the texture
+		int layer;           // layer inside the texture array
+		int width;           // size of the source image
+		int height;
+		bool bResident;      // true once the image is uploaded
+		int residentLevel;   // finest mipmap level uploaded into the layer
+		int wantedLevel;     // finest level asked for in the last round
+		int finestLevel;     // finest level that can be streamed in, raised
+		                     // when the source cannot be read again
+		bool bReading;       // true while finer levels are read
+		int version;         // counts the reloads, levels read from an
+		                     // older source are dropped
+		std::string sourceFile;   // image file watched for changes, the
+		                          // cooked file when there is no image,
+		                          // empty for a texture loaded from memory
+		std::string cookedFile;   // cooked file the texels are read from,
+		                          // empty when the image is decoded
+		const unsigned char* pMappedTexels;  // every level of a cooked file
+		                                     // in memory, NULL otherwise
+		const unsigned char* pImageData;     // image in memory decoded
+		size_t imageSize;                    // again for finer levels
+	};
+
+	// queue an image file to be decoded and packed into the arrays
+	bool LoadTexture(const char* filename, const char* tag);
+	// queue an image or cooked file in memory, which must stay
+	// valid while the texture is loaded
+	bool LoadTextureFromMemory(const unsigned char* data, size_t size, const char* tag);
+	// queue the source file of a loaded texture to be read again
+	// into its existing layer, the texture keeps its current
+	// texels until the new ones are uploaded
+	bool ReloadTexture(int textureIndex);
+	// allocate the texture arrays for all of the queued textures
+	void BuildTextureArrays();
+	// upload decoded images that are ready, returns the number of
+	// textures that became resident
+	int ProcessCompletedLoads(int maxUploads);
+	// block until every queued image is decoded and uploaded
+	void WaitForLoads();
+	// true while some of the queued images are still loading
+	bool IsLoading() const { return(m_pendingLoads > 0); }
+	// bind the texture arrays to their texture units
+	void BindTextureArrays();
+	// free the texture arrays
+	void DestroyTextures();
+
+	// find the index of a loaded texture by tag, -1 if not found
+	int FindTexture(const char* tag) const;
+	// get the index the shaders use to sample a loaded texture,
+	// which packs the array slot and the layer
+	int GetShaderIndex(int textureIndex) const;
+	// get the description of a loaded texture
+	const TEXTURE_INFO& GetTextureInfo(int textureIndex) const { return(m_textures[textureIndex]); }
+	// get the number of loaded textures
+	int GetTextureCount() const { return((int)m_textures.size()); }
+	// get the bytes of video memory the layer of a texture holds
+	size_t GetTextureBytes(int textureIndex) const;
+
+	// start a new round of texture size requests, the arrays not
+	// asked for during it count as unused
+	void BeginStreamingRequests();
+	// ask for a texture to be sharp when it covers the passed in
+	// number of pixels across on screen
+	void RequestTextureSize(int textureIndex, float pixelsOnScreen);
+	// stream in up to the passed in number of requested levels,
+	// evicting unused levels to stay within the memory budget,
+	// returns the number of levels streamed in or evicted
+	int UpdateStreaming(int maxLevelUploads);
+	// true while requested levels wait for their turn to upload
+	bool IsStreaming() const { return(m_bStreamingPending); }
+
+private:
+	// loaded textures in load order
+	std::vector<TEXTURE_INFO> m_textures;
+	// maps a hashed texture tag to its index in m_textures, tags
+	// sharing a hash each keep an entry
+	std::unordered_multimap<uint32_t, int> m_textureIndex;
+	// OpenGL texture array objects, 0 if the array is unused
+	GLuint m_textureArrays[TOTAL_TEXTURE_ARRAYS];
+	// number of layers used in each texture array
+	int m_layerCounts[TOTAL_TEXTURE_ARRAYS];
+	// true once the texture arrays have been allocated
+	bool m_bArraysBuilt;
+	// finest mipmap level allocated in each texture array
+	int m_topLevels[TOTAL_TEXTURE_ARRAYS];
+	// finest mipmap level the objects asked for in any layer of
+	// each array during the last round of requests
+	int m_wantedLevels[TOTAL_TEXTURE_ARRAYS];
+	// round of requests each array was last asked for in
+	long long m_lastUsed[TOTAL_TEXTURE_ARRAYS];
+	// number of request rounds started so far
+	long long m_streamingRound;
+	// true while requested levels are not streamed in yet
+	bool m_bStreamingPending;
+	// finest resident level of every layer for the shaders
+	UniformBuffer m_levelBlock;
+	UniformBuffer::TEXTURE_BLOCK m_levelData;
+	// true when m_levelData changed since its last upload
+	bool m_bLevelsDirty;
+
+	// DECODED_IMAGE struct holds the levels a worker read for a
+	// layer, already resampled to the layer size of its array
+	struct DECODED_IMAGE
+	{
+		int textureIndex;
+		bool bSuccess;
+		// true for finer levels of a resident texture
+		bool bStreamed;
+		// version of the texture the levels were read for
+		int version;
+		// mipmap level of the first of the levels
+		int firstLevel;
+		// texels of each mipmap level, decoded images have their
+		// mipmaps built on the worker
+		std::vector<std::vector<unsigned char>> levels;
+		// texels of every level of a cooked file in memory, used
+		// in place of the levels when not NULL
+		const unsigned char* pMappedTexels;
+	};
+
+	// worker threads decoding the queued images
+	ThreadPool* m_pLoader;
+	// decoded images waiting to be uploaded
+	std::vector<DECODED_IMAGE> m_completedImages;
+	// guards m_completedImages
+	std::mutex m_completedMutex;
+	// number of queued images not uploaded yet
+	int m_pendingLoads;
+	// pixel buffer object used to stream the uploads
+	GLuint m_uploadBuffer;
+
+	// TEXEL_UPLOAD struct locates the texels of one level of a layer
+	struct TEXEL_UPLOAD
+	{
+		int layer;
+		int level;
+		const unsigned char* pTexels;
+		size_t size;
+	};
+
+	// read the levels of a texture from the first up to the end
+	// level on a worker thread, from its cooked file, its image or
+	// its memory, cooking the image into the file first when asked to
+	void QueueRead(int textureIndex, int firstLevel, int endLevel, bool bCookFirst, bool bStreamed);
+	// upload the levels read for a texture into its layer
+	void UploadImage(const DECODED_IMAGE& image);
+	// add a level of an image to a list of uploads
+	void AddLevelUpload(const DECODED_IMAGE& image, int arraySlot, int layer, int level, std::vector<TEXEL_UPLOAD>& uploads) const;
+	// copy levels of layers into a texture array through the pixel
+	// buffer object
+	void UploadTexels(int arraySlot, const std::vector<TEXEL_UPLOAD>& uploads);
+	// allocate or free one mipmap level of the bound texture array
+	void AllocateLevel(int arraySlot, int level);
+	void FreeLevel(int level);
+	// allocate the next finer level of a texture array
+	void AddArrayLevel(int arraySlot);
+	// evict the finest level of the least recently used array that
+	// is not the kept one, levels still in use only when allowed,
+	// returns false when there is no level to evict
+	bool EvictLevel(int keepSlot, bool bAllowInUse);
+	// get the bytes of one level of a texture array
+	size_t GetLevelBytes(int arraySlot, int level) const;
+	// get the bytes of the allocated levels of a texture array
+	size_t GetArrayBytes(int arraySlot) const;
+	// set the finest resident level of a layer for the shaders, and
+	// upload the changed levels
+	void SetLayerLevel(int arraySlot, int layer, int level);
+	void UpdateLevelBlock();
+	// assign a new texture to a layer, returns -1 on failure
+	int RegisterTexture(const char* tag, TextureCodec::Format format, int layerSlot, int width, int height);
+
+	// find a usable cooked file for an image, empty if there is none
+	static std::string FindCookedFile(const char* filename, TextureCodec::Format& format, int& layerSlot);
+	// get the texture array for a texel format and layer size
+	static int GetArraySlot(TextureCodec::Format format, int layerSlot)
+		{ return((int)format * TextureCodec::LAYER_SIZE_COUNT + layerSlot); }
+	// get the texel format of a texture array
+	static TextureCodec::Format GetArrayFormat(int arraySlot)
+		{ return((TextureCodec::Format)(arraySlot / TextureCodec::LAYER_SIZE_COUNT)); }
+	// get the layer size of a texture array
+	static int GetLayerSize(int arraySlot)
+		{ return(TextureCodec::GetLayerSize(arraySlot % TextureCodec::LAYER_SIZE_COUNT)); }
+	// get the finest mipmap level a texture array starts out with
+	static int GetStartLevel(int arraySlot);
+	// true if the GPU can use a cooked texture as is
+	static bool IsUsableCooked(TextureCodec::Format format, int width, int height, int mipCount, int& layerSlot);
+	// get the OpenGL internal format of a texel format
+	static GLenum GetInternalFormat(TextureCodec::Format format);
+};
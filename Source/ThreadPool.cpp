@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// run background jobs on a fixed set of worker threads
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(int workerCount)
+{
+	m_activeJobs = 0;
+	m_bStopping = false;
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 1)
+		{
+			workerCount = 1;
+		}
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queuing a job to run on the next
+ *  free worker thread.
+ ***********************************************************/
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobAvailable.notify_one();
+}
+
+/***********************************************************
+ *  WaitIdle()
+ *
+ *  This method is used for blocking the calling thread until
+ *  the job queue is empty and no job is running.
+ ***********************************************************/
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return(m_jobs.empty() && (m_activeJobs == 0)); });
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the main loop of each worker thread.  It
+ *  runs queued jobs until the pool is stopped, and drains the
+ *  queue before exiting.
+ ***********************************************************/
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this]() { return(m_bStopping || !m_jobs.empty()); });
+			if (m_jobs.empty())
+			{
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			m_activeJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeJobs--;
+			if (m_jobs.empty() && (m_activeJobs == 0))
+			{
+				m_idle.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// run background jobs on a fixed set of worker threads
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class runs submitted jobs on a fixed number of worker
+ *  threads.  Jobs must not make OpenGL calls, since the GL
+ *  context belongs to the main thread.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// constructor - zero workers picks one less than the
+	// number of hardware threads
+	ThreadPool(int workerCount = 0);
+	// destructor - waits for the queued jobs to finish
+	~ThreadPool();
+
+	// queue a job to run on one of the worker threads
+	void Submit(std::function<void()> job);
+	// block until all of the queued jobs have finished
+	void WaitIdle();
+	// get the number of worker threads
+	int GetWorkerCount() const { return((int)m_workers.size()); }
+
+private:
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// jobs waiting for a worker
+	std::deque<std::function<void()>> m_jobs;
+	// guards the job queue and the counters
+	std::mutex m_mutex;
+	// signaled when a job is queued or the pool stops
+	std::condition_variable m_jobAvailable;
+	// signaled when the pool runs out of work
+	std::condition_variable m_idle;
+	// number of jobs currently running
+	int m_activeJobs;
+	// true when the workers should exit
+	bool m_bStopping;
+
+	// main loop of each worker thread
+	void WorkerLoop();
+};
@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.cpp
+// ============
+// compose the model matrices of many objects from packed transform values
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBatch.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// SSE2 is always present on x64, and x86 builds enable it with
+// /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRANSFORM_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+
+#ifdef TRANSFORM_BATCH_SSE
+	/***********************************************************
+	 *  Select()
+	 *
+	 *  This function is used for taking the lanes of a where the
+	 *  mask is set and the lanes of b everywhere else.
+	 ***********************************************************/
+	inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return(_mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)));
+	}
+
+	/***********************************************************
+	 *  SinCos()
+	 *
+	 *  This function is used for getting the sine and cosine of
+	 *  four angles in radians.  The angle is reduced to the
+	 *  nearest multiple of pi/2, in three parts so the reduction
+	 *  stays exact, and the remainder within pi/4 goes through
+	 *  the minimax polynomials of sinf() and cosf().  The
+	 *  quadrant then swaps and negates the two results.  The
+	 *  error stays within a few float ulps for the angles a
+	 *  scene uses.
+	 ***********************************************************/
+	void SinCos(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		const __m128 twoOverPi = _mm_set1_ps(0.636619772367581f);
+		const __m128 halfPi1 = _mm_set1_ps(1.5703125f);
+		const __m128 halfPi2 = _mm_set1_ps(4.837512969970703125e-4f);
+		const __m128 halfPi3 = _mm_set1_ps(7.54978995489188216e-8f);
+
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, twoOverPi));
+		__m128 q = _mm_cvtepi32_ps(quadrant);
+		__m128 r = _mm_sub_ps(angle, _mm_mul_ps(q, halfPi1));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, halfPi2));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, halfPi3));
+
+		__m128 r2 = _mm_mul_ps(r, r);
+		__m128 sinR = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+		sinR = _mm_add_ps(_mm_mul_ps(sinR, r2), _mm_set1_ps(-1.6666654611e-1f));
+		sinR = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinR, r2), r), r);
+
+		__m128 cosR = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+		cosR = _mm_add_ps(_mm_mul_ps(cosR, r2), _mm_set1_ps(4.166664568298827e-2f));
+		cosR = _mm_mul_ps(_mm_mul_ps(cosR, r2), r2);
+		cosR = _mm_add_ps(_mm_sub_ps(cosR, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+		// the odd quadrants swap the sine and the cosine, the sine
+		// is negative in quadrants 2 and 3 and the cosine in 1 and 2
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i two = _mm_set1_epi32(2);
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+		sine = _mm_xor_ps(Select(swap, cosR, sinR), sinSign);
+		cosine = _mm_xor_ps(Select(swap, sinR, cosR), cosSign);
+	}
+#endif
+
+	/***********************************************************
+	 *  ComposeRadians()
+	 *
+	 *  This function is used for composing one model matrix
+	 *  from rotation angles in radians.
+	 ***********************************************************/
+	glm::mat4 ComposeRadians(const glm::vec3& scale, const glm::vec3& angles, const glm::vec3& position)
+	{
+		const float sx = sinf(angles.x);
+		const float cx = cosf(angles.x);
+		const float sy = sinf(angles.y);
+		const float cy = cosf(angles.y);
+		const float sz = sinf(angles.z);
+		const float cz = cosf(angles.z);
+
+		glm::mat4 model;
+		model[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * scale.x;
+		model[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) * scale.y;
+		model[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) * scale.z;
+		model[3] = glm::vec4(position, 1.0f);
+
+		return(model);
+	}
+}
+
+/***********************************************************
+ *  TransformBatch()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformBatch::TransformBatch()
+{
+	m_count = 0;
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for setting the transform values of
+ *  an object.  The arrays grow to hold the passed in index,
+ *  and the matrix is composed by the next update.
+ ***********************************************************/
+void TransformBatch::SetTransform(int index, const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& position)
+{
+	if (index >= m_count)
+	{
+		m_count = index + 1;
+		size_t paddedCount = (size_t)((m_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH);
+		if (paddedCount > m_dirty.size())
+		{
+			m_scaleX.resize(paddedCount, 0.0f);
+			m_scaleY.resize(paddedCount, 0.0f);
+			m_scaleZ.resize(paddedCount, 0.0f);
+			m_angleX.resize(paddedCount, 0.0f);
+			m_angleY.resize(paddedCount, 0.0f);
+			m_angleZ.resize(paddedCount, 0.0f);
+			m_positionX.resize(paddedCount, 0.0f);
+			m_positionY.resize(paddedCount, 0.0f);
+			m_positionZ.resize(paddedCount, 0.0f);
+			m_dirty.resize(paddedCount, 0);
+			m_matrices.resize(paddedCount, glm::mat4(1.0f));
+		}
+	}
+
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	m_angleX[index] = rotationDeg.x * DEGREES_TO_RADIANS;
+	m_angleY[index] = rotationDeg.y * DEGREES_TO_RADIANS;
+	m_angleZ[index] = rotationDeg.z * DEGREES_TO_RADIANS;
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_dirty[index] = 1;
+}
+
+/***********************************************************
+ *  MarkAll()
+ *
+ *  This method is used for marking every transform, so the
+ *  next update composes all of the matrices again.
+ ***********************************************************/
+void TransformBatch::MarkAll()
+{
+	if (m_count > 0)
+	{
+		memset(m_dirty.data(), 1, (size_t)m_count);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the transforms.
+ ***********************************************************/
+void TransformBatch::Clear()
+{
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_angleX.clear();
+	m_angleY.clear();
+	m_angleZ.clear();
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_dirty.clear();
+	m_matrices.clear();
+	m_updated.clear();
+	m_count = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for composing the matrices of the
+ *  marked transforms.  The marks are read a group at a time
+ *  so the unchanged groups cost one test, and a group with
+ *  any mark is composed as a whole.
+ ***********************************************************/
+const std::vector<int>& TransformBatch::Update()
+{
+	m_updated.clear();
+
+	for (int first = 0; first < m_count; first += SIMD_WIDTH)
+	{
+		uint32_t marks;
+		memcpy(&marks, &m_dirty[first], sizeof(marks));
+		if (marks == 0)
+		{
+			continue;
+		}
+
+		ComposeGroup(first);
+		for (int i = first; (i < first + SIMD_WIDTH) && (i < m_count); i++)
+		{
+			if (m_dirty[i] != 0)
+			{
+				m_updated.push_back(i);
+				m_dirty[i] = 0;
+			}
+		}
+	}
+
+	return(m_updated);
+}
+
+/***********************************************************
+ *  ComposeGroup()
+ *
+ *  This method is used for composing the matrices of four
+ *  neighbouring transforms.  The rotation Rz * Ry * Rx is
+ *  written out from the sines and cosines, each of its
+ *  columns is scaled by the matching axis scale and the
+ *  position becomes the last column.  With SSE each matrix
+ *  element is worked out for all four transforms at once,
+ *  and every column is transposed into the four matrices.
+ ***********************************************************/
+void TransformBatch::ComposeGroup(int first)
+{
+#ifdef TRANSFORM_BATCH_SSE
+	__m128 sx, cx, sy, cy, sz, cz;
+	SinCos(_mm_loadu_ps(&m_angleX[first]), sx, cx);
+	SinCos(_mm_loadu_ps(&m_angleY[first]), sy, cy);
+	SinCos(_mm_loadu_ps(&m_angleZ[first]), sz, cz);
+
+	const __m128 scaleX = _mm_loadu_ps(&m_scaleX[first]);
+	const __m128 scaleY = _mm_loadu_ps(&m_scaleY[first]);
+	const __m128 scaleZ = _mm_loadu_ps(&m_scaleZ[first]);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 czsy = _mm_mul_ps(cz, sy);
+	const __m128 szsy = _mm_mul_ps(sz, sy);
+
+	// the columns of the four matrices, one register per row
+	__m128 columns[4][4];
+	columns[0][0] = _mm_mul_ps(_mm_mul_ps(cz, cy), scaleX);
+	columns[0][1] = _mm_mul_ps(_mm_mul_ps(sz, cy), scaleX);
+	columns[0][2] = _mm_mul_ps(_mm_sub_ps(zero, sy), scaleX);
+	columns[0][3] = zero;
+
+	columns[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(czsy, sx), _mm_mul_ps(sz, cx)), scaleY);
+	columns[1][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(szsy, sx), _mm_mul_ps(cz, cx)), scaleY);
+	columns[1][2] = _mm_mul_ps(_mm_mul_ps(cy, sx), scaleY);
+	columns[1][3] = zero;
+
+	columns[2][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(sz, sx)), scaleZ);
+	columns[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(szsy, cx), _mm_mul_ps(cz, sx)), scaleZ);
+	columns[2][2] = _mm_mul_ps(_mm_mul_ps(cy, cx), scaleZ);
+	columns[2][3] = zero;
+
+	columns[3][0] = _mm_loadu_ps(&m_positionX[first]);
+	columns[3][1] = _mm_loadu_ps(&m_positionY[first]);
+	columns[3][2] = _mm_loadu_ps(&m_positionZ[first]);
+	columns[3][3] = _mm_set1_ps(1.0f);
+
+	for (int column = 0; column < 4; column++)
+	{
+		_MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+		for (int lane = 0; lane < SIMD_WIDTH; lane++)
+		{
+			_mm_storeu_ps(&m_matrices[first + lane][column][0], columns[column][lane]);
+		}
+	}
+#else
+	for (int i = first; i < first + SIMD_WIDTH; i++)
+	{
+		m_matrices[i] = ComposeRadians(
+			glm::vec3(m_scaleX[i], m_scaleY[i], m_scaleZ[i]),
+			glm::vec3(m_angleX[i], m_angleY[i], m_angleZ[i]),
+			glm::vec3(m_positionX[i], m_positionY[i], m_positionZ[i]));
+	}
+#endif
+}
+
+/***********************************************************
+ *  Compose()
+ *
+ *  This method is used for composing one model matrix the
+ *  same way as the batched update, for the objects drawn
+ *  one at a time.  The result matches
+ *  translate * rotateZ * rotateY * rotateX * scale.
+ ***********************************************************/
+glm::mat4 TransformBatch::Compose(const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& position)
+{
+	return(ComposeRadians(scale, rotationDeg * DEGREES_TO_RADIANS, position));
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.h
+// ============
+// compose the model matrices of many objects from packed transform values
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TransformBatch
+ *
+ *  This class keeps the scale, the rotation angles and the
+ *  position of many objects as packed arrays, one array per
+ *  axis, next to the model matrix composed from them.  A
+ *  matrix is written straight from the sines and cosines of
+ *  its angles instead of multiplying a matrix for each part
+ *  of the transform, four objects at a time with SSE.  Only
+ *  the transforms changed since the last update are composed
+ *  again, every other object keeps its cached matrix.
+ ***********************************************************/
+class TransformBatch
+{
+public:
+	// constructor
+	TransformBatch();
+
+	// set the transform values of an object and mark it for the
+	// next update, the rotation is in degrees around X, Y and Z
+	void SetTransform(int index, const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& position);
+	// mark every transform for the next update
+	void MarkAll();
+	// remove all of the transforms
+	void Clear();
+
+	// compose the matrices of the marked transforms, returns the
+	// indices of the transforms that were composed
+	const std::vector<int>& Update();
+
+	// get the number of transforms
+	int GetCount() const { return(m_count); }
+	// get the composed model matrix of a transform
+	const glm::mat4& GetMatrix(int index) const { return(m_matrices[index]); }
+
+	// compose one model matrix, scaled first, then rotated around
+	// X, Y and Z and moved to the position last
+	static glm::mat4 Compose(const glm::vec3& scale, const glm::vec3& rotationDeg, const glm::vec3& position);
+
+private:
+	// transforms composed together, the arrays are padded to a multiple
+	static const int SIMD_WIDTH = 4;
+
+	// packed transform values of each axis, the angles in radians
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<float> m_angleX;
+	std::vector<float> m_angleY;
+	std::vector<float> m_angleZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	// set for a transform changed since the last update
+	std::vector<unsigned char> m_dirty;
+	// composed model matrix of each transform
+	std::vector<glm::mat4> m_matrices;
+	// transforms composed by the last update
+	std::vector<int> m_updated;
+	// number of transforms, without the padding
+	int m_count;
+
+	// compose the group of transforms starting at a multiple of SIMD_WIDTH
+	void ComposeGroup(int first);
+};
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffer.cpp
+// ============
+// std140 uniform blocks shared by all of the shader programs
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBuffer.h"
+#include "GpuMemory.h"
+#include "UniformCache.h"
+
+// the block structs are copied into the buffers as they are, so
+// they have to match the std140 offsets of the shader blocks
+static_assert(offsetof(UniformBuffer::FRAME_BLOCK, projection) == 64, "FrameBlock layout does not match std140");
+static_assert(offsetof(UniformBuffer::FRAME_BLOCK, viewPosition) == 128, "FrameBlock layout does not match std140");
+static_assert(offsetof(UniformBuffer::FRAME_BLOCK, clusterTileScale) == 144, "FrameBlock layout does not match std140");
+static_assert(offsetof(UniformBuffer::FRAME_BLOCK, globalLightCount) == 160, "FrameBlock layout does not match std140");
+static_assert(sizeof(UniformBuffer::FRAME_BLOCK) == 176, "FrameBlock layout does not match std140");
+static_assert(offsetof(UniformBuffer::SHADER_MATERIAL, specularColor) == 16, "Material layout does not match std140");
+static_assert(sizeof(UniformBuffer::SHADER_MATERIAL) == 32, "Material layout does not match std140");
+static_assert(sizeof(UniformBuffer::TEXTURE_BLOCK) == UniformBuffer::MAX_TEXTURE_LAYERS, "TextureBlock layout does not match std140");
+
+/***********************************************************
+ *  UniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBuffer::UniformBuffer()
+{
+	m_buffer = 0;
+	m_size = 0;
+	m_binding = FRAME_BINDING;
+}
+
+/***********************************************************
+ *  ~UniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBuffer::~UniformBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer store and
+ *  attaching the buffer to its binding point, where it stays
+ *  for the life of the buffer.
+ ***********************************************************/
+void UniformBuffer::Initialize(BindingPoint binding, size_t size)
+{
+	Destroy();
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	GpuMemory::Track(GpuMemory::OBJECT_BUFFER, m_buffer, GpuMemory::MEMORY_BUFFERS, size);
+	glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)binding, m_buffer);
+	m_size = size;
+	m_binding = binding;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffer.
+ ***********************************************************/
+void UniformBuffer::Destroy()
+{
+	if (m_buffer != 0)
+	{
+		GpuMemory::Release(GpuMemory::OBJECT_BUFFER, m_buffer);
+		glDeleteBuffers(1, &m_buffer);
+	}
+	m_buffer = 0;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for replacing part of the buffer with
+ *  a single glBufferSubData() call, which is counted as one
+ *  uniform upload.
+ ***********************************************************/
+void UniformBuffer::Update(const void* pData, size_t size, size_t offset)
+{
+	if ((m_buffer == 0) || (offset + size > m_size))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, pData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	UniformCache::CountUploads(1);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for attaching the buffer to its
+ *  binding point again.
+ ***********************************************************/
+void UniformBuffer::Bind()
+{
+	if (m_buffer != 0)
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)m_binding, m_buffer);
+	}
+}
+
+/***********************************************************
+ *  BindBlock()
+ *
+ *  This method is used for pointing a uniform block of a
+ *  linked program at a binding point.  GLSL 3.30 cannot set
+ *  the binding in the shader, so this is done once after each
+ *  program is linked.
+ ***********************************************************/
+void UniformBuffer::BindBlock(GLuint programID, const char* blockName, BindingPoint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, blockName);
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, blockIndex, (GLuint)binding);
+	}
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffer.h
+// ============
+// std140 uniform blocks shared by all of the shader programs
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/***********************************************************
+ *  UniformBuffer
+ *
+ *  This class owns a uniform buffer object attached to one
+ *  of the fixed binding points below.  A program reads the
+ *  buffer once its block is pointed at the same binding point,
+ *  so every program shares the contents without uploading
+ *  them again.  The block structs mirror the std140 layout of
+ *  the blocks in the shaders, and must change with them.
+ ***********************************************************/
+class UniformBuffer
+{
+public:
+	// BindingPoint enum names the binding point of each block
+	enum BindingPoint
+	{
+		FRAME_BINDING = 0,
+		MATERIAL_BINDING,
+		SHADOW_BINDING,
+		TEXTURE_BINDING,
+		BINDING_COUNT
+	};
+
+	// most materials in the material table, this matches the shaders
+	static const int MAX_SHADER_MATERIALS = 256;
+	// most lights casting shadows and the shadow map faces of each,
+	// these match the shaders
+	static const int MAX_SHADOW_LIGHTS = 4;
+	static const int SHADOW_FACES = 6;
+	// layers of all of the texture arrays together, this matches
+	// the shaders
+	static const int MAX_TEXTURE_LAYERS = 3072;
+
+	// FRAME_BLOCK struct is the FrameBlock of the shaders, updated
+	// once per frame
+	struct FRAME_BLOCK
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		float padding0;
+		glm::vec2 clusterTileScale;
+		float clusterDepthScale;
+		float clusterDepthBias;
+		GLint globalLightCount;
+		GLint padding1[3];
+	};
+
+	// SHADER_MATERIAL struct is one Material of the MaterialBlock
+	struct SHADER_MATERIAL
+	{
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+	// SHADOW_BLOCK struct is the ShadowBlock of the shaders, updated
+	// when a shadow casting light moves
+	struct SHADOW_BLOCK
+	{
+		glm::mat4 faceMatrices[MAX_SHADOW_LIGHTS * SHADOW_FACES];
+		glm::vec4 lights[MAX_SHADOW_LIGHTS]; // position and far distance
+		glm::vec2 tileScale;                 // size of a tile in the atlas
+		GLint lightCount;
+		GLint padding;
+	};
+
+	// TEXTURE_BLOCK struct is the TextureBlock of the shaders, which
+	// holds the finest resident mipmap level of every texture array
+	// layer, one byte each, updated when the texture streaming moves
+	struct TEXTURE_BLOCK
+	{
+		glm::uvec4 layerLevels[MAX_TEXTURE_LAYERS / 16];
+	};
+
+	// constructor
+	UniformBuffer();
+	// destructor
+	~UniformBuffer();
+
+	// create the buffer with the passed in size and attach it to
+	// its binding point
+	void Initialize(BindingPoint binding, size_t size);
+	// free the buffer
+	void Destroy();
+	// replace part of the buffer contents with one upload
+	void Update(const void* pData, size_t size, size_t offset = 0);
+	// attach the buffer to its binding point again, after another
+	// buffer was bound there
+	void Bind();
+
+	// point a uniform block of a program at a binding point, blocks
+	// the program does not use are skipped
+	static void BindBlock(GLuint programID, const char* blockName, BindingPoint binding);
+
+private:
+	// uniform buffer object
+	GLuint m_buffer;
+	// size of the buffer in bytes
+	size_t m_size;
+	// binding point the buffer is attached to
+	BindingPoint m_binding;
+};
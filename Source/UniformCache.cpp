@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// cache shader uniform locations so per-draw setters skip name lookups
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// declaration of global variables
+namespace
+{
+	// shader names of the known uniforms, in UniformID order
+	const char* g_UniformNames[UniformCache::UNIFORM_COUNT] =
+	{
+		"model",
+		"objectColor",
+		"objectTextureIndex",
+		"textureArrays",
+		"UVscale",
+		"bUseInstancing",
+		"objectMaterialIndex",
+		"lightData",
+		"clusterGrid",
+		"clusterLightIndices",
+		"shadowAtlas"
+	};
+
+	// number of glUniform*() calls since the last reset
+	int g_uploadCount = 0;
+}
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache()
+{
+	m_programID = 0;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = -1;
+	}
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for looking up the locations of all
+ *  the known uniforms in the passed in shader program.  It
+ *  needs to be called again whenever the program is relinked.
+ ***********************************************************/
+void UniformCache::Resolve(GLuint programID)
+{
+	m_programID = programID;
+	m_namedLocations.clear();
+
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = glGetUniformLocation(programID, g_UniformNames[i]);
+	}
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for looking up the locations of all
+ *  the known uniforms in the shader program currently in use.
+ ***********************************************************/
+void UniformCache::Resolve()
+{
+	GLint programID = 0;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	Resolve((GLuint)programID);
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for getting the location of a uniform
+ *  that is not one of the known uniforms.  The location is
+ *  looked up in the program once and then cached by name.
+ ***********************************************************/
+GLint UniformCache::GetLocation(const char* name)
+{
+	std::unordered_map<std::string, GLint>::const_iterator it = m_namedLocations.find(name);
+	if (it != m_namedLocations.end())
+	{
+		return(it->second);
+	}
+
+	GLint location = glGetUniformLocation(m_programID, name);
+	m_namedLocations.emplace(name, location);
+
+	return(location);
+}
+
+/***********************************************************
+ *  GetUploadCount() / ResetUploadCount() / CountUploads()
+ *
+ *  These methods are used for counting the uniform uploads of
+ *  all of the caches, which the profiler reports per frame.
+ *  A uniform buffer update counts as one upload.
+ ***********************************************************/
+int UniformCache::GetUploadCount()
+{
+	return(g_uploadCount);
+}
+
+void UniformCache::ResetUploadCount()
+{
+	g_uploadCount = 0;
+}
+
+void UniformCache::CountUploads(int count)
+{
+	g_uploadCount += count;
+}
+
+/***********************************************************
+ *  Set*()
+ *
+ *  These methods are used for setting uniform values into the
+ *  program in use through the cached uniform locations.
+ ***********************************************************/
+void UniformCache::SetBool(UniformID id, bool value) const
+{
+	g_uploadCount++;
+	glUniform1i(m_locations[id], (int)value);
+}
+
+void UniformCache::SetInt(UniformID id, int value) const
+{
+	g_uploadCount++;
+	glUniform1i(m_locations[id], value);
+}
+
+void UniformCache::SetFloat(UniformID id, float value) const
+{
+	g_uploadCount++;
+	glUniform1f(m_locations[id], value);
+}
+
+void UniformCache::SetVec2(UniformID id, const glm::vec2& value) const
+{
+	g_uploadCount++;
+	glUniform2fv(m_locations[id], 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetVec3(UniformID id, const glm::vec3& value) const
+{
+	g_uploadCount++;
+	glUniform3fv(m_locations[id], 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetVec4(UniformID id, const glm::vec4& value) const
+{
+	g_uploadCount++;
+	glUniform4fv(m_locations[id], 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetMat4(UniformID id, const glm::mat4& value) const
+{
+	g_uploadCount++;
+	glUniformMatrix4fv(m_locations[id], 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void UniformCache::SetIntArray(UniformID id, const int* values, int count) const
+{
+	g_uploadCount++;
+	glUniform1iv(m_locations[id], count, values);
+}
+
+void UniformCache::SetBool(const char* name, bool value)
+{
+	g_uploadCount++;
+	glUniform1i(GetLocation(name), (int)value);
+}
+
+void UniformCache::SetInt(const char* name, int value)
+{
+	g_uploadCount++;
+	glUniform1i(GetLocation(name), value);
+}
+
+void UniformCache::SetFloat(const char* name, float value)
+{
+	g_uploadCount++;
+	glUniform1f(GetLocation(name), value);
+}
+
+void UniformCache::SetVec3(const char* name, const glm::vec3& value)
+{
+	g_uploadCount++;
+	glUniform3fv(GetLocation(name), 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetVec3(const char* name, float x, float y, float z)
+{
+	g_uploadCount++;
+	glUniform3f(GetLocation(name), x, y, z);
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// cache shader uniform locations so per-draw setters skip name lookups
+//
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class resolves the uniform locations of a linked
+ *  shader program once, so that the per-draw setters can call
+ *  glUniform*() directly instead of looking up each uniform by
+ *  its string name on every draw.
+ ***********************************************************/
+class UniformCache
+{
+public:
+	// compile-time handles for the uniforms used on every draw
+	enum UniformID
+	{
+		MODEL = 0,
+		OBJECT_COLOR,
+		OBJECT_TEXTURE_INDEX,
+		TEXTURE_ARRAYS,
+		UV_SCALE,
+		USE_INSTANCING,
+		OBJECT_MATERIAL_INDEX,
+		LIGHT_DATA,
+		CLUSTER_GRID,
+		CLUSTER_LIGHT_INDICES,
+		SHADOW_ATLAS,
+		UNIFORM_COUNT
+	};
+
+	// constructor
+	UniformCache();
+
+	// resolve the known uniform locations for the passed in program
+	void Resolve(GLuint programID);
+	// resolve the known uniform locations for the program in use
+	void Resolve();
+	// true once Resolve() has been called for a valid program
+	bool IsResolved() const { return(m_programID != 0); }
+	// get the program the locations were resolved for
+	GLuint GetProgram() const { return(m_programID); }
+
+	// get the cached location for a known uniform
+	GLint GetLocation(UniformID id) const { return(m_locations[id]); }
+	// get the location for any uniform, cached by name on first use
+	GLint GetLocation(const char* name);
+
+	// get the number of uniform uploads of all caches since the last reset
+	static int GetUploadCount();
+	// restart counting the uniform uploads
+	static void ResetUploadCount();
+	// count uploads made outside of the caches, like uniform buffers
+	static void CountUploads(int count);
+
+	// set uniform values through a known uniform handle
+	void SetBool(UniformID id, bool value) const;
+	void SetInt(UniformID id, int value) const;
+	void SetFloat(UniformID id, float value) const;
+	void SetVec2(UniformID id, const glm::vec2& value) const;
+	void SetVec3(UniformID id, const glm::vec3& value) const;
+	void SetVec4(UniformID id, const glm::vec4& value) const;
+	void SetMat4(UniformID id, const glm::mat4& value) const;
+	void SetIntArray(UniformID id, const int* values, int count) const;
+
+	// set uniform values through a name cached on first use
+	void SetBool(const char* name, bool value);
+	void SetInt(const char* name, int value);
+	void SetFloat(const char* name, float value);
+	void SetVec3(const char* name, const glm::vec3& value);
+	void SetVec3(const char* name, float x, float y, float z);
+
+private:
+	// program the cached locations belong to
+	GLuint m_programID;
+	// locations of the known uniforms, -1 if not used by the program
+	GLint m_locations[UNIFORM_COUNT];
+	// locations of other uniforms looked up by name
+	std::unordered_map<std::string, GLint> m_namedLocations;
+};
@@ -8,12 +8,14 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "FramePacer.h"
 
 // GLM Math Header inclusions
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
+#include <algorithm>
 
 // declaration of the global variables and defines
 namespace
@@ -21,8 +23,10 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+	// current size of the window framebuffer, which differs from the
+	// window size on high density displays and after a resize
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,6 +36,10 @@ namespace
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
+	// false while the camera follows a scripted path
+	bool gInputEnabled = true;
+	// true when a mouse click asked for an object to be picked
+	bool gPickRequested = false;
 
 	// time between current frame and last frame
 	float gDeltaTime = 0.0f; 
@@ -40,6 +48,10 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// longest time step the camera moves by in one frame, so the
+	// first frame after an idle wait does not jump the camera
+	const float MAX_DELTA_TIME = 0.1f;
 }
 
 /***********************************************************
@@ -53,6 +65,8 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -84,16 +98,32 @@ ViewManager::~ViewManager()
  *
  *  This method is used to create the main display window.
  ***********************************************************/
-GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
+GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle, bool bVisible)
 {
 	GLFWwindow* window = nullptr;
 
 	// try to create the displayed OpenGL window
+	glfwWindowHint(GLFW_VISIBLE, bVisible ? GLFW_TRUE : GLFW_FALSE);
 	window = glfwCreateWindow(
 		WINDOW_WIDTH,
 		WINDOW_HEIGHT,
 		windowTitle,
 		NULL, NULL);
+#ifndef __APPLE__
+	// drivers without OpenGL 4.3 get the 3.1 context, which draws
+	// the scene with the CPU culled path
+	if (window == NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+		window = glfwCreateWindow(
+			WINDOW_WIDTH,
+			WINDOW_HEIGHT,
+			windowTitle,
+			NULL, NULL);
+	}
+#endif
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -103,16 +133,29 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	glfwMakeContextCurrent(window);
 
 	// tell GLFW to capture all mouse events
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (bVisible)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// this callback is used to receive mouse moving events
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
 
 	glfwSetScrollCallback(window, Mouse_Scroll_Callback);// registering the scroll callback
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// this callback is used to receive the clicks for picking
+	glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
+
+	// these callbacks wake the main loop when it redraws on demand
+	glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+
+	// this callback is used to follow the window as it is resized
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+
+	// blending is turned on by the scene for its transparent pass
+	// only, the opaque objects are drawn without it
 
 	m_pWindow = window;
 
@@ -127,6 +170,11 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	if (!gInputEnabled)
+	{
+		return;
+	}
+
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
@@ -147,16 +195,82 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 
 	// move the 3D camera according to the calculated offsets
 	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	if ((xOffset != 0.0f) || (yOffset != 0.0f))
+	{
+		FramePacer::RequestRedraw();
+	}
 }
-// Added Mouse scroll input call back 
+// Added Mouse scroll input call back - it only changes the speed of the
+// camera and not the view, so it draws no frame on demand
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
 {
+	if (!gInputEnabled)
+		return;
+
 	if (yOffset > 0)
 		g_pCamera->MovementSpeed += 1;
 	else if (yOffset < 0)
 		g_pCamera->MovementSpeed -= 1;
 }
 
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  mouse button is pressed or released.  A left click asks
+ *  for the object in the center of the view to be picked.
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	if (gInputEnabled && (button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		gPickRequested = true;
+		FramePacer::RequestRedraw();
+	}
+}
+
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  key is pressed or released.  The keys are polled by the
+ *  frame, so every change draws one, and a held movement key
+ *  keeps drawing through ProcessKeyboardEvents().
+ ***********************************************************/
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_REPEAT)
+	{
+		FramePacer::RequestRedraw();
+	}
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window have to be drawn again, such
+ *  as after it was resized or uncovered.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	FramePacer::RequestRedraw();
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the window framebuffer is resized.  The next frame is
+ *  drawn at the new size with the projection of its aspect.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+	FramePacer::RequestRedraw();
+}
+
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
@@ -165,6 +279,8 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, doub
  ***********************************************************/
 void ViewManager::ProcessKeyboardEvents()
 {
+	bool bCameraMoved = false;
+
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
@@ -175,29 +291,35 @@ void ViewManager::ProcessKeyboardEvents()
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		bCameraMoved = true;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		bCameraMoved = true;
 	}
 
 	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		bCameraMoved = true;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		bCameraMoved = true;
 	}
 	//Added up and down funtionality with q and e keys
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		bCameraMoved = true;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		bCameraMoved = true;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
 	{
@@ -208,11 +330,20 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 		g_pCamera->Yaw = -90.0f;   // Facing Z
 		g_pCamera->Pitch = 0.0f;    // Level with the "horizon"
+		bCameraMoved = true;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
+		bCameraMoved = bCameraMoved || bOrthographicProjection;
 		bOrthographicProjection = false;
 	}
+
+	// a key held down keeps moving the camera, so the next frame
+	// is drawn as well when redrawing on demand
+	if (bCameraMoved)
+	{
+		FramePacer::RequestRedraw();
+	}
 }
 
 /***********************************************************
@@ -229,22 +360,32 @@ void ViewManager::PrepareSceneView()
 
 	// per-frame timing
 	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
+	gDeltaTime = std::min(currentFrame - gLastFrame, MAX_DELTA_TIME);
 	gLastFrame = currentFrame;
 
 	// process any keyboard events that may be waiting in the 
 	// event queue
-	ProcessKeyboardEvents();
+	if (gInputEnabled)
+	{
+		ProcessKeyboardEvents();
+	}
 
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
 
+	// the projection follows the shape of the window, a minimized
+	// window keeps the aspect it was created with
+	float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+	if ((gFramebufferWidth > 0) && (gFramebufferHeight > 0))
+	{
+		aspect = (float)gFramebufferWidth / (float)gFramebufferHeight;
+	}
+
 	// define the current projection matrix
 	if (bOrthographicProjection)
 	{
 
 		float orthoHalfHeight = 10.0f;
-		float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 		float orthoHalfWidth = orthoHalfHeight * aspect;
 
 		float nearPlane = 0.1f;
@@ -262,20 +403,109 @@ void ViewManager::PrepareSceneView()
 	{
 		projection = glm::perspective(
 			glm::radians(g_pCamera->Zoom),
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
+			aspect,
 			0.1f,
 			100.0f
 		);
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	// keep the matrices for culling against the frustum and for
+	// the per-frame uniform block, which the scene manager uploads
+	// with the rest of the frame values in one update
+	m_view = view;
+	m_projection = projection;
+}
+
+/***********************************************************
+ *  SetInputEnabled()
+ *
+ *  This method is used for turning the keyboard and mouse
+ *  camera controls on or off.  The controls are off while a
+ *  scripted camera path places the camera.
+ ***********************************************************/
+void ViewManager::SetInputEnabled(bool bEnabled)
+{
+	gInputEnabled = bEnabled;
+	gFirstMouse = true;
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used for placing the camera at the passed
+ *  in position, looking along the passed in direction.  The
+ *  yaw and pitch are derived from the direction so that the
+ *  mouse controls continue from the new pose.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& front)
+{
+	glm::vec3 direction = glm::normalize(front);
+
+	g_pCamera->Position = position;
+	g_pCamera->Front = direction;
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	g_pCamera->Yaw = glm::degrees(atan2(direction.z, direction.x));
+	g_pCamera->Pitch = glm::degrees(asin(direction.y));
+}
+
+/***********************************************************
+ *  ConsumePickRequest()
+ *
+ *  This method is used for getting the picking ray of the
+ *  last mouse click.  The mouse movement turns the camera and
+ *  the cursor stays captured, so the ray starts at the camera
+ *  and goes through the center of the view.
+ ***********************************************************/
+bool ViewManager::ConsumePickRequest(glm::vec3& origin, glm::vec3& direction)
+{
+	if (!gPickRequested)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		return(false);
 	}
-}
\ No newline at end of file
+
+	gPickRequested = false;
+	origin = g_pCamera->Position;
+	direction = glm::normalize(g_pCamera->Front);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetCameraPosition()
+ *
+ *  This method is used for getting the camera position.
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraPosition() const
+{
+	return(g_pCamera->Position);
+}
+
+/***********************************************************
+ *  GetCameraFront()
+ *
+ *  This method is used for getting the camera view direction.
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraFront() const
+{
+	return(g_pCamera->Front);
+}
+
+/***********************************************************
+ *  GetWindowWidth()
+ *
+ *  This method is used for getting the display window width.
+ ***********************************************************/
+int ViewManager::GetWindowWidth()
+{
+	return(gFramebufferWidth);
+}
+
+/***********************************************************
+ *  GetWindowHeight()
+ *
+ *  This method is used for getting the display window height.
+ ***********************************************************/
+int ViewManager::GetWindowHeight()
+{
+	return(gFramebufferHeight);
+}
@@ -30,19 +30,56 @@ public:
 	// mouse scroll callback for mouse scroll interaction with the 3D scene
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
 
+	// mouse button callback for picking objects in the 3D scene
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+
+	// key callback, the keys themselves are polled every frame but
+	// a frame has to be drawn to poll them
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+	// window refresh callback for redrawing a window that was uncovered
+	static void Window_Refresh_Callback(GLFWwindow* window);
+
+	// framebuffer size callback for following the size of the window
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices of the current frame, which
+	// reach the shaders through the per-frame uniform block
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
 
 public:
-	// create the initial OpenGL display window
-	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create the initial OpenGL display window, a hidden window
+	// only provides the OpenGL context
+	GLFWwindow* CreateDisplayWindow(const char* windowTitle, bool bVisible = true);
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// turn the keyboard and mouse camera controls on or off
+	void SetInputEnabled(bool bEnabled);
+	// place the camera, used for driving it along a scripted path
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& front);
+	// get the view and projection matrices of the current frame
+	const glm::mat4& GetViewMatrix() const { return(m_view); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projection); }
+	// get the picking ray of a mouse click since the last call,
+	// returns false if there was no click
+	bool ConsumePickRequest(glm::vec3& origin, glm::vec3& direction);
+	// get the current camera position and view direction
+	glm::vec3 GetCameraPosition() const;
+	glm::vec3 GetCameraFront() const;
+
+	// get the size of the display window framebuffer in pixels,
+	// which follows the window as it is resized
+	static int GetWindowWidth();
+	static int GetWindowHeight();
 };
\ No newline at end of file
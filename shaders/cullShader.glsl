@@ -0,0 +1,160 @@
+#version 430 core
+// frustum and occlusion culls the opaque objects of the scene, chooses
+// their level of detail and appends the visible ones to the instances of
+// the indirect draw command of that level
+layout (local_size_x = 64) in;
+
+struct CullObject {
+    mat4 model;
+    vec4 boundsCenter;       // world bounding box center
+    vec4 boundsExtents;      // world bounding box half extents
+    ivec4 indices;           // draw command of level 0, material, texture
+                             // layer, level count | level drawn last << 8
+                             // | OCCLUDER_BIT
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// the level each object was drawn with is written back for the next frame
+layout (std430, binding = 0) buffer ObjectBuffer {
+    CullObject objects[];
+};
+
+layout (std430, binding = 1) buffer CommandBuffer {
+    DrawCommand commands[];
+};
+
+// written in the layout of the instance vertex attributes - a mat4
+// model matrix followed by the material and texture indices
+layout (std430, binding = 2) writeonly buffer InstanceBuffer {
+    uint instanceWords[];
+};
+
+const uint INSTANCE_WORDS = 18u;
+// set for the objects drawn into the Hi-Z pyramid, this matches
+// GpuCuller::LOD_STATE_OCCLUDER
+const int OCCLUDER_BIT = 0x10000;
+// the own depth of an occluder is never in front of its bounds, but
+// the rasterized depth of a face lying on the bounds can round to just
+// in front of them, so the occluders are only hidden by this much more
+const float OCCLUDER_DEPTH_BIAS = 0.00001;
+// levels of detail of a mesh, this matches MeshManager::LOD_COUNT
+const int LOD_COUNT = 3;
+
+// frustum planes as (normal, distance), normals point inside
+uniform vec4 frustumPlanes[6];
+uniform uint objectCount;
+// the projected radius of an object is its world radius times the scale
+// over its distance from the camera, a scale of 0 draws the finest level
+uniform vec3 cameraPosition;
+uniform float lodScale;
+// projected radius in pixels below which a mesh moves past each level,
+// and the part of it the radius has to pass it by
+uniform float lodSwitchSizes[LOD_COUNT - 1];
+uniform float lodHysteresis;
+// Hi-Z pyramid of the occluders, each texel the farthest depth under it,
+// and the camera it was rendered with
+uniform bool bOcclusion;
+uniform sampler2D hiZPyramid;
+uniform mat4 occlusionViewProjection;
+
+// true when the box is behind the occluders everywhere it covers the
+// screen by more than the bias, a box reaching behind the camera is
+// always kept
+bool IsOccluded(vec3 center, vec3 extents, float bias)
+{
+    vec3 ndcMin = vec3(1.0);
+    vec3 ndcMax = vec3(-1.0);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extents * vec3(((i & 1) != 0) ? 1.0 : -1.0,
+                                              ((i & 2) != 0) ? 1.0 : -1.0,
+                                              ((i & 4) != 0) ? 1.0 : -1.0);
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+
+    vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+    float nearestDepth = ndcMin.z * 0.5 + 0.5;
+
+    // the level where the rectangle spans at most one texel, which
+    // it covers with at most 2x2 texels of that level
+    vec2 pixels = (uvMax - uvMin) * vec2(textureSize(hiZPyramid, 0));
+    int level = int(ceil(log2(max(max(pixels.x, pixels.y), 1.0))));
+    level = min(level, textureQueryLevels(hiZPyramid) - 1);
+
+    ivec2 levelSize = textureSize(hiZPyramid, level);
+    ivec2 texelMin = min(ivec2(uvMin * vec2(levelSize)), levelSize - 1);
+    ivec2 texelMax = min(ivec2(uvMax * vec2(levelSize)), levelSize - 1);
+    float farthestDepth = 0.0;
+    for (int y = texelMin.y; y <= texelMax.y; y++) {
+        for (int x = texelMin.x; x <= texelMax.x; x++) {
+            farthestDepth = max(farthestDepth, texelFetch(hiZPyramid, ivec2(x, y), level).r);
+        }
+    }
+
+    return(nearestDepth > farthestDepth + bias);
+}
+
+void main()
+{
+    uint objectIndex = gl_GlobalInvocationID.x;
+    if (objectIndex >= objectCount) {
+        return;
+    }
+
+    vec3 center = objects[objectIndex].boundsCenter.xyz;
+    vec3 extents = objects[objectIndex].boundsExtents.xyz;
+    for (int p = 0; p < 6; p++) {
+        float distance = dot(frustumPlanes[p].xyz, center) + frustumPlanes[p].w;
+        float radius = dot(abs(frustumPlanes[p].xyz), extents);
+        if (distance + radius < 0.0) {
+            return;
+        }
+    }
+    ivec4 indices = objects[objectIndex].indices;
+    float bias = ((indices.w & OCCLUDER_BIT) != 0) ? OCCLUDER_DEPTH_BIAS : 0.0;
+    if (bOcclusion && IsOccluded(center, extents, bias)) {
+        return;
+    }
+
+    int lodCount = indices.w & 0xFF;
+    int lod = min((indices.w >> 8) & 0xFF, lodCount - 1);
+    if (lodScale > 0.0) {
+        float size = length(extents) * lodScale / max(length(center - cameraPosition), 0.001);
+        while ((lod > 0) && (size > lodSwitchSizes[lod - 1] * (1.0 + lodHysteresis))) {
+            lod--;
+        }
+        while ((lod < lodCount - 1) && (size < lodSwitchSizes[lod] * (1.0 - lodHysteresis))) {
+            lod++;
+        }
+    }
+    else {
+        lod = 0;
+    }
+    objects[objectIndex].indices.w = (indices.w & ~0xFF00) | (lod << 8);
+
+    uint command = uint(indices.x + lod);
+    uint slot = commands[command].baseInstance + atomicAdd(commands[command].instanceCount, 1u);
+    uint word = slot * INSTANCE_WORDS;
+
+    mat4 model = objects[objectIndex].model;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            instanceWords[word++] = floatBitsToUint(model[column][row]);
+        }
+    }
+    instanceWords[word++] = uint(indices.y);
+    instanceWords[word] = uint(indices.z);
+}
@@ -1,14 +1,26 @@
 #version 330 core
+// the shader loader compiles one variant per feature set, with these
+// defines placed right after the #version line:
+//   VARIANT_TEXTURED        sample the object texture array
+//   VARIANT_LIT             shade with the scene lights
+//   VARIANT_GLOBAL_LIGHTS   number of global point lights, known at
+//                           compile time so the loop is unrolled
+//   VARIANT_DEPTH_ONLY      depth pre-pass, nothing is shaded
 out vec4 fragmentColor;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+// texture array slot in the upper 16 bits, layer in the lower 16 bits
+flat in int fragmentTextureIndex;
+flat in int fragmentMaterialIndex;
+in float fragmentViewDepth;
 
+// std140 layout, shininess fills the padding after diffuseColor
 struct Material {
     vec3 diffuseColor;
-    vec3 specularColor;
     float shininess;
+    vec3 specularColor;
 }; 
 
 struct DirectionalLight {
@@ -21,16 +33,6 @@ struct DirectionalLight {
     bool bActive;
 };
 
-struct PointLight {
-    vec3 position;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    bool bActive;
-};
-
 struct SpotLight {
     vec3 position;
     vec3 direction;
@@ -48,81 +50,187 @@ struct SpotLight {
     bool bActive;
 };
 
-#define TOTAL_POINT_LIGHTS 5
+// size of the light cluster grid, matches LightClusters on the CPU
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+// one texture array per texel format (RGBA8, BC1, BC3) and layer size
+#define TOTAL_TEXTURE_ARRAYS 12
+// layer sizes of the arrays, each doubling the one before, and the most
+// layers of an array, these match TextureCodec and TextureManager
+#define LAYER_SIZE_COUNT 4
+#define MIN_LAYER_SIZE 256
+#define MAX_ARRAY_LAYERS 256
+// size of the material table, matches UniformBuffer on the CPU
+#define MAX_SHADER_MATERIALS 256
+// shadow casting lights and the faces of each, matches UniformBuffer
+#define MAX_SHADOW_LIGHTS 4
+#define SHADOW_FACES 6
+// depth offset of the shadow comparison, on top of the offset the
+// casters were drawn with
+#define SHADOW_DEPTH_BIAS 0.0005
+
+// camera and light cluster values of the frame, declared the same in
+// both shaders and updated in one upload per frame
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    vec2 clusterTileScale;
+    float clusterDepthScale;
+    float clusterDepthBias;
+    int globalLightCount;
+};
+
+// every material of the scene, indexed by the material of the object
+layout (std140) uniform MaterialBlock {
+    Material materials[MAX_SHADER_MATERIALS];
+};
+
+// face matrices of the shadow casting lights, a row of six tiles of the
+// shadow atlas for each light, updated when a light moves
+layout (std140) uniform ShadowBlock {
+    mat4 shadowFaceMatrices[MAX_SHADOW_LIGHTS * SHADOW_FACES];
+    vec4 shadowLights[MAX_SHADOW_LIGHTS];   // position and far distance
+    vec2 shadowTileScale;
+    int shadowLightCount;
+};
+
+// finest mipmap level streamed into each texture array layer, one byte
+// each - the finer levels of a layer may hold no texels yet, even when
+// other layers of its array use them
+layout (std140) uniform TextureBlock {
+    uvec4 layerLevels[TOTAL_TEXTURE_ARRAYS * MAX_ARRAY_LAYERS / 16];
+};
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
 uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
 uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+// point lights, four texels each: position and range, ambient and shadow
+// map, diffuse and specular - the lights without a range come first and
+// light every fragment, the others are found through the cluster of the
+// fragment
+uniform samplerBuffer lightData;
+// (first index, count) into clusterLightIndices for each cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
 uniform SpotLight spotLight;
-uniform Material material;
-uniform sampler2D objectTexture;
+uniform sampler2DArray textureArrays[TOTAL_TEXTURE_ARRAYS];
+uniform sampler2DShadow shadowAtlas;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
 
 // the scaled texture coordinate to use in calculations
 vec2 fragmentTextureCoordinateScaled = fragmentTextureCoordinate * UVscale;
+// color of the object, sampled once at the start of main()
+vec4 albedo;
+// material of the object, read from the table at the start of main()
+Material material;
 
 // function prototypes
+vec4 SampleObjectTexture(vec2 textureCoordinate);
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcPointLight(int light, vec3 normal, vec3 fragPos, vec3 viewDir);
+float CalcShadow(int shadowMap, vec3 fragPos);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {   
-    if(bUseLighting == true)
+#ifdef VARIANT_DEPTH_ONLY
+    // the color writes are masked, only the depth of the pass is kept
+    fragmentColor = vec4(0.0f);
+    return;
+#endif
+
+#ifdef VARIANT_TEXTURED
+    albedo = SampleObjectTexture(fragmentTextureCoordinateScaled);
+#else
+    albedo = objectColor;
+#endif
+
+#ifdef VARIANT_LIT
+    material = materials[clamp(fragmentMaterialIndex, 0, MAX_SHADER_MATERIALS - 1)];
+
+    vec3 phongResult = vec3(0.0f);
+    // properties
+    vec3 norm = normalize(fragmentVertexNormal);
+    vec3 viewDir = normalize(viewPosition - fragmentPosition);
+
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per light source. In the main() function we take all the calculated colors and sum them 
+    // up for this fragment's final color.
+    // == =====================================================
+    // phase 1: directional lighting
+    if(directionalLight.bActive == true)
     {
-        vec3 phongResult = vec3(0.0f);
-        // properties
-        vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
-    
-        // == =====================================================
-        // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-        // For each phase, a calculate function is defined that calculates the corresponding color
-        // per light source. In the main() function we take all the calculated colors and sum them 
-        // up for this fragment's final color.
-        // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
-        {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
-        }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
-        {
-	    if(pointLights[i].bActive == true)
-            {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
-            }
-        } 
-        // phase 3: spot light
-        if(spotLight.bActive == true)
-        {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
-        }
-    
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinateScaled)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
+        phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
     }
-    else
+    // phase 2: point lights, the global ones and then the ones
+    // listed for the cluster of this fragment
+#ifdef VARIANT_GLOBAL_LIGHTS
+    for(int i = 0; i < VARIANT_GLOBAL_LIGHTS; i++)
+#else
+    for(int i = 0; i < globalLightCount; i++)
+#endif
     {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinateScaled);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
+        phongResult += CalcPointLight(i, norm, fragmentPosition, viewDir);
+    }
+    ivec3 cluster = ivec3(gl_FragCoord.xy * clusterTileScale,
+        log(max(fragmentViewDepth, 1e-4)) * clusterDepthScale + clusterDepthBias);
+    cluster = clamp(cluster, ivec3(0), ivec3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1));
+    uvec2 clusterList = texelFetch(clusterGrid, cluster.x + CLUSTER_GRID_X * (cluster.y + CLUSTER_GRID_Y * cluster.z)).xy;
+    for(uint i = 0u; i < clusterList.y; i++)
+    {
+        int light = int(texelFetch(clusterLightIndices, int(clusterList.x + i)).x);
+        phongResult += CalcPointLight(light, norm, fragmentPosition, viewDir);
+    }
+    // phase 3: spot light
+    if(spotLight.bActive == true)
+    {
+        phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
+    }
+
+    fragmentColor = vec4(phongResult, albedo.a);
+#else
+    fragmentColor = albedo;
+#endif
+}
+
+// samples the object texture from the layer of its texture array - sampler
+// arrays can only be indexed with constant expressions in GLSL 3.30
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+    int arraySlot = fragmentTextureIndex >> 16;
+    int layer = fragmentTextureIndex & 0xFFFF;
+    vec3 layerCoordinate = vec3(textureCoordinate, float(layer));
+
+    // widen the gradients so the sampled level is never finer than the
+    // levels of the layer, the shorter one decides so that anisotropic
+    // filtering stays within them too
+    int entry = arraySlot * MAX_ARRAY_LAYERS + layer;
+    uint residentLevel = (layerLevels[entry >> 4][(entry >> 2) & 3] >> uint((entry & 3) * 8)) & 0xFFu;
+    vec2 dx = dFdx(textureCoordinate);
+    vec2 dy = dFdy(textureCoordinate);
+    float footprint = min(length(dx), length(dy)) * float(MIN_LAYER_SIZE << (arraySlot % LAYER_SIZE_COUNT));
+    float widen = max(exp2(float(residentLevel)) / max(footprint, 1e-6), 1.0);
+    dx *= widen;
+    dy *= widen;
+
+    switch(arraySlot)
+    {
+        case 0: return textureGrad(textureArrays[0], layerCoordinate, dx, dy);
+        case 1: return textureGrad(textureArrays[1], layerCoordinate, dx, dy);
+        case 2: return textureGrad(textureArrays[2], layerCoordinate, dx, dy);
+        case 3: return textureGrad(textureArrays[3], layerCoordinate, dx, dy);
+        case 4: return textureGrad(textureArrays[4], layerCoordinate, dx, dy);
+        case 5: return textureGrad(textureArrays[5], layerCoordinate, dx, dy);
+        case 6: return textureGrad(textureArrays[6], layerCoordinate, dx, dy);
+        case 7: return textureGrad(textureArrays[7], layerCoordinate, dx, dy);
+        case 8: return textureGrad(textureArrays[8], layerCoordinate, dx, dy);
+        case 9: return textureGrad(textureArrays[9], layerCoordinate, dx, dy);
+        case 10: return textureGrad(textureArrays[10], layerCoordinate, dx, dy);
     }
+    return textureGrad(textureArrays[11], layerCoordinate, dx, dy);
 }
 
 // calculates the color when using a directional light.
@@ -139,30 +247,37 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDirection, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    ambient = light.ambient * vec3(albedo);
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(albedo);
+    specular = light.specular * spec * material.specularColor * vec3(albedo);
     
     return (ambient + diffuse + specular);
 }
 
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+// calculates the color when using a point light from the light data.
+vec3 CalcPointLight(int light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
     vec3 specular= vec3(0.0f);
 
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec4 positionRange = texelFetch(lightData, light * 4);
+    vec4 lightAmbientShadow = texelFetch(lightData, light * 4 + 1);
+    vec3 lightAmbient = lightAmbientShadow.rgb;
+    vec3 lightDiffuse = texelFetch(lightData, light * 4 + 2).rgb;
+    vec3 lightSpecular = texelFetch(lightData, light * 4 + 3).rgb;
+
+    // a light with a range fades out smoothly at its edge, the
+    // global lights are not attenuated
+    float attenuation = 1.0;
+    if(positionRange.w > 0.0)
+    {
+        vec3 toLight = positionRange.xyz - fragPos;
+        float falloff = clamp(1.0 - dot(toLight, toLight) / (positionRange.w * positionRange.w), 0.0, 1.0);
+        attenuation = falloff * falloff;
+    }
+
+    vec3 lightDir = normalize(positionRange.xyz - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
@@ -171,20 +286,77 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
    
     // combine results
-    if(bUseTexture == true)
+    ambient = lightAmbient * vec3(albedo);
+    diffuse = lightDiffuse * diff * material.diffuseColor * vec3(albedo);
+    specular = lightSpecular * specularComponent * material.specularColor;
+
+    // the shadow only takes away the direct light
+    int shadowMap = int(lightAmbientShadow.a);
+    if(shadowMap >= 0 && diff > 0.0)
+    {
+        float shadow = CalcShadow(shadowMap, fragPos);
+        diffuse *= shadow;
+        specular *= shadow;
+    }
+    
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+// calculates how much of a light reaches the fragment from the shadow map
+// of the light, 1 where it is fully lit - the face is picked by the major
+// axis of the direction from the light, and a 3x3 PCF of filtered depth
+// comparisons softens the shadow edges
+float CalcShadow(int shadowMap, vec3 fragPos)
+{
+    if(shadowMap >= shadowLightCount)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * specularComponent * material.specularColor;
+        return 1.0;
+    }
+
+    vec4 shadowLight = shadowLights[shadowMap];
+    vec3 fromLight = fragPos - shadowLight.xyz;
+    if(dot(fromLight, fromLight) >= shadowLight.w * shadowLight.w)
+    {
+        return 1.0;
+    }
+
+    vec3 axis = abs(fromLight);
+    int face;
+    if(axis.x >= axis.y && axis.x >= axis.z)
+    {
+        face = (fromLight.x > 0.0) ? 0 : 1;
+    }
+    else if(axis.y >= axis.z)
+    {
+        face = (fromLight.y > 0.0) ? 2 : 3;
     }
     else
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
+        face = (fromLight.z > 0.0) ? 4 : 5;
     }
-    
-    return (ambient + diffuse + specular);
+
+    vec4 shadowPosition = shadowFaceMatrices[shadowMap * SHADOW_FACES + face] * vec4(fragPos, 1.0);
+    vec3 shadowCoordinate = shadowPosition.xyz / shadowPosition.w * 0.5 + 0.5;
+    float depth = shadowCoordinate.z - SHADOW_DEPTH_BIAS;
+
+    // the taps are kept inside the tile of the face, so they never read
+    // the neighbouring faces
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 tileOrigin = vec2(face, shadowMap) * shadowTileScale;
+    vec2 tileMin = tileOrigin + texelSize * 1.5;
+    vec2 tileMax = tileOrigin + shadowTileScale - texelSize * 1.5;
+    vec2 uv = tileOrigin + clamp(shadowCoordinate.xy, 0.0, 1.0) * shadowTileScale;
+
+    float lit = 0.0;
+    for(int y = -1; y <= 1; y++)
+    {
+        for(int x = -1; x <= 1; x++)
+        {
+            vec2 tapUV = clamp(uv + vec2(x, y) * texelSize, tileMin, tileMax);
+            lit += texture(shadowAtlas, vec3(tapUV, depth));
+        }
+    }
+    return lit / 9.0;
 }
 
 // calculates the color when using a spot light.
@@ -208,18 +380,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    ambient = light.ambient * vec3(albedo);
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(albedo);
+    specular = light.specular * spec * material.specularColor * vec3(albedo);
     
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
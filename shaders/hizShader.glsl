@@ -0,0 +1,32 @@
+#version 430 core
+// reduces the occluder depth into the levels of the Hi-Z pyramid, every
+// texel keeps the farthest depth of the 2x2 texels of the level below
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// level 0 is copied from the occluder depth, every other level is
+// reduced from the level before it
+uniform sampler2D depthTexture;
+uniform int sourceLevel;
+layout (r32f, binding = 0) readonly uniform image2D sourceImage;
+layout (r32f, binding = 1) writeonly uniform image2D targetImage;
+
+void main()
+{
+    ivec2 target = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(target, imageSize(targetImage)))) {
+        return;
+    }
+
+    float depth;
+    if (sourceLevel < 0) {
+        depth = texelFetch(depthTexture, target, 0).r;
+    }
+    else {
+        // texels past the edge of an odd level read as 0, which never
+        // wins the max
+        ivec2 source = target * 2;
+        depth = max(max(imageLoad(sourceImage, source).r, imageLoad(sourceImage, source + ivec2(1, 0)).r),
+                    max(imageLoad(sourceImage, source + ivec2(0, 1)).r, imageLoad(sourceImage, source + ivec2(1, 1)).r));
+    }
+    imageStore(targetImage, target, vec4(depth));
+}
@@ -0,0 +1,11 @@
+#version 430 core
+// draws the occluders of the frame depth only, the static batches are
+// already moved into world space
+layout (location = 0) in vec3 inVertexPosition;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(inVertexPosition, 1.0);
+}
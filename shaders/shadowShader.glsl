@@ -0,0 +1,13 @@
+#version 330 core
+// draws the shadow casters depth only into one face of a shadow map - the
+// dynamic casters are instanced, the static batches are drawn with the
+// identity matrix in place of the instance model matrix
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 3) in mat4 inInstanceModel;
+
+uniform mat4 faceViewProjection;
+
+void main()
+{
+    gl_Position = faceViewProjection * inInstanceModel * vec4(inVertexPosition, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+// stretches the scene over the window from the part of the scene texture
+// it was drawn into, and sharpens it with contrast adaptive weights - the
+// four neighbours are subtracted less where the contrast is already high,
+// so the edges the bilinear filter blurred come back without ringing
+in vec2 sourceCoordinate;
+out vec4 fragmentColor;
+
+uniform sampler2D sceneTexture;
+// size of one texel of the scene texture
+uniform vec2 sourceTexelSize;
+// center of the last texel drawn, the texels past it are stale
+uniform vec2 sourceMax;
+// strength of the sharpening, 0 copies the scene as it is
+uniform float sharpness;
+
+vec3 SampleScene(vec2 coordinate)
+{
+    return texture(sceneTexture, clamp(coordinate, sourceTexelSize * 0.5, sourceMax)).rgb;
+}
+
+void main()
+{
+    vec3 center = SampleScene(sourceCoordinate);
+    if(sharpness <= 0.0)
+    {
+        fragmentColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 north = SampleScene(sourceCoordinate + vec2(0.0, sourceTexelSize.y));
+    vec3 south = SampleScene(sourceCoordinate - vec2(0.0, sourceTexelSize.y));
+    vec3 east = SampleScene(sourceCoordinate + vec2(sourceTexelSize.x, 0.0));
+    vec3 west = SampleScene(sourceCoordinate - vec2(sourceTexelSize.x, 0.0));
+
+    vec3 minimum = min(center, min(min(north, south), min(east, west)));
+    vec3 maximum = max(center, max(max(north, south), max(east, west)));
+    // room left to sharpen before the result clips, relative to the peak
+    vec3 amplitude = clamp(min(minimum, 1.0 - maximum) / max(maximum, vec3(1e-4)), 0.0, 1.0);
+    vec3 weight = -sqrt(amplitude) * mix(0.125, 0.2, sharpness);
+
+    vec3 result = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    fragmentColor = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
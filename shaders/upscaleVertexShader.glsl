@@ -0,0 +1,14 @@
+#version 330 core
+// draws one triangle over the whole window for the upscale of the scene,
+// the corners come from the vertex id so no vertex buffer is read
+out vec2 sourceCoordinate;
+
+// part of the scene texture the scene was drawn into
+uniform vec2 sourceScale;
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    sourceCoordinate = corner * sourceScale;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -2,19 +2,48 @@
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance attributes streamed by the instanced draw path
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in ivec2 inInstanceIndices;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+flat out int fragmentTextureIndex;
+flat out int fragmentMaterialIndex;
+// distance in front of the camera, used to find the light cluster
+out float fragmentViewDepth;
+// the depth pre-pass and the shading pass build different variants of
+// this shader, and their depths have to be equal for GL_EQUAL to pass
+invariant gl_Position;
+
+// camera and light cluster values of the frame, declared the same in
+// both shaders and updated in one upload per frame
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    vec2 clusterTileScale;
+    float clusterDepthScale;
+    float clusterDepthBias;
+    int globalLightCount;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool bUseInstancing = false;
+uniform int objectTextureIndex = -1;
+uniform int objectMaterialIndex = 0;
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   mat4 objectModel = bUseInstancing ? inInstanceModel : model;
+
+   fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0));
+   vec4 viewPosition = view * vec4(fragmentPosition, 1.0);
+   fragmentViewDepth = -viewPosition.z;
+   gl_Position = projection * viewPosition;
    fragmentVertexNormal = inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentTextureIndex = bUseInstancing ? inInstanceIndices.y : objectTextureIndex;
+   fragmentMaterialIndex = bUseInstancing ? inInstanceIndices.x : objectMaterialIndex;
 }
\ No newline at end of file